@@ -0,0 +1,273 @@
+/*
+*******************************************************
+
+    Cadence Extended Truncated Balanced Realization
+                (*** CadETBR ***)
+
+*******************************************************
+*/
+
+/*
+ *    $RCSfile: SpMV_ccsr.cpp,v $
+ *    $Revision: 1.1 $
+ *    $Date: 2013/03/23 21:08:01 $
+ *
+ *    Functions: Index compressed CSR for the host iterative solver
+ *
+ *    A grid row has 5-7 entries close to its diagonal, so column j of
+ *    row i is stored as the offset j-i, which fits in 8 or 16 bits
+ *    (after -reorder almost always). The row itself is the base, no
+ *    column index is kept. The few entries farther away (branch rows,
+ *    package and via couplings) would force wide offsets on the whole
+ *    matrix, they are kept aside as (row, column) pairs in row order;
+ *    the width is the one that moves the fewest index bytes. The
+ *    kernels decode the offsets in the inner loop, they are
+ *    instantiated for every offset and value width.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+#include "SpMV_ccsr.h"
+
+using namespace std;
+
+typedef signed char     s8;
+typedef short           s16;
+typedef int             s32;
+typedef unsigned short  u16;
+typedef unsigned int    u32;
+
+struct CCSR {
+  int n, nnz;
+  int nnear, nfar;	/* entries within and beyond the offset width */
+  int dbytes;	/* 1, 2 or 4 bytes per offset */
+  int vtype;	/* CCSR_FLOAT, CCSR_BF16 or CCSR_DOUBLE */
+  vector<int> rowIndices;	/* of the near entries */
+  vector<char> delta;
+  vector<int> frow, fcol;	/* far entries, in row order */
+  /* values: the near entries, then the far ones */
+  vector<float> val;
+  vector<u16> hval;
+  vector<double> dval;
+};
+
+/* round to nearest even on the upper half of the float */
+static inline u16 to_bf16(float f)
+{
+  u32 u;
+  memcpy(&u, &f, 4);
+  u += 0x7fff + ((u >> 16) & 1);
+  return (u16)(u >> 16);
+}
+
+static inline float value(float v)
+{
+  return v;
+}
+
+static inline double value(double v)
+{
+  return v;
+}
+
+static inline float value(u16 h)
+{
+  u32 u = (u32)h << 16;
+  float f;
+  memcpy(&f, &u, 4);
+  return f;
+}
+
+/* sums in double for double values, in float otherwise */
+template <typename V> struct Acc { typedef float T; };
+template <> struct Acc<double> { typedef double T; };
+
+template <typename T>
+static CCSR *build(int n, const int *rowIndices, const int *indices, const T *val, int vtype)
+{
+  CCSR *A = new CCSR;
+  A->n = n;
+  A->nnz = rowIndices[n];
+  A->vtype = vtype;
+  /* index bytes of a width: offsets of the near entries plus a row and
+     a column for every far one; the diagonal is always near */
+  long n8 = 0, n16 = 0;
+  for (int i = 0; i < n; i++)
+    for (int j = rowIndices[i]; j < rowIndices[i+1]; j++){
+      int d = abs(indices[j] - i);
+      n8 += d < 128;
+      n16 += d < 32768;
+    }
+  double b8 = n8 + (A->nnz - n8)*8.0, b16 = n16*2.0 + (A->nnz - n16)*8.0, b32 = A->nnz*4.0;
+  A->dbytes = b8 <= b16 && b8 <= b32 ? 1 : (b16 <= b32 ? 2 : 4);
+  int lim = A->dbytes == 1 ? 128 : (A->dbytes == 2 ? 32768 : 0);
+
+  vector<int> order;	/* source entry of every stored value */
+  A->rowIndices.resize(n+1);
+  A->rowIndices[0] = 0;
+  for (int i = 0; i < n; i++){
+    for (int j = rowIndices[i]; j < rowIndices[i+1]; j++)
+      if (lim == 0 || abs(indices[j] - i) < lim)
+	order.push_back(j);
+    A->rowIndices[i+1] = order.size();
+  }
+  A->nnear = order.size();
+  A->delta.resize((size_t)A->nnear*A->dbytes + 1);
+  for (int i = 0; i < n; i++)
+    for (int k = A->rowIndices[i]; k < A->rowIndices[i+1]; k++){
+      int d = indices[order[k]] - i;
+      if (A->dbytes == 1)
+	((s8 *)&A->delta[0])[k] = (s8)d;
+      else if (A->dbytes == 2)
+	((s16 *)&A->delta[0])[k] = (s16)d;
+      else
+	((s32 *)&A->delta[0])[k] = d;
+    }
+  for (int i = 0; lim != 0 && i < n; i++)
+    for (int j = rowIndices[i]; j < rowIndices[i+1]; j++)
+      if (abs(indices[j] - i) >= lim){
+	A->frow.push_back(i);
+	A->fcol.push_back(indices[j]);
+	order.push_back(j);
+      }
+  A->nfar = A->frow.size();
+  A->frow.push_back(n);		/* sentinel */
+  A->fcol.push_back(0);
+
+  if (vtype == CCSR_BF16){
+    A->hval.resize(A->nnz + 1);
+    for (int k = 0; k < A->nnz; k++)
+      A->hval[k] = to_bf16((float)val[order[k]]);
+  }else if (vtype == CCSR_DOUBLE){
+    A->dval.resize(A->nnz + 1);
+    for (int k = 0; k < A->nnz; k++)
+      A->dval[k] = val[order[k]];
+  }else{
+    A->val.resize(A->nnz + 1);
+    for (int k = 0; k < A->nnz; k++)
+      A->val[k] = (float)val[order[k]];
+  }
+  return A;
+}
+
+CCSR *ccsr_build(int n, const int *rowIndices, const int *indices, const float *val, int vtype)
+{
+  return build(n, rowIndices, indices, val, vtype);
+}
+
+CCSR *ccsr_build(int n, const int *rowIndices, const int *indices, const double *val, int vtype)
+{
+  return build(n, rowIndices, indices, val, vtype);
+}
+
+template <typename D, typename V>
+static void spmv(const CCSR *A, const D *d, const V *v, float *x, const float *y)
+{
+  const int *rp = &A->rowIndices[0];
+  const int *fr = &A->frow[0], *fc = &A->fcol[0];
+  const V *fv = v + A->nnear;
+  int f = 0;
+  for (int i = 0; i < A->n; i++){
+    const float *yb = y + i;
+    typename Acc<V>::T t = 0.0;
+    for (int j = rp[i]; j < rp[i+1]; j++)
+      t += value(v[j]) * yb[d[j]];
+    for (; fr[f] == i; f++)
+      t += value(fv[f]) * y[fc[f]];
+    x[i] = t;
+  }
+}
+
+template <typename D, typename V>
+static void lsolve(const CCSR *A, const D *d, const V *v, float *x)
+{
+  const int *rp = &A->rowIndices[0];
+  const int *fr = &A->frow[0], *fc = &A->fcol[0];
+  const V *fv = v + A->nnear;
+  int f = 0;
+  for (int i = 0; i < A->n; i++){
+    const float *xb = x + i;
+    typename Acc<V>::T t = x[i];
+    int ub = rp[i+1];
+    for (int j = rp[i]; j < ub-1; j++)
+      t -= value(v[j]) * xb[d[j]];
+    for (; fr[f] == i; f++)
+      t -= value(fv[f]) * x[fc[f]];
+    x[i] = t / value(v[ub-1]);
+  }
+}
+
+template <typename D, typename V>
+static void usolve(const CCSR *A, const D *d, const V *v, float *x)
+{
+  const int *rp = &A->rowIndices[0];
+  const int *fr = &A->frow[0], *fc = &A->fcol[0];
+  const V *fv = v + A->nnear;
+  int f = A->nfar - 1;
+  for (int i = A->n-1; i >= 0; i--){
+    const float *xb = x + i;
+    typename Acc<V>::T t = x[i];
+    int lb = rp[i];
+    for (int j = lb+1; j < rp[i+1]; j++)
+      t -= value(v[j]) * xb[d[j]];
+    for (; f >= 0 && fr[f] == i; f--)
+      t -= value(fv[f]) * x[fc[f]];
+    x[i] = t / value(v[lb]);
+  }
+}
+
+/* call K<offset type, value type>(A, offsets, values, ...) */
+#define CCSR_CALL(K, A, ...)						\
+  do{									\
+    const void *dp = &(A)->delta[0];					\
+    if ((A)->vtype == CCSR_BF16){					\
+      const u16 *vp = &(A)->hval[0];					\
+      if ((A)->dbytes == 1) K(A, (const s8 *)dp, vp, __VA_ARGS__);	\
+      else if ((A)->dbytes == 2) K(A, (const s16 *)dp, vp, __VA_ARGS__); \
+      else K(A, (const s32 *)dp, vp, __VA_ARGS__);			\
+    }else if ((A)->vtype == CCSR_DOUBLE){				\
+      const double *vp = &(A)->dval[0];					\
+      if ((A)->dbytes == 1) K(A, (const s8 *)dp, vp, __VA_ARGS__);	\
+      else if ((A)->dbytes == 2) K(A, (const s16 *)dp, vp, __VA_ARGS__); \
+      else K(A, (const s32 *)dp, vp, __VA_ARGS__);			\
+    }else{								\
+      const float *vp = &(A)->val[0];					\
+      if ((A)->dbytes == 1) K(A, (const s8 *)dp, vp, __VA_ARGS__);	\
+      else if ((A)->dbytes == 2) K(A, (const s16 *)dp, vp, __VA_ARGS__); \
+      else K(A, (const s32 *)dp, vp, __VA_ARGS__);			\
+    }									\
+  }while(0)
+
+void ccsr_spmv(CCSR *A, float *x, const float *y)
+{
+  CCSR_CALL(spmv, A, x, y);
+}
+
+void ccsr_lsolve(CCSR *L, float *x)
+{
+  CCSR_CALL(lsolve, L, x);
+}
+
+void ccsr_usolve(CCSR *U, float *x)
+{
+  CCSR_CALL(usolve, U, x);
+}
+
+double ccsr_bytes(CCSR *A)
+{
+  int vbytes = A->vtype == CCSR_BF16 ? 2 : (A->vtype == CCSR_DOUBLE ? 8 : 4);
+  return (A->n+1)*4.0 + (double)A->nnear*A->dbytes + A->nfar*8.0 + (double)A->nnz*vbytes;
+}
+
+int ccsr_delta_bits(CCSR *A)
+{
+  return 8*A->dbytes;
+}
+
+void ccsr_free(CCSR *A)
+{
+  delete A;
+}
@@ -0,0 +1,55 @@
+/*
+*******************************************************
+
+    Cadence Extended Truncated Balanced Realization
+                (*** CadETBR ***)
+
+*******************************************************
+*/
+
+/*
+ *    $RCSfile: SpMV_ccsr.h,v $
+ *    $Revision: 1.1 $
+ *    $Date: 2013/03/23 21:08:01 $
+ *
+ *    Functions: Index compressed CSR for the host iterative solver header
+ *
+ */
+
+#ifndef SPMV_CCSR_H
+#define SPMV_CCSR_H
+
+/* SPMV_OPT_CCSR (-ccsr): the host GMRES matrix and the ILU factors keep
+   the 8/16 bit offset of each column from the diagonal instead of the
+   column index, the factor values stay double; with SPMV_OPT_BF16
+   (-ccsr_bf16) the factor values are rounded to bfloat16 */
+
+/* value storage of a CCSR matrix */
+#define CCSR_FLOAT   0
+#define CCSR_BF16    1	/* float range, 8 bit mantissa */
+#define CCSR_DOUBLE  2
+
+typedef struct CCSR CCSR;
+
+/* compress a square CSR matrix; the offsets take 1, 2 or 4 bytes,
+   the entries beyond that width keep their column index aside. The
+   values are stored as vtype, the sums run in double for CCSR_DOUBLE */
+CCSR *ccsr_build(int n, const int *rowIndices, const int *indices, const float *val, int vtype);
+CCSR *ccsr_build(int n, const int *rowIndices, const int *indices, const double *val, int vtype);
+
+/* x = A*y */
+void ccsr_spmv(CCSR *A, float *x, const float *y);
+
+/* x = L\x, the diagonal is the last entry of each row (ILU++ left factor) */
+void ccsr_lsolve(CCSR *L, float *x);
+
+/* x = U\x, the diagonal is the first entry of each row */
+void ccsr_usolve(CCSR *U, float *x);
+
+/* bytes of one pass over the matrix and its offset width in bits */
+double ccsr_bytes(CCSR *A);
+int ccsr_delta_bits(CCSR *A);
+
+void ccsr_free(CCSR *A);
+
+#endif
@@ -85,6 +85,7 @@ void LUSolve(float *x,
 		assert(u_indices[j] == i);// in the U matrix, the element in the diagonal should not be zero
 		x[i] /= u_val[j];
 	}
+	free(v);
 }
 
 
@@ -133,6 +134,7 @@ void LUSolve_ignoreZero(float *x,
 			x[i] /= u_val[j];
 		}
 	}
+	free(v);
 }
 
 
@@ -0,0 +1,221 @@
+/*
+*******************************************************
+
+    Cadence Extended Truncated Balanced Realization
+                (*** CadETBR ***)
+
+*******************************************************
+*/
+
+/*
+ *    $RCSfile: SpMV_stencil.cpp,v $
+ *    $Revision: 1.1 $
+ *    $Date: 2013/03/23 21:08:01 $
+ *
+ *    Functions: Stencil + CSR hybrid operator for regular mesh layers
+ *
+ *    A metal layer with uniform pitch and segment resistance gives
+ *    consecutive rows whose off-diagonal entries sit at the same column
+ *    offsets (+-1, +-row length) with the same values. Such a run keeps
+ *    its offsets and coefficients once; only the diagonal (which also
+ *    carries the vias, pads and C/h) is stored per row, and the entries
+ *    outside the stencil (vias, mesh edges, irregular rows) stay in CSR.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <map>
+#include <utility>
+#include <algorithm>
+#include "SpMV_stencil.h"
+
+using namespace std;
+
+#define STENCIL_WINDOW   8	/* rows voting for the stencil of a run */
+#define STENCIL_MIN_RUN  4	/* shorter runs go to the CSR part */
+
+struct STENCIL {
+  int n;
+  vector<float> diag;
+  /* rows run_row[r]..run_row[r+1]-1 share soff/scoef[run_sp[r]..run_sp[r+1]-1] */
+  vector<int> run_row, run_sp, soff;
+  vector<float> scoef;
+  /* the rest of the off-diagonal entries, only for the rows that have some:
+     row rrow[q] holds ci/rv[rp[q]..rp[q+1]-1] */
+  vector<int> rrow, rp, ci;
+  vector<float> rv;
+  long covered, offdiag;
+};
+
+typedef pair<int, float> entry;
+
+/* does row i hold every (offset, value) of s? */
+static bool row_has(const int *rowIndices, const int *indices, const float *val,
+		    int i, const vector<entry> &s)
+{
+  for (size_t k = 0; k < s.size(); k++){
+    int c = i + s[k].first;
+    bool found = false;
+    for (int j = rowIndices[i]; j < rowIndices[i+1]; j++)
+      if (indices[j] == c && val[j] == s[k].second){
+	found = true;
+	break;
+      }
+    if (!found)
+      return false;
+  }
+  return true;
+}
+
+/* the pairs found in most rows of the window starting at row i */
+static void vote(const int *rowIndices, const int *indices, const float *val,
+		 int n, int i, vector<entry> &s)
+{
+  map<entry, int> count;
+  int last = min(n, i+STENCIL_WINDOW);
+  for (int r = i; r < last; r++)
+    for (int j = rowIndices[r]; j < rowIndices[r+1]; j++)
+      if (indices[j] != r)
+	count[entry(indices[j]-r, val[j])]++;
+  s.clear();
+  for (map<entry, int>::iterator it = count.begin(); it != count.end(); ++it)
+    if (2*it->second > last-i)
+      s.push_back(it->first);
+}
+
+STENCIL *stencil_build(int n, const int *rowIndices, const int *indices, const float *val)
+{
+  STENCIL *S = new STENCIL;
+  S->n = n;
+  S->diag.assign(n, 0.0);
+  S->run_row.push_back(0);
+  S->run_sp.push_back(0);
+  S->rp.push_back(0);
+  S->covered = 0;
+  S->offdiag = 0;
+
+  vector<entry> s;
+  int i = 0;
+  while (i < n){
+    vote(rowIndices, indices, val, n, i, s);
+    int end = i;
+    if (s.size() >= 2)
+      while (end < n && row_has(rowIndices, indices, val, end, s))
+	end++;
+    if (end - i < STENCIL_MIN_RUN){
+      /* irregular rows: a run with an empty stencil, merged with the previous one */
+      end = max(end, i+1);
+      s.clear();
+      if (S->run_row.size() > 1 && S->run_sp[S->run_sp.size()-1] == S->run_sp[S->run_sp.size()-2]){
+	S->run_row.back() = end;
+      }else{
+	S->run_row.push_back(end);
+	S->run_sp.push_back(S->soff.size());
+      }
+    }else{
+      for (size_t k = 0; k < s.size(); k++){
+	S->soff.push_back(s[k].first);
+	S->scoef.push_back(s[k].second);
+      }
+      S->run_row.push_back(end);
+      S->run_sp.push_back(S->soff.size());
+    }
+
+    /* split the rows: diagonal, stencil (each pair once), CSR rest */
+    for (int r = i; r < end; r++){
+      vector<char> used(s.size(), 0);
+      size_t nrest = S->ci.size();
+      for (int j = rowIndices[r]; j < rowIndices[r+1]; j++){
+	if (indices[j] == r){
+	  S->diag[r] += val[j];
+	  continue;
+	}
+	S->offdiag++;
+	size_t k = 0;
+	for (; k < s.size(); k++)
+	  if (!used[k] && indices[j]-r == s[k].first && val[j] == s[k].second)
+	    break;
+	if (k < s.size()){
+	  used[k] = 1;
+	  S->covered++;
+	}else{
+	  S->ci.push_back(indices[j]);
+	  S->rv.push_back(val[j]);
+	}
+      }
+      if (S->ci.size() > nrest){
+	S->rrow.push_back(r);
+	S->rp.push_back(S->ci.size());
+      }
+    }
+    i = end;
+  }
+  S->rrow.push_back(0);
+  S->ci.push_back(0);
+  S->rv.push_back(0.0);
+  S->soff.push_back(0);
+  S->scoef.push_back(0.0);
+
+  if (2*S->covered < S->offdiag){
+    delete S;
+    return NULL;
+  }
+  return S;
+}
+
+/* NS >= 0: the stencil size is a constant, the k loop unrolls and the
+   row loop vectorizes (every row of the run reads the same offsets) */
+template <int NS>
+static void run_kernel(const STENCIL *S, int r, float *x, const float *y)
+{
+  const int *off = &S->soff[S->run_sp[r]];
+  const float *c = &S->scoef[S->run_sp[r]];
+  int ns = NS >= 0 ? NS : S->run_sp[r+1] - S->run_sp[r];
+  const float *diag = &S->diag[0];
+  for (int i = S->run_row[r]; i < S->run_row[r+1]; i++){
+    float t = diag[i] * y[i];
+    for (int k = 0; k < ns; k++)
+      t += c[k] * y[i+off[k]];
+    x[i] = t;
+  }
+}
+
+void stencil_spmv(STENCIL *S, float *x, const float *y)
+{
+  int nrun = S->run_row.size()-1;
+  for (int r = 0; r < nrun; r++){
+    switch (S->run_sp[r+1] - S->run_sp[r]){
+    case 0:  run_kernel<0>(S, r, x, y); break;
+    case 2:  run_kernel<2>(S, r, x, y); break;
+    case 3:  run_kernel<3>(S, r, x, y); break;
+    case 4:  run_kernel<4>(S, r, x, y); break;
+    case 6:  run_kernel<6>(S, r, x, y); break;
+    default: run_kernel<-1>(S, r, x, y);
+    }
+  }
+  const int *rrow = &S->rrow[0], *rp = &S->rp[0], *ci = &S->ci[0];
+  const float *rv = &S->rv[0];
+  int nrest = S->rp.size()-1;
+  for (int q = 0; q < nrest; q++){
+    float t = 0.0;
+    for (int j = rp[q]; j < rp[q+1]; j++)
+      t += rv[j] * y[ci[j]];
+    x[rrow[q]] += t;
+  }
+}
+
+double stencil_coverage(STENCIL *S)
+{
+  return S->offdiag > 0 ? (double)S->covered/S->offdiag : 0.0;
+}
+
+int stencil_runs(STENCIL *S)
+{
+  return S->run_row.size()-1;
+}
+
+void stencil_free(STENCIL *S)
+{
+  delete S;
+}
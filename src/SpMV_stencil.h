@@ -0,0 +1,42 @@
+/*
+*******************************************************
+
+    Cadence Extended Truncated Balanced Realization
+                (*** CadETBR ***)
+
+*******************************************************
+*/
+
+/*
+ *    $RCSfile: SpMV_stencil.h,v $
+ *    $Revision: 1.1 $
+ *    $Date: 2013/03/23 21:08:01 $
+ *
+ *    Functions: Stencil + CSR hybrid operator for regular mesh layers header
+ *
+ */
+
+#ifndef SPMV_STENCIL_H
+#define SPMV_STENCIL_H
+
+/* SPMV_OPT_STENCIL (-stencil): the host GMRES matrix is applied as
+   stencil runs for the regular mesh rows and CSR for the vias and
+   irregular rows */
+
+typedef struct STENCIL STENCIL;
+
+/* find the runs of consecutive rows that have the same off-diagonal
+   (column offset, value) pairs, i.e. rows of a uniform mesh layer;
+   NULL if they hold less than half of the off-diagonal entries */
+STENCIL *stencil_build(int n, const int *rowIndices, const int *indices, const float *val);
+
+/* x = A*y */
+void stencil_spmv(STENCIL *S, float *x, const float *y);
+
+/* fraction of the off-diagonal entries covered by the runs, number of runs */
+double stencil_coverage(STENCIL *S);
+int stencil_runs(STENCIL *S);
+
+void stencil_free(STENCIL *S);
+
+#endif
@@ -0,0 +1,466 @@
+/*
+*******************************************************
+
+    Cadence Extended Truncated Balanced Realization
+                (*** CadETBR ***)
+
+*******************************************************
+*/
+
+/*
+ *    $RCSfile: SpMV_tune.cpp,v $
+ *    $Revision: 1.1 $
+ *    $Date: 2013/03/23 21:08:01 $
+ *
+ *    Functions: Runtime selection of the host SpMV format
+ *
+ *    The BCSR_* and PADDED_CSR macros of config.h fix the format when the
+ *    GPU kernels are compiled. On the host the format is picked here
+ *    instead: each candidate is built from the CSR matrix and timed on it,
+ *    and the fastest one is kept for every later matrix of the analysis
+ *    with the same sparsity pattern. The plans belong to the analysis
+ *    (SpMVCache), so analyses running at the same time do not share them.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <vector>
+#include <algorithm>
+#include "SpMV_tune.h"
+#include "SpMV_ccsr.h"
+#include "SpMV_stencil.h"
+
+using namespace std;
+
+#define SELL_C      8      /* rows per chunk, one SIMD lane each */
+#define SELL_SIGMA  256    /* rows are sorted by length inside windows of SELL_SIGMA */
+#define BCSR_MAX_FILL  2.0 /* skip block sizes that store more than twice nnz */
+#define SPMV_TIME   2.0    /* ms spent timing each candidate */
+
+struct SpMVPlan {
+  int format, R, C;
+  int opt;               /* SPMV_OPT_* it was planned with */
+  int n, nnz;
+  unsigned long skey;     /* hash of the pattern, computed once per spmv_plan */
+  char name[32];
+  /* CSR: the caller's arrays, refreshed by every spmv_plan */
+  const float *val;
+  const int *rowIndices, *indices;
+  /* BCSR: R*C row major values per block, bcol is the block column */
+  int nbr, nbc;
+  vector<int> brow, bcol;
+  vector<float> bval, ypad;
+  /* SELL-C-sigma: chunk ch holds sorted rows ch*C..ch*C+C-1 column major */
+  int nchunk;
+  vector<int> cptr, clen, perm, scol;
+  vector<float> sval;
+  /* CCSR: 8/16 bit offsets from the diagonal */
+  CCSR *cc;
+  /* STENCIL: mesh runs + CSR */
+  STENCIL *st;
+};
+
+struct SpMVCache {
+  vector<SpMVPlan*> plans;
+};
+
+static unsigned long hash_int(unsigned long h, const int *a, int n)
+{
+  for (int i = 0; i < n; i++)
+    h = (h ^ (unsigned int)a[i]) * 1099511628211UL;
+  return h;
+}
+
+static double wtime()
+{
+  timeval t;
+  gettimeofday(&t, NULL);
+  return t.tv_sec*1000.0 + t.tv_usec/1000.0;
+}
+
+static void csr_kernel(const SpMVPlan *P, float *x, const float *y)
+{
+  const float *val = P->val;
+  const int *rowIndices = P->rowIndices, *indices = P->indices;
+  for (int i = 0; i < P->n; i++){
+    float t = 0.0;
+    for (int j = rowIndices[i]; j < rowIndices[i+1]; j++)
+      t += val[j] * y[indices[j]];
+    x[i] = t;
+  }
+}
+
+/* R and C are constants here so the block loops unroll */
+template <int R, int C>
+static void bcsr_kernel(SpMVPlan *P, float *x, const float *y)
+{
+  int n = P->n;
+  const float *yp = y;
+  if (n % C){
+    memcpy(&P->ypad[0], y, n*sizeof(float));
+    yp = &P->ypad[0];
+  }
+  const int *brow = &P->brow[0], *bcol = &P->bcol[0];
+  const float *bval = &P->bval[0];
+  for (int br = 0; br < P->nbr; br++){
+    float t[R];
+    for (int r = 0; r < R; r++) t[r] = 0.0;
+    for (int k = brow[br]; k < brow[br+1]; k++){
+      const float *b = bval + k*R*C;
+      const float *yc = yp + bcol[k]*C;
+      for (int r = 0; r < R; r++)
+	for (int c = 0; c < C; c++)
+	  t[r] += b[r*C+c] * yc[c];
+    }
+    int r0 = br*R, rn = min(R, n-r0);
+    for (int r = 0; r < rn; r++) x[r0+r] = t[r];
+  }
+}
+
+static void sell_kernel(const SpMVPlan *P, float *x, const float *y)
+{
+  const int *cptr = &P->cptr[0], *clen = &P->clen[0], *perm = &P->perm[0];
+  const int *scol = &P->scol[0];
+  const float *sval = &P->sval[0];
+  for (int ch = 0; ch < P->nchunk; ch++){
+    float t[SELL_C];
+    for (int l = 0; l < SELL_C; l++) t[l] = 0.0;
+    const int *col = scol + cptr[ch];
+    const float *v = sval + cptr[ch];
+    for (int j = 0; j < clen[ch]; j++, col += SELL_C, v += SELL_C)
+      for (int l = 0; l < SELL_C; l++)
+	t[l] += v[l] * y[col[l]];
+    int r0 = ch*SELL_C, rn = min(SELL_C, P->n-r0);
+    for (int l = 0; l < rn; l++) x[perm[r0+l]] = t[l];
+  }
+}
+
+/* number of R x C blocks, -1 if the fill is above BCSR_MAX_FILL */
+static long bcsr_count(const int *rowIndices, const int *indices, int n, int R, int C)
+{
+  int nbc = (n+C-1)/C;
+  vector<int> mark(nbc, -1);
+  long nb = 0;
+  for (int br = 0; br*R < n; br++)
+    for (int i = br*R; i < min(n, br*R+R); i++)
+      for (int j = rowIndices[i]; j < rowIndices[i+1]; j++){
+	int bc = indices[j]/C;
+	if (mark[bc] != br){
+	  mark[bc] = br;
+	  nb++;
+	}
+      }
+  if ((double)nb*R*C > BCSR_MAX_FILL*rowIndices[n])
+    return -1;
+  return nb;
+}
+
+static void bcsr_build(SpMVPlan *P, int fill_pattern)
+{
+  int n = P->n, R = P->R, C = P->C;
+  const int *rowIndices = P->rowIndices, *indices = P->indices;
+  vector<int> slot(P->nbc, -1);
+  if (fill_pattern){
+    P->brow.assign(P->nbr+1, 0);
+    P->bcol.clear();
+    for (int br = 0; br < P->nbr; br++){
+      for (int i = br*R; i < min(n, br*R+R); i++)
+	for (int j = rowIndices[i]; j < rowIndices[i+1]; j++){
+	  int bc = indices[j]/C;
+	  if (slot[bc] < P->brow[br]){
+	    slot[bc] = P->bcol.size();
+	    P->bcol.push_back(bc);
+	  }
+	}
+      P->brow[br+1] = P->bcol.size();
+    }
+    if (n % C) P->ypad.assign(P->nbc*C, 0.0);
+    slot.assign(P->nbc, -1);
+  }
+  P->bval.assign(P->bcol.size()*R*C, 0.0);
+  for (int br = 0; br < P->nbr; br++){
+    for (int k = P->brow[br]; k < P->brow[br+1]; k++)
+      slot[P->bcol[k]] = k;
+    for (int i = br*R; i < min(n, br*R+R); i++)
+      for (int j = rowIndices[i]; j < rowIndices[i+1]; j++){
+	int c = indices[j];
+	P->bval[slot[c/C]*R*C + (i-br*R)*C + c%C] += P->val[j];
+      }
+  }
+}
+
+struct row_longer {
+  const int *len;
+  bool operator()(int a, int b) const { return len[a] > len[b]; }
+};
+
+static void sell_build(SpMVPlan *P, int fill_pattern)
+{
+  int n = P->n;
+  const int *rowIndices = P->rowIndices, *indices = P->indices;
+  if (fill_pattern){
+    vector<int> len(n);
+    for (int i = 0; i < n; i++) len[i] = rowIndices[i+1]-rowIndices[i];
+    P->perm.resize(n);
+    for (int i = 0; i < n; i++) P->perm[i] = i;
+    row_longer cmp = { &len[0] };
+    for (int s = 0; s < n; s += SELL_SIGMA)
+      stable_sort(P->perm.begin()+s, P->perm.begin()+min(n, s+SELL_SIGMA), cmp);
+    P->nchunk = (n+SELL_C-1)/SELL_C;
+    P->cptr.resize(P->nchunk+1);
+    P->clen.resize(P->nchunk);
+    P->cptr[0] = 0;
+    for (int ch = 0; ch < P->nchunk; ch++){
+      int w = 0;
+      for (int r = ch*SELL_C; r < min(n, ch*SELL_C+SELL_C); r++)
+	w = max(w, len[P->perm[r]]);
+      P->clen[ch] = w;
+      P->cptr[ch+1] = P->cptr[ch] + w*SELL_C;
+    }
+    /* padding points at row 0 of y with a zero value */
+    P->scol.assign(P->cptr[P->nchunk], 0);
+    for (int ch = 0; ch < P->nchunk; ch++)
+      for (int r = ch*SELL_C; r < min(n, ch*SELL_C+SELL_C); r++){
+	int i = P->perm[r], l = r-ch*SELL_C;
+	for (int j = rowIndices[i]; j < rowIndices[i+1]; j++)
+	  P->scol[P->cptr[ch] + (j-rowIndices[i])*SELL_C + l] = indices[j];
+      }
+  }
+  P->sval.assign(P->cptr[P->nchunk], 0.0);
+  for (int ch = 0; ch < P->nchunk; ch++)
+    for (int r = ch*SELL_C; r < min(n, ch*SELL_C+SELL_C); r++){
+      int i = P->perm[r], l = r-ch*SELL_C;
+      for (int j = rowIndices[i]; j < rowIndices[i+1]; j++)
+	P->sval[P->cptr[ch] + (j-rowIndices[i])*SELL_C + l] = P->val[j];
+    }
+}
+
+static void plan_build(SpMVPlan *P, int fill_pattern)
+{
+  if (P->format == SPMV_BCSR){
+    if (fill_pattern){
+      P->nbr = (P->n+P->R-1)/P->R;
+      P->nbc = (P->n+P->C-1)/P->C;
+    }
+    bcsr_build(P, fill_pattern);
+  }
+  else if (P->format == SPMV_SELL)
+    sell_build(P, fill_pattern);
+  else if (P->format == SPMV_CCSR){
+    if (P->cc) ccsr_free(P->cc);
+    P->cc = ccsr_build(P->n, P->rowIndices, P->indices, P->val, CCSR_FLOAT);
+  }
+  else if (P->format == SPMV_STENCIL){
+    if (P->st) stencil_free(P->st);
+    P->st = stencil_build(P->n, P->rowIndices, P->indices, P->val);
+    if (P->st == NULL)	/* no mesh (any more) */
+      P->format = SPMV_CSR;
+  }
+}
+
+static void plan_release(SpMVPlan *P)
+{
+  vector<int>().swap(P->brow);  vector<int>().swap(P->bcol);
+  vector<float>().swap(P->bval);  vector<float>().swap(P->ypad);
+  vector<int>().swap(P->cptr);  vector<int>().swap(P->clen);
+  vector<int>().swap(P->perm);  vector<int>().swap(P->scol);
+  vector<float>().swap(P->sval);
+  if (P->cc) ccsr_free(P->cc);
+  if (P->st) stencil_free(P->st);
+  P->cc = NULL;
+  P->st = NULL;
+}
+
+void spmv_run(SpMVPlan *P, float *x, const float *y)
+{
+  if (P->format == SPMV_SELL)
+    sell_kernel(P, x, y);
+  else if (P->format == SPMV_CCSR)
+    ccsr_spmv(P->cc, x, y);
+  else if (P->format == SPMV_STENCIL)
+    stencil_spmv(P->st, x, y);
+  else if (P->format == SPMV_BCSR){
+    switch (P->R*8 + P->C){
+    case 1*8+2: bcsr_kernel<1,2>(P, x, y); break;
+    case 2*8+1: bcsr_kernel<2,1>(P, x, y); break;
+    case 2*8+2: bcsr_kernel<2,2>(P, x, y); break;
+    case 4*8+1: bcsr_kernel<4,1>(P, x, y); break;
+    case 1*8+4: bcsr_kernel<1,4>(P, x, y); break;
+    case 4*8+4: bcsr_kernel<4,4>(P, x, y); break;
+    default:    csr_kernel(P, x, y);
+    }
+  }
+  else
+    csr_kernel(P, x, y);
+}
+
+/* best time of a few batches of runs, in ms per SpMV */
+static double plan_time(SpMVPlan *P, float *x, const float *y, int reps)
+{
+  double best = 1e30;
+  for (int k = 0; k < 3; k++){
+    double t0 = wtime();
+    for (int r = 0; r < reps; r++)
+      spmv_run(P, x, y);
+    best = min(best, (wtime()-t0)/reps);
+  }
+  return best;
+}
+
+static void plan_name(SpMVPlan *P);
+
+static void plan_tune(SpMVPlan *P)
+{
+  static const int blocks[6][2] = { {1,2}, {2,1}, {2,2}, {4,1}, {1,4}, {4,4} };
+  int n = P->n;
+  vector<float> x(n), y(n);
+  for (int i = 0; i < n; i++) y[i] = 1.0 + (i % 7)*0.125;
+
+  P->format = SPMV_CSR;
+  P->R = P->C = 1;
+  double t0 = wtime();
+  spmv_run(P, &x[0], &y[0]);
+  double once = wtime()-t0;
+  int reps = once > 0 ? (int)(SPMV_TIME/once) : 100;
+  reps = max(2, min(reps, 200));
+  double t_csr = plan_time(P, &x[0], &y[0], reps);
+  double t_best = t_csr;
+  int best_format = SPMV_CSR, best_R = 1, best_C = 1;
+
+  for (int b = 0; b < 9; b++){
+    if (b == 7 && !(P->opt & SPMV_OPT_CCSR))
+      continue;
+    if (b < 6){
+      if (bcsr_count(P->rowIndices, P->indices, n, blocks[b][0], blocks[b][1]) < 0)
+	continue;
+      P->format = SPMV_BCSR;
+      P->R = blocks[b][0];
+      P->C = blocks[b][1];
+    }
+    else if (b == 6){
+      P->format = SPMV_SELL;
+      P->R = 1;
+      P->C = SELL_C;
+    }
+    else{
+      P->format = b == 7 ? SPMV_CCSR : SPMV_STENCIL;
+      P->R = P->C = 1;
+    }
+    plan_build(P, 1);
+    if (P->format == SPMV_CSR)
+      continue;
+    double t = plan_time(P, &x[0], &y[0], reps);
+    if (t < t_best){
+      t_best = t;
+      best_format = P->format;
+      best_R = P->R;
+      best_C = P->C;
+    }
+    plan_release(P);
+  }
+
+  P->format = best_format;
+  P->R = best_R;
+  P->C = best_C;
+  if (P->format != SPMV_CSR)
+    plan_build(P, 1);
+  plan_name(P);
+  printf("SpMV format for n=%d nnz=%d: %s (%.4f ms, CSR %.4f ms)\n",
+	 n, P->nnz, P->name, t_best, t_csr);
+}
+
+static void plan_name(SpMVPlan *P)
+{
+  if (P->format == SPMV_BCSR)
+    sprintf(P->name, "BCSR %dx%d", P->R, P->C);
+  else if (P->format == SPMV_SELL)
+    sprintf(P->name, "SELL-%d-%d", SELL_C, SELL_SIGMA);
+  else if (P->format == SPMV_CCSR)
+    sprintf(P->name, "CCSR-%d", ccsr_delta_bits(P->cc));
+  else if (P->format == SPMV_STENCIL)
+    sprintf(P->name, "stencil %.0f%% + CSR", 100*stencil_coverage(P->st));
+  else
+    strcpy(P->name, "CSR");
+}
+
+SpMVCache *spmv_cache_new()
+{
+  return new SpMVCache;
+}
+
+void spmv_cache_free(SpMVCache *cache)
+{
+  if (cache == NULL)
+    return;
+  for (size_t k = 0; k < cache->plans.size(); k++){
+    plan_release(cache->plans[k]);
+    delete cache->plans[k];
+  }
+  delete cache;
+}
+
+SpMVPlan *spmv_plan(SpMVCache *cache, const float *val, const int *rowIndices,
+		    const int *indices, const int numRows, int opt)
+{
+  int nnz = rowIndices[numRows];
+  unsigned long skey = hash_int(hash_int(14695981039346656037UL, rowIndices, numRows+1),
+				indices, nnz);
+  vector<SpMVPlan*> &plans = cache->plans;
+  SpMVPlan *P = NULL;
+  for (size_t k = 0; k < plans.size(); k++)
+    if (plans[k]->n == numRows && plans[k]->nnz == nnz && plans[k]->skey == skey &&
+	plans[k]->opt == opt){
+      P = plans[k];
+      break;
+    }
+  int fresh = (P == NULL);
+  if (fresh){
+    P = new SpMVPlan;
+    P->opt = opt;
+    P->n = numRows;
+    P->nnz = nnz;
+    P->skey = skey;
+    P->cc = NULL;
+    P->st = NULL;
+    plans.push_back(P);
+  }
+  P->val = val;
+  P->rowIndices = rowIndices;
+  P->indices = indices;
+  if (fresh && !(opt & SPMV_OPT_TUNE)){
+    /* -stencil or -ccsr alone, no timing */
+    P->R = P->C = 1;
+    P->format = SPMV_CSR;
+    if (opt & SPMV_OPT_STENCIL){
+      P->format = SPMV_STENCIL;
+      plan_build(P, 1);
+    }
+    if (P->format == SPMV_CSR && (opt & SPMV_OPT_CCSR)){
+      P->format = SPMV_CCSR;
+      plan_build(P, 1);
+    }
+    plan_name(P);
+    if (P->format == SPMV_CCSR)
+      printf("SpMV format for n=%d nnz=%d: %s (%.0f -> %.0f bytes)\n", numRows, nnz, P->name,
+	     (numRows+1)*4.0 + nnz*8.0, ccsr_bytes(P->cc));
+    else if (P->format == SPMV_STENCIL)
+      printf("SpMV format for n=%d nnz=%d: %s in %d runs\n", numRows, nnz, P->name,
+	     stencil_runs(P->st));
+    else
+      printf("SpMV format for n=%d nnz=%d: CSR, no regular mesh found\n", numRows, nnz);
+  }
+  else if (fresh)
+    plan_tune(P);
+  else{
+    plan_build(P, 0);
+    plan_name(P);
+  }
+  return P;
+}
+
+const char *spmv_name(SpMVPlan *P)
+{
+  return P->name;
+}
@@ -0,0 +1,59 @@
+/*
+*******************************************************
+
+    Cadence Extended Truncated Balanced Realization
+                (*** CadETBR ***)
+
+*******************************************************
+*/
+
+/*
+ *    $RCSfile: SpMV_tune.h,v $
+ *    $Revision: 1.1 $
+ *    $Date: 2013/03/23 21:08:01 $
+ *
+ *    Functions: Runtime selection of the host SpMV format header
+ *
+ */
+
+#ifndef SPMV_TUNE_H
+#define SPMV_TUNE_H
+
+#define SPMV_CSR   0
+#define SPMV_BCSR  1
+#define SPMV_SELL  2
+#define SPMV_CCSR  3	/* SpMV_ccsr.h */
+#define SPMV_STENCIL 4	/* SpMV_stencil.h */
+
+/* bits of SOLVER_CTX::spmv_opt, 0: plain CSR (computeSpMV) */
+#define SPMV_OPT_TUNE     1	/* -spmvtune: time the candidate formats, keep the fastest */
+#define SPMV_OPT_CCSR     2	/* -ccsr: SpMV_ccsr.h, also for the ILU factors */
+#define SPMV_OPT_BF16     4	/* -ccsr_bf16: with CCSR, bfloat16 factor values */
+#define SPMV_OPT_STENCIL  8	/* -stencil: SpMV_stencil.h */
+
+typedef struct SpMVPlan SpMVPlan;
+
+/* the plans of one analysis (SOLVER_CTX::spmv_cache) */
+typedef struct SpMVCache SpMVCache;
+
+SpMVCache *spmv_cache_new();
+
+/* frees the plans too; called at the end of a solve */
+void spmv_cache_free(SpMVCache *cache);
+
+/* plan for x = A*y with A in CSR (val, rowIndices, indices), built once
+   per matrix, not per solve. The first call for a sparsity pattern times
+   CSR, BCSR 1x2..4x4, SELL-8-256, the mesh stencil and, with
+   SPMV_OPT_CCSR, CCSR (SPMV_OPT_STENCIL or SPMV_OPT_CCSR without
+   SPMV_OPT_TUNE take that format without timing); later calls with the
+   same pattern and opt reuse the winner and convert the new values.
+   Owned by the cache, valid until spmv_cache_free */
+SpMVPlan *spmv_plan(SpMVCache *cache, const float *val, const int *rowIndices,
+		    const int *indices, const int numRows, int opt);
+
+void spmv_run(SpMVPlan *P, float *x, const float *y);
+
+/* e.g. "BCSR 2x2" */
+const char *spmv_name(SpMVPlan *P);
+
+#endif
@@ -28,6 +28,7 @@
 #include "etbr.h"
 #include "etbr_dd.h"
 #include "cs.h"
+#include "direct_solver.h"
 
 using namespace itpp;
 
@@ -106,7 +107,8 @@ void dc_solver(cs_dl *G, cs_dl *B, Source *VS, int nVS, Source *IS, int nIS, vec
 
 void dc_dd_solver(cs_dl *G, cs_dl *B, Source *VS, int nVS, Source *IS, int nIS, vec &dc_value,
 				  int npart, UF_long *part_size, UF_long *node_part, 
-				  UF_long *mat_pinv, UF_long *mat_q)
+				  UF_long *mat_pinv, UF_long *mat_q, const DDSCRATCH &scratch,
+				  THREAD_POOL *pool)
 {
   Real_Timer form_dd_run_time, dd_solve_run_time;
   Real_Timer symbolic_runtime, numeric_runtime, solve_runtime;
@@ -181,7 +183,7 @@ void dc_dd_solver(cs_dl *G, cs_dl *B, Source *VS, int nVS, Source *IS, int nIS,
   cs_dl_spfree(A_dd);
   double *z_dd = new double[nDim];
   dd_solve_run_time.start();
-  dd_solve_ooc(npart, As, E, F, At, f, g, z_dd, symbolic_runtime, numeric_runtime, solve_runtime);
+  dd_solve_ooc(npart, As, E, F, At, f, g, z_dd, symbolic_runtime, numeric_runtime, solve_runtime, scratch, pool);
   dd_solve_run_time.stop();
 
   dc_value.set_size(nDim);
@@ -217,7 +219,8 @@ void dc_dd_solver(cs_dl *G, cs_dl *B, Source *VS, int nVS, Source *IS, int nIS,
   std::cout << "solve           \t: " << solve_runtime.get_time() << std::endl;
 }
 
-void dc_solver2(cs_dl *G, cs_dl *B, Source *VS, int nVS, Source *IS, int nIS, vec &dc_value)
+void dc_solver2(cs_dl *G, cs_dl *B, Source *VS, int nVS, Source *IS, int nIS, vec &dc_value, int solver,
+				THREAD_POOL *pool)
 {
   Real_Timer umfpack_symbolic, umfpack_numeric, umfpack_solve;
   Real_Timer umfpack_run_time, svd_run_time, rmatrix_run_time;
@@ -235,22 +238,10 @@ void dc_solver2(cs_dl *G, cs_dl *B, Source *VS, int nVS, Source *IS, int nIS, ve
   umfpack_run_time.start();
   UF_long nDim = B->m;
   UF_long nSDim = B->n;
-  cs_dls *Symbolic;
-  cs_dln *Numeric;
-  int order = 2;
-  double tol = 1e-14;
-  umfpack_symbolic.start();
-  Symbolic = cs_dl_sqr(order, G, 0);
-  umfpack_symbolic.stop();
-
+  DSOLVER ds;
   umfpack_numeric.start();
-  Numeric = cs_dl_lu(G, Symbolic, tol);
+  ds_factor(ds, G, solver, pool);
   umfpack_numeric.stop();
-  UF_long *Symbolic_q = new UF_long[G->n];
-  for (UF_long j = 0; j < G->n; j++){
-	Symbolic_q[j] = Symbolic->q[j];
-  }
-  cs_dl_sfree(Symbolic);
 
   /* solve Gx = Bu  */
   vec b(nDim);
@@ -261,12 +252,10 @@ void dc_solver2(cs_dl *G, cs_dl *B, Source *VS, int nVS, Source *IS, int nIS, ve
   umfpack_solve.start();
   dc_value.set_size(nDim);
   dc_value.zeros();
-  cs_dl_ipvec(Numeric->pinv, b._data(), x._data(), G->n);
-  cs_dl_lsolve(Numeric->L, x._data());
-  cs_dl_usolve(Numeric->U, x._data());
-  cs_dl_ipvec(Symbolic_q, x._data(), dc_value._data(), G->n);  
+  ds_solve(ds, b._data(), dc_value._data());
+  umfpack_solve.stop();
 
-  cs_dl_nfree(Numeric);
+  ds_free(ds);
   umfpack_run_time.stop();
 	
 #ifndef UCR_EXTERNAL
@@ -1,10 +1,30 @@
 #include <iostream>
 #include <fstream>
+#include <vector>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/types.h>
 #include "cs.h"
 #include "etbr_dd.h"
 
 using namespace std;
 
+void dd_scratch_init(DDSCRATCH &scratch)
+{
+  scratch.dir = "temp";
+  scratch.budget_mb = 0;
+  scratch.compress = 0;
+}
+
+string dd_scratch_path(const DDSCRATCH &scratch, const char *name)
+{
+  if (mkdir(scratch.dir.c_str(), 0755) != 0 && errno != EEXIST){
+	cout << "Can not create scratch directory " << scratch.dir << endl;
+	exit(-1);
+  }
+  return scratch.dir + "/" + name;
+}
+
 void numeric_dl_save(ofstream &file, cs_dln *N)
 {
   cs_dl *L = N->L;
@@ -58,3 +78,153 @@ void cs_dl_load(ifstream &file, cs_dl *&A)
   delete [] nzmax;
   delete [] nz;
 }
+
+double numeric_dl_bytes(cs_dln *N)
+{
+  double n = N->L->n;
+  double nnz = N->L->nzmax + N->U->nzmax;
+  return (2*(n+1) + n)*sizeof(UF_long) + nnz*(sizeof(UF_long) + sizeof(double));
+}
+
+/* packed factors: the column pointers and the row indices (as the
+   difference to the previous row of the column) are written as
+   variable length integers, 1-2 bytes instead of 8 on a grid */
+static void put_varint(vector<unsigned char> &buf, UF_long v)
+{
+  unsigned long u = ((unsigned long)v << 1) ^ (unsigned long)(v >> (8*sizeof(UF_long)-1));   /* zigzag */
+  while (u >= 0x80){
+	buf.push_back((unsigned char)(u | 0x80));
+	u >>= 7;
+  }
+  buf.push_back((unsigned char)u);
+}
+
+static UF_long get_varint(const unsigned char *&c)
+{
+  unsigned long u = 0;
+  int shift = 0;
+  while (*c & 0x80){
+	u |= (unsigned long)(*c++ & 0x7f) << shift;
+	shift += 7;
+  }
+  u |= (unsigned long)(*c++) << shift;
+  return (UF_long)(u >> 1) ^ -(UF_long)(u & 1);
+}
+
+static void cs_dl_save_packed(ofstream &file, cs_dl *A)
+{
+  vector<unsigned char> buf;
+  UF_long nnz = A->p[A->n];
+  buf.reserve(A->n + 2*nnz);
+  for (UF_long j = 0; j < A->n; j++){
+	put_varint(buf, A->p[j+1] - A->p[j]);
+	UF_long prev = j;
+	for (UF_long p = A->p[j]; p < A->p[j+1]; p++){
+	  put_varint(buf, A->i[p] - prev);
+	  prev = A->i[p];
+	}
+  }
+  UF_long nbuf = buf.size();
+  file.write((char *)&A->m, sizeof(UF_long));
+  file.write((char *)&A->n, sizeof(UF_long));
+  file.write((char *)&nnz, sizeof(UF_long));
+  file.write((char *)&nbuf, sizeof(UF_long));
+  file.write((char *)&buf[0], nbuf);
+  file.write((char *)A->x, sizeof(double)*nnz);
+}
+
+static void cs_dl_load_packed(ifstream &file, cs_dl *&A)
+{
+  UF_long m, n, nnz, nbuf;
+  file.read((char *)&m, sizeof(UF_long));
+  file.read((char *)&n, sizeof(UF_long));
+  file.read((char *)&nnz, sizeof(UF_long));
+  file.read((char *)&nbuf, sizeof(UF_long));
+  vector<unsigned char> buf(nbuf > 0 ? nbuf : 1);
+  file.read((char *)&buf[0], nbuf);
+  A = cs_dl_spalloc(m, n, nnz, 1, 0);
+  const unsigned char *c = &buf[0];
+  A->p[0] = 0;
+  for (UF_long j = 0; j < n; j++){
+	A->p[j+1] = A->p[j] + get_varint(c);
+	UF_long prev = j;
+	for (UF_long p = A->p[j]; p < A->p[j+1]; p++){
+	  prev += get_varint(c);
+	  A->i[p] = prev;
+	}
+  }
+  file.read((char *)A->x, sizeof(double)*nnz);
+}
+
+static void *dd_io_run(void *arg)
+{
+  DDIOJOB *job = (DDIOJOB *)arg;
+  if (job->save){
+	ofstream file(job->name.c_str(), ios::binary);
+	char packed = job->compress ? 1 : 0;
+	file.write(&packed, 1);
+	if (packed){
+	  UF_long n = job->N->L->n;
+	  cs_dl_save_packed(file, job->N->L);
+	  cs_dl_save_packed(file, job->N->U);
+	  file.write((char *)job->N->pinv, sizeof(UF_long)*n);
+	}else{
+	  numeric_dl_save(file, job->N);
+	}
+	file.close();
+	if (!file){
+	  cout << "Error writing " << job->name << endl;
+	  exit(-1);
+	}
+	cs_dl_nfree(job->N);
+	job->N = NULL;
+  }else{
+	ifstream file(job->name.c_str(), ios::binary);
+	if (!file){
+	  cout << "Can not open " << job->name << endl;
+	  exit(-1);
+	}
+	char packed = 0;
+	file.read(&packed, 1);
+	if (packed){
+	  job->N = (cs_dln *)cs_dl_calloc(1, sizeof(cs_dln));
+	  cs_dl_load_packed(file, job->N->L);
+	  cs_dl_load_packed(file, job->N->U);
+	  UF_long n = job->N->L->n;
+	  job->N->pinv = (UF_long *) cs_malloc (n, sizeof (UF_long));
+	  file.read((char *)job->N->pinv, sizeof(UF_long)*n);
+	}else{
+	  numeric_dl_load(file, job->N);
+	}
+	file.close();
+  }
+  return NULL;
+}
+
+void dd_io_start_save(DDIOJOB &job, const string &name, cs_dln *N, int compress)
+{
+  job.name = name;
+  job.N = N;
+  job.save = 1;
+  job.compress = compress;
+  job.active = 1;
+  pthread_create(&job.thread, NULL, dd_io_run, (void *)&job);
+}
+
+void dd_io_start_load(DDIOJOB &job, const string &name)
+{
+  job.name = name;
+  job.N = NULL;
+  job.save = 0;
+  job.active = 1;
+  pthread_create(&job.thread, NULL, dd_io_run, (void *)&job);
+}
+
+cs_dln *dd_io_wait(DDIOJOB &job)
+{
+  if (job.active){
+	pthread_join(job.thread, NULL);
+	job.active = 0;
+  }
+  return job.N;
+}
@@ -0,0 +1,166 @@
+/*
+*******************************************************
+
+    Cadence Extended Truncated Balanced Realization
+                (*** CadETBR ***)
+
+*******************************************************
+*/
+
+/*
+ *    $RCSfile: direct_solver.cpp,v $
+ *    $Revision: 1.1 $
+ *    $Date: 2013/03/23 21:08:01 $
+ *
+ *    Functions: Pluggable sparse direct solver
+ *
+ */
+
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include "umfpack.h"
+#include "cs.h"
+#include "direct_solver.h"
+#include "phase_timer.h"
+
+using namespace std;
+
+int ds_type(const char *name)
+{
+  if (strcmp(name, "csparse") == 0)
+	return DS_CSPARSE;
+  if (strcmp(name, "umfpack") == 0)
+	return DS_UMFPACK;
+  if (strcmp(name, "sn") == 0)
+	return DS_SUPERNODAL;
+  if (strcmp(name, "chol") == 0)
+	return DS_CHOL;
+  return -1;
+}
+
+static void umfpack_check(double *Control, double *Info, const char *phase)
+{
+  if (Info[0] == -1){
+	cout << "UMFPACK ERROR: " << phase << " out of memory" << endl;
+	umfpack_dl_report_info(Control, Info);
+	exit(-1);
+  }else if (Info[0] < 0){
+	cout << "Info[0] = " << Info[0] << endl;
+	umfpack_dl_report_info(Control, Info);
+	exit(-1);
+  }
+}
+
+/* A == A' up to rounding: inductor and voltage source rows of G are
+   skew (+1/-1), and sn_chol reads the lower triangle only */
+static int ds_symmetric(cs_dl *A)
+{
+  if (A->m != A->n)
+	return 0;
+  cs_dl *AT = cs_dl_transpose(A, 1);
+  cs_dl *D = cs_dl_add(A, AT, 1, -1);
+  double tol = 1e-12*cs_dl_norm(A), dmax = 0;
+  for (UF_long p = 0; p < D->p[D->n]; p++)
+	dmax = max(dmax, fabs(D->x[p]));
+  cs_dl_spfree(AT);
+  cs_dl_spfree(D);
+  return dmax <= tol;
+}
+
+static void csparse_factor(DSOLVER &ds, cs_dl *A)
+{
+  int order = 2;
+  double tol = 1e-14;
+  ds.type = DS_CSPARSE;
+  ds.S = cs_dl_sqr(order, A, 0);
+  ds.N = cs_dl_lu(A, ds.S, tol);
+  if (ds.N == NULL){
+	cout << "LU factorization failed: matrix is singular" << endl;
+	exit(-1);
+  }
+  ds.w = new double[ds.n];
+  phase_count("factor_nnz", (double)(ds.N->L->p[ds.n] + ds.N->U->p[ds.n]));
+}
+
+void ds_factor(DSOLVER &ds, cs_dl *A, int type, THREAD_POOL *pool)
+{
+  ds.type = type;
+  ds.n = A->n;
+  ds.S = NULL;
+  ds.N = NULL;
+  ds.A = NULL;
+  ds.Numeric = NULL;
+  ds.sn = NULL;
+  ds.w = NULL;
+  /* the factor size goes to the phase the caller has open */
+  phase_count("nnz", (double)A->p[A->n]);
+  if (ds.type == DS_UMFPACK){
+	void *Symbolic;
+	double Control[UMFPACK_CONTROL], Info[UMFPACK_INFO];
+	umfpack_dl_defaults(Control);
+	/* umfpack_dl_solve needs the matrix again */
+	ds.A = cs_dl_add(A, A, 1, 0);
+	(void) umfpack_dl_symbolic(A->m, A->n, ds.A->p, ds.A->i, ds.A->x, &Symbolic, Control, Info);
+	umfpack_check(Control, Info, "symbolic");
+	(void) umfpack_dl_numeric(ds.A->p, ds.A->i, ds.A->x, Symbolic, &ds.Numeric, Control, Info);
+	umfpack_check(Control, Info, "numeric");
+	umfpack_dl_free_symbolic(&Symbolic);
+	phase_count("factor_nnz", Info[UMFPACK_LNZ] + Info[UMFPACK_UNZ]);
+  }else if (ds.type == DS_SUPERNODAL || ds.type == DS_CHOL){
+	if (ds.type == DS_CHOL && !ds_symmetric(A)){
+	  cout << "Cholesky: matrix is not symmetric (inductors or voltage sources), using supernodal LU" << endl;
+	  ds.type = DS_SUPERNODAL;
+	}
+	if (ds.type == DS_CHOL){
+	  ds.sn = sn_chol(A, pool);
+	  if (ds.sn == NULL)
+		cout << "Cholesky: matrix is not positive definite (use -vsfold), using CSparse" << endl;
+	}else{
+	  ds.sn = sn_factor(A, pool);
+	  if (ds.sn == NULL)
+		cout << "Supernodal LU: zero pivot inside a supernode, using CSparse" << endl;
+	}
+	if (ds.sn == NULL)
+	  csparse_factor(ds, A);
+	else
+	  phase_count("factor_nnz", sn_nnz(ds.sn));
+  }else{
+	csparse_factor(ds, A);
+  }
+}
+
+void ds_solve(DSOLVER &ds, const double *b, double *x)
+{
+  if (ds.type == DS_UMFPACK){
+	double Control[UMFPACK_CONTROL], Info[UMFPACK_INFO];
+	umfpack_dl_defaults(Control);
+	(void) umfpack_dl_solve(UMFPACK_A, ds.A->p, ds.A->i, ds.A->x, x, b, ds.Numeric, Control, Info);
+	umfpack_check(Control, Info, "solve");
+  }else if (ds.type == DS_SUPERNODAL || ds.type == DS_CHOL){
+	sn_solve(ds.sn, b, x);
+  }else{
+	cs_dl_ipvec(ds.N->pinv, b, ds.w, ds.n);
+	cs_dl_lsolve(ds.N->L, ds.w);
+	cs_dl_usolve(ds.N->U, ds.w);
+	cs_dl_ipvec(ds.S->q, ds.w, x, ds.n);
+  }
+}
+
+void ds_free(DSOLVER &ds)
+{
+  if (ds.S) cs_dl_sfree(ds.S);
+  if (ds.N) cs_dl_nfree(ds.N);
+  if (ds.A) cs_dl_spfree(ds.A);
+  if (ds.Numeric) umfpack_dl_free_numeric(&ds.Numeric);
+  if (ds.sn) sn_free(ds.sn);
+  if (ds.w) delete [] ds.w;
+  ds.S = NULL;
+  ds.N = NULL;
+  ds.A = NULL;
+  ds.Numeric = NULL;
+  ds.sn = NULL;
+  ds.w = NULL;
+}
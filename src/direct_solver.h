@@ -0,0 +1,53 @@
+/*
+*******************************************************
+
+    Cadence Extended Truncated Balanced Realization
+                (*** CadETBR ***)
+
+*******************************************************
+*/
+
+/*
+ *    $RCSfile: direct_solver.h,v $
+ *    $Revision: 1.1 $
+ *    $Date: 2013/03/23 21:08:01 $
+ *
+ *    Functions: Pluggable sparse direct solver header
+ *
+ */
+
+#ifndef DIRECT_SOLVER_H
+#define DIRECT_SOLVER_H
+
+#include "cs.h"
+#include "supernodal.h"
+
+#define DS_CSPARSE    0		/* cs_dl_lu, left looking */
+#define DS_UMFPACK    1		/* unsymmetric multifrontal */
+#define DS_SUPERNODAL 2		/* supernodal multifrontal, threaded BLAS-3 fronts */
+#define DS_CHOL       3		/* supernodal Cholesky, SPD matrices (RC grids) */
+
+typedef struct{
+  int type;
+  UF_long n;
+  cs_dls *S;                 /* DS_CSPARSE */
+  cs_dln *N;
+  cs_dl *A;                  /* DS_UMFPACK, the factored matrix */
+  void *Numeric;
+  SNFACT *sn;                /* DS_SUPERNODAL, DS_CHOL */
+  double *w;
+}DSOLVER;
+
+/* parse the name given to -solver, -1 if unknown */
+int ds_type(const char *name);
+
+/* factor A with the DS_* backend type; the supernodal backends run on
+   pool (NULL: a pool of their own, see sn_factor) */
+void ds_factor(DSOLVER &ds, cs_dl *A, int type, THREAD_POOL *pool);
+
+/* x = A\b */
+void ds_solve(DSOLVER &ds, const double *b, double *x);
+
+void ds_free(DSOLVER &ds);
+
+#endif
@@ -0,0 +1,157 @@
+/*
+*******************************************************
+
+    Cadence Extended Truncated Balanced Realization
+                (*** CadETBR ***)
+
+*******************************************************
+*/
+
+/*
+ *    $RCSfile: ds_check.cpp,v $
+ *    $Revision: 1.1 $
+ *    $Date: 2013/03/23 21:08:01 $
+ *
+ *    Functions: Residual check of the direct solver backends
+ *
+ *    Writes a small RC mesh deck, once with package inductors from the
+ *    corners to the pads and once with resistors in their place, stamps
+ *    it with parser_wrapper and solves (G+C/h) x = b with every -solver
+ *    backend. The inductor rows make G+C/h unsymmetric, so -solver chol
+ *    has to fall back to LU there and keep the Cholesky factor on the
+ *    RC deck. Returns 1 if a residual is above the tolerance or a
+ *    backend was not the expected one; run with "make check".
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <vector>
+#include <string>
+#include "cs.h"
+#include "etbr.h"
+#include "etbr_wrapper.h"
+#include "direct_solver.h"
+
+using namespace std;
+
+#define MESH      10
+#define NPAD      4
+#define TOL       1e-10
+
+static void write_deck(const char *name, int inductors)
+{
+  FILE *f = fopen(name, "w");
+  if (f == NULL){
+	printf("Can not open %s.\n", name);
+	exit(-1);
+  }
+  fprintf(f, "* %dx%d mesh, %s to the pads\n", MESH, MESH, inductors ? "inductors" : "resistors");
+  long e = 0;
+  for (int y = 0; y < MESH; y++)
+	for (int x = 0; x < MESH; x++){
+	  if (x+1 < MESH)
+		fprintf(f, "R%ld n%d_%d n%d_%d %g\n", e++, x, y, x+1, y, 0.5 + 0.1*((x+y)%3));
+	  if (y+1 < MESH)
+		fprintf(f, "R%ld n%d_%d n%d_%d %g\n", e++, x, y, x, y+1, 0.5 + 0.1*((x*y)%4));
+	  fprintf(f, "C%ld n%d_%d 0 %g\n", e++, x, y, 1e-13);
+	}
+  int corner[NPAD][2] = {{0, 0}, {MESH-1, 0}, {0, MESH-1}, {MESH-1, MESH-1}};
+  for (int k = 0; k < NPAD; k++){
+	if (inductors)
+	  fprintf(f, "L%d n%d_%d p%d %g\n", k, corner[k][0], corner[k][1], k, 1e-10);
+	else
+	  fprintf(f, "R%ld n%d_%d p%d %g\n", e++, corner[k][0], corner[k][1], k, 0.05);
+	fprintf(f, "R%ld p%d 0 %g\n", e++, k, 0.01);
+  }
+  fprintf(f, "I0 n%d_%d 0 PWL(0 0 1e-10 0.1 2e-10 0)\n", MESH/2, MESH/2);
+  fprintf(f, "I1 n%d_%d 0 PWL(0 0 1e-10 0.05 2e-10 0)\n", MESH/3, 2*MESH/3);
+  fprintf(f, ".tran %g %g\n", 1e-11, 1e-9);
+  fprintf(f, ".print tran v(n%d_%d)\n", MESH/2, MESH/2);
+  fprintf(f, ".end\n");
+  fclose(f);
+}
+
+/* |A*x - b| / |b| in the max norm */
+static double residual(cs_dl *A, const vector<double> &x, const vector<double> &b)
+{
+  vector<double> r(b.size());
+  for (size_t i = 0; i < b.size(); i++)
+	r[i] = -b[i];
+  cs_dl_gaxpy(A, &x[0], &r[0]);
+  double rmax = 0, bmax = 0;
+  for (size_t i = 0; i < b.size(); i++){
+	rmax = max(rmax, fabs(r[i]));
+	bmax = max(bmax, fabs(b[i]));
+  }
+  return rmax/bmax;
+}
+
+static int check_deck(int inductors)
+{
+  char name[] = "/tmp/ds_check_XXXXXX";
+  int fd = mkstemp(name);
+  if (fd < 0){
+	printf("Can not create the deck.\n");
+	exit(-1);
+  }
+  close(fd);
+  write_deck(name, inductors);
+
+  cs_dl *Gs, *Cs, *Bs;
+  Source *VS, *IS;
+  int nVS, nIS, nNodes, nport, dc_sign;
+  double tstep, tstop;
+  vector<string> port_name, tc_name;
+  vector<int> tc_node;
+  ivec port;
+  gpuETBR myGPUetbr;
+  gpuRelatedDataInit(&myGPUetbr);
+  myGPUetbr.PWLcurExist = 0;  myGPUetbr.PULSEcurExist = 0;
+  myGPUetbr.PWLvolExist = 0;  myGPUetbr.PULSEvolExist = 0;
+  parser_wrapper(name, Gs, Cs, Bs, VS, nVS, IS, nIS, nNodes, nport, tstep, tstop,
+				 dc_sign, port_name, port, tc_node, tc_name, &myGPUetbr);
+  unlink(name);
+
+  cs_dl *A = cs_dl_add(Gs, Cs, 1, 1/tstep);
+  vector<double> b(A->n), x(A->n);
+  for (UF_long i = 0; i < A->n; i++)
+	b[i] = i < nNodes ? 1e-3*(1 + i%7) : 0;
+
+  static const char *names[] = {"csparse", "umfpack", "sn", "chol"};
+  int fail = 0;
+  for (int k = 0; k < 4; k++){
+	int type = ds_type(names[k]);
+	DSOLVER ds;
+	ds_factor(ds, A, type, NULL);
+	ds_solve(ds, &b[0], &x[0]);
+	double res = residual(A, x, b);
+	/* chol only keeps its factor on the symmetric (RC) deck */
+	int expect = type;
+	if (type == DS_CHOL && inductors)
+	  expect = DS_SUPERNODAL;
+	int ok = res <= TOL && ds.type == expect;
+	printf("%-10s %-8s backend %d residual %.3e %s\n", inductors ? "inductors" : "rc",
+		   names[k], ds.type, res, ok ? "ok" : "FAILED");
+	fail |= !ok;
+	ds_free(ds);
+  }
+
+  cs_dl_spfree(A);
+  cs_dl_spfree(Gs);
+  cs_dl_spfree(Cs);
+  cs_dl_spfree(Bs);
+  delete [] VS;
+  delete [] IS;
+  return fail;
+}
+
+int main(int argc, char *argv[])
+{
+  int fail = check_deck(0);
+  fail |= check_deck(1);
+  printf(fail ? "ds_check FAILED\n" : "ds_check passed\n");
+  return fail;
+}
@@ -24,8 +24,12 @@
 #include <itpp/base/smat.h>
 #include <itpp/base/mat.h>
 #include <vector>
+#include <string>
 #include "cs.h"
 #include "gpuData.h"
+#include "thread_pool.h"
+#include "gmres_log.h"
+#include "SpMV_tune.h"
 
 using namespace itpp;
 using namespace std;
@@ -44,11 +48,70 @@ typedef struct{
   vec *zvec;
 }AXBDATA;
 
-// #define NUM_THREADS 20
-// pthread_t threads[NUM_THREADS];
-//pthread_mutex_t mutexz;
+/* where the out-of-core DD keeps its files */
+typedef struct{
+  string dir;        /* scratch directory, default "temp" */
+  double budget_mb;  /* factors beyond this stay in memory, 0 = no limit */
+  int compress;      /* pack the indices of the spilled factors */
+}DDSCRATCH;
+
+/* the defaults: "temp", no budget, no packing */
+void dd_scratch_init(DDSCRATCH &scratch);
+
+/* the state of one analysis: analyses with their own context can run
+   at the same time in one process and share a thread pool */
+typedef struct{
+  AXBDATA axb;                  /* the frequency sample solves of -mt */
+  double ilu_threshold;         /* ILU++ pivot threshold and memory factor */
+  double ilu_factor;            /* of the -gmres preconditioner */
+  THREAD_POOL *pool;            /* NULL: a thread per sample */
+  int integ_method;             /* INTEG_* of the fixed step transient (-integ) */
+  int direct_solver;            /* DS_* backend of the direct solves (-solver) */
+  int spmv_opt;                 /* SPMV_OPT_* of the host GMRES (SpMV_tune.h) */
+  SpMVCache *spmv_cache;        /* its plans, for the length of a GMRES solve */
+  DDSCRATCH dd_scratch;         /* files of the out-of-core DD */
+  GMRES_LOG *gmres_log;         /* -gmres_log, NULL: the solves are not logged */
+}SOLVER_CTX;
+
+/* one solve_axb task: sample i of the context */
+typedef struct{
+  SOLVER_CTX *ctx;
+  int i;
+}AXBTASK;
 
+void solver_ctx_init(SOLVER_CTX *ctx);
 
+/* reduced order model persisted by -rom_save / -rom_load */
+typedef struct{
+  int q;
+  UF_long nDim;                 /* order of the full model */
+  int nVS;
+  int nIS;
+  double tstep;                 /* time step and stop time used for the reduction */
+  double tstop;
+  double max_i;
+  int max_i_idx;
+  int fft_n;                    /* frequency sampling of etbr2 */
+  double f_min;
+  double f_max;
+  mat Gr;
+  mat Cr;
+  mat Br;
+  mat Dr;                       /* dc start of reduced_transim2, X'*x(0) = Dr*u(0) */
+  mat Xp;                       /* rows of X at the ports */
+  mat Xc;                       /* rows of X at the tap nodes */
+  vector<string> port_name;
+  vector<string> tc_name;
+  vector<int> is_map;           /* -iscluster: column of each current source, */
+  vector<double> is_coef;       /* and its weight; empty without clustering */
+}ROMDATA;
+
+
+/* frequency sampling of etbr2, etbr2_thread and gpu_etbr_thread: the
+   sources are transformed with ETBR_FFT_N points and the samples are
+   spread in log scale over [f_min, f_max] */
+#define ETBR_FFT_N 1024
+void etbr_sampling(double tstep, int &fft_n, double &f_min, double &f_max);
 
 void etbr(sparse_mat &G, sparse_mat &C, sparse_mat &B, 
 		  Source *VS, int nVS, Source *IS, int nIS, 
@@ -68,7 +131,8 @@ void etbr2(cs_dl *G, cs_dl *C, cs_dl *B,
 void etbr2(cs_dl *G, cs_dl *C, cs_dl *B, 
 		   Source *VS, int nVS, Source *IS, int nIS, 
 		   double tstep, double tstop, int q, 
-		   mat &Gr, mat &Cr, mat &Br, mat &X, double &max_i, int &max_i_idx);
+		   mat &Gr, mat &Cr, mat &Br, mat &X, double &max_i, int &max_i_idx,
+		   double svd_tol = 0);
 
 
 void etbr2(cs_dl *G, cs_dl *C, cs_dl *B,
@@ -86,17 +150,19 @@ void etbr2_thread(cs_dl *G, cs_dl *C, cs_dl *B,
 				 Source *VS, int nVS, Source *IS, int nIS, 
 				 double tstep, double tstop, int q, 
 				 mat &Gr, mat &Cr, mat &Br, mat &X,
-				 double &max_i, int &max_i_idx);
+				 double &max_i, int &max_i_idx, SOLVER_CTX *ctx, double svd_tol = 0);
 
 void gpu_etbr_thread(cs_dl *G, cs_dl *C, cs_dl *B, 
 		     Source *VS, int nVS, Source *IS, int nIS, 
 		     double tstep, double tstop, int q, 
 		     mat &Gr, mat &Cr, mat &Br, mat &X,
-		     double &max_i, int &max_i_idx, gpuETBR *myGPUetbr);
+		     double &max_i, int &max_i_idx, gpuETBR *myGPUetbr, SOLVER_CTX *ctx);
 
 void dc_solver(cs_dl *G, cs_dl *B, Source *VS, int nVS, Source *IS, int nIS, vec &dc_value);
 
-void dc_solver2(cs_dl *G, cs_dl *B, Source *VS, int nVS, Source *IS, int nIS, vec &dc_value);
+/* solver is the DS_* backend of ds_factor, run on pool */
+void dc_solver2(cs_dl *G, cs_dl *B, Source *VS, int nVS, Source *IS, int nIS, vec &dc_value,
+				int solver, THREAD_POOL *pool);
 
 void mna_solve(cs_dl *G, cs_dl *C, cs_dl *B, 
 			   Source *VS, int nVS, Source *IS, int nIS, 
@@ -106,7 +172,20 @@ void mna_solve(cs_dl *G, cs_dl *C, cs_dl *B,
 void mna_solve(cs_dl *G, cs_dl *C, cs_dl *B, 
 			   Source *VS, int nVS, Source *IS, int nIS, 
 			   double tstep, double tstop, const ivec &port, mat &sim_port_value, 
-			   vector<int> &tc_node, vector<string> &tc_name, int num, int ir_info, char *ir_name);
+			   vector<int> &tc_node, vector<string> &tc_name, int num, int ir_info, char *ir_name,
+			   SOLVER_CTX *ctx);
+
+#define INTEG_BE   0		/* backward Euler */
+#define INTEG_TR   1		/* trapezoidal */
+#define INTEG_BDF2 2		/* Gear-2, the step before t=0 is the dc solution */
+
+/* the companion matrix is G + integ_coef(method, tstep)*C */
+double integ_coef(int method, double tstep);
+
+/* w (= B*u1) += history of the step: right = integ_coef(method, tstep)*C,
+   bu0 = B*u0, x0 and xm1 are the solutions of the last two steps */
+void integ_history(int method, cs_dl *G, cs_dl *right, const vec &bu0, const vec &x0,
+				   const vec &xm1, vec &w);
 
 void ir_analysis(int display_num, vector<int> &tc_node,
 				 vector<string> &tc_name, mat &X, mat &sim_value, char *ir_name);
@@ -131,11 +210,13 @@ void mixed_transim2(cs_dl *G, cs_dl *C, cs_dl *B, Source *VS, int nVS, Source *I
 				   mat &Gr, mat &Cr, mat &Br, mat &X, mat &sim_port_value,
 				   const ivec &port, vector<int> &tc_node, vector<string> &tc_name, 
 				   int num, int ir_info, char *ir_name);
+/* X is released once the port/tap rows are extracted; with x_float
+   those rows are kept in single precision */
 void reduced_transim2(cs_dl *G, cs_dl *C, cs_dl *B, Source *VS, int nVS, Source *IS, int nIS, 
 					double tstep, double tstop, int q, double max_i, int max_i_idx, double threshold_percentage,
 				   mat &Gr, mat &Cr, mat &Br, mat &X, mat &sim_port_value,
 				   const ivec &port, vector<int> &tc_node, vector<string> &tc_name, 
-				   int num, int ir_info, char *ir_name);
+				   int num, int ir_info, char *ir_name, SOLVER_CTX *ctx, int x_float = 0);
 
 // XXLiu
 // #ifdef __cplusplus
@@ -153,19 +234,28 @@ void mna_solve_gpu_gmres(cs_dl *G, cs_dl *C, cs_dl *B,
                          Source *VS, int nVS, Source *IS, int nIS, 
                          double tstep, double tstop, const ivec &port, mat &sim_port_value, 
                          vector<int> &tc_node, vector<string> &tc_name, int num,
-                         int ir_info, char *ir_name, gpuETBR *myGPUetbr);
+                         int ir_info, char *ir_name, gpuETBR *myGPUetbr, SOLVER_CTX *ctx);
 
 void mna_solve_cpu_gmres(cs_dl *G, cs_dl *C, cs_dl *B, 
                          Source *VS, int nVS, Source *IS, int nIS, 
                          double tstep, double tstop, const ivec &port, mat &sim_port_value, 
                          vector<int> &tc_node, vector<string> &tc_name, int num,
-                         int ir_info, char *ir_name, gpuETBR *myGPUetbr);
+                         int ir_info, char *ir_name, gpuETBR *myGPUetbr, SOLVER_CTX *ctx);
+
+/* transient without a time step: exact on each piece of the PWL
+   sources, exp(-C^-1*G*h) is applied in a rational Krylov space of
+   (C + gamma*G)^-1*C */
+void mna_solve_exp(cs_dl *G, cs_dl *C, cs_dl *B,
+				   Source *VS, int nVS, Source *IS, int nIS,
+				   double tstep, double tstop, const ivec &port, mat &sim_port_value,
+				   vector<int> &tc_node, vector<string> &tc_name, int num, int ir_info,
+				   char *ir_name, SOLVER_CTX *ctx);
 
 void mna_solve_cpu_ilu_gmres(cs_dl *G, cs_dl *C, cs_dl *B, 
                          Source *VS, int nVS, Source *IS, int nIS, 
                          double tstep, double tstop, const ivec &port, mat &sim_port_value, 
                          vector<int> &tc_node, vector<string> &tc_name, int num,
-                         int ir_info, char *ir_name);//, gpuETBR *myGPUetbr
+                         int ir_info, char *ir_name, SOLVER_CTX *ctx);//, gpuETBR *myGPUetbr
 
 void mna_solve_gpu(cs_dl *G, cs_dl *C, cs_dl *B, 
                    Source *VS, int nVS, Source *IS, int nIS, 
@@ -192,8 +282,32 @@ void mixed_transim(cs_dl *G, cs_dl *C, cs_dl *B, Source *VS, int nVS, Source *IS
 				   const ivec &port, vector<int> &tc_node, vector<string> &tc_name, 
 				   int num, int ir_info, char *ir_name, vec *u_col);
 
+void rom_save(char *rom_name, ROMDATA &rom, mat &X,
+			  const ivec &port, vector<int> &tc_node,
+			  cs_dl *G, cs_dl *B, SOLVER_CTX *ctx);
+
+void rom_load(char *rom_name, ROMDATA &rom);
+
+/* group the current sources of the deck the way the model was
+   clustered when it was saved; IS is reallocated */
+void rom_is_cluster(ROMDATA &rom, Source *&IS, int &nIS);
+
+void rom_transim(ROMDATA &rom, Source *VS, int nVS, Source *IS, int nIS,
+				 double tstep, double tstop, mat &sim_port_value,
+				 const ivec &port, vector<string> &port_name,
+				 vector<string> &tc_name,
+				 int num, int ir_info, char *ir_name, SOLVER_CTX *ctx);
+
 void multiply(mat& a, vec& x, vec& b);
 
 void multiply(mat& a, double* x, double* b);
 
+void multiply(float* a, int m, int n, double* x, double* b);
+
+void multiply_trans(mat& a, double* x, double* b);
+
+void get_rows(mat& a, const ivec& idx, mat& r);
+
+void get_rows(mat& a, const ivec& idx, float* r);
+
 #endif
@@ -35,7 +35,9 @@
 #include "etbr.h"
 #include "interp.h"
 #include "svd0.h"
+#include "isvd.h"
 #include "cs.h"
+#include "phase_timer.h"
 
 using namespace itpp;
 
@@ -328,18 +330,22 @@ void etbr2(cs_dl *G, cs_dl *C, cs_dl *B,
   std::cout << "Total           \t: " << etbr2_run_time.get_time() << std::endl;
 }
 
+void etbr_sampling(double tstep, int &fft_n, double &f_min, double &f_max)
+{
+  fft_n = ETBR_FFT_N;
+  f_min = 1/tstep/fft_n;
+  f_max = 0.5/tstep;
+}
+
 void etbr2(cs_dl *G, cs_dl *C, cs_dl *B, 
 		   Source *VS, int nVS, Source *IS, int nIS, 
 		   double tstep, double tstop, int q, 
-		   mat &Gr, mat &Cr, mat &Br, mat &X, double &max_i, int &max_i_idx)
+		   mat &Gr, mat &Cr, mat &Br, mat &X, double &max_i, int &max_i_idx,
+		   double svd_tol)
 {
 
-  Real_Timer interp_run_time, interp2_run_time, fft_run_time, sCpG_run_time;
-  Real_Timer cs_symbolic, cs_numeric, cs_solve;
-  Real_Timer svd_run_time, rmatrix_run_time;
-  Real_Timer etbr2_run_time;
 
-  etbr2_run_time.start();
+  phase_begin("etbr2");
 
   UF_long nDim = B->m;
   UF_long nSDim = B->n;
@@ -349,12 +355,10 @@ void etbr2(cs_dl *G, cs_dl *C, cs_dl *B,
 
 
   /* FFT */
-  int fft_n = 512;
+  int fft_n;
   int L = ts.size();
-  //int N = floor_i(log2(L))+1;
-  int N = 10;  //1024 samples
-  
-  fft_n = pow2i(N);
+  double f_min, f_max;
+  etbr_sampling(tstep, fft_n, f_min, f_max);
   std::cout << "# time steps: "<< L << std::endl;
   std::cout << "# FFT points: "<< fft_n << std::endl;
 
@@ -366,8 +370,6 @@ void etbr2(cs_dl *G, cs_dl *C, cs_dl *B,
   */
 
   /* sampling: uniform in log scale */
-  double f_min = 1/tstep/fft_n;
-  double f_max = 0.5/tstep;
   //cout <<"f_min: " << f_min << endl;
   //cout << "f_max: " << f_max << endl;
   vec lin_samples;
@@ -398,15 +400,15 @@ void etbr2(cs_dl *G, cs_dl *C, cs_dl *B,
   vec us_row(np);
   vec interp_value(ts.size());
   for (int i = 0; i < nVS; i++){
-	interp_run_time.start();
+	phase_begin("interp");
 	interp1(VS[i].time, VS[i].value, ts, interp_value);
-	interp_run_time.stop();
-	fft_run_time.start();
+	phase_end();
+	phase_begin("fft");
 	// spwl_row = fft_real(interp_value, fft_n);
 	interp_value.set_size(fft_n, true);
 	fft_real(interp_value, spwl_row);
 	spwl_row /= L;
-	fft_run_time.stop();
+	phase_end();
 	// spwl_row *= (double)1/fft_n;
 	abs_spwl_row = real(spwl_row(0,floor_i(fft_n/2)));
 	abs_spwl_row *= 2;
@@ -414,9 +416,9 @@ void etbr2(cs_dl *G, cs_dl *C, cs_dl *B,
 	us.set_row(i, us_row);
   }
   for (int i = 0; i < nIS; i++){
-	interp_run_time.start();
+	phase_begin("interp");
 	interp1(IS[i].time, IS[i].value, ts, interp_value);
-	interp_run_time.stop();
+	phase_end();
 	vec abs_interp_value = abs(interp_value);
 	double max_interp = max(abs_interp_value);
 	// int max_interp_idx = max_index(abs_interp_value);
@@ -424,12 +426,12 @@ void etbr2(cs_dl *G, cs_dl *C, cs_dl *B,
 	  max_i = max_interp;
 	  max_i_idx = max_index(abs_interp_value);
 	}
-	fft_run_time.start();
+	phase_begin("fft");
 	// spwl_row = fft_real(interp_value, fft_n);
 	interp_value.set_size(fft_n, true);
 	fft_real(interp_value, spwl_row);
 	spwl_row /= L;
-	fft_run_time.stop();
+	phase_end();
 	// spwl_row *= (double)1/fft_n;
 	abs_spwl_row = real(spwl_row(0,floor_i(fft_n/2)));
 	abs_spwl_row *= 2;
@@ -437,8 +439,10 @@ void etbr2(cs_dl *G, cs_dl *C, cs_dl *B,
 	us.set_row(nVS+i, us_row);
   } 
 	
-  /* use UMFPACK to solve Ax=b */
-  mat Z(nDim, np);
+  /* use UMFPACK to solve Ax=b, the samples go straight into the
+     incremental QR instead of a dense Z */
+  ISVD isvd;
+  isvd_init(isvd, nDim, np);
   cs_dls *Symbolic;
   cs_dln *Numeric;
   int order = 2;
@@ -446,26 +450,28 @@ void etbr2(cs_dl *G, cs_dl *C, cs_dl *B,
 
   for (int i = 0; i < np; i++){
 	
-	sCpG_run_time.start();
+	phase_begin("sCpG");
 	cs_dl *A;
 	if (C != NULL)
 	  A = cs_dl_add(G, C, 1, samples(i));
 	else
 	  A = G;
-	sCpG_run_time.stop();
+	phase_end();
 
 	/* LU decomposition */
 	UF_long *Ap = A->p; 
 	UF_long *Ai = A->i;
 	double *Ax = A->x;
 
-	cs_symbolic.start();
+	phase_begin("symbolic");
 	Symbolic = cs_dl_sqr(order, A, 0);
-	cs_symbolic.stop();
+	phase_end();
 
-	cs_numeric.start();
+	phase_begin("numeric");
 	Numeric = cs_dl_lu(A, Symbolic, tol);
-	cs_numeric.stop();
+	phase_count("nnz", (double)Ap[A->n]);
+	phase_count("factor_nnz", (double)(Numeric->L->p[A->n] + Numeric->U->p[A->n]));
+	phase_end();
 
 	/* solve Az = b  */
 	vec x(nDim);
@@ -475,14 +481,16 @@ void etbr2(cs_dl *G, cs_dl *C, cs_dl *B,
 	vec b(nDim);
 	b.zeros();
 	(void) cs_dl_gaxpy(B, us.get_col(i)._data(), b._data());
-	cs_solve.start();
+	phase_begin("solve");
 	cs_dl_ipvec(Numeric->pinv, b._data(), x._data(), A->n);
 	cs_dl_lsolve(Numeric->L, x._data());
 	cs_dl_usolve(Numeric->U, x._data());
 	cs_dl_ipvec(Symbolic->q, x._data(), z._data(), A->n);  	
-	cs_solve.stop();
+	phase_end();
 
-	Z.set_col(i, z);	
+	phase_begin("svd");
+	isvd_add_col(isvd, z._data());
+	phase_end();
 	cs_dl_sfree(Symbolic);
 	cs_dl_nfree(Numeric);
 	if (A != G)
@@ -490,16 +498,15 @@ void etbr2(cs_dl *G, cs_dl *C, cs_dl *B,
   }
 
   /* SVD */
-  svd_run_time.start();
-  mat U, V;
+  phase_begin("svd");
   vec S;
-  int info;
-  info =  svd0(Z, U, S, V);
-  X = U.get_cols(0,q-1);
-  svd_run_time.stop();
+  isvd_finish(isvd, X, S, q, svd_tol);
+  phase_end();
+  if (svd_tol > 0)
+	cout << "# reduced order (by singular value decay): " << q << endl;
 
   /* Generate reduced matrices */
-  rmatrix_run_time.start();
+  phase_begin("reduce_matrices");
   // Gr = X.T()*G*X;
   Gr.set_size(q, q);
   for (int j = 0; j < q; j++){
@@ -531,22 +538,25 @@ void etbr2(cs_dl *G, cs_dl *C, cs_dl *B,
 	Br.set_row(j, v);
   }
   cs_dl_spfree(BT);
-  rmatrix_run_time.stop();
-
-  etbr2_run_time.stop();
+  phase_end();
 
 #ifndef UCR_EXTERNAL
   std::cout.setf(std::ios::fixed,std::ios::floatfield); 
   std::cout.precision(2);
-  std::cout << "interpolation   \t: " << interp_run_time.get_time() << std::endl;
-  std::cout << "FFT             \t: " << fft_run_time.get_time() << std::endl;
-  std::cout << "sC+G            \t: " << sCpG_run_time.get_time() << std::endl;
-  std::cout << "symbolic        \t: " << cs_symbolic.get_time() << std::endl;
-  std::cout << "numeric         \t: " << cs_numeric.get_time() << std::endl;
-  std::cout << "solve           \t: " << cs_solve.get_time() << std::endl;
-  std::cout << "SVD             \t: " << svd_run_time.get_time() << std::endl;
-  std::cout << "reduce matrices \t: " << rmatrix_run_time.get_time() << std::endl;
-  std::cout << "total reduction \t: " << etbr2_run_time.get_time() << std::endl;
+  std::cout << "interpolation   \t: " << phase_child_wall("interp") << std::endl;
+  std::cout << "FFT             \t: " << phase_child_wall("fft") << std::endl;
+  std::cout << "sC+G            \t: " << phase_child_wall("sCpG") << std::endl;
+  std::cout << "symbolic        \t: " << phase_child_wall("symbolic") << std::endl;
+  std::cout << "numeric         \t: " << phase_child_wall("numeric") << std::endl;
+  std::cout << "solve           \t: " << phase_child_wall("solve") << std::endl;
+  std::cout << "SVD             \t: " << phase_child_wall("svd") << std::endl;
+  std::cout << "reduce matrices \t: " << phase_child_wall("reduce_matrices") << std::endl;
+#endif
+
+  phase_end();
+
+#ifndef UCR_EXTERNAL
+  std::cout << "total reduction \t: " << phase_child_wall("etbr2") << std::endl;
 #endif
 }
 
@@ -23,6 +23,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <itpp/base/timing.h>
 #include <itpp/base/smat.h>
 #include <itpp/base/math/min_max.h>
@@ -39,6 +40,11 @@
 #include "etbr.h"
 #include "etbr_dd.h"
 #include "etbr_wrapper.h"
+#include "topo_reduce.h"
+#include "direct_solver.h"
+#include "SpMV_tune.h"
+#include "phase_timer.h"
+#include "gmres_log.h"
 #include "metis.h"
 
 #include "gpuData.h"
@@ -46,11 +52,10 @@
 using namespace itpp;
 using namespace std;
 
-extern long interp1_sum;
-extern long interp2_sum;
-
 #define ETBR_VER "2.0"  /* ETBR version */
 #define DEFAULT_R_ORDER  20	/* default reduction order */
+#define DEFAULT_MAX_R_ORDER  40	/* number of samples for "-nq auto" */
+#define DEFAULT_SVD_TOL 1e-6	/* relative singular value cut for "-nq auto" */
 #define DEFAULT_IR_PERCENTAGE 0.05	 /* default allowed IR drop percentage */
 	
 void help_message();
@@ -67,27 +72,34 @@ int main(int argc, char* argv[]){
 		exit(-1);
 	}
   
-	Real_Timer total_run_time, parser_run_time, partition_run_time, etbr_run_time, write_run_time;
-	CPU_Timer total_cpu_time, parser_cpu_time, partition_cpu_time, etbr_cpu_time, write_cpu_time;
-	Real_Timer ir_run_time, simu_run_time;
-	CPU_Timer ir_cpu_time, simu_cpu_time;
-	total_run_time.start();
-	total_cpu_time.start();
+	phase_begin("total");
 	
 	int q = DEFAULT_R_ORDER;
+	double svd_tol = 0;
 	
 	int npart = 1;
 	int ir_info = 0;
 	int use_gpu = 0, use_cuda_double=1, use_cuda_single=0;
 	int cd_info = 0;
 	int thread_version = 0;
+	int nthreads = 0;
 	int mna_version = 1;
 	int etbr_version = 0;
 	int error_control = 0;
-        int use_gmres = 0, use_iluPackage = 0;
+        int use_gmres = 0, use_iluPackage = 0, use_expint = 0;
+	char *rom_save_name = NULL, *rom_load_name = NULL;
+	int x_float = 0;
+	int topo_info = 0;
+	int vsfold_info = 0;
+	int reorder = REORDER_NONE;
+	int iscluster_info = 0;
+	int kway = 0;
 	// error percentgae allowed
 	double threshold_percentage = DEFAULT_IR_PERCENTAGE;	
 
+	SOLVER_CTX ctx;
+	solver_ctx_init(&ctx);
+
 	for (int i = 2; i < argc;){
 	  if (strcmp(argv[i],"-fast") == 0){
 	    etbr_version = 1;
@@ -98,7 +110,19 @@ int main(int argc, char* argv[]){
 	      cout << "Error: missing -fast option" << endl;
 	      exit(-1);
 	    }
-	    q = atoi(argv[i+1]);
+	    if (strcmp(argv[i+1],"auto") == 0){
+	      q = DEFAULT_MAX_R_ORDER;
+	      if (svd_tol == 0)
+		svd_tol = DEFAULT_SVD_TOL;
+	    }else
+	      q = atoi(argv[i+1]);
+	    i += 2;
+	  }else if (strcmp(argv[i],"-svdtol") == 0){
+	    if (!etbr_version) {
+	      cout << "Error: missing -fast option" << endl;
+	      exit(-1);
+	    }
+	    svd_tol = atof(argv[i+1]);
 	    i += 2;
 	  }else if (strcmp(argv[i],"-np") == 0){
 	    if (!etbr_version) {
@@ -128,6 +152,9 @@ int main(int argc, char* argv[]){
 	    }
 	    thread_version = 1;
 	    i++;
+	  }else if (strcmp(argv[i],"-nthreads") == 0){
+	    nthreads = atoi(argv[i+1]);
+	    i += 2;
 	  }else if (strcmp(argv[i],"-ir") == 0){
 	    ir_info = 1;
 	    i++;	  
@@ -150,6 +177,34 @@ int main(int argc, char* argv[]){
 	    cd_info = 1;
 	    i++;
 	  }
+          else if(strcmp(argv[i],"-expint") == 0){
+            use_expint = 1;
+            i++;
+          }
+          else if(strcmp(argv[i],"-spmvtune") == 0){
+            ctx.spmv_opt |= SPMV_OPT_TUNE;
+            i++;
+          }
+          else if(strcmp(argv[i],"-ccsr") == 0){
+            ctx.spmv_opt |= SPMV_OPT_CCSR;
+            i++;
+          }
+          else if(strcmp(argv[i],"-ccsr_bf16") == 0){
+            ctx.spmv_opt |= SPMV_OPT_CCSR | SPMV_OPT_BF16;
+            i++;
+          }
+          else if(strcmp(argv[i],"-stencil") == 0){
+            ctx.spmv_opt |= SPMV_OPT_STENCIL;
+            i++;
+          }
+          else if(strcmp(argv[i],"-trace") == 0){
+            phase_trace_file = argv[i+1];
+            i += 2;
+          }
+          else if(strcmp(argv[i],"-gmres_log") == 0){
+            ctx.gmres_log = gmres_log_create(argv[i+1]);
+            i += 2;
+          }
           else if(strcmp(argv[i],"-gmres") == 0){
             use_gmres = 1;
             i++;
@@ -158,6 +213,93 @@ int main(int argc, char* argv[]){
             use_iluPackage = 1;
             i++;
           }
+	  else if (strcmp(argv[i],"-xfloat") == 0){
+	    if (!etbr_version) {
+	      cout << "Error: missing -fast option" << endl;
+	      exit(-1);
+	    }
+	    x_float = 1;
+	    i++;
+	  }
+	  else if (strcmp(argv[i],"-scratch") == 0){
+	    ctx.dd_scratch.dir = argv[i+1];
+	    i += 2;
+	  }
+	  else if (strcmp(argv[i],"-scratch_mb") == 0){
+	    ctx.dd_scratch.budget_mb = atof(argv[i+1]);
+	    i += 2;
+	  }
+	  else if (strcmp(argv[i],"-scratch_zip") == 0){
+	    ctx.dd_scratch.compress = 1;
+	    i++;
+	  }
+	  else if (strcmp(argv[i],"-kway") == 0){
+	    if (!etbr_version) {
+	      cout << "Error: missing -fast option" << endl;
+	      exit(-1);
+	    }
+	    kway = 1;
+	    i++;
+	  }
+	  else if (strcmp(argv[i],"-vsfold") == 0){
+	    vsfold_info = 1;
+	    i++;
+	  }
+	  else if (strcmp(argv[i],"-solver") == 0){
+	    if (i+1 >= argc || ds_type(argv[i+1]) < 0){
+	      cout << "Error: -solver takes csparse, umfpack, sn or chol" << endl;
+	      exit(-1);
+	    }
+	    ctx.direct_solver = ds_type(argv[i+1]);
+	    i += 2;
+	  }
+	  else if (strcmp(argv[i],"-iscluster") == 0){
+	    iscluster_info = 1;
+	    i++;
+	  }
+	  else if (strcmp(argv[i],"-integ") == 0){
+	    if (i+1 < argc && strcmp(argv[i+1],"be") == 0)
+	      ctx.integ_method = INTEG_BE;
+	    else if (i+1 < argc && strcmp(argv[i+1],"tr") == 0)
+	      ctx.integ_method = INTEG_TR;
+	    else if (i+1 < argc && strcmp(argv[i+1],"bdf2") == 0)
+	      ctx.integ_method = INTEG_BDF2;
+	    else{
+	      cout << "Error: -integ takes be, tr or bdf2" << endl;
+	      exit(-1);
+	    }
+	    i += 2;
+	  }
+	  else if (strcmp(argv[i],"-reorder") == 0){
+	    if (i+1 < argc && strcmp(argv[i+1],"rcm") == 0)
+	      reorder = REORDER_RCM;
+	    else if (i+1 < argc && strcmp(argv[i+1],"nd") == 0)
+	      reorder = REORDER_ND;
+	    else{
+	      cout << "Error: -reorder takes rcm or nd" << endl;
+	      exit(-1);
+	    }
+	    i += 2;
+	  }
+	  else if (strcmp(argv[i],"-topo") == 0){
+	    topo_info = 1;
+	    i++;
+	  }
+	  else if (strcmp(argv[i],"-rom_save") == 0){
+	    if (!etbr_version) {
+	      cout << "Error: missing -fast option" << endl;
+	      exit(-1);
+	    }
+	    rom_save_name = argv[i+1];
+	    i += 2;
+	  }
+	  else if (strcmp(argv[i],"-rom_load") == 0){
+	    /* simulate a saved reduced model, no reduction needed */
+	    etbr_version = 1;
+	    mna_version = 0;
+	    rom_load_name = argv[i+1];
+	    i += 2;
+	  }
 	  else{
 	    //help_message();
 	    help_message_rel();
@@ -165,6 +307,31 @@ int main(int argc, char* argv[]){
 	    exit(-1);
 	  }
 	}
+
+	if (rom_load_name != NULL && npart > 1){
+	  cout << "Error: -rom_load does not work with -np" << endl;
+	  exit(-1);
+	}
+
+	/* the CUDA steppers, -expint, -ec and the domain decomposition have
+	   their own integration */
+	if (ctx.integ_method != INTEG_BE){
+	  const char *other = NULL;
+	  if (mna_version && use_expint)
+	    other = "-expint";
+	  else if (mna_version && use_gpu && !use_gmres)
+	    other = "-gpu without -gmres";
+	  else if (etbr_version && npart > 1)
+	    other = "-np";
+	  else if (etbr_version && rom_load_name == NULL && use_gpu)
+	    other = "-fast -gpu";
+	  else if (etbr_version && rom_load_name == NULL && error_control)
+	    other = "-ec";
+	  if (other != NULL){
+	    cout << "Error: -integ tr and bdf2 do not work with " << other << endl;
+	    exit(-1);
+	  }
+	}
 	
 	// print the banner
 	banner();
@@ -181,6 +348,9 @@ int main(int argc, char* argv[]){
 	
 	int display_ir_num = 20;
 
+	if (nthreads > 0)
+	  ctx.pool = pool_create(nthreads);
+
 	char cktname[100];
 	char cktname_cd[100];
 
@@ -205,8 +375,10 @@ int main(int argc, char* argv[]){
 	vector<string> tc_name;
 
 	/* Parser */
-	parser_run_time.start();
-	parser_cpu_time.start();
+	phase_begin("parse");
+	struct stat deck;
+	if (stat(cktname, &deck) == 0)
+	  phase_count("deck_bytes", (double)deck.st_size);
 
 	gpuETBR myGPUetbr; // XXLiu
         gpuRelatedDataInit(&myGPUetbr);
@@ -223,10 +395,53 @@ int main(int argc, char* argv[]){
 		       dc_sign,
 		       port_name, port,
 		       tc_node, tc_name,
-		       &myGPUetbr);
+		       &myGPUetbr, rom_load_name != NULL);
 
-	parser_run_time.stop();
-	parser_cpu_time.stop();
+	/* the saved model replaces G and C, only the sources were stamped */
+	if (rom_load_name != NULL && dc_sign == 1){
+	  cout << "Error: -rom_load needs a transient deck" << endl;
+	  exit(-1);
+	}
+
+
+	/* pads at fixed supplies become rhs terms, G is nodal SPD */
+	if (vsfold_info && rom_load_name == NULL){
+	  vs_fold(Gs, Cs, Bs, nNodes, VS, nVS, port, tc_node);
+	}
+
+	/* one column of B per distinct current waveform; a saved model
+	   keeps its groups and applies them to the sources it is loaded
+	   with, see rom_is_cluster */
+	vector<int> is_map;
+	vector<double> is_coef;
+	if (iscluster_info && rom_load_name == NULL){
+	  if (use_gpu){
+	    cout << "Error: -iscluster does not work with -gpu" << endl;
+	    exit(-1);
+	  }
+	  is_cluster(Bs, nVS, IS, nIS, &is_map, &is_coef);
+	}
+
+	/* merge shorts, collapse series chains and drop floating pieces;
+	   the saved model is not touched, its ports are in the old numbering */
+	TOPOMAP tmap;
+	if (topo_info && rom_load_name == NULL){
+	  topo_reduce(Gs, Cs, Bs, nNodes, port, tc_node, dc_sign != 1,
+				  DEFAULT_SHORT_R, tmap);
+	}
+
+	/* renumber the nodes for the locality of the solver; the ports
+	   follow the new numbers, a dc solution is mapped back below */
+	vector<UF_long> reorder_pinv;
+	if (reorder != REORDER_NONE && rom_load_name == NULL){
+	  mna_reorder(Gs, Cs, Bs, nNodes, reorder, port, tc_node, reorder_pinv, ctx.pool);
+	}
+
+	if (Gs != NULL){
+	  phase_count("nodes", (double)Gs->n);
+	  phase_count("nnz", (double)(Gs->p[Gs->n] + (Cs != NULL ? Cs->p[Cs->n] : 0)));
+	}
+	phase_end();
 		
 	mat Gr, Cr, Br, X, sim_value;
 	mat Xp, sim_port_value;
@@ -248,24 +463,27 @@ int main(int argc, char* argv[]){
 	if (mna_version){
 	  if (dc_sign == 1){ 
             cout << "dc_sign = 1, solve dc"<<endl;
-	    etbr_dc_wrapper(Gs, Bs, VS, nVS, IS, nIS, nport, port, dc_value, dc_port_value);
+	    etbr_dc_wrapper(Gs, Bs, VS, nVS, IS, nIS, nport, port, dc_value, dc_port_value, &ctx);
 	  }else{
-	    simu_run_time.start();
-	    simu_cpu_time.start();
+	    phase_begin("simulation");
             
-            if(use_gmres) /* XXLiu: Iterative solvers will be used. */
+            if(use_expint) /* steps set by the source breakpoints */
+              mna_solve_exp(Gs, Cs, Bs, VS, nVS, IS, nIS, tstep, tstop,
+                            port, sim_port_value, tc_node, tc_name,
+                            display_ir_num, ir_info, ir_name, &ctx);
+            else if(use_gmres) /* XXLiu: Iterative solvers will be used. */
               if(use_gpu) // -gmres -gpu -single
                 mna_solve_gpu_gmres(Gs, Cs, Bs, VS, nVS, IS, nIS, tstep, tstop, 
                                     port, sim_port_value, tc_node, tc_name,
-                                    display_ir_num, ir_info, ir_name, &myGPUetbr);
+                                    display_ir_num, ir_info, ir_name, &myGPUetbr, &ctx);
               else if(use_iluPackage) // -gmres -ilu
                 mna_solve_cpu_ilu_gmres(Gs, Cs, Bs, VS, nVS, IS, nIS, tstep, tstop, 
                                         port, sim_port_value, tc_node, tc_name,
-                                        display_ir_num, ir_info, ir_name);
+                                        display_ir_num, ir_info, ir_name, &ctx);
               else // -gmres
                 mna_solve_cpu_gmres(Gs, Cs, Bs, VS, nVS, IS, nIS, tstep, tstop, 
                                     port, sim_port_value, tc_node, tc_name,
-                                    display_ir_num, ir_info, ir_name, &myGPUetbr);
+                                    display_ir_num, ir_info, ir_name, &myGPUetbr, &ctx);
                 
             else if(use_gpu) // -gpu
               mna_solve_gpu(Gs, Cs, Bs, VS, nVS, IS, nIS, tstep, tstop, 
@@ -274,10 +492,9 @@ int main(int argc, char* argv[]){
             else
               mna_solve(Gs, Cs, Bs, VS, nVS, IS, nIS, tstep, tstop, 
                         port, sim_port_value, tc_node, tc_name,
-                        display_ir_num, ir_info, ir_name);
+                        display_ir_num, ir_info, ir_name, &ctx);
 
-	    simu_run_time.stop();
-	    simu_cpu_time.stop();
+	    phase_end();
 	  }
 	  etbr_version = 0;
 	}
@@ -285,37 +502,72 @@ int main(int argc, char* argv[]){
 	if (etbr_version && npart == 1){
           /* ETBR */
           cout << "**** starting ETBR ****" << endl;
-	  etbr_run_time.start();
-	  etbr_cpu_time.start();
+	  phase_begin("reduction");
 
 	  if (dc_sign == 1){  
-	    etbr_dc_wrapper(Gs, Bs, VS, nVS, IS, nIS, nport, port, dc_value, dc_port_value);
+	    etbr_dc_wrapper(Gs, Bs, VS, nVS, IS, nIS, nport, port, dc_value, dc_port_value, &ctx);
+	    phase_end();
 	  }else{
 
 	    double max_i = 0;
 	    int max_i_idx = 0;
 
+	    if (rom_load_name != NULL){
+	      ROMDATA rom;
+	      rom_load(rom_load_name, rom);
+	      rom_is_cluster(rom, IS, nIS);
+	      phase_end();
+
+	      phase_begin("simulation");
+	      cout << "**** starting simulation  ****" << endl;
+	      rom_transim(rom, VS, nVS, IS, nIS, tstep, tstop, sim_port_value,
+			  port, port_name, tc_name, display_ir_num, ir_info, ir_name, &ctx);
+	      cout << "**** simulation complete ****" << endl;
+	      phase_end();
+	    }else{
 	    cout << "**** starting reduction ****" << endl;
 	    cout << "# reduced order: " << q << endl;
 	    if (thread_version){
 	      if(use_gpu)
 	      	gpu_etbr_thread(Gs, Cs, Bs, VS, nVS, IS, nIS, tstep, tstop, q, 
-	      			Gr, Cr, Br, X, max_i, max_i_idx, &myGPUetbr);
+	      			Gr, Cr, Br, X, max_i, max_i_idx, &myGPUetbr, &ctx);
 	      else
 		etbr2_thread(Gs, Cs, Bs, VS, nVS, IS, nIS, tstep, tstop, q, 
-			     Gr, Cr, Br, X, max_i, max_i_idx);
+			     Gr, Cr, Br, X, max_i, max_i_idx, &ctx, svd_tol);
 	    }else{
 	      etbr2(Gs, Cs, Bs, VS, nVS, IS, nIS, tstep, tstop, q, 
-		    Gr, Cr, Br, X, max_i, max_i_idx);
+		    Gr, Cr, Br, X, max_i, max_i_idx, svd_tol);
 	    }
+	    /* the order may be lowered by the singular value decay */
+	    q = Gr.rows();
+	    myGPUetbr.q = q;
 	    cout << "**** reduction complete ****" << endl;
 
-	    etbr_run_time.stop();
-	    etbr_cpu_time.stop();
+	    if (rom_save_name != NULL){
+	      ROMDATA rom;
+	      rom.q = q;
+	      rom.nDim = Gs->n;
+	      rom.nVS = nVS;
+	      rom.nIS = nIS;
+	      rom.tstep = tstep;
+	      rom.tstop = tstop;
+	      rom.max_i = max_i;
+	      rom.max_i_idx = max_i_idx;
+	      etbr_sampling(tstep, rom.fft_n, rom.f_min, rom.f_max);
+	      rom.Gr = Gr;
+	      rom.Cr = Cr;
+	      rom.Br = Br;
+	      rom.port_name = port_name;
+	      rom.tc_name = tc_name;
+	      rom.is_map = is_map;
+	      rom.is_coef = is_coef;
+	      rom_save(rom_save_name, rom, X, port, tc_node, Gs, Bs, &ctx);
+	    }
+
+	    phase_end();
             cout << "**** ETBR complete ****" << endl;
 
-	    simu_run_time.start();
-	    simu_cpu_time.start();
+	    phase_begin("simulation");
 
 	    std::cout.precision(10);
 	    //cout << "max_i = " << max_i << endl;
@@ -335,7 +587,7 @@ int main(int argc, char* argv[]){
 				 tstep, tstop, q, max_i, max_i_idx, threshold_percentage,
 				 Gr, Cr, Br, X, sim_port_value,
 				 port, tc_node, tc_name, 
-				 display_ir_num, ir_info, ir_name);
+				 display_ir_num, ir_info, ir_name, &ctx, x_float);
 	    }else{
 	      mixed_transim2(Gs, Cs, Bs, VS, nVS, IS, nIS, 
 			     tstep, tstop, q, max_i, max_i_idx, threshold_percentage,
@@ -345,26 +597,22 @@ int main(int argc, char* argv[]){
 	    }
 		
 	    cout << "**** simulation complete ****" << endl;
-	    simu_run_time.stop();
-	    simu_cpu_time.stop();
-		
+	    phase_end();
+	    }
 	  }
 	}else if (etbr_version && npart > 1){
-	  etbr_run_time.start();
-	  etbr_cpu_time.start();
+	  phase_begin("reduction");
 	  UF_long m = Gs->m;
 	  UF_long *node_part = new UF_long[m];
 	  UF_long *part_size = new UF_long[npart+1];
 	  UF_long *mat_pinv = new UF_long[m];
 	  UF_long *mat_q = new UF_long[m];	
-	  partition_run_time.start();
-	  partition_cpu_time.start();
-	  string GC_file_name = "temp/GC_file";
+	  phase_begin("partition");
+	  string GC_file_name = dd_scratch_path(ctx.dd_scratch, "GC_file");
 
 	  partition_wrapper(GC_file_name, Gs, Cs, nNodes, npart,
-						part_size, node_part, mat_pinv, mat_q);
-	  partition_cpu_time.stop();
-	  partition_run_time.stop();
+						part_size, node_part, mat_pinv, mat_q, kway, ctx.pool);
+	  phase_end();
 	  
 	  etbr_dd_wrapper(GC_file_name, Gs, Cs, Bs, 
 					  VS, nVS, IS,  nIS, 
@@ -372,14 +620,13 @@ int main(int argc, char* argv[]){
 					  npart, nport, port, q, tstep, tstop,
 					  part_size, node_part, mat_pinv, mat_q,
 					  Gr, Cr, Br, X, sim_value,
-					  Xp, sim_port_value);
+					  Xp, sim_port_value, &ctx);
 
 	  delete [] node_part;
 	  delete [] part_size;
 	  delete [] mat_pinv;
 	  delete [] mat_q;
-	  etbr_run_time.stop();
-	  etbr_cpu_time.stop();
+	  phase_end();
 	}
        
         if (dc_sign != 1){  
@@ -391,9 +638,21 @@ int main(int argc, char* argv[]){
 	cs_dl_spfree(Bs);
         }
 
+	if (!reorder_pinv.empty() && dc_sign == 1){
+	  vec dc_orig;
+	  reorder_restore(reorder_pinv, dc_port_value, dc_orig);
+	  dc_port_value = dc_orig;
+	}
+
+	/* in dc all nodes are ports, rebuild the eliminated ones */
+	if (topo_info && rom_load_name == NULL && dc_sign == 1){
+	  vec dc_full;
+	  topo_restore(tmap, dc_port_value, dc_full);
+	  dc_port_value = dc_full;
+	}
+
 	/* Write simulation value */
-	write_run_time.start();
-	write_cpu_time.start();
+	phase_begin("write");
 
 	char outFileName[100];
 	char outGraphName[100];
@@ -413,27 +672,31 @@ int main(int argc, char* argv[]){
 				   port_name, port,
 				   dc_port_value, sim_port_value);
 
-	write_run_time.stop();
-	write_cpu_time.stop();
+	phase_end();
 	cout << "**** " << endl;
 
-	total_run_time.stop();
-	total_cpu_time.stop();
+	phase_end();
 	cout << "****** Runtime Statistics (seconds) ******  " << endl;
 	std::cout.setf(std::ios::fixed,std::ios::floatfield); 
 	std::cout.precision(2);
-	//cout << "interp1_sum = " << interp1_sum << endl;
-	//cout << "interp2_sum = " << interp2_sum << endl;
-	cout << "parse      \t: " << parser_run_time.get_time() << " (CPU: " << parser_cpu_time.get_time() << ")" << endl;	
+	cout << "parse      \t: " << phase_wall("total/parse") << " (CPU: " << phase_cpu("total/parse") << ")" << endl;	
 	if (npart > 1)
-	  cout << "partition  \t: " << partition_run_time.get_time() << " (CPU: " << partition_cpu_time.get_time() << ")" << endl;
+	  cout << "partition  \t: " << phase_wall("total/reduction/partition") << " (CPU: " << phase_cpu("total/reduction/partition") << ")" << endl;
         if(etbr_version)
-          cout << "reduction  \t: " << etbr_run_time.get_time() << " (CPU: " << etbr_cpu_time.get_time() << ")" << endl;
-	cout << "simulation \t: " << simu_run_time.get_time() << " (CPU: " << simu_cpu_time.get_time() << ")" << endl;
-	cout << "write      \t: " << write_run_time.get_time() << " (CPU: " << write_cpu_time.get_time() << ")" << endl;
+          cout << "reduction  \t: " << phase_wall("total/reduction") << " (CPU: " << phase_cpu("total/reduction") << ")" << endl;
+	cout << "simulation \t: " << phase_wall("total/simulation") << " (CPU: " << phase_cpu("total/simulation") << ")" << endl;
+	cout << "write      \t: " << phase_wall("total/write") << " (CPU: " << phase_cpu("total/write") << ")" << endl;
 	if (ir_info)
-	  cout << "IR analysis\t: " << ir_run_time.get_time() << " (CPU: " << ir_cpu_time.get_time() << ")" << endl;
-	cout << "total      \t: " << total_run_time.get_time() << " (CPU: " << total_cpu_time.get_time() << ")" << endl;
+	  cout << "IR analysis\t: " << phase_wall("total/simulation/ir_analysis") << " (CPU: " << phase_cpu("total/simulation/ir_analysis") << ")" << endl;
+	cout << "total      \t: " << phase_wall("total") << " (CPU: " << phase_cpu("total") << ")" << endl;
+	if (phase_trace_file != NULL)
+	  phase_report();
+	if (ctx.gmres_log != NULL){
+	  gmres_log_report(ctx.gmres_log);
+	  gmres_log_free(ctx.gmres_log);
+	}
+	if (ctx.pool != NULL)
+	  pool_free(ctx.pool);
 
         gpuRelatedDataFree(&myGPUetbr);
 }
@@ -457,14 +720,36 @@ void help_message()
 	printf("Usage: etbr_cmd circuit_name [ -fast [-nq reduced_order] [-np partition_number] [-ec] [-th threshold] [-mt] ] [-ir] [-gpu] [-cd]\n");
 	//cout << "******************* general options ***********************\n";
 	printf("  [-fast -- fast version using reduction method]\n");
-	printf("  [-nq <int> -- reduced order, default: %d]\n", (int)DEFAULT_R_ORDER);
+	printf("  [-nq <int>|auto -- reduced order, default: %d; auto picks it from the singular value decay]\n", (int)DEFAULT_R_ORDER);
+	printf("  [-svdtol <double> -- drop singular values below svdtol*max, default for auto: %g]\n", (float)DEFAULT_SVD_TOL);
 	printf("  [-np <int> -- partition_number]\n");
+	printf("  [-kway -- multilevel k-way partitioning instead of recursive bisection]\n");
+	printf("  [-scratch <dir> -- directory for the out-of-core partition files, default: temp]\n");
+	printf("  [-scratch_mb <double> -- keep the factors in memory once the scratch files reach this size]\n");
+	printf("  [-scratch_zip -- pack the indices of the factors written to the scratch directory]\n");
 	printf("  [-ec -- use dynamic error control technique]\n");
 	printf("  [-th <double> -- allowed IR drop error in percentage (wrt the lartgest IR drop), default: %g]\n", (float)DEFAULT_IR_PERCENTAGE);
 	printf("  [-mt -- use multi-threading simulation]\n");		
+	printf("  [-nthreads n -- one pool of n threads for the -mt sample solves, DD, supernodal solver and graph build; default a thread per sample, one per core elsewhere]\n");
 	printf("  [-ir -- perform IR drop analysis and print out 20 nodes with largest IR drops]\n");
 	printf("  [-gpu -- GPU acceleration]\n");
 	printf("  [-cd -- dump the output files into current directory]\n");
+	printf("  [-rom_save <file> -- save the reduced model (with -fast)]\n");
+	printf("  [-xfloat -- keep the port/tap rows of the projection in single precision]\n");
+	printf("  [-rom_load <file> -- simulate a saved reduced model with the sources of circuit_name]\n");
+	printf("  [-topo -- merge shorts, collapse series chains and drop floating nodes before solving]\n");
+	printf("  [-reorder rcm|nd -- renumber the nodes by reverse Cuthill-McKee or METIS nested dissection for cache locality]\n");
+	printf("  [-vsfold -- fold grounded voltage sources into the right hand side (nodal SPD G)]\n");
+	printf("  [-iscluster -- merge current sources with the same waveform shape into one column of B]\n");
+	printf("  [-integ be|tr|bdf2 -- backward Euler, trapezoidal or Gear-2 fixed step integration (direct, -gmres, -fast and -rom_load; not with -gpu other than -gmres -gpu, -expint, -ec or -np), default: be]\n");
+	printf("  [-expint -- matrix exponential transient, steps only at the source breakpoints (without -fast)]\n");
+	printf("  [-solver csparse|umfpack|sn|chol -- sparse direct solver for the DC and transient LU, chol for SPD grids, default: csparse]\n");
+	printf("  [-spmvtune -- time CSR, BCSR, SELL-C-sigma and the mesh stencil on the matrix and use the fastest in the host GMRES (-gmres)]\n");
+	printf("  [-ccsr -- host GMRES matrix and ILU factors with 8/16 bit column offsets per row (-gmres)]\n");
+	printf("  [-ccsr_bf16 -- as -ccsr, with the ILU factor values rounded to bfloat16 (lower precision preconditioner)]\n");
+	printf("  [-stencil -- apply the regular mesh rows of the host GMRES matrix as stencils, the rest as CSR (-gmres)]\n");
+	printf("  [-trace <file> -- write the nested phase times and counters of all threads as a Chrome trace (chrome://tracing) at exit]\n");
+	printf("  [-gmres_log <file> -- write the residual of every GMRES iteration and restart, the time and preconditioner time of every solve and its transient step as CSV (-gmres)]\n");
 
 	cout <<"\n";
 }
@@ -477,12 +762,34 @@ void help_message_rel()
                "[-gpu -single|-double] [-cd]\n");
 	//cout << "******************* general options ***********************\n";
 	printf("  [-fast -- fast version using reduction method]\n");
-	printf("  [-nq <int> -- reduced order, default: %d]\n", (int)DEFAULT_R_ORDER);
+	printf("  [-nq <int>|auto -- reduced order, default: %d; auto picks it from the singular value decay]\n", (int)DEFAULT_R_ORDER);
+	printf("  [-svdtol <double> -- drop singular values below svdtol*max, default for auto: %g]\n", (float)DEFAULT_SVD_TOL);
 	printf("  [-np <int> -- partition_number]\n");
+	printf("  [-kway -- multilevel k-way partitioning instead of recursive bisection]\n");
+	printf("  [-scratch <dir> -- directory for the out-of-core partition files, default: temp]\n");
+	printf("  [-scratch_mb <double> -- keep the factors in memory once the scratch files reach this size]\n");
+	printf("  [-scratch_zip -- pack the indices of the factors written to the scratch directory]\n");
 	printf("  [-mt -- use multi-threading simulation]\n");
+	printf("  [-nthreads n -- one pool of n threads for the -mt sample solves, DD, supernodal solver and graph build; default a thread per sample, one per core elsewhere]\n");
 	printf("  [-gpu -- GPU acceleration]\n");
 	printf("  [-single|-double -- GPU float point precision]\n");
 	printf("  [-cd -- dump the output files into current directory]\n");
+	printf("  [-rom_save <file> -- save the reduced model (with -fast)]\n");
+	printf("  [-xfloat -- keep the port/tap rows of the projection in single precision]\n");
+	printf("  [-rom_load <file> -- simulate a saved reduced model with the sources of circuit_name]\n");
+	printf("  [-topo -- merge shorts, collapse series chains and drop floating nodes before solving]\n");
+	printf("  [-reorder rcm|nd -- renumber the nodes by reverse Cuthill-McKee or METIS nested dissection for cache locality]\n");
+	printf("  [-vsfold -- fold grounded voltage sources into the right hand side (nodal SPD G)]\n");
+	printf("  [-iscluster -- merge current sources with the same waveform shape into one column of B]\n");
+	printf("  [-integ be|tr|bdf2 -- backward Euler, trapezoidal or Gear-2 fixed step integration (direct, -gmres, -fast and -rom_load; not with -gpu other than -gmres -gpu, -expint, -ec or -np), default: be]\n");
+	printf("  [-expint -- matrix exponential transient, steps only at the source breakpoints (without -fast)]\n");
+	printf("  [-solver csparse|umfpack|sn|chol -- sparse direct solver for the DC and transient LU, chol for SPD grids, default: csparse]\n");
+	printf("  [-spmvtune -- time CSR, BCSR, SELL-C-sigma and the mesh stencil on the matrix and use the fastest in the host GMRES (-gmres)]\n");
+	printf("  [-ccsr -- host GMRES matrix and ILU factors with 8/16 bit column offsets per row (-gmres)]\n");
+	printf("  [-ccsr_bf16 -- as -ccsr, with the ILU factor values rounded to bfloat16 (lower precision preconditioner)]\n");
+	printf("  [-stencil -- apply the regular mesh rows of the host GMRES matrix as stencils, the rest as CSR (-gmres)]\n");
+	printf("  [-trace <file> -- write the nested phase times and counters of all threads as a Chrome trace (chrome://tracing) at exit]\n");
+	printf("  [-gmres_log <file> -- write the residual of every GMRES iteration and restart, the time and preconditioner time of every solve and its transient step as CSV (-gmres)]\n");
 
 	cout <<"\n";
 }
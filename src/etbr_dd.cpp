@@ -51,7 +51,8 @@ void etbr_dd(cs_dl *B,
 			 double tstep, double tstop, int q, 
 			 mat &Gr, mat &Cr, mat &Br, mat &X, mat &sim_value,
 			 int npart, UF_long *part_size, UF_long *node_part, 
-			 UF_long *mat_pinv, UF_long *mat_q)
+			 UF_long *mat_pinv, UF_long *mat_q, const DDSCRATCH &scratch,
+			 THREAD_POOL *pool)
 {
 
   Real_Timer interp_run_time, fft_run_time, sCpG_run_time;
@@ -144,7 +145,7 @@ void etbr_dd(cs_dl *B,
   // Control[UMFPACK_PRL] = 2;
   ifstream in_GC_file;
   ofstream out_GC_file;
-  string GC_file_name = "temp/GC_file";
+  string GC_file_name = dd_scratch_path(scratch, "GC_file");
   /*
   out_GC_file.open(GC_file_name.c_str(), ios::binary);
   cs_dl_save(out_GC_file, G);
@@ -242,7 +243,7 @@ void etbr_dd(cs_dl *B,
 	cs_dl_spfree(A_dd);
 	double *z_dd = new double[nDim];
 	dd_solve_run_time.start();
-	dd_solve_ooc(npart, As, E, F, At, f, g, z_dd, symbolic_runtime, numeric_runtime, solve_runtime);
+	dd_solve_ooc(npart, As, E, F, At, f, g, z_dd, symbolic_runtime, numeric_runtime, solve_runtime, scratch, pool);
 	dd_solve_run_time.stop();
 
 	double *z = new double[nDim];
@@ -22,6 +22,8 @@
 
 #include "cs.h"
 #include "etbr.h"
+#include <string>
+#include <pthread.h>
 #include <iostream>
 #include <fstream>
 #include <itpp/base/timing.h>
@@ -40,8 +42,17 @@ void partition2(cs_dl *A, int npart, int nNodes,
 void partition3(cs_dl *A, int npart, int nNodes,
 			   UF_long *part_size, UF_long *node_part, UF_long *pinv, UF_long *q);
 
+/* symmetric node graph of the patterns of G and C, vwgt = nnz of each
+   column; the neighbour lists are sorted on pool (NULL: one of
+   pool_default_size threads for the call) */
+void build_adjacency(cs_dl *G, cs_dl *C, int nNodes,
+					 idxtype *&xadj, idxtype *&adjncy, idxtype *&vwgt,
+					 THREAD_POOL *pool);
+
+/* kway = 1 uses the multilevel k-way partitioner instead of recursive bisection */
 void partition4(idxtype *xadj, idxtype *adjncy, int npart, UF_long m, int nNodes, UF_long* vnode,
-				UF_long *part_size, UF_long *node_part, UF_long *pinv, UF_long *q);
+				UF_long *part_size, UF_long *node_part, UF_long *pinv, UF_long *q,
+				idxtype *vwgt = NULL, int kway = 0);
 
 void dd_form(int npart, UF_long *part_size, UF_long *node_part, cs_dl *A, double *b, 
 			 cs_dl **&As, cs_dl **&E, cs_dl **&F, cs_dl *&At, double **&f, double *&g);
@@ -60,7 +71,8 @@ void dd_solve3(int npart, cs_dl **As, cs_dl **E, cs_dl **F, cs_dl *At,
 
 void dd_solve_ooc(int npart, cs_dl **As, cs_dl **E, cs_dl **F, cs_dl *At, 
 				  double **f, double *g, double *z,
-				  Real_Timer &cs_symbolic_runtime, Real_Timer &cs_numeric_runtime, Real_Timer &cs_solve_runtime);
+				  Real_Timer &cs_symbolic_runtime, Real_Timer &cs_numeric_runtime, Real_Timer &cs_solve_runtime,
+				  const DDSCRATCH &scratch, THREAD_POOL *pool);
 
 int my_cs_dl_lsolve (const cs_dl *L, double *x);
 
@@ -78,11 +90,37 @@ void etbr_dd(cs_dl *B,
 			 double tstep, double tstop, int q, 
 			 mat &Gr, mat &Cr, mat &Br, mat &X, mat &sim_value,
 			 int npart, UF_long *part_size, UF_long *node_part, 
-			 UF_long *mat_pinv, UF_long *mat_q);
+			 UF_long *mat_pinv, UF_long *mat_q, const DDSCRATCH &scratch,
+			 THREAD_POOL *pool);
 
 void dc_dd_solver(cs_dl *G, cs_dl *B, Source *VS, int nVS, Source *IS, int nIS, vec &dc_value,
 				  int npart, UF_long *part_size, UF_long *node_part, 
-				  UF_long *mat_pinv, UF_long *mat_q);
+				  UF_long *mat_pinv, UF_long *mat_q, const DDSCRATCH &scratch,
+				  THREAD_POOL *pool);
+
+/* scratch.dir + "/" + name, the directory is created if needed */
+string dd_scratch_path(const DDSCRATCH &scratch, const char *name);
+
+/* save or load a factor on a background thread; a saved factor is
+   freed once it is written, dd_io_wait() returns the loaded one */
+typedef struct{
+  string name;
+  cs_dln *N;
+  int save;
+  int compress;
+  int active;
+  pthread_t thread;
+}DDIOJOB;
+
+/* compress packs the indices as DDSCRATCH::compress */
+void dd_io_start_save(DDIOJOB &job, const string &name, cs_dln *N, int compress);
+
+void dd_io_start_load(DDIOJOB &job, const string &name);
+
+cs_dln *dd_io_wait(DDIOJOB &job);
+
+/* bytes of a factor on disk without compression */
+double numeric_dl_bytes(cs_dln *N);
 
 void numeric_dl_save(ofstream &file, cs_dln *N);
 
@@ -214,7 +214,9 @@ int main(int argc, char* argv[]){
 	  xadj[m] = adjncy_index;
 	  adjncy = (idxtype *) realloc(adjncy, adjncy_index*sizeof(idxtype));	  
 	  ofstream out_GC_file;
-	  string GC_file_name = "temp/GC_file";
+	  DDSCRATCH scratch;
+	  dd_scratch_init(scratch);
+	  string GC_file_name = dd_scratch_path(scratch, "GC_file");
 	  out_GC_file.open(GC_file_name.c_str(), ios::binary);
 	  cs_dl_save(out_GC_file, Gs);
 	  cs_dl_spfree(Gs);
@@ -244,7 +246,7 @@ int main(int argc, char* argv[]){
 		cs_dl_load(in_GC_file, Gs);
 		in_GC_file.close();
 		dc_dd_solver(Gs, Bs, VS, nVS, IS, nIS, dc_value, 
-					 npart, part_size, node_part, mat_pinv, mat_q);
+					 npart, part_size, node_part, mat_pinv, mat_q, scratch, NULL);
 		delete [] VS;
 		delete [] IS;
 		delete [] node_part;
@@ -265,7 +267,7 @@ int main(int argc, char* argv[]){
 		  Gr, Cr, Br, X, sim_value, npart, part_size, node_part, mat_pinv, mat_q);
 		*/
 		etbr_dd(Bs, VS, nVS, IS, nIS, tstep, tstop, q, 
-				Gr, Cr, Br, X, sim_value, npart, part_size, node_part, mat_pinv, mat_q);
+				Gr, Cr, Br, X, sim_value, npart, part_size, node_part, mat_pinv, mat_q, scratch, NULL);
 
 		delete [] VS;
 		delete [] IS;
@@ -32,6 +32,7 @@
 #include "itpp2csparse.h"
 #include "etbr.h"
 #include "etbr_dd.h"
+#include "direct_solver.h"
 #include <pthread.h>
 
 using namespace itpp;
@@ -182,7 +183,7 @@ int main(int argc, char* argv[]){
 	  etbr_cpu_time.start();
 
 	  if (dc_sign == 1){		
-		dc_solver2(Gs, Bs, VS, nVS, IS, nIS, dc_value);
+		dc_solver2(Gs, Bs, VS, nVS, IS, nIS, dc_value, DS_CSPARSE, NULL);
 		delete [] VS;
 		delete [] IS;
 		cs_dl_spfree(Gs);
@@ -225,7 +226,9 @@ int main(int argc, char* argv[]){
 	  etbr_cpu_time.start();
 	  cs_dl* As = cs_dl_add(Gs, Cs, 1, 1);
 	  ofstream out_GC_file;
-	  string GC_file_name = "temp/GC_file";
+	  DDSCRATCH scratch;
+	  dd_scratch_init(scratch);
+	  string GC_file_name = dd_scratch_path(scratch, "GC_file");
 	  out_GC_file.open(GC_file_name.c_str(), ios::binary);
 	  cs_dl_save(out_GC_file, Gs);
 	  cs_dl_spfree(Gs);
@@ -258,7 +261,7 @@ int main(int argc, char* argv[]){
 		cs_dl_load(in_GC_file, Gs);
 		in_GC_file.close();
 		dc_dd_solver(Gs, Bs, VS, nVS, IS, nIS, dc_value, 
-					 npart, part_size, node_part, mat_pinv, mat_q);
+					 npart, part_size, node_part, mat_pinv, mat_q, scratch, NULL);
 		delete [] VS;
 		delete [] IS;
 		delete [] node_part;
@@ -279,7 +282,7 @@ int main(int argc, char* argv[]){
 		  Gr, Cr, Br, X, sim_value, npart, part_size, node_part, mat_pinv, mat_q);
 		*/
 		etbr_dd(Bs, VS, nVS, IS, nIS, tstep, tstop, q, 
-				Gr, Cr, Br, X, sim_value, npart, part_size, node_part, mat_pinv, mat_q);
+				Gr, Cr, Br, X, sim_value, npart, part_size, node_part, mat_pinv, mat_q, scratch, NULL);
 
 		delete [] VS;
 		delete [] IS;
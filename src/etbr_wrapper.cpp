@@ -50,7 +50,7 @@ void parser_wrapper(char cktname[],
 		    int& dc_sign,
 		    vector<string>& port_name, ivec& port,
 		    vector<int>& tc_node, vector<string>& tc_name,
-		    gpuETBR *myGPUetbr)
+		    gpuETBR *myGPUetbr, int sources_only)
 {
   NodeList *nodePool;
   int nL,nsubnode;
@@ -64,8 +64,16 @@ void parser_wrapper(char cktname[],
 
   printf("start parser ...\n");
   nsubnode = 0;
+  nL = 0;
   //parser(cktname, tstep, tstop, nVS, nIS, nL, nodePool);
-  parser_sub(cktname, tstep, tstop, nsubnode, nVS, nIS, nL, nodePool);
+  if(sources_only && !parser_sources(cktname, tstep, tstop, nVS, nIS, nodePool)){
+    /* subcircuits: their nodes are numbered by the full parse */
+    delete nodePool;
+    nodePool = new NodeList;
+    sources_only = 0;
+  }
+  if(!sources_only)
+    parser_sub(cktname, tstep, tstop, nsubnode, nVS, nIS, nL, nodePool);
   // nodePool->map_clear();
   //printf("get port information.\n");
   /* get port information */
@@ -133,7 +141,17 @@ void parser_wrapper(char cktname[],
   }
   
   printf("start stamping circuit...\n");
-  if(nsubnode != 0){
+  if(sources_only){
+    /* -rom_load: only the sources and B, G and C stay NULL */
+    stampB(cktname, nL, nIS, nVS, nNodes, tstop, VS, IS, B, nodePool, myGPUetbr);
+	Bs = B->mat2csdl();
+	delete B;
+	delete C;
+	delete G;
+	Cs = Gs = NULL;
+	printf("B matrix done.\n");
+  }
+  else if(nsubnode != 0){
     stamp_sub(cktname, nL, nIS, nVS, nNodes, tstep, tstop, VS, IS, G,  C,  B, nodePool, myGPUetbr); // XXLiu
 	Bs = B->mat2csdl();
 	delete B;
@@ -168,10 +186,10 @@ void parser_wrapper(char cktname[],
 void etbr_dc_wrapper(cs_dl* Gs, cs_dl* Bs, 
 					 Source* VS, int nVS, Source* IS, int nIS, 
 					 int nport, ivec& port,
-					 vec& dc_value, vec& dc_port_value)
+					 vec& dc_value, vec& dc_port_value, SOLVER_CTX *ctx)
 {
   //dc_solver2(Gs, Bs, VS, nVS, IS, nIS, dc_value);
-  dc_solver2(Gs, Bs, VS, nVS, IS, nIS, dc_port_value);
+  dc_solver2(Gs, Bs, VS, nVS, IS, nIS, dc_port_value, ctx->direct_solver, ctx->pool);
   delete [] VS;
   delete [] IS;
   cs_dl_spfree(Gs);
@@ -187,51 +205,23 @@ void etbr_dc_wrapper(cs_dl* Gs, cs_dl* Bs,
 }
 
 void partition_wrapper(string& GC_file_name, cs_dl* Gs, cs_dl* Cs, int nNodes, int npart,
-					   UF_long* part_size, UF_long* node_part, UF_long* mat_pinv, UF_long* mat_q)
+					   UF_long* part_size, UF_long* node_part, UF_long* mat_pinv, UF_long* mat_q,
+					   int kway, THREAD_POOL *pool)
 {
 
-  UF_long *Gp, *Gi, *Cp, *Ci;
+  UF_long *Gp, *Gi;
   UF_long m = Gs->m;
-  UF_long nzmax = Gs->nzmax;
   Gp = Gs->p;
   Gi = Gs->i;
-  if (Cs != NULL){
-	nzmax += Cs->nzmax;
-	Cp = Cs->p;
-	Ci = Cs->i;
-  }
-  UF_long i = 0, j = 0, p = 0;
-  idxtype *xadj = (idxtype *) malloc((nNodes+1)*sizeof(idxtype));
-  idxtype *adjncy = (idxtype *) malloc(nzmax*sizeof(idxtype));
-  idxtype adjncy_index = 0;
-  set<UF_long> adjncy_set;
-  for (j = 0; j < nNodes; j++){
-	xadj[j] = adjncy_index;
-	for (p = Gp[j]; p < Gp[j+1]; p++){
-	  if (Gi[p] < nNodes) 
-		adjncy_set.insert(Gi[p]);
-	}
-	if (Cs != NULL){
-	  for (p = Cp[j]; p < Cp[j+1]; p++){
-		if (Ci[p] < nNodes)
-		  adjncy_set.insert(Ci[p]);
-	  }
-	}
-	for (set<UF_long>::iterator iter = adjncy_set.begin(); iter != adjncy_set.end(); iter++){
-	  if (*iter != j){
-		adjncy[adjncy_index++] = *iter;
-	  }
-	}
-	adjncy_set.clear();
-  }
-  xadj[nNodes] = adjncy_index;
+  UF_long j = 0, p = 0;
+  idxtype *xadj, *adjncy, *vwgt;
+  build_adjacency(Gs, Cs, nNodes, xadj, adjncy, vwgt, pool);
   UF_long *vnode = new UF_long[m-nNodes];
   for (j = nNodes; j < m; j++){
 	for (p = Gp[j]; p < Gp[j+1]; p++){
 	  vnode[j-nNodes] = Gi[p];
 	}
   }
-  adjncy = (idxtype *) realloc(adjncy, adjncy_index*sizeof(idxtype));	  
   ofstream out_GC_file;
   out_GC_file.open(GC_file_name.c_str(), ios::binary);
   cs_dl_save(out_GC_file, Gs);
@@ -242,10 +232,12 @@ void partition_wrapper(string& GC_file_name, cs_dl* Gs, cs_dl* Cs, int nNodes, i
   }
   out_GC_file.close();
   
-  partition4(xadj, adjncy, npart, m, nNodes, vnode, part_size, node_part, mat_pinv, mat_q);
+  partition4(xadj, adjncy, npart, m, nNodes, vnode, part_size, node_part, mat_pinv, mat_q,
+			 vwgt, kway);
   delete [] vnode;
   free(xadj);
   free(adjncy);
+  free(vwgt);
 
   cout << "**** Partition results ****" << endl;
   UF_long sum = 0;
@@ -264,7 +256,7 @@ void etbr_dd_wrapper(string& GC_file_name, cs_dl* Gs, cs_dl* Cs, cs_dl* Bs,
 					 int npart, int nport, ivec& port, int q, double tstep, double tstop,
 					 UF_long* part_size, UF_long* node_part, UF_long* mat_pinv, UF_long* mat_q,
 					 mat& Gr, mat& Cr, mat& Br, mat& X, mat& sim_value,
-					 mat& Xp, mat& sim_port_value)
+					 mat& Xp, mat& sim_port_value, SOLVER_CTX *ctx)
 {  
   if (dc_sign == 1){
 	ifstream in_GC_file;
@@ -272,7 +264,7 @@ void etbr_dd_wrapper(string& GC_file_name, cs_dl* Gs, cs_dl* Cs, cs_dl* Bs,
 	cs_dl_load(in_GC_file, Gs);
 	in_GC_file.close();
 	dc_dd_solver(Gs, Bs, VS, nVS, IS, nIS, dc_value, 
-				 npart, part_size, node_part, mat_pinv, mat_q);
+				 npart, part_size, node_part, mat_pinv, mat_q, ctx->dd_scratch, ctx->pool);
 		
 	dc_port_value.set_size(nport);
 	if (nport > 0){
@@ -281,7 +273,8 @@ void etbr_dd_wrapper(string& GC_file_name, cs_dl* Gs, cs_dl* Cs, cs_dl* Bs,
 	  }
 	}else{
 	  etbr_dd(Bs, VS, nVS, IS, nIS, tstep, tstop, q, 
-			  Gr, Cr, Br, X, sim_value, npart, part_size, node_part, mat_pinv, mat_q);
+			  Gr, Cr, Br, X, sim_value, npart, part_size, node_part, mat_pinv, mat_q,
+			  ctx->dd_scratch, ctx->pool);
 	
 	  Xp.set_size(nport, q);
 	  sim_port_value.set_size(nport, sim_value.cols());
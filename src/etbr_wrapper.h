@@ -38,15 +38,16 @@ void parser_wrapper(char cktname[],
 		    int& dc_sign,
 		    vector<string>& port_name, ivec& port,
 		    vector<int>& tc_node, vector<string>& tc_name,
-		    gpuETBR *myGPUetbr);
+		    gpuETBR *myGPUetbr, int sources_only = 0);
 
 void etbr_dc_wrapper(cs_dl* Gs, cs_dl* Bs, 
 					 Source* VS, int nVS, Source* IS, int nIS, 
 					 int nport, ivec& port,
-					 vec& dc_value, vec& dc_port_value);
+					 vec& dc_value, vec& dc_port_value, SOLVER_CTX *ctx);
 
 void partition_wrapper(string& GC_file_name, cs_dl* Gs, cs_dl* Cs, int nNodes, int npart,
-					   UF_long* part_size, UF_long* node_part, UF_long* mat_pinv, UF_long* mat_q);
+					   UF_long* part_size, UF_long* node_part, UF_long* mat_pinv, UF_long* mat_q,
+					   int kway = 0, THREAD_POOL *pool = NULL);
 
 void etbr_dd_wrapper(string& GC_file_name, cs_dl* Gs, cs_dl* Cs, cs_dl* Bs, 
 					 Source* VS, int nVS, Source* IS, int nIS, 
@@ -54,7 +55,7 @@ void etbr_dd_wrapper(string& GC_file_name, cs_dl* Gs, cs_dl* Cs, cs_dl* Bs,
 					 int npart, int nport, ivec& port, int q, double tstep, double tstop,
 					 UF_long* part_size, UF_long* node_part, UF_long* mat_pinv, UF_long* mat_q,
 					 mat& Gr, mat& Cr, mat& Br, mat& X, mat& sim_value,
-					 mat& Xp, mat& sim_port_value);
+					 mat& Xp, mat& sim_port_value, SOLVER_CTX *ctx);
 
 void writer_wrapper(char outFileName[], char outGraphName[],
 					int nport, int dc_sign, double tstep, double tstop,
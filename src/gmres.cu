@@ -4,6 +4,8 @@
 //#include <cutil.h>
 #include <helper_cuda.h>
 #include "gmres.h"
+#include "SpMV_tune.h"
+#include "gmres_log.h"
 
 // zky
 float difftime(timeval &st, timeval &et){
@@ -256,10 +258,14 @@ GMRES_leftDiag(const float *val, const  int *rowIndices, const  int *indices,
 	if (normb == 0.0)  normb = 1;
 
 	resid = norm2(r, n) / normb;
+	if (gmres_log_on)
+		gmres_log_begin("GMRES_leftDiag", resid);
 
 	if ((resid = norm2(r, n) / normb) <= *tol) {
 		*tol = resid;
 		*max_iter = 0;
+		if (gmres_log_on)
+			gmres_log_end(1, 0, resid);
 
 		free(s);
 		free(cs);
@@ -270,7 +276,9 @@ GMRES_leftDiag(const float *val, const  int *rowIndices, const  int *indices,
 		free(H);
 		free(v);
 
+#ifdef GMRES_SHOW_RESID_PROGRESS
 		cout<<endl;
+#endif
 		return 0;
 	}
 
@@ -285,7 +293,7 @@ GMRES_leftDiag(const float *val, const  int *rowIndices, const  int *indices,
 			// XXLiu: w = M.solve(A * v[i]);
 			//computeSpMV(w, val, rowIndices, indices, v+i*n, n);
 			computeSpMV(ww, val, rowIndices, indices, v+i*n, n);
-			computeSpMV(w, m_val, m_rowIndices, m_indices, ww, n);
+			timePrecond(computeSpMV(w, m_val, m_rowIndices, m_indices, ww, n));
 
 			for (k = 0; k <= i; k++) {
 				*(H+k+i*(m+1)) = dot(w, v+k*n, n); // XXLiu: H(k, i) = dot(w, v[k]);
@@ -303,12 +311,17 @@ GMRES_leftDiag(const float *val, const  int *rowIndices, const  int *indices,
 			ApplyPlaneRotation( H+i+i*(m+1), H+(i+1)+i*(m+1), cs[i], sn[i]);
 			ApplyPlaneRotation( s+i, s+(i+1), cs[i], sn[i]);
 
-			if ((resid = fabs(s[i+1]) / normb) < *tol) {
+			resid = fabs(s[i+1]) / normb;
+			if (gmres_log_on)
+				gmres_log_iter(j, resid);
+			if (resid < *tol) {
 				//printf("HOST---BREAK: %6.4e\n",resid);
 				Update(x, i, H, m, s, v, n);
 
 				*tol = resid;
 				*max_iter = j;
+				if (gmres_log_on)
+					gmres_log_end(1, j, resid);
 
 				free(s);
 				free(cs);
@@ -319,10 +332,14 @@ GMRES_leftDiag(const float *val, const  int *rowIndices, const  int *indices,
 				free(H);
 				free(v);
 
+#ifdef GMRES_SHOW_RESID_PROGRESS
 				cout<<endl;
+#endif
 				return 0;
 			}
+#ifdef GMRES_SHOW_RESID_PROGRESS
 			cout<<"HOST---resid: "<<scientific<<resid<<" < "<<*tol<<'\r'<<flush;
+#endif
 
 		}// end of for (i = 0; i < m && j <= *max_iter; i++, j++)
 
@@ -331,13 +348,18 @@ GMRES_leftDiag(const float *val, const  int *rowIndices, const  int *indices,
 		// XXLiu: r = M.solve(b - A * x);
 		//sgemv(r, val, rowIndices, indices, -1.0, x, 1, b, n, n);
 		sgemv(rr, val, rowIndices, indices, -1.0, x, 1, b, n, n);
-		computeSpMV(r, m_val, m_rowIndices, m_indices, rr, n);
+		timePrecond(computeSpMV(r, m_val, m_rowIndices, m_indices, rr, n));
 
 
 		beta = norm2(r, n);
-		if ((resid = beta / normb) < *tol) {
+		resid = beta / normb;
+		if (gmres_log_on)
+			gmres_log_restart(j-1, resid);
+		if (resid < *tol) {
 			*tol = resid;
-			*max_iter = j;
+			*max_iter = j-1;
+			if (gmres_log_on)
+				gmres_log_end(1, j-1, resid);
 
 			free(s);
 			free(cs);
@@ -348,12 +370,16 @@ GMRES_leftDiag(const float *val, const  int *rowIndices, const  int *indices,
 			free(H);
 			free(v);
 
+#ifdef GMRES_SHOW_RESID_PROGRESS
 			cout<<endl;
+#endif
 			return 0;
 		}
 	}// end of while(j <= *max_iter)
 
 	*tol = resid;
+	if (gmres_log_on)
+		gmres_log_end(0, *max_iter, resid);
 
 	free(s);
 	free(cs);
@@ -463,7 +489,9 @@ GMRES_cpu_AINV(const float *val, const  int *rowIndices, const  int *indices,
 		free(H);
 		free(v);
 
+#ifdef GMRES_SHOW_RESID_PROGRESS
 		cout<<endl;
+#endif
 		return 0;
 	}
 
@@ -512,10 +540,14 @@ GMRES_cpu_AINV(const float *val, const  int *rowIndices, const  int *indices,
 				free(H);
 				free(v);
 
+#ifdef GMRES_SHOW_RESID_PROGRESS
 				cout<<endl;
+#endif
 				return 0;
 			}
+#ifdef GMRES_SHOW_RESID_PROGRESS
 			cout<<"HOST---resid: "<<scientific<<resid<<" < "<<*tol<<'\r'<<flush;
+#endif
 		}// end of for (i = 0; i < m && j <= *max_iter; i++, j++)
 
 		Update(x, m-1, H, m, s, v, n);
@@ -540,7 +572,9 @@ GMRES_cpu_AINV(const float *val, const  int *rowIndices, const  int *indices,
 			free(H);
 			free(v);
 
+#ifdef GMRES_SHOW_RESID_PROGRESS
 			cout<<endl;
+#endif
 			return 0;
 		}
 	}// end of while(j <= *max_iter)
@@ -556,7 +590,9 @@ GMRES_cpu_AINV(const float *val, const  int *rowIndices, const  int *indices,
 	free(H);
 	free(v);
 
+#ifdef GMRES_SHOW_RESID_PROGRESS
 	cout<<endl;
+#endif
 	return 1;
 }
 
@@ -618,7 +654,9 @@ GMRES_leftILU0(const float *val, const  int *rowIndices, const  int *indices,
 		free(H);
 		free(v);
 
+#ifdef GMRES_SHOW_RESID_PROGRESS
 		cout<<endl;
+#endif
 		return 0;
 	}
 
@@ -667,10 +705,14 @@ GMRES_leftILU0(const float *val, const  int *rowIndices, const  int *indices,
 				free(H);
 				free(v);
 
+#ifdef GMRES_SHOW_RESID_PROGRESS
 				cout<<endl;
+#endif
 				return 0;
 			}
+#ifdef GMRES_SHOW_RESID_PROGRESS
 			cout<<"HOST---resid: "<<scientific<<resid<<" < "<<*tol<<'\r'<<flush;
+#endif
 
 		}// end of for (i = 0; i < m && j <= *max_iter; i++, j++)
 
@@ -696,7 +738,9 @@ GMRES_leftILU0(const float *val, const  int *rowIndices, const  int *indices,
 			free(H);
 			free(v);
 
+#ifdef GMRES_SHOW_RESID_PROGRESS
 			cout<<endl;
+#endif
 			return 0;
 		}
 	}// end of while(j <= *max_iter)
@@ -712,7 +756,9 @@ GMRES_leftILU0(const float *val, const  int *rowIndices, const  int *indices,
 	free(H);
 	free(v);
 
+#ifdef GMRES_SHOW_RESID_PROGRESS
 	cout<<endl;
+#endif
 	return 1;
 }
 
@@ -758,7 +804,9 @@ GMRES(const float *val, const  int *rowIndices, const  int *indices,
 		free(H);
 		free(v);
 
+#ifdef GMRES_SHOW_RESID_PROGRESS
 		cout<<endl;
+#endif
 		return 0;
 	}
 
@@ -792,7 +840,9 @@ GMRES(const float *val, const  int *rowIndices, const  int *indices,
 			ApplyPlaneRotation( s+i, s+(i+1), cs[i], sn[i]);
 
 			if ((resid = fabs(s[i+1]) / normb) < *tol) {
+#ifdef GMRES_SHOW_RESID_PROGRESS
 			  cout<<"HOST---resid: "<<scientific<<resid<<" < "<<*tol<<'\r'<<flush;
+#endif
 				//printf("HOST---BREAK: %6.4e\n",resid);
 				Update(x, i, H, m, s, v, n);
 
@@ -806,10 +856,14 @@ GMRES(const float *val, const  int *rowIndices, const  int *indices,
 				free(H);
 				free(v);
 
+#ifdef GMRES_SHOW_RESID_PROGRESS
 				cout<<endl;
+#endif
 				return 0;
 			}
+#ifdef GMRES_SHOW_RESID_PROGRESS
 			cout<<"HOST---resid: "<<scientific<<resid<<" < "<<*tol<<'\r'<<flush;
+#endif
 		}// end of for (i = 0; i < m && j <= *max_iter; i++, j++)
 
 		Update(x, m-1, H, m, s, v, n);
@@ -818,7 +872,9 @@ GMRES(const float *val, const  int *rowIndices, const  int *indices,
 		sgemv(r, val, rowIndices, indices, -1.0, x, 1, b, n, n);
 		beta = norm2(r, n);
 		if ((resid = beta / normb) < *tol) {
+#ifdef GMRES_SHOW_RESID_PROGRESS
 		  cout<<"HOST---resid: "<<scientific<<resid<<" < "<<*tol<<'\r'<<flush;
+#endif
 			*tol = resid;
 			*max_iter = j;
 
@@ -829,13 +885,19 @@ GMRES(const float *val, const  int *rowIndices, const  int *indices,
 			free(H);
 			free(v);
 
+#ifdef GMRES_SHOW_RESID_PROGRESS
 			cout<<endl;
+#endif
 			return 0;
 		}
+#ifdef GMRES_SHOW_RESID_PROGRESS
 		cout<<"HOST---resid: "<<scientific<<resid<<" < "<<*tol<<'\r'<<flush;
+#endif
 	}// end of while(j <= *max_iter)
 
+#ifdef GMRES_SHOW_RESID_PROGRESS
 	cout<<"HOST---resid: "<<scientific<<resid<<" < "<<*tol<<'\r'<<flush;
+#endif
 	*tol = resid;
 
 	free(s);
@@ -845,7 +907,9 @@ GMRES(const float *val, const  int *rowIndices, const  int *indices,
 	free(H);
 	free(v);
 
+#ifdef GMRES_SHOW_RESID_PROGRESS
 	cout<<endl;
+#endif
 	return 1;
 }
 
@@ -901,7 +965,9 @@ GMRES_right_diag(const float *val, const  int *rowIndices, const  int *indices,
 		free(H);
 		free(v);
 
+#ifdef GMRES_SHOW_RESID_PROGRESS
 		cout<<endl;
+#endif
 		return 0;
 	}
 
@@ -957,11 +1023,15 @@ GMRES_right_diag(const float *val, const  int *rowIndices, const  int *indices,
 				free(H);
 				free(v);
 
+#ifdef GMRES_SHOW_RESID_PROGRESS
 				cout<<endl;
+#endif
 				return 0;
 			}
+#ifdef GMRES_SHOW_RESID_PROGRESS
 			printf("HOST---resid: %6.4e < %6.4e\n",resid, *tol);
 			cout<<"HOST---resid: "<<scientific<<resid<<" < "<<*tol<<'\r'<<flush;
+#endif
 
 		}// end of for (i = 0; i < m && j <= *max_iter; i++, j++)
 
@@ -986,7 +1056,9 @@ GMRES_right_diag(const float *val, const  int *rowIndices, const  int *indices,
 			free(H);
 			free(v);
 
+#ifdef GMRES_SHOW_RESID_PROGRESS
 			cout<<endl;
+#endif
 			return 0;
 		}
 	}// end of while(j <= *max_iter)
@@ -1000,7 +1072,9 @@ GMRES_right_diag(const float *val, const  int *rowIndices, const  int *indices,
 	free(H);
 	free(v);
 
+#ifdef GMRES_SHOW_RESID_PROGRESS
 	cout<<endl;
+#endif
 	return 1;
 }
 
@@ -1100,7 +1174,9 @@ GMRES_GPU(SpMatrixGPU *Sparse, SpMatrix *spm, dim3 *grid, dim3 *block,
 		*tol = resid;
 		*max_iter = 0;
 		cudaFree(d_r);
+#ifdef GMRES_SHOW_RESID_PROGRESS
 		cout<<endl;
+#endif
 		return 0;
 	}
 
@@ -1149,10 +1225,14 @@ GMRES_GPU(SpMatrixGPU *Sparse, SpMatrix *spm, dim3 *grid, dim3 *block,
 
 				free(H);   free(s);   free(cs);   free(sn);
 				cudaFree(d_v);	cudaFree(d_w);	cudaFree(d_r);
+#ifdef GMRES_SHOW_RESID_PROGRESS
 				cout<<endl;
+#endif
 				return 0;
 			}
+#ifdef GMRES_SHOW_RESID_PROGRESS
 			cout<<"DEV---resid: "<<scientific<<resid<<" < "<<*tol<<'\r'<<flush;
+#endif
 		}
 		Update_GPU(d_x, m-1, H, m, s, d_v, n);
 
@@ -1166,7 +1246,9 @@ GMRES_GPU(SpMatrixGPU *Sparse, SpMatrix *spm, dim3 *grid, dim3 *block,
 
 			free(H);      free(s);      free(cs);      free(sn);
 			cudaFree(d_v);      cudaFree(d_w);      cudaFree(d_r);
+#ifdef GMRES_SHOW_RESID_PROGRESS
 			cout<<endl;
+#endif
 			return 0;
 		}
 	}
@@ -1176,7 +1258,9 @@ GMRES_GPU(SpMatrixGPU *Sparse, SpMatrix *spm, dim3 *grid, dim3 *block,
 	free(H);  free(s);  free(cs);  free(sn);
 	cudaFree(d_v);  cudaFree(d_w);  cudaFree(d_r);
 
+#ifdef GMRES_SHOW_RESID_PROGRESS
 	cout<<endl;
+#endif
 	return 1;
 }
 
@@ -1235,7 +1319,9 @@ GMRES_GPU_leftDiag(SpMatrixGPU *Sparse, SpMatrix *spm, dim3 *grid, dim3 *block,
 		*tol = resid;
 		*max_iter = 0;
 		cudaFree(d_r);
+#ifdef GMRES_SHOW_RESID_PROGRESS
 		cout<<endl;
+#endif
 		return 0;
 	}
 
@@ -1317,10 +1403,14 @@ GMRES_GPU_leftDiag(SpMatrixGPU *Sparse, SpMatrix *spm, dim3 *grid, dim3 *block,
 
 				free(H);   free(s);   free(cs);   free(sn);
 				cudaFree(d_v);	cudaFree(d_w);	cudaFree(d_r);
+#ifdef GMRES_SHOW_RESID_PROGRESS
 				cout<<endl;
+#endif
 				return 0;
 			}
+#ifdef GMRES_SHOW_RESID_PROGRESS
 			cout<<"DEV---resid: "<<scientific<<resid<<" < "<<*tol<<'\r'<<flush;
+#endif
 		}
 		Update_GPU(d_x, m-1, H, m, s, d_v, n);
 
@@ -1363,7 +1453,9 @@ GMRES_GPU_leftDiag(SpMatrixGPU *Sparse, SpMatrix *spm, dim3 *grid, dim3 *block,
 
 			free(H);      free(s);      free(cs);      free(sn);
 			cudaFree(d_v);      cudaFree(d_w);      cudaFree(d_r);
+#ifdef GMRES_SHOW_RESID_PROGRESS
 			cout<<endl;
+#endif
 			return 0;
 		}
 	}
@@ -1380,7 +1472,9 @@ GMRES_GPU_leftDiag(SpMatrixGPU *Sparse, SpMatrix *spm, dim3 *grid, dim3 *block,
 
 	cudaFree(d_m_val); cudaFree(d_m_rowIndices); cudaFree(d_m_indices);
 
+#ifdef GMRES_SHOW_RESID_PROGRESS
 	cout<<endl;
+#endif
 	return 1;
 }
 
@@ -1543,7 +1637,9 @@ GMRES_GPU_leftILU0(SpMatrixGPU *Sparse, SpMatrix *spm, dim3 *grid, dim3 *block,
 		*tol = resid;
 		*max_iter = 0;
 		cudaFree(d_r);
+#ifdef GMRES_SHOW_RESID_PROGRESS
 		cout<<endl;
+#endif
 		return 0;
 	}
 
@@ -1626,10 +1722,14 @@ GMRES_GPU_leftILU0(SpMatrixGPU *Sparse, SpMatrix *spm, dim3 *grid, dim3 *block,
 
 				free(H);   free(s);   free(cs);   free(sn);
 				cudaFree(d_v);	cudaFree(d_w);	cudaFree(d_r);
+#ifdef GMRES_SHOW_RESID_PROGRESS
 				cout<<endl;
+#endif
 				return 0;
 			}
+#ifdef GMRES_SHOW_RESID_PROGRESS
 			cout<<"DEV---resid: "<<scientific<<resid<<" < "<<*tol<<'\r'<<flush;
+#endif
 		}
 		Update_GPU(d_x, m-1, H, m, s, d_v, n);
 
@@ -1672,7 +1772,9 @@ GMRES_GPU_leftILU0(SpMatrixGPU *Sparse, SpMatrix *spm, dim3 *grid, dim3 *block,
 
 			free(H);      free(s);      free(cs);      free(sn);
 			cudaFree(d_v);      cudaFree(d_w);      cudaFree(d_r);
+#ifdef GMRES_SHOW_RESID_PROGRESS
 			cout<<endl;
+#endif
 			return 0;
 		}
 	}
@@ -1691,7 +1793,9 @@ GMRES_GPU_leftILU0(SpMatrixGPU *Sparse, SpMatrix *spm, dim3 *grid, dim3 *block,
 	free(H);  free(s);  free(cs);  free(sn);
 	cudaFree(d_v);  cudaFree(d_w);  cudaFree(d_r);
 
+#ifdef GMRES_SHOW_RESID_PROGRESS
 	cout<<endl;
+#endif
 	return 1;
 }
 
@@ -1751,7 +1855,9 @@ GMRES_GPU_ainv(SpMatrixGPU *Sparse, SpMatrix *spm, dim3 *grid, dim3 *block,
 		*tol = resid;
 		*max_iter = 0;
 		cudaFree(d_r);
+#ifdef GMRES_SHOW_RESID_PROGRESS
 		cout<<endl;
+#endif
 		return 0;
 	}
 
@@ -1835,10 +1941,14 @@ GMRES_GPU_ainv(SpMatrixGPU *Sparse, SpMatrix *spm, dim3 *grid, dim3 *block,
 
 				free(H);   free(s);   free(cs);   free(sn);
 				cudaFree(d_v);	cudaFree(d_w);	cudaFree(d_r);
+#ifdef GMRES_SHOW_RESID_PROGRESS
 				cout<<endl;
+#endif
 				return 0;
 			}
+#ifdef GMRES_SHOW_RESID_PROGRESS
 			cout<<"DEV---resid: "<<scientific<<resid<<" < "<<*tol<<'\r'<<flush;
+#endif
 		}
 		Update_GPU(d_x, m-1, H, m, s, d_v, n);
 
@@ -1881,7 +1991,9 @@ GMRES_GPU_ainv(SpMatrixGPU *Sparse, SpMatrix *spm, dim3 *grid, dim3 *block,
 
 			free(H);      free(s);      free(cs);      free(sn);
 			cudaFree(d_v);      cudaFree(d_w);      cudaFree(d_r);
+#ifdef GMRES_SHOW_RESID_PROGRESS
 			cout<<endl;
+#endif
 			return 0;
 		}
 	}
@@ -1895,7 +2007,9 @@ GMRES_GPU_ainv(SpMatrixGPU *Sparse, SpMatrix *spm, dim3 *grid, dim3 *block,
 	free(H);  free(s);  free(cs);  free(sn);
 	cudaFree(d_v);  cudaFree(d_w);  cudaFree(d_r);
 
+#ifdef GMRES_SHOW_RESID_PROGRESS
 	cout<<endl;
+#endif
 	return 1;
 }
 
@@ -2070,7 +2184,8 @@ int
 GMRESilu(const float *val, const  int *rowIndices, const  int *indices,
          float *x, const float *b, const  int n,
          const  int m, int *max_iter, float *tol, 
-         Preconditioner &preconditioner)// n: rowNum, m: restart threshold
+         Preconditioner &preconditioner,
+         SpMVPlan *plan)// n: rowNum, m: restart threshold
 {
   //printf("         using GMRESilu\n");
   float resid;
@@ -2109,9 +2224,13 @@ GMRESilu(const float *val, const  int *rowIndices, const  int *indices,
   float beta = norm2(r, n);
   //resid = beta / normb;
 
+  if (gmres_log_on)
+    gmres_log_begin("GMRESilu", beta / normb);
   if ((resid = beta / normb) <= *tol) {
     *tol = resid;
     *max_iter = 0;
+    if (gmres_log_on)
+      gmres_log_end(1, 0, resid);
     
     free(s);
     free(cs);
@@ -2140,9 +2259,12 @@ GMRESilu(const float *val, const  int *rowIndices, const  int *indices,
     for (i = 0; i < m && j <= *max_iter; i++, j++) {
       // XXLiu: w = M.solve(A * v[i]);
       //computeSpMV(w, val, rowIndices, indices, v+i*n, n);
-      preconditioner.HostPrecond_right(v+i*n, w);
-      computeSpMV(ww, val, rowIndices, indices, w, n);
-      preconditioner.HostPrecond_left(ww, w);
+      timePrecond(preconditioner.HostPrecond_right(v+i*n, w));
+      if(plan)
+        spmv_run(plan, ww, w);
+      else
+        computeSpMV(ww, val, rowIndices, indices, w, n);
+      timePrecond(preconditioner.HostPrecond_left(ww, w));
       //KuangYa: computeSpMV(ww, val, rowIndices, indices, v+i*n, n);
       //KuangYa: preconditioner.HostPrecond(ww, w);
 
@@ -2162,7 +2284,10 @@ GMRESilu(const float *val, const  int *rowIndices, const  int *indices,
       ApplyPlaneRotation( H+i+i*(m+1), H+(i+1)+i*(m+1), cs[i], sn[i]);
       ApplyPlaneRotation( s+i, s+(i+1), cs[i], sn[i]);
       
-      if ((resid = fabs(s[i+1]) / normb) < *tol) {
+      resid = fabs(s[i+1]) / normb;
+      if (gmres_log_on)
+        gmres_log_iter(j, resid);
+      if (resid < *tol) {
 #ifdef GMRES_SHOW_RESID_PROGRESS
         cout<<"HOST---resid: "<<scientific<<resid<<" < "<<*tol<<'\r'<<flush;
         cout<<endl;
@@ -2173,7 +2298,9 @@ GMRESilu(const float *val, const  int *rowIndices, const  int *indices,
         *tol = resid;
         *max_iter = j;
                                 
-        preconditioner.HostPrecond_right(y, x);
+        timePrecond(preconditioner.HostPrecond_right(y, x));
+        if (gmres_log_on)
+          gmres_log_end(1, j, resid);
 
         free(H);  free(s);  free(cs);  free(sn);
         free(r);
@@ -2194,23 +2321,28 @@ GMRESilu(const float *val, const  int *rowIndices, const  int *indices,
     // printf("restart\n");
     
     Update(y, m-1, H, m, s, v, n);
-    preconditioner.HostPrecond_right(y, x);
+    timePrecond(preconditioner.HostPrecond_right(y, x));
     
     // XXLiu: r = M.solve(b - A * x);
     //sgemv(r, val, rowIndices, indices, -1.0, x, 1, b, n, n);
     sgemv(rr, val, rowIndices, indices, -1.0, x, 1, b, n, n);
-    preconditioner.HostPrecond_rhs(rr, r);
+    timePrecond(preconditioner.HostPrecond_rhs(rr, r));
     //preconditioner.HostPrecond(rr, r);
 
 
     beta = norm2(r, n);
-    if ((resid = beta / normb) < *tol) {
+    resid = beta / normb;
+    if (gmres_log_on)
+      gmres_log_restart(j-1, resid);
+    if (resid < *tol) {
 #ifdef GMRES_SHOW_RESID_PROGRESS
       cout<<"HOST---resid: "<<scientific<<resid<<" < "<<*tol<<'\r'<<flush;
       cout<<endl;
 #endif
       *tol = resid;
-      *max_iter = j;
+      *max_iter = j-1;
+      if (gmres_log_on)
+        gmres_log_end(1, j-1, resid);
 
       free(s);
       free(cs);
@@ -2235,6 +2367,8 @@ GMRESilu(const float *val, const  int *rowIndices, const  int *indices,
   cout<<"HOST---resid: "<<scientific<<resid<<" < "<<*tol<<'\r'<<flush;
 #endif
   *tol = resid;
+  if (gmres_log_on)
+    gmres_log_end(0, *max_iter, resid);
 
   free(s);
   free(cs);
@@ -2251,6 +2385,28 @@ GMRESilu(const float *val, const  int *rowIndices, const  int *indices,
   return 1;
 }
 
+// device preconditioner time for the convergence log: pairs of events
+// around the preconditioner calls (pe[0..1] right, pe[2..3] left), read
+// after the iteration has synchronized
+static void precond_events(cudaEvent_t *pe, bool create)
+{
+  for (int k = 0; k < 4; k++)
+    if (create)
+      cudaEventCreate(pe+k);
+    else
+      cudaEventDestroy(pe[k]);
+}
+
+static double precond_events_time(cudaEvent_t *pe, int npair)
+{
+  float ms, sum = 0;
+  cudaEventSynchronize(pe[2*npair-1]);
+  for (int k = 0; k < npair; k++)
+    if (cudaEventElapsedTime(&ms, pe[2*k], pe[2*k+1]) == cudaSuccess)
+      sum += ms;
+  return sum*1e-3;
+}
+
 int 
 GMRESilu_GPU(float *d_val, int *d_rowIndices, int *d_indices, int nnz,
              float *d_x, float *d_b, const  int n,
@@ -2309,9 +2465,13 @@ GMRESilu_GPU(float *d_val, int *d_rowIndices, int *d_indices, int nnz,
   }
   preconditioner.DevPrecond_rhs(d_rr, d_r);
   float beta = cublasSnrm2(n, d_r, 1);
+  if (gmres_log_on)
+    gmres_log_begin("GMRESilu_GPU", beta / normb);
   if ((resid = beta / normb) <= *tol) {
     *tol = resid;
     *max_iter = 0;
+    if (gmres_log_on)
+      gmres_log_end(1, 0, resid);
 #ifdef GMRES_SHOW_RESID_PROGRESS
     cout<<endl;
 #endif
@@ -2337,6 +2497,9 @@ GMRESilu_GPU(float *d_val, int *d_rowIndices, int *d_indices, int nnz,
   float *s=preconditioner.s, *cs=preconditioner.cs,
     *sn=preconditioner.sn, *H=preconditioner.H; // use preallocated memory instead
   float *d_v=preconditioner.d_v, *d_w=preconditioner.d_w, *d_ww=preconditioner.d_ww;
+  cudaEvent_t pe[4];
+  if (gmres_log_on)
+    precond_events(pe, true);
 
   while (j <= *max_iter) {
     cublasScopy(n, d_r, 1, d_v, 1);
@@ -2347,11 +2510,15 @@ GMRESilu_GPU(float *d_val, int *d_rowIndices, int *d_indices, int nnz,
 
     for (i = 0; i < m && j <= *max_iter; i++, j++) {
       // XXLiu: w = M.solve(A * v[i]);
+      if (gmres_log_on)  cudaEventRecord(pe[0], 0);
       preconditioner.DevPrecond_right(d_v+i*n, d_w);
+      if (gmres_log_on)  cudaEventRecord(pe[1], 0);
       status = cusparseScsrmv( handle, CUSPARSE_OPERATION_NON_TRANSPOSE, n, n, nnz,
                                &one, descr, d_val, d_rowIndices, d_indices,
                                d_w, &zero, d_ww);
+      if (gmres_log_on)  cudaEventRecord(pe[2], 0);
       preconditioner.DevPrecond_left(d_ww, d_w);
+      if (gmres_log_on)  cudaEventRecord(pe[3], 0);
       
       for (k = 0; k <= i; k++) {
         *(H+k+i*(m+1)) = cublasSdot(n, d_w, 1, d_v+k*n, 1); // XXLiu: H(k, i) = dot(w, v[k]);
@@ -2369,17 +2536,29 @@ GMRESilu_GPU(float *d_val, int *d_rowIndices, int *d_indices, int nnz,
       ApplyPlaneRotation( H+i+i*(m+1), H+(i+1)+i*(m+1), cs[i], sn[i]);
       ApplyPlaneRotation( s+i, s+(i+1), cs[i], sn[i]);
       
-      if ((resid = fabs(s[i+1]) / normb) < *tol) {
+      resid = fabs(s[i+1]) / normb;
+      if (gmres_log_on){
+        gmres_log_add_precond(precond_events_time(pe, 2));
+        gmres_log_iter(j, resid);
+      }
+      if (resid < *tol) {
 #ifdef GMRES_SHOW_RESID_PROGRESS
         cout<<"DEV---resid: "<<scientific<<resid<<" < "<<*tol<<'\r'<<flush;
         cout<<endl;
 #endif
         //printf("DEV---BREAK: %6.4e\n",resid);
         Update_GPU(d_y, i, H, m, s, d_v, n);                     
+        if (gmres_log_on)  cudaEventRecord(pe[0], 0);
         preconditioner.DevPrecond_right(d_y, d_x);
+        if (gmres_log_on)  cudaEventRecord(pe[1], 0);
         
         *tol = resid;
         *max_iter = j;
+        if (gmres_log_on){
+          gmres_log_add_precond(precond_events_time(pe, 1));
+          precond_events(pe, false);
+          gmres_log_end(1, j, resid);
+        }
         /*
         free(H);   free(s);   free(cs);   free(sn);
         checkCudaErrors(cudaFree(d_r));
@@ -2397,23 +2576,36 @@ GMRESilu_GPU(float *d_val, int *d_rowIndices, int *d_indices, int nnz,
 #endif
     }
     Update_GPU(d_y, m-1, H, m, s, d_v, n);
+    if (gmres_log_on)  cudaEventRecord(pe[0], 0);
     preconditioner.DevPrecond_right(d_y, d_x);
+    if (gmres_log_on)  cudaEventRecord(pe[1], 0);
 
     cudaMemcpy(d_rr, d_b, n*sizeof(float), cudaMemcpyDeviceToDevice);
     status = cusparseScsrmv( handle, CUSPARSE_OPERATION_NON_TRANSPOSE, n, n, nnz,
                              &neg_one, descr, d_val, d_rowIndices, d_indices,
                              d_x, &one, d_rr);
+    if (gmres_log_on)  cudaEventRecord(pe[2], 0);
     preconditioner.DevPrecond_rhs(d_rr, d_r);
+    if (gmres_log_on)  cudaEventRecord(pe[3], 0);
 
     beta = cublasSnrm2(n, d_r, 1);
-    if ((resid = beta / normb) < *tol) {
+    resid = beta / normb;
+    if (gmres_log_on){
+      gmres_log_add_precond(precond_events_time(pe, 2));
+      gmres_log_restart(j-1, resid);
+    }
+    if (resid < *tol) {
 #ifdef GMRES_SHOW_RESID_PROGRESS
       cout<<"DEV---resid: "<<scientific<<resid<<" < "<<*tol<<'\r'<<flush;
       cout<<endl;
 #endif
 
       *tol = resid;
-      *max_iter = j;
+      *max_iter = j-1;
+      if (gmres_log_on){
+        precond_events(pe, false);
+        gmres_log_end(1, j-1, resid);
+      }
       /*
       free(H);      free(s);      free(cs);      free(sn);
       checkCudaErrors(cudaFree(d_r));
@@ -2429,6 +2621,10 @@ GMRESilu_GPU(float *d_val, int *d_rowIndices, int *d_indices, int nnz,
   }
 
   *tol = resid;
+  if (gmres_log_on){
+    precond_events(pe, false);
+    gmres_log_end(0, *max_iter, resid);
+  }
   /*
   free(H);  free(s);  free(cs);  free(sn);
   checkCudaErrors(cudaFree(d_r));
@@ -2484,13 +2680,19 @@ GMRES_tran(const float *val, const  int *rowIndices, const  int *indices,
 	if (normb == 0.0)  normb = 1;
 
 	resid = norm2(r, n) / normb;
+	if (gmres_log_on)
+		gmres_log_begin("GMRES_tran", resid);
 
 	if ((resid = norm2(r, n) / normb) <= tol) {
+		if (gmres_log_on)
+			gmres_log_end(1, 0, resid);
 
 		free(s); free(cs); free(sn); free(w); free(ww);
 		free(r); free(rr); free(bb); free(H); free(v);
 
+#ifdef GMRES_SHOW_RESID_PROGRESS
 		cout<<endl;
+#endif
 		return 0;
 	}
 
@@ -2505,7 +2707,7 @@ GMRES_tran(const float *val, const  int *rowIndices, const  int *indices,
 			// XXLiu: w = M.solve(A * v[i]);
 			//computeSpMV(w, val, rowIndices, indices, v+i*n, n);
 			computeSpMV(ww, val, rowIndices, indices, v+i*n, n);
-			preconditioner.HostPrecond(ww, w);
+			timePrecond(preconditioner.HostPrecond(ww, w));
 
 			for (k = 0; k <= i; k++) {
 				*(H+k+i*(m+1)) = dot(w, v+k*n, n); // XXLiu: H(k, i) = dot(w, v[k]);
@@ -2523,17 +2725,26 @@ GMRES_tran(const float *val, const  int *rowIndices, const  int *indices,
 			ApplyPlaneRotation( H+i+i*(m+1), H+(i+1)+i*(m+1), cs[i], sn[i]);
 			ApplyPlaneRotation( s+i, s+(i+1), cs[i], sn[i]);
 
-			if ((resid = fabs(s[i+1]) / normb) < tol) {
+			resid = fabs(s[i+1]) / normb;
+			if (gmres_log_on)
+				gmres_log_iter(j, resid);
+			if (resid < tol) {
 				//printf("HOST---BREAK: %6.4e\n",resid);
 				Update(x, i, H, m, s, v, n);
+				if (gmres_log_on)
+					gmres_log_end(1, j, resid);
 
 				free(s); free(cs); free(sn); free(w); free(ww);
 				free(r); free(rr); free(bb); free(H); free(v);
 
+#ifdef GMRES_SHOW_RESID_PROGRESS
 				cout<<endl;
+#endif
 				return 0;
 			}
+#ifdef GMRES_SHOW_RESID_PROGRESS
 			cout<<"HOST---resid: "<<scientific<<resid<<" < "<<tol<<'\r'<<flush;
+#endif
 
 		}// end of for (i = 0; i < m && j <= max_iter; i++, j++)
 
@@ -2542,24 +2753,35 @@ GMRES_tran(const float *val, const  int *rowIndices, const  int *indices,
 		// XXLiu: r = M.solve(b - A * x);
 		//sgemv(r, val, rowIndices, indices, -1.0, x, 1, b, n, n);
 		sgemv(rr, val, rowIndices, indices, -1.0, x, 1, b, n, n);
-		preconditioner.HostPrecond(rr, r);
+		timePrecond(preconditioner.HostPrecond(rr, r));
 
 
 		beta = norm2(r, n);
-		if ((resid = beta / normb) < tol) {
+		resid = beta / normb;
+		if (gmres_log_on)
+			gmres_log_restart(j-1, resid);
+		if (resid < tol) {
+			if (gmres_log_on)
+				gmres_log_end(1, j-1, resid);
 
 			free(s); free(cs); free(sn); free(w); free(ww);
 			free(r); free(rr); free(bb); free(H); free(v);
 
+#ifdef GMRES_SHOW_RESID_PROGRESS
 			cout<<endl;
+#endif
 			return 0;
 		}
 	}// end of while(j <= *max_iter)
 
+	if (gmres_log_on)
+		gmres_log_end(0, max_iter, resid);
 	free(s); free(cs); free(sn); free(w); free(ww);
 	free(r); free(rr); free(bb); free(H); free(v);
 
+#ifdef GMRES_SHOW_RESID_PROGRESS
 	cout<<endl;
+#endif
 	return 1;
 }
 
@@ -2757,12 +2979,22 @@ GMRES_GPU_tran(SpMatrixGPU *Sparse, SpMatrix *spm, dim3 *grid, dim3 *block,
 	preconditioner.DevPrecond(ggd.d_rr, ggd.d_r);
 
 	float beta = cublasSnrm2(n, ggd.d_r, 1);
+	if (gmres_log_on)
+		gmres_log_begin("GMRES_GPU_tran", beta / normb);
 	if ((resid = beta / normb) <= tol) {
+		if (gmres_log_on)
+			gmres_log_end(1, 0, resid);
 
+#ifdef GMRES_SHOW_RESID_PROGRESS
 		cout<<endl;
+#endif
 		return 0;
 	}
 
+	cudaEvent_t pe[4];
+	if (gmres_log_on)
+		precond_events(pe, true);
+
 	while (j <= max_iter) {
 
 		timeSentence(cublasScopy(n, ggd.d_r, 1, ggd.d_v, 1), time_cublas);
@@ -2776,7 +3008,9 @@ GMRES_GPU_tran(SpMatrixGPU *Sparse, SpMatrix *spm, dim3 *grid, dim3 *block,
 			// XXLiu: w = M.solve(A * v[i]);
 			SpMV<<<*grid, *block>>>(ggd.d_ww, Sparse->d_val, Sparse->d_rowIndices, Sparse->d_indices, ggd.d_v+i*n, n, n, spm->numNZEntries);
 			cudaThreadSynchronize();
+			if (gmres_log_on)  cudaEventRecord(pe[0], 0);
 			preconditioner.DevPrecond(ggd.d_ww, ggd.d_w);
+			if (gmres_log_on)  cudaEventRecord(pe[1], 0);
 
 
 			for (k = 0; k <= i; k++) {
@@ -2795,14 +3029,27 @@ GMRES_GPU_tran(SpMatrixGPU *Sparse, SpMatrix *spm, dim3 *grid, dim3 *block,
 			ApplyPlaneRotation( ggd.H+i+i*(m+1), ggd.H+(i+1)+i*(m+1), ggd.cs[i], ggd.sn[i]);
 			ApplyPlaneRotation( ggd.s+i, ggd.s+(i+1), ggd.cs[i], ggd.sn[i]);
 
-			if ((resid = fabs(ggd.s[i+1]) / normb) < tol) {
+			resid = fabs(ggd.s[i+1]) / normb;
+			if (gmres_log_on){
+				gmres_log_add_precond(precond_events_time(pe, 1));
+				gmres_log_iter(j, resid);
+			}
+			if (resid < tol) {
 				//printf("DEV---BREAK: %6.4e\n",resid);
 				Update_GPU(d_x, i, ggd.H, m, ggd.s, ggd.d_v, n);
+				if (gmres_log_on){
+					precond_events(pe, false);
+					gmres_log_end(1, j, resid);
+				}
 
+#ifdef GMRES_SHOW_RESID_PROGRESS
 				cout<<endl;
+#endif
 				return 0;
 			}
+#ifdef GMRES_SHOW_RESID_PROGRESS
 			cout<<"DEV---resid: "<<scientific<<resid<<" < "<<tol<<'\r'<<flush;
+#endif
 		}
 		Update_GPU(d_x, m-1, ggd.H, m, ggd.s, ggd.d_v, n);
 
@@ -2810,18 +3057,35 @@ GMRES_GPU_tran(SpMatrixGPU *Sparse, SpMatrix *spm, dim3 *grid, dim3 *block,
 		//sgemv_GPU(d_r, Sparse, spm, grid, block, -1.0, d_x, 1.0, d_b, n, n);
 		sgemv_GPU(ggd.d_rr, Sparse, spm, grid, block, -1.0, d_x, 1.0, d_b, n, n);
 		cudaThreadSynchronize();
+		if (gmres_log_on)  cudaEventRecord(pe[0], 0);
 		preconditioner.DevPrecond(ggd.d_rr, ggd.d_r);
+		if (gmres_log_on)  cudaEventRecord(pe[1], 0);
 
 		beta = cublasSnrm2(n, ggd.d_r, 1);
+		resid = beta / normb;
+		if (gmres_log_on){
+			gmres_log_add_precond(precond_events_time(pe, 1));
+			gmres_log_restart(j-1, resid);
+		}
 
 
-		if ((resid = beta / normb) < tol) {
+		if (resid < tol) {
+			if (gmres_log_on){
+				precond_events(pe, false);
+				gmres_log_end(1, j-1, resid);
+			}
 
+#ifdef GMRES_SHOW_RESID_PROGRESS
 			cout<<endl;
+#endif
 			return 0;
 		}
 	}
 
+	if (gmres_log_on){
+		precond_events(pe, false);
+		gmres_log_end(0, max_iter, resid);
+	}
 	cout<<"Failure"<<endl;
 	return 1;
 }
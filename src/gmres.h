@@ -51,6 +51,7 @@
 #include "defs.h"
 
 #include "preconditioner.h"
+#include "SpMV_tune.h"
 
 #define REAL float
 
@@ -62,10 +63,10 @@ using namespace std;
 // to get the ratio of time for different operations of GPU
 
 #if SUB_TIMER
-	static timeval st, et;
-	static float time_trisolve = 0.0f, time_spmv = 0.0f, time_cublas = 0.0f;
+	static __thread timeval st, et;
+	static __thread float time_trisolve = 0.0f, time_spmv = 0.0f, time_cublas = 0.0f;
 
-	void summary_time(){
+	static void summary_time(){
 		printf("********** The time used for cublas operation is %f\n", time_cublas);
 		printf("********** The time used for tri-matrix solving is %f\n", time_trisolve);
 		printf("********** The time used for sparse matrix-vector multiply is %f\n", time_spmv);
@@ -390,7 +391,8 @@ int
 GMRESilu(const float *val, const  int *rowIndices, const  int *indices,
          float *x, const float *b, const  int n,
          const  int m, int *max_iter, float *tol, 
-         Preconditioner &preconditioner);// n: rowNum, m: restart threshold
+         Preconditioner &preconditioner,
+         SpMVPlan *plan = NULL);// n: rowNum, m: restart threshold, plan: spmv_plan() of val, NULL: CSR
 int 
 GMRESilu_GPU(float *val, int *rowIndices, int *indices, int nnz,
          float *x, float *b, const  int n,
@@ -10,12 +10,15 @@ void gmresInterfacePG::setPrecondPG(MySpMatrix *A,
                                     MySpMatrixDouble *PrLeft, MySpMatrixDouble *PrRight,
                                     MySpMatrix *PrMiddle,
                                     MySpMatrix *PrPermRow, MySpMatrix *PrPermCol,
-                                    MySpMatrixDouble *PrLscale, MySpMatrixDouble *PrRscale)
+                                    MySpMatrixDouble *PrLscale, MySpMatrixDouble *PrRscale,
+                                    SpMVCache *cache, int spmv_opt)
 {
   matrixSize = A->numRows;
   h_val = A->val;
   h_rowPtr = A->rowIndices;
   h_colIdx = A->indices;
+  // fastest host format for A, chosen once here rather than per solve
+  plan = spmv_opt ? spmv_plan(cache, h_val, h_rowPtr, h_colIdx, matrixSize, spmv_opt) : NULL;
   
   xgmres_h = (float*)malloc(matrixSize*sizeof(float));
   rhs_h = (float*)malloc(matrixSize*sizeof(float));
@@ -23,7 +26,7 @@ void gmresInterfacePG::setPrecondPG(MySpMatrix *A,
   Precond = (Preconditioner *)new MyILUPP(); // MyNONE;//
   //((MyILUPP *) Precond)->Initilize(*A);
   ((MyILUPP *) Precond)->Initilize(*PrLeft, *PrRight, *PrMiddle, *PrPermRow, *PrPermCol,
-                                   *PrLscale, *PrRscale);
+                                   *PrLscale, *PrRscale, spmv_opt);
   printf("ILU++double has been constructed.\n");
 }
 
@@ -31,12 +34,14 @@ void gmresInterfacePGfloat::setPrecondPG(MySpMatrix *A,
                                          MySpMatrixDouble *PrLeft, MySpMatrixDouble *PrRight,
                                          MySpMatrix *PrMiddle,
                                          MySpMatrix *PrPermRow, MySpMatrix *PrPermCol,
-                                         MySpMatrix *PrLscale, MySpMatrix *PrRscale)
+                                         MySpMatrix *PrLscale, MySpMatrix *PrRscale,
+                                         SpMVCache *cache, int spmv_opt)
 {
   matrixSize = A->numRows;
   h_val = A->val;
   h_rowPtr = A->rowIndices;
   h_colIdx = A->indices;
+  plan = spmv_opt ? spmv_plan(cache, h_val, h_rowPtr, h_colIdx, matrixSize, spmv_opt) : NULL;
   nnz = h_rowPtr[matrixSize];
   
   cudaMalloc((void**)&d_val, nnz*sizeof(float));
@@ -55,7 +60,7 @@ void gmresInterfacePGfloat::setPrecondPG(MySpMatrix *A,
   Precond = (Preconditioner *)new MyILUPPfloat(); // MyNONE;//
   //((MyILUPP *) Precond)->Initilize(*A);
   ((MyILUPPfloat *) Precond)->Initilize(*PrLeft, *PrRight, *PrMiddle, *PrPermRow, *PrPermCol,
-                                        *PrLscale, *PrRscale, restart);
+                                        *PrLscale, *PrRscale, restart, spmv_opt);
   // printf("ILU++float has been constructed.\n");
 }
 
@@ -71,7 +76,7 @@ int gmresInterfacePG::GMRES_host_PG()
   // solve with preconditioned GMRES on Host
   // for(int i=0; i<N; i++)  xTranGMREShost[i] = 0.0;
   int result = GMRESilu(h_val, h_rowPtr, h_colIdx, xgmres_h, rhs_h, matrixSize,
-                        restart, &max_it, &tol, *precond);
+                        restart, &max_it, &tol, *precond, plan);
   gettimeofday(&et, NULL);
   // float cputime = (et.tv_sec-st.tv_sec)*1000.0 + (et.tv_usec - st.tv_usec)/1000.0;
   // printf("CPU GMRES flag = %d\n", result);
@@ -95,7 +100,7 @@ int gmresInterfacePGfloat::GMRES_host_PG()
   // solve with preconditioned GMRES on Host
   // for(int i=0; i<N; i++)  xTranGMREShost[i] = 0.0;
   int result = GMRESilu(h_val, h_rowPtr, h_colIdx, xgmres_h, rhs_h, matrixSize,
-                        restart, &max_it, &tol, *precond);
+                        restart, &max_it, &tol, *precond, plan);
   gettimeofday(&et, NULL);
   // float cputime = (et.tv_sec-st.tv_sec)*1000.0 + (et.tv_usec - st.tv_usec)/1000.0;
   // printf("CPU GMRES flag = %d\n", result);
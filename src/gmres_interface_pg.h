@@ -1,6 +1,7 @@
 #ifndef _GMRES_INTERFACE_PG_H_
 #define _GMRES_INTERFACE_PG_H_
 #include "SpMV.h"
+#include "SpMV_tune.h"
 
 class gmresInterfacePG {
  public:
@@ -26,12 +27,14 @@ class gmresInterfacePG {
   
   int max_it; // both input and output
   float tol;
+  SpMVPlan *plan; // host SpMV of A, NULL: CSR
 
   void setPrecondPG(MySpMatrix *A,
                     MySpMatrixDouble *PrLeft, MySpMatrixDouble *PrRight,
                     MySpMatrix *PrMiddle_mySpM,
                     MySpMatrix *PrPermRow, MySpMatrix *PrPermCol,
-                    MySpMatrixDouble *PrLscale, MySpMatrixDouble *PrRscale);
+                    MySpMatrixDouble *PrLscale, MySpMatrixDouble *PrRscale,
+                    SpMVCache *cache, int spmv_opt);
   int GMRES_host_PG();  
 };
 
@@ -62,12 +65,14 @@ class gmresInterfacePGfloat {
 
   int max_it; // both input and output
   float tol;
+  SpMVPlan *plan; // host SpMV of A, NULL: CSR
 
   void setPrecondPG(MySpMatrix *A,
                     MySpMatrixDouble *PrLeft, MySpMatrixDouble *PrRight,
                     MySpMatrix *PrMiddle_mySpM,
                     MySpMatrix *PrPermRow, MySpMatrix *PrPermCol,
-                    MySpMatrix *PrLscale, MySpMatrix *PrRscale);
+                    MySpMatrix *PrLscale, MySpMatrix *PrRscale,
+                    SpMVCache *cache, int spmv_opt);
   int GMRES_host_PG();
   int GMRES_dev_PG();  
 };
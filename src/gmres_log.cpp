@@ -0,0 +1,276 @@
+/*
+*******************************************************
+
+    Cadence Extended Truncated Balanced Realization
+                (*** CadETBR ***)
+
+*******************************************************
+*/
+
+/*
+ *    $RCSfile: gmres_log.cpp,v $
+ *    $Revision: 1.1 $
+ *    $Date: 2013/03/23 21:08:01 $
+ *
+ *    Functions: Convergence history of the GMRES solves
+ *
+ *    A solve appends its history to the state of its thread, which keeps
+ *    its capacity from one solve to the next, so an iteration costs a
+ *    clock read and a store. The file is written and the callback is
+ *    called once per solve, in gmres_log_end; nothing is printed while
+ *    the solver iterates. Each analysis has its own GMRES_LOG, bound to
+ *    the thread that runs its solves.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include "gmres_log.h"
+
+using namespace std;
+
+__thread int gmres_log_on = 0;
+
+struct GMRES_RUN {
+  GMRES_LOG *log;
+  int thread;
+  int step;
+  double t;
+  const char *solver;
+  double t0, precond;
+  int restarts;
+  bool open;
+  vector<GMRES_ITER> hist;
+};
+
+struct GMRES_SUM {
+  int step;
+  int converged, iterations, restarts;
+  double wall, precond;
+};
+
+struct GMRES_LOG {
+  FILE *file;
+  gmres_log_callback cb;
+  void *cb_arg;
+  vector<GMRES_SUM> solves;
+  pthread_mutex_t lock;
+};
+
+static pthread_mutex_t gl_lock = PTHREAD_MUTEX_INITIALIZER;
+static int gl_nthreads = 0;
+static __thread GMRES_RUN *gl_self = NULL;
+
+double gmres_log_clock()
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec*1e-9;
+}
+
+static GMRES_RUN *gl_run()
+{
+  if (gl_self != NULL)
+    return gl_self;
+  GMRES_RUN *R = new GMRES_RUN;
+  pthread_mutex_lock(&gl_lock);
+  R->thread = gl_nthreads++;
+  pthread_mutex_unlock(&gl_lock);
+  R->log = NULL;
+  R->step = -1;
+  R->t = 0;
+  R->open = false;
+  gl_self = R;
+  return R;
+}
+
+GMRES_LOG *gmres_log_create(const char *file)
+{
+  GMRES_LOG *log = new GMRES_LOG;
+  log->file = NULL;
+  log->cb = NULL;
+  log->cb_arg = NULL;
+  pthread_mutex_init(&log->lock, NULL);
+  if (file != NULL){
+    log->file = fopen(file, "w");
+    if (log->file == NULL){
+      printf("Can not open %s.\n", file);
+      exit(-1);
+    }
+    fprintf(log->file, "solve,thread,solver,step,t,kind,iter,resid,wall_s,precond_s\n");
+  }
+  return log;
+}
+
+void gmres_log_set_callback(GMRES_LOG *log, gmres_log_callback cb, void *arg)
+{
+  log->cb = cb;
+  log->cb_arg = arg;
+}
+
+void gmres_log_free(GMRES_LOG *log)
+{
+  if (log->file != NULL)
+    fclose(log->file);
+  pthread_mutex_destroy(&log->lock);
+  delete log;
+}
+
+void gmres_log_bind(GMRES_LOG *log)
+{
+  GMRES_RUN *R = gl_run();
+  R->log = log;
+  R->open = false;
+  gmres_log_on = log != NULL;
+}
+
+void gmres_log_step(int step, double t)
+{
+  GMRES_RUN *R = gl_run();
+  R->step = step;
+  R->t = t;
+}
+
+void gmres_log_begin(const char *solver, float resid0)
+{
+  if (!gmres_log_on)
+    return;
+  GMRES_RUN *R = gl_run();
+  R->solver = solver;
+  R->precond = 0;
+  R->restarts = 0;
+  R->hist.clear();
+  R->open = true;
+  R->t0 = gmres_log_clock();
+  gmres_log_iter(0, resid0);
+}
+
+void gmres_log_iter(int iter, float resid)
+{
+  GMRES_RUN *R = gl_self;
+  if (R == NULL || !R->open)
+    return;
+  GMRES_ITER p;
+  p.kind = 'i';
+  p.iter = iter;
+  p.resid = resid;
+  p.wall = gmres_log_clock() - R->t0;
+  p.precond = R->precond;
+  R->hist.push_back(p);
+}
+
+void gmres_log_restart(int iter, float resid)
+{
+  GMRES_RUN *R = gl_self;
+  if (R == NULL || !R->open)
+    return;
+  gmres_log_iter(iter, resid);
+  R->hist.back().kind = 'r';
+  R->restarts++;
+}
+
+void gmres_log_add_precond(double sec)
+{
+  if (gl_self != NULL)
+    gl_self->precond += sec;
+}
+
+void gmres_log_end(int converged, int iter, float resid)
+{
+  GMRES_RUN *R = gl_self;
+  if (R == NULL || !R->open)
+    return;
+  R->open = false;
+  GMRES_LOG *log = R->log;
+  GMRES_SOLVE s;
+  s.thread = R->thread;
+  s.solver = R->solver;
+  s.step = R->step;
+  s.t = R->t;
+  s.converged = converged;
+  s.iterations = iter;
+  s.restarts = R->restarts;
+  s.resid = resid;
+  s.wall = gmres_log_clock() - R->t0;
+  s.precond = R->precond;
+  s.nhist = R->hist.size();
+  s.hist = R->hist.empty() ? NULL : &R->hist[0];
+
+  GMRES_SUM sum;
+  sum.step = s.step;
+  sum.converged = converged;
+  sum.iterations = iter;
+  sum.restarts = s.restarts;
+  sum.wall = s.wall;
+  sum.precond = s.precond;
+
+  pthread_mutex_lock(&log->lock);
+  s.id = log->solves.size();
+  log->solves.push_back(sum);
+  if (log->file != NULL){
+    for (int k = 0; k < s.nhist; k++)
+      fprintf(log->file, "%ld,%d,%s,%d,%.9g,%s,%d,%.6e,%.6e,%.6e\n",
+	      s.id, s.thread, s.solver, s.step, s.t, s.hist[k].kind == 'r' ? "restart" : "iter",
+	      s.hist[k].iter, s.hist[k].resid, s.hist[k].wall, s.hist[k].precond);
+    fprintf(log->file, "%ld,%d,%s,%d,%.9g,%s,%d,%.6e,%.6e,%.6e\n",
+	    s.id, s.thread, s.solver, s.step, s.t, converged ? "converged" : "failed",
+	    iter, resid, s.wall, s.precond);
+  }
+  pthread_mutex_unlock(&log->lock);
+
+  if (log->cb != NULL)
+    log->cb(&s, log->cb_arg);
+}
+
+void gmres_log_report(GMRES_LOG *log)
+{
+  pthread_mutex_lock(&log->lock);
+  long nsolve = log->solves.size(), failed = 0, iters = 0, restarts = 0;
+  int imin = 0, imax = 0;
+  double wall = 0, precond = 0;
+  map<int, int> per_step;	/* iterations of every transient step */
+  for (long k = 0; k < nsolve; k++){
+    const GMRES_SUM &s = log->solves[k];
+    if (!s.converged)
+      failed++;
+    iters += s.iterations;
+    restarts += s.restarts;
+    wall += s.wall;
+    precond += s.precond;
+    if (k == 0 || s.iterations < imin)
+      imin = s.iterations;
+    if (k == 0 || s.iterations > imax)
+      imax = s.iterations;
+    if (s.step >= 0)
+      per_step[s.step] += s.iterations;
+  }
+  pthread_mutex_unlock(&log->lock);
+
+  printf("****** GMRES convergence ******\n");
+  printf("solves:                %ld (%ld failed)\n", nsolve, failed);
+  if (nsolve == 0)
+    return;
+  printf("iterations:            %ld, %ld restarts\n", iters, restarts);
+  printf("iterations per solve:  min %d  mean %.1f  max %d\n",
+	 imin, (double)iters/nsolve, imax);
+  if (!per_step.empty()){
+    int smin = per_step.begin()->second, smax = smin, worst = per_step.begin()->first;
+    long ssum = 0;
+    for (map<int, int>::iterator it = per_step.begin(); it != per_step.end(); ++it){
+      ssum += it->second;
+      smin = min(smin, it->second);
+      if (it->second > smax){
+	smax = it->second;
+	worst = it->first;
+      }
+    }
+    printf("iterations per step:   min %d  mean %.1f  max %d (step %d) over %d steps\n",
+	   smin, (double)ssum/per_step.size(), smax, worst, (int)per_step.size());
+  }
+  printf("solve time:            %.3f s, preconditioner %.3f s (%.0f%%)\n",
+	 wall, precond, wall > 0 ? 100*precond/wall : 0.0);
+}
@@ -0,0 +1,92 @@
+/*
+*******************************************************
+
+    Cadence Extended Truncated Balanced Realization
+                (*** CadETBR ***)
+
+*******************************************************
+*/
+
+/*
+ *    $RCSfile: gmres_log.h,v $
+ *    $Revision: 1.1 $
+ *    $Date: 2013/03/23 21:08:01 $
+ *
+ *    Functions: Convergence history of the GMRES solves header
+ *
+ */
+
+#ifndef GMRES_LOG_H
+#define GMRES_LOG_H
+
+/* one point of the history of a solve: the residual after an Arnoldi
+   step ('i', iter 0 is the starting residual) or the true residual
+   recomputed at a restart ('r'); wall and precond are the seconds since
+   the start of the solve */
+struct GMRES_ITER {
+  char kind;
+  int iter;
+  float resid;
+  double wall, precond;
+};
+
+/* a finished solve, as passed to the callback */
+struct GMRES_SOLVE {
+  long id;			/* solves are numbered in the order they end */
+  int thread;
+  const char *solver;
+  int step;			/* transient step of gmres_log_step, -1 outside */
+  double t;
+  int converged, iterations, restarts;
+  float resid;
+  double wall, precond;
+  int nhist;
+  const GMRES_ITER *hist;
+};
+
+typedef void (*gmres_log_callback)(const GMRES_SOLVE *s, void *arg);
+
+/* the log of one analysis (SOLVER_CTX::gmres_log) */
+typedef struct GMRES_LOG GMRES_LOG;
+
+/* -gmres_log file: one CSV line per iteration, restart and solve;
+   NULL file: only the callback and the report */
+GMRES_LOG *gmres_log_create(const char *file);
+/* called on the solving thread at the end of every solve */
+void gmres_log_set_callback(GMRES_LOG *log, gmres_log_callback cb, void *arg);
+void gmres_log_free(GMRES_LOG *log);
+
+/* the following solves of this thread go to log, NULL: not logged */
+void gmres_log_bind(GMRES_LOG *log);
+
+/* nonzero while this thread is bound to a log; the solvers test it
+   before they read the clock */
+extern __thread int gmres_log_on;
+
+/* the transient step the following solves of this thread belong to */
+void gmres_log_step(int step, double t);
+
+/* for the solvers */
+void gmres_log_begin(const char *solver, float resid0);
+void gmres_log_iter(int iter, float resid);
+void gmres_log_restart(int iter, float resid);
+void gmres_log_end(int converged, int iter, float resid);
+double gmres_log_clock();
+void gmres_log_add_precond(double sec);
+
+/* a preconditioner call, timed when the log is on */
+#define timePrecond(a)						\
+  do{								\
+    if (gmres_log_on){						\
+      double gl_t0 = gmres_log_clock();				\
+      (a);							\
+      gmres_log_add_precond(gmres_log_clock()-gl_t0);		\
+    }else							\
+      (a);							\
+  }while(0)
+
+/* solves, iterations per time step, restarts and the preconditioner
+   share of the solve time on stdout */
+void gmres_log_report(GMRES_LOG *log);
+
+#endif
@@ -36,22 +36,24 @@
 #include "interp.h"
 #include "svd0.h"
 #include "cs.h"
+#include "phase_timer.h"
 #include <pthread.h>
 
 using namespace itpp;
 
-AXBDATA pdata2011;
-
-
 void *solve_axb2011(void * threadarg)
 {
+  AXBTASK *task = (AXBTASK *) threadarg;
+  AXBDATA &pdata2011 = task->ctx->axb;
   UF_long nDim = pdata2011.B->m;
   UF_long nSDim = pdata2011.B->n;
   cs_dls *Symbolic;
   cs_dln *Numeric;
   int order = 2;
   double tol = 1e-14;
-  int i = *(int*) threadarg;
+  int i = task->i;
+  phase_thread_name("solve_axb");
+  phase_begin("solve_axb");
 
   cs_dl *A;
   if (pdata2011.C != NULL)
@@ -67,6 +69,8 @@ void *solve_axb2011(void * threadarg)
   Symbolic = cs_dl_sqr(order, A, 0);
 
   Numeric = cs_dl_lu(A, Symbolic, tol);
+  phase_count("nnz", (double)Ap[A->n]);
+  phase_count("factor_nnz", (double)(Numeric->L->p[A->n] + Numeric->U->p[A->n]));
 
   /* solve Az = b  */
   vec x(nDim);
@@ -87,13 +91,9 @@ void *solve_axb2011(void * threadarg)
 	cs_dl_spfree(A);
 
   pdata2011.zvec[i] = z;
-  /*
-  pthread_mutex_lock(&mutexz);
-  pdata2011.Z.set_col(i, z);	
-  pthread_mutex_unlock(&mutexz);
-  */
+  phase_end();
 
-  pthread_exit((void*) 0);
+  return NULL;
 }
 
 
@@ -102,8 +102,9 @@ void gpu_etbr_thread(cs_dl *G, cs_dl *C, cs_dl *B,
 		     Source *VS, int nVS, Source *IS, int nIS, 
 		     double tstep, double tstop, int q, 
 		     mat &Gr, mat &Cr, mat &Br, mat &X,
-		     double &max_i, int &max_i_idx, gpuETBR *myGPUetbr)
+		     double &max_i, int &max_i_idx, gpuETBR *myGPUetbr, SOLVER_CTX *ctx)
 {
+  AXBDATA &pdata2011 = ctx->axb;
 
   Real_Timer interp_run_time, fft_run_time, sCpG_run_time;
   Real_Timer cs_symbolic, cs_numeric, cs_solve;
@@ -163,14 +164,12 @@ void gpu_etbr_thread(cs_dl *G, cs_dl *C, cs_dl *B,
   else
     form_vec(ts, 0, tstep, tstop);
 
-  int fft_n = 512;
+  int fft_n;
   int L = ts.size(), ldUt=((L+31)/32)*32, nBat=2048;
-  int N = 10;  //1024 samples    
 
   /* FFT */
-  //int N = floor_i(log2(L))+1;
-  
-  fft_n = pow2i(N);
+  double f_min, f_max;
+  etbr_sampling(tstep, fft_n, f_min, f_max);
   std::cout << "# time steps: "<< L << " ldUt=" << ldUt << std::endl;
   std::cout << "# FFT points: "<< fft_n << std::endl;
     
@@ -182,8 +181,6 @@ void gpu_etbr_thread(cs_dl *G, cs_dl *C, cs_dl *B,
 #endif 
     
   /* sampling: uniform in log scale */
-  double f_min = 1/tstep/fft_n;
-  double f_max = 0.5/tstep;
   vec lin_samples;
   vec samples;
   if(q > 6){
@@ -307,35 +304,24 @@ void gpu_etbr_thread(cs_dl *G, cs_dl *C, cs_dl *B,
   //pdata2011.us.set_size(nVS+nIS, np);
   pdata2011.us = &us;
 	
-  /* Solve Ax=b */
-  pthread_t* threads = new pthread_t[np];
-  int ** thd_idx = new int*[np];
-  pthread_attr_t attr;
-  void *status;
+  /* Solve Ax=b, on the pool of the context or on a thread per sample */
   pdata2011.zvec = new vec[np];
   pdata2011.G = G;
   pdata2011.C = C;
   pdata2011.B = B;
-  //pthread_mutex_init(&mutexz, NULL);
-  pthread_attr_init(&attr);
-  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
-
-  for (int i = 0; i < np; i++){
-	thd_idx[i] = new int;
-	*thd_idx[i] = i;
-	pthread_create(&threads[i], &attr, solve_axb2011, (void *)thd_idx[i]);
-  }
-  pthread_attr_destroy(&attr);
-  for (int i = 0; i < np; i++){
-	pthread_join(threads[i], &status);
-  }
-  //pthread_mutex_destroy(&mutexz);
-
-  delete [] threads;
+  AXBTASK *tasks = new AXBTASK[np];
+  void **args = new void*[np];
   for (int i = 0; i < np; i++){
-	delete thd_idx[i];
+	tasks[i].ctx = ctx;
+	tasks[i].i = i;
+	args[i] = &tasks[i];
   }
-  delete [] thd_idx;
+  THREAD_POOL *pool = ctx->pool != NULL ? ctx->pool : pool_create(np);
+  pool_wait(pool_submit(pool, solve_axb2011, args, np));
+  if (pool != ctx->pool)
+	pool_free(pool);
+  delete [] tasks;
+  delete [] args;
 
   /* SVD */
   svd_run_time.start();
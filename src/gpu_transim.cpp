@@ -38,8 +38,6 @@
 #include "gpuData.h"
 //extern "C" void cudaTranSim(gpuETBR *myGPUetbr);
 
-extern long interp2_sum;
-
 using namespace itpp;
 using namespace std;
 
@@ -27,9 +27,6 @@
 
 using namespace itpp;
 
-long interp1_sum = 0;
-long interp2_sum = 0;
-
 void find_nextpos(const vec &x0, double x, int &a, int &b, int cur)
 {
   if (cur == -1){
@@ -112,7 +109,6 @@ void find_nextpos(const vec &x0, double x, int &cur)
   }	
   if (x > x0(cur+1)){
 	for (int i = cur+1; i < len-1; i++){
-	  //interp1_sum++;
 	  if (x <= x0(i+1)){
 		cur = i;
 		return;
@@ -140,8 +136,6 @@ void interp1(const vec &x0, const vec &y0, double x, double &y, int &cur)
     return;
   }else if (x > x0(cur+1)){
 	for (int i = cur+1; i < len-1; i++){
-	  // interp2_sum++;
-	  // std::cout << interp2_sum << std::endl;
 	  if (x <= x0(i+1)){
 		cur = i;
 		y = y0(cur) + (x - x0(cur)) * (y0(cur+1) - y0(cur)) / (x0(cur+1) - x0(cur));
@@ -154,7 +148,6 @@ void interp1(const vec &x0, const vec &y0, double x, double &y, int &cur)
 	  return;	
 	}
   }else{
-	// interp2_sum++;
 	y = y0(cur) + (x - x0(cur)) * (y0(cur+1) - y0(cur)) / (x0(cur+1) - x0(cur));
   }
 }
@@ -195,8 +188,6 @@ void interp1(const vec &x0, const vec &y0, double x, double &y, int &cur, vec &s
   else{
   	y = y0[cur] + (x - x0[cur]) * slope[cur];
   }
-  //interp2_sum++;
-  //std::cout << interp2_sum << std::endl;
   //y = y0[cur] + (x - x0[cur]) * slope[cur];
 }
 
@@ -288,7 +279,6 @@ void interp1(const vec &x0, const vec &y0, const vec &x, vec &y)
 	if (cur == len0-1){
 	  y(i) = y0(len0-1);
 	}else{
-	  //interp1_sum++;
 	  if (x0(cur+1) == x0(cur)){
 	    y(i) = y0(cur);
 	  }else{
@@ -0,0 +1,126 @@
+/*
+*******************************************************
+
+    Cadence Extended Truncated Balanced Realization
+                (*** CadETBR ***)
+
+*******************************************************
+*/
+
+/*
+ *    $RCSfile: isvd.cpp,v $
+ *    $Revision: 1.1 $
+ *    $Date: 2013/03/23 21:08:01 $
+ *
+ *    Functions: Incremental thin-QR based SVD
+ *
+ */
+
+#include <iostream>
+#include <cmath>
+#include <itpp/base/algebra/svd.h>
+#include "isvd.h"
+
+using namespace std;
+
+void isvd_init(ISVD &s, int n, int np)
+{
+  s.n = n;
+  s.np = np;
+  s.m = 0;
+  s.k = 0;
+  s.Q.set_size(n, np, false);
+  s.R.set_size(np, np, false);
+  s.R.zeros();
+}
+
+void isvd_add_col(ISVD &s, const double *z)
+{
+  if (s.m >= s.np){
+	cout << "isvd_add_col: more than " << s.np << " columns" << endl;
+	exit(-1);
+  }
+  int n = s.n;
+  int k = s.k;
+  double *q = s.Q._data();
+  double *r = s.R._data() + s.m*s.np;
+  double *w = q + k*n;   /* the next free column of Q */
+  double *h = new double[k>0?k:1];
+
+  double norm0 = 0;
+  for (int i = 0; i < n; i++){
+	w[i] = z[i];
+	norm0 += z[i]*z[i];
+  }
+  norm0 = sqrt(norm0);
+
+  for (int pass = 0; pass < 2; pass++){
+	for (int j = 0; j < k; j++){
+	  const double *qj = q + j*n;
+	  double t = 0;
+	  for (int i = 0; i < n; i++)
+		t += qj[i]*w[i];
+	  h[j] = t;
+	}
+	for (int j = 0; j < k; j++){
+	  const double *qj = q + j*n;
+	  double t = h[j];
+	  for (int i = 0; i < n; i++)
+		w[i] -= t*qj[i];
+	  r[j] += t;
+	}
+  }
+  delete [] h;
+
+  double norm = 0;
+  for (int i = 0; i < n; i++)
+	norm += w[i]*w[i];
+  norm = sqrt(norm);
+
+  /* drop the direction if nothing is left after the projection */
+  if (norm > 1e-12*norm0 && norm > 0){
+	for (int i = 0; i < n; i++)
+	  w[i] /= norm;
+	r[k] = norm;
+	s.k++;
+  }
+  s.m++;
+}
+
+void isvd_finish(ISVD &s, mat &U, vec &S, int &q, double tol)
+{
+  int k = s.k;
+  mat Ur, Vr;
+  if (k == 0){
+	U.set_size(s.n, 0);
+	S.set_size(0);
+	q = 0;
+	return;
+  }
+  svd(s.R(0, k-1, 0, s.m-1), Ur, S, Vr);
+
+  if (q > k)
+	q = k;
+  if (tol > 0){
+	int nq = 0;
+	while (nq < q && S(nq) > tol*S(0))
+	  nq++;
+	q = nq;
+  }
+
+  /* U = Q*Ur(:,0:q-1) */
+  U.set_size(s.n, q, false);
+  U.zeros();
+  const double *qd = s.Q._data();
+  for (int j = 0; j < q; j++){
+	double *uj = U._data() + j*s.n;
+	for (int l = 0; l < k; l++){
+	  double t = Ur(l, j);
+	  const double *ql = qd + l*s.n;
+	  for (int i = 0; i < s.n; i++)
+		uj[i] += t*ql[i];
+	}
+  }
+  s.Q.set_size(0, 0);
+  s.R.set_size(0, 0);
+}
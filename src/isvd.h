@@ -0,0 +1,48 @@
+/*
+*******************************************************
+
+    Cadence Extended Truncated Balanced Realization
+                (*** CadETBR ***)
+
+*******************************************************
+*/
+
+/*
+ *    $RCSfile: isvd.h,v $
+ *    $Revision: 1.1 $
+ *    $Date: 2013/03/23 21:08:01 $
+ *
+ *    Functions: Incremental thin-QR based SVD header
+ *
+ */
+
+#ifndef ISVD_H
+#define ISVD_H
+
+#include <itpp/base/vec.h>
+#include <itpp/base/mat.h>
+
+using namespace itpp;
+
+/* Z = Q*R is grown one sample column at a time, so the n x np
+   sample matrix is never formed; the SVD is taken on the small R */
+typedef struct{
+  int n;         /* length of the columns */
+  int np;        /* maximum number of columns */
+  int m;         /* number of columns added */
+  int k;         /* rank, number of columns of Q in use */
+  mat Q;         /* n x np, orthonormal in the first k columns */
+  mat R;         /* np x np, the leading k x m block is used */
+}ISVD;
+
+void isvd_init(ISVD &s, int n, int np);
+
+/* orthogonalize z against Q (classical Gram-Schmidt, twice) and
+   append it; a column already in span(Q) only adds a column to R */
+void isvd_add_col(ISVD &s, const double *z);
+
+/* U = the first q left singular vectors of Z, S = all singular values;
+   if tol > 0, q is lowered to the number of S(i) > tol*S(0) */
+void isvd_finish(ISVD &s, mat &U, vec &S, int &q, double tol);
+
+#endif
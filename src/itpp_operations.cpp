@@ -79,3 +79,59 @@ void multiply(mat& a, double* x, double* b)
 	}
   }
 }
+
+/* b = a^T*x, without forming a.T() */
+void multiply_trans(mat& a, double* x, double* b)
+{
+  int i, k, m, n;
+  double *a_data = a._data();
+  m = a.rows();
+  n = a.cols();
+  for (k = 0; k < n; k++) {
+	double *a_col = a_data + k*m;
+	double t = 0;
+	for (i = 0; i < m; i++)
+	  t += a_col[i] * x[i];
+	b[k] = t;
+  }
+}
+
+/* r = a(idx, :) */
+void get_rows(mat& a, const ivec& idx, mat& r)
+{
+  int m = a.rows();
+  int n = a.cols();
+  int nr = idx.size();
+  r.set_size(nr, n);
+  double *a_data = a._data();
+  double *r_data = r._data();
+  for (int k = 0; k < n; k++)
+	for (int i = 0; i < nr; i++)
+	  r_data[k*nr+i] = a_data[k*m+idx(i)];
+}
+
+/* r = a(idx, :) in float, stored column-major */
+void get_rows(mat& a, const ivec& idx, float* r)
+{
+  int m = a.rows();
+  int n = a.cols();
+  int nr = idx.size();
+  double *a_data = a._data();
+  for (int k = 0; k < n; k++)
+	for (int i = 0; i < nr; i++)
+	  r[k*nr+i] = (float)a_data[k*m+idx(i)];
+}
+
+/* b = a*x, a is a m x n float matrix stored column-major */
+void multiply(float* a, int m, int n, double* x, double* b)
+{
+  int i, k;
+  for (i = 0; i < m; i++)
+	b[i] = 0;
+  for (k = 0; k < n; k++) {
+	float *a_col = a + k*m;
+	double xk = x[k];
+	for (i = 0; i < m; i++)
+	  b[i] += a_col[i] * xk;
+  }
+}
@@ -0,0 +1,635 @@
+/*
+*******************************************************
+
+    Cadence Extended Truncated Balanced Realization
+                (*** CadETBR ***)
+
+*******************************************************
+*/
+
+/*
+ *    $RCSfile: kernel_bench.cu,v $
+ *    $Revision: 1.1 $
+ *    $Date: 2013/03/23 21:08:01 $
+ *
+ *    Functions: Micro-benchmarks of the host solver kernels
+ *
+ *    Runs computeSpMV (and the CCSR/stencil operators), LUSolve, the
+ *    MyILUPP host triangular solves, GMRES_tran and cs_dl_lu alone on
+ *    generated mesh matrices or on .mtx files (e.g. from pg_gen). Each
+ *    repetition calls the kernel often enough to last -min_time ms; the
+ *    report gives min/median/mean/stddev per call and, from the median,
+ *    GB/s, GFLOP/s and ns per nonzero. -json writes one result per line,
+ *    -baseline compares the medians against such a file and returns 1 if
+ *    a kernel got slower than -threshold percent.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "cs.h"
+#include "SpMV.h"
+#include "preconditioner.h"
+#include "gmres.h"
+#include "SpMV_tune.h"
+#include "SpMV_ccsr.h"
+#include "SpMV_stencil.h"
+
+using namespace std;
+
+struct BenchMatrix {
+  string name;
+  int n;
+  vector<int> rp, ci;	/* CSR, columns sorted in each row */
+  vector<double> val;
+};
+
+struct BenchParam {
+  int warmup, reps;
+  double min_time;	/* s per repetition */
+  int lu_max;		/* skip cs_dl_lu above this size */
+  int restart, max_iter;
+  float tol;
+  int spmv_opt;		/* SPMV_OPT_CCSR with -ccsr */
+};
+
+struct BenchResult {
+  string kernel, matrix;
+  int n, reps, calls;
+  long nnz;
+  double tmin, tmed, tmean, tsd;
+  double bytes, flops;	/* per call, 0 if not meaningful */
+  double fill;		/* nnz(L+U)/nnz(A) of cs_lu, 0 otherwise */
+};
+
+static double wtime()
+{
+  struct timeval t;
+  gettimeofday(&t, NULL);
+  return t.tv_sec + t.tv_usec*1e-6;
+}
+
+/* ---------------- matrices ---------------- */
+
+/* side x side grid of unit conductances, every 16th node tied to the
+   ground and C/h = 0.01 on the diagonal, i.e. the A = G+C/h of a mesh */
+static void mesh_matrix(int side, BenchMatrix &M)
+{
+  char s[64];
+  sprintf(s, "mesh%d", side);
+  M.name = s;
+  M.n = side*side;
+  M.rp.assign(1, 0);
+  M.ci.clear();
+  M.val.clear();
+  for (int y = 0; y < side; y++)
+    for (int x = 0; x < side; x++){
+      int i = y*side + x;
+      double d = 0.01 + (i % 16 == 0 ? 1.0 : 0.0);
+      if (y > 0)      { M.ci.push_back(i-side); M.val.push_back(-1.0); d += 1.0; }
+      if (x > 0)      { M.ci.push_back(i-1);    M.val.push_back(-1.0); d += 1.0; }
+      M.ci.push_back(i); M.val.push_back(0.0);
+      int k = M.val.size()-1;
+      if (x+1 < side) { M.ci.push_back(i+1);    M.val.push_back(-1.0); d += 1.0; }
+      if (y+1 < side) { M.ci.push_back(i+side); M.val.push_back(-1.0); d += 1.0; }
+      M.val[k] = d;
+      M.rp.push_back(M.ci.size());
+    }
+}
+
+/* "rows cols nnz" after the % comments, then 1-based "row col value";
+   duplicates are added */
+static int load_matrix(const char *file, BenchMatrix &M)
+{
+  FILE *f = fopen(file, "r");
+  if (f == NULL){
+    printf("Can not open %s.\n", file);
+    return -1;
+  }
+  char line[256];
+  while (fgets(line, 256, f) != NULL && line[0] == '%')
+    ;
+  double fm, fn, fnz;
+  if (sscanf(line, "%lf %lf %lf", &fm, &fn, &fnz) != 3 || fm != fn){
+    printf("%s is not a square matrix.\n", file);
+    fclose(f);
+    return -1;
+  }
+  M.n = (int)fm;
+  long nnz = (long)fnz;
+  vector<pair<long, double> > e(nnz);
+  for (long k = 0; k < nnz; k++){
+    double r, c, v;
+    if (fscanf(f, "%lf %lf %lf", &r, &c, &v) != 3){
+      printf("%s: only %ld of %ld entries.\n", file, k, nnz);
+      fclose(f);
+      return -1;
+    }
+    e[k] = make_pair(((long)r-1)*M.n + (long)c-1, v);
+  }
+  fclose(f);
+  sort(e.begin(), e.end());
+  M.rp.assign(M.n+1, 0);
+  M.ci.clear();
+  M.val.clear();
+  for (long k = 0; k < nnz; k++){
+    int r = e[k].first / M.n, c = e[k].first % M.n;
+    if (!M.ci.empty() && k > 0 && e[k].first == e[k-1].first){
+      M.val.back() += e[k].second;
+      continue;
+    }
+    M.ci.push_back(c);
+    M.val.push_back(e[k].second);
+    M.rp[r+1]++;
+  }
+  for (int i = 0; i < M.n; i++)
+    M.rp[i+1] += M.rp[i];
+  M.name = file;
+  return 0;
+}
+
+/* ILU(0) in place on a copy of the values; diag[i] is the position of a(i,i) */
+static int ilu0(const BenchMatrix &A, vector<double> &lu, vector<int> &diag)
+{
+  int n = A.n;
+  lu = A.val;
+  diag.assign(n, -1);
+  vector<int> pos(n, -1);
+  for (int i = 0; i < n; i++){
+    for (int j = A.rp[i]; j < A.rp[i+1]; j++){
+      pos[A.ci[j]] = j;
+      if (A.ci[j] == i)
+	diag[i] = j;
+    }
+    if (diag[i] < 0){
+      printf("%s: row %d has no diagonal.\n", A.name.c_str(), i);
+      return -1;
+    }
+    for (int j = A.rp[i]; j < A.rp[i+1] && A.ci[j] < i; j++){
+      int k = A.ci[j];
+      lu[j] /= lu[diag[k]];
+      for (int kk = diag[k]+1; kk < A.rp[k+1]; kk++)
+	if (pos[A.ci[kk]] >= 0)
+	  lu[pos[A.ci[kk]]] -= lu[j]*lu[kk];
+    }
+    for (int j = A.rp[i]; j < A.rp[i+1]; j++)
+      pos[A.ci[j]] = -1;
+    if (lu[diag[i]] == 0.0){
+      printf("%s: zero pivot in row %d.\n", A.name.c_str(), i);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/* ---------------- kernels ---------------- */
+
+class BenchOp {
+public:
+  virtual ~BenchOp() {}
+  virtual void run() = 0;
+};
+
+class OpSpMV : public BenchOp {
+public:
+  const float *val; const int *rp, *ci; float *x; const float *y; int n;
+  void run() { computeSpMV(x, val, rp, ci, y, n); }
+};
+
+class OpCCSR : public BenchOp {
+public:
+  CCSR *A; float *x; const float *y;
+  void run() { ccsr_spmv(A, x, y); }
+};
+
+class OpStencil : public BenchOp {
+public:
+  STENCIL *S; float *x; const float *y;
+  void run() { stencil_spmv(S, x, y); }
+};
+
+class OpLUSolve : public BenchOp {
+public:
+  const float *lu; const int *rp, *ci; float *x; const float *y; int n;
+  void run() { LUSolve(x, lu, rp, ci, lu, rp, ci, y, n); }
+};
+
+class OpPrecondLeft : public BenchOp {
+public:
+  MyILUPP *P; const float *y; float *x;
+  void run() { P->HostPrecond_left(y, x); }
+};
+
+class OpPrecondRight : public BenchOp {
+public:
+  MyILUPP *P; const float *y; float *x;
+  void run() { P->HostPrecond_right(y, x); }
+};
+
+class OpGMRES : public BenchOp {
+public:
+  const float *val; const int *rp, *ci; float *x; const float *b; int n;
+  const BenchParam *p; MyILUPP *P;
+  void run()
+  {
+    memset(x, 0, n*sizeof(float));
+    GMRES_tran(val, rp, ci, x, b, n, p->restart, p->max_iter, p->tol, *P);
+  }
+};
+
+class OpCsLU : public BenchOp {
+public:
+  cs_dl *A; cs_dls *S;
+  long lu_nnz;
+  void run()
+  {
+    cs_dln *N = cs_dl_lu(A, S, 1e-14);
+    if (N == NULL){
+      printf("cs_dl_lu failed: matrix is singular\n");
+      exit(-1);
+    }
+    lu_nnz = N->L->nzmax + N->U->nzmax;
+    cs_dl_nfree(N);
+  }
+};
+
+static void measure(BenchOp &op, const BenchParam &p, const char *kernel, const BenchMatrix &M,
+		    double bytes, double flops, vector<BenchResult> &res)
+{
+  /* the warmup also sizes the repetitions */
+  double t0 = wtime();
+  for (int w = 0; w < p.warmup; w++)
+    op.run();
+  double tw = p.warmup > 0 ? (wtime() - t0)/p.warmup : 0.0;
+  int calls = tw > 0 ? (int)ceil(p.min_time/tw) : 1;
+  calls = max(1, calls);
+
+  vector<double> t(p.reps);
+  for (int r = 0; r < p.reps; r++){
+    t0 = wtime();
+    for (int c = 0; c < calls; c++)
+      op.run();
+    t[r] = (wtime() - t0)/calls;
+  }
+  BenchResult R;
+  R.kernel = kernel;
+  R.matrix = M.name;
+  R.n = M.n;
+  R.nnz = M.rp[M.n];
+  R.reps = p.reps;
+  R.calls = calls;
+  R.bytes = bytes;
+  R.flops = flops;
+  R.fill = 0;
+  double s = 0, s2 = 0;
+  for (int r = 0; r < p.reps; r++){
+    s += t[r];
+    s2 += t[r]*t[r];
+  }
+  R.tmean = s/p.reps;
+  R.tsd = p.reps > 1 ? sqrt(max(0.0, (s2 - s*s/p.reps)/(p.reps-1))) : 0.0;
+  sort(t.begin(), t.end());
+  R.tmin = t[0];
+  R.tmed = p.reps % 2 ? t[p.reps/2] : 0.5*(t[p.reps/2-1] + t[p.reps/2]);
+  printf("  %-14s %-16s %9.3f us  (min %9.3f, sd %5.1f%%)", kernel, M.name.c_str(),
+	 R.tmed*1e6, R.tmin*1e6, 100.0*R.tsd/R.tmean);
+  if (bytes > 0)
+    printf("  %6.2f GB/s", bytes/R.tmed*1e-9);
+  if (flops > 0)
+    printf("  %6.2f GFLOP/s", flops/R.tmed*1e-9);
+  printf("  %6.2f ns/nnz\n", R.tmed*1e9/R.nnz);
+  res.push_back(R);
+}
+
+static bool selected(const char *list, const char *kernel)
+{
+  if (list == NULL)
+    return true;
+  string l = string(",") + list + ",";
+  return l.find(string(",") + kernel + ",") != string::npos;
+}
+
+static void bench_matrix(const BenchMatrix &M, const BenchParam &p, const char *kernels,
+			 vector<BenchResult> &res)
+{
+  int n = M.n;
+  long nnz = M.rp[n];
+  vector<float> fval(M.val.begin(), M.val.end());
+  vector<float> x(n, 0.0f), y(n, 1.0f), b(n);
+  computeSpMV(&b[0], &fval[0], &M.rp[0], &M.ci[0], &y[0], n);
+  printf("%s: n = %d, nnz = %ld\n", M.name.c_str(), n, nnz);
+
+  /* the same CSR traffic for all SpMV formats, so their rates compare directly */
+  double spmv_bytes = 8.0*nnz + 12.0*n + 4.0, spmv_flops = 2.0*nnz;
+  if (selected(kernels, "spmv")){
+    OpSpMV op;
+    op.val = &fval[0]; op.rp = &M.rp[0]; op.ci = &M.ci[0]; op.x = &x[0]; op.y = &y[0]; op.n = n;
+    measure(op, p, "spmv", M, spmv_bytes, spmv_flops, res);
+  }
+  if (selected(kernels, "spmv_ccsr")){
+    OpCCSR op;
+    op.A = ccsr_build(n, &M.rp[0], &M.ci[0], &fval[0], CCSR_FLOAT);
+    op.x = &x[0]; op.y = &y[0];
+    measure(op, p, "spmv_ccsr", M, spmv_bytes, spmv_flops, res);
+    ccsr_free(op.A);
+  }
+  if (selected(kernels, "spmv_stencil")){
+    OpStencil op;
+    op.S = stencil_build(n, &M.rp[0], &M.ci[0], &fval[0]);
+    op.x = &x[0]; op.y = &y[0];
+    if (op.S == NULL)
+      printf("  %-14s %-16s skipped, no regular rows\n", "spmv_stencil", M.name.c_str());
+    else{
+      measure(op, p, "spmv_stencil", M, spmv_bytes, spmv_flops, res);
+      stencil_free(op.S);
+    }
+  }
+
+  bool need_ilu = selected(kernels, "lusolve") || selected(kernels, "precond_left") ||
+    selected(kernels, "precond_right") || selected(kernels, "gmres_tran");
+  vector<double> lu;
+  vector<int> diag;
+  if (need_ilu && ilu0(M, lu, diag) != 0)
+    need_ilu = false;
+
+  if (need_ilu && selected(kernels, "lusolve")){
+    vector<float> flu(lu.begin(), lu.end());
+    OpLUSolve op;
+    op.lu = &flu[0]; op.rp = &M.rp[0]; op.ci = &M.ci[0]; op.x = &x[0]; op.y = &b[0]; op.n = n;
+    measure(op, p, "lusolve", M, 8.0*nnz + 8.0*(n+1) + 16.0*n, 2.0*nnz, res);
+  }
+
+  if (need_ilu && (selected(kernels, "precond_left") || selected(kernels, "precond_right") ||
+		   selected(kernels, "gmres_tran"))){
+    /* ILU(0) in the ILU++ layout of MyILUPP: the diagonal last in L and
+       first in U, no permutation, no scaling */
+    vector<int> lrp(1, 0), lci, urp(1, 0), uci, id(n), one_rp(n+1);
+    vector<double> lval, uval, dscale(n, 1.0);
+    vector<float> middle(n, 1.0f);
+    for (int i = 0; i < n; i++){
+      for (int j = M.rp[i]; j < diag[i]; j++){
+	lci.push_back(M.ci[j]);
+	lval.push_back(lu[j]);
+      }
+      lci.push_back(i);
+      lval.push_back(1.0);
+      lrp.push_back(lci.size());
+      for (int j = diag[i]; j < M.rp[i+1]; j++){
+	uci.push_back(M.ci[j]);
+	uval.push_back(lu[j]);
+      }
+      urp.push_back(uci.size());
+      id[i] = i;
+      one_rp[i] = i;
+    }
+    one_rp[n] = n;
+    MySpMatrixDouble L, U, ls, rs;
+    MySpMatrix mid, prow, pcol;
+    L.isCSR = U.isCSR = ls.isCSR = rs.isCSR = 1;
+    mid.isCSR = prow.isCSR = pcol.isCSR = 1;
+    L.numRows = L.numCols = n; L.numNZEntries = lci.size();
+    L.val = &lval[0]; L.rowIndices = &lrp[0]; L.indices = &lci[0];
+    U.numRows = U.numCols = n; U.numNZEntries = uci.size();
+    U.val = &uval[0]; U.rowIndices = &urp[0]; U.indices = &uci[0];
+    ls.numRows = ls.numCols = ls.numNZEntries = n;
+    ls.val = &dscale[0]; ls.rowIndices = &one_rp[0]; ls.indices = &id[0];
+    rs = ls;
+    mid.numRows = mid.numCols = mid.numNZEntries = n;
+    mid.val = &middle[0]; mid.rowIndices = &one_rp[0]; mid.indices = &id[0];
+    prow = mid;
+    pcol = mid;
+    MyILUPP P;
+    P.Initilize(L, U, mid, prow, pcol, ls, rs, p.spmv_opt);
+    long lnnz = lci.size(), unnz = uci.size();
+
+    if (selected(kernels, "precond_left")){
+      OpPrecondLeft op;
+      op.P = &P; op.y = &b[0]; op.x = &x[0];
+      measure(op, p, "precond_left", M, 12.0*lnnz + 4.0*(n+1) + 24.0*n, 2.0*lnnz, res);
+    }
+    if (selected(kernels, "precond_right")){
+      OpPrecondRight op;
+      op.P = &P; op.y = &b[0]; op.x = &x[0];
+      measure(op, p, "precond_right", M, 12.0*unnz + 4.0*(n+1) + 24.0*n, 2.0*unnz, res);
+    }
+    if (selected(kernels, "gmres_tran")){
+      OpGMRES op;
+      op.val = &fval[0]; op.rp = &M.rp[0]; op.ci = &M.ci[0]; op.x = &x[0]; op.b = &b[0]; op.n = n;
+      op.p = &p; op.P = &P;
+      measure(op, p, "gmres_tran", M, 0, 0, res);
+    }
+  }
+
+  if (selected(kernels, "cs_lu")){
+    if (n > p.lu_max)
+      printf("  %-14s %-16s skipped, n > %d (-lu_max)\n", "cs_lu", M.name.c_str(), p.lu_max);
+    else{
+      /* CSC of A^T, the pattern of our matrices is symmetric anyway */
+      cs_dl T;
+      vector<UF_long> cp(M.rp.begin(), M.rp.end()), ri(M.ci.begin(), M.ci.end());
+      vector<double> v(M.val);
+      T.nzmax = nnz; T.m = T.n = n; T.p = &cp[0]; T.i = &ri[0]; T.x = &v[0]; T.nz = -1;
+      OpCsLU op;
+      op.A = &T;
+      op.S = cs_dl_sqr(2, &T, 0);
+      measure(op, p, "cs_lu", M, 0, 0, res);
+      res.back().fill = (double)op.lu_nnz/nnz;
+      printf("  %-14s %-16s fill %.2f\n", "", "", res.back().fill);
+      cs_dl_sfree(op.S);
+    }
+  }
+}
+
+/* ---------------- reports ---------------- */
+
+static void write_json(const char *file, const vector<BenchResult> &res, int argc, char *argv[])
+{
+  FILE *f = fopen(file, "w");
+  if (f == NULL){
+    printf("Can not open %s.\n", file);
+    exit(-1);
+  }
+  char host[256] = "unknown";
+  gethostname(host, sizeof(host)-1);
+  time_t now = time(NULL);
+  char date[64];
+  strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+  fprintf(f, "{\n  \"host\": \"%s\",\n  \"date\": \"%s\",\n  \"command\": \"", host, date);
+  for (int i = 0; i < argc; i++)
+    fprintf(f, "%s%s", i ? " " : "", argv[i]);
+  fprintf(f, "\",\n  \"results\": [\n");
+  /* one result per line, read back by -baseline */
+  for (size_t k = 0; k < res.size(); k++){
+    const BenchResult &R = res[k];
+    fprintf(f, "    {\"kernel\": \"%s\", \"matrix\": \"%s\", \"n\": %d, \"nnz\": %ld, "
+	    "\"reps\": %d, \"calls\": %d, \"min_s\": %.6e, \"median_s\": %.6e, "
+	    "\"mean_s\": %.6e, \"stddev_s\": %.6e, ",
+	    R.kernel.c_str(), R.matrix.c_str(), R.n, R.nnz, R.reps, R.calls,
+	    R.tmin, R.tmed, R.tmean, R.tsd);
+    if (R.bytes > 0)
+      fprintf(f, "\"gbps\": %.4f, ", R.bytes/R.tmed*1e-9);
+    else
+      fprintf(f, "\"gbps\": null, ");
+    if (R.flops > 0)
+      fprintf(f, "\"gflops\": %.4f, ", R.flops/R.tmed*1e-9);
+    else
+      fprintf(f, "\"gflops\": null, ");
+    if (R.fill > 0)
+      fprintf(f, "\"fill\": %.4f, ", R.fill);
+    else
+      fprintf(f, "\"fill\": null, ");
+    fprintf(f, "\"ns_per_nnz\": %.4f}%s\n", R.tmed*1e9/R.nnz, k+1 < res.size() ? "," : "");
+  }
+  fprintf(f, "  ]\n}\n");
+  fclose(f);
+  printf("results written to %s\n", file);
+}
+
+static bool json_field(const char *line, const char *key, char *out, int len)
+{
+  char k[64];
+  sprintf(k, "\"%s\":", key);
+  const char *s = strstr(line, k);
+  if (s == NULL)
+    return false;
+  s += strlen(k);
+  while (*s == ' ' || *s == '"')
+    s++;
+  int i = 0;
+  while (*s && *s != '"' && *s != ',' && *s != '}' && i < len-1)
+    out[i++] = *s++;
+  out[i] = '\0';
+  return true;
+}
+
+/* the number of kernels slower than the baseline by more than threshold % */
+static int compare_baseline(const char *file, const vector<BenchResult> &res, double threshold)
+{
+  FILE *f = fopen(file, "r");
+  if (f == NULL){
+    printf("Can not open %s.\n", file);
+    exit(-1);
+  }
+  printf("\ncompared with %s (threshold %.1f%%):\n", file, threshold);
+  char line[1024], kernel[64], matrix[256], med[64];
+  int nslow = 0, nfound = 0;
+  while (fgets(line, sizeof(line), f) != NULL){
+    if (!json_field(line, "kernel", kernel, 64) || !json_field(line, "matrix", matrix, 256) ||
+	!json_field(line, "median_s", med, 64))
+      continue;
+    double old = atof(med);
+    for (size_t k = 0; k < res.size(); k++){
+      if (res[k].kernel != kernel || res[k].matrix != matrix)
+	continue;
+      double change = 100.0*(res[k].tmed - old)/old;
+      const char *tag = "";
+      if (change > threshold){
+	tag = "  SLOWER";
+	nslow++;
+      }else if (change < -threshold)
+	tag = "  faster";
+      printf("  %-14s %-16s %9.3f -> %9.3f us  %+6.1f%%%s\n", kernel, matrix,
+	     old*1e6, res[k].tmed*1e6, change, tag);
+      nfound++;
+    }
+  }
+  fclose(f);
+  if (nfound == 0)
+    printf("  no common kernel/matrix pairs\n");
+  return nslow;
+}
+
+static void usage()
+{
+  printf("usage: kernel_bench [options]\n");
+  printf("       -mesh n          add the n x n mesh matrix (default: 128 and 1024)\n");
+  printf("       -mtx file        add a matrix file (\"rows cols nnz\" + 1-based triplets)\n");
+  printf("       -kernels a,b     run only these of spmv, spmv_ccsr, spmv_stencil, lusolve,\n");
+  printf("                        precond_left, precond_right, gmres_tran, cs_lu\n");
+  printf("       -warmup n        calls before timing (3)\n");
+  printf("       -reps n          timed repetitions (20)\n");
+  printf("       -min_time ms     length of one repetition (1)\n");
+  printf("       -lu_max n        largest matrix for cs_lu (250000)\n");
+  printf("       -restart n -max_iter n -tol t   GMRES_tran settings (32, 200, 1e-6)\n");
+  printf("       -ccsr            the preconditioner keeps compressed factors (-ccsr of etbr_cmd)\n");
+  printf("       -json file       write the results as JSON\n");
+  printf("       -baseline file   compare with an earlier -json file, exit 1 if slower\n");
+  printf("       -threshold pct   tolerated slowdown for -baseline (5)\n");
+  exit(-1);
+}
+
+int main(int argc, char* argv[])
+{
+  BenchParam p;
+  p.warmup = 3;
+  p.reps = 20;
+  p.min_time = 1e-3;
+  p.lu_max = 250000;
+  p.restart = 32;
+  p.max_iter = 200;
+  p.tol = 1e-6;
+  p.spmv_opt = 0;
+  vector<int> meshes;
+  vector<const char *> files;
+  const char *kernels = NULL, *json = NULL, *baseline = NULL;
+  double threshold = 5.0;
+
+  for (int i = 1; i < argc; i++){
+    const char *a = argv[i];
+    if (strcmp(a, "-ccsr") == 0){
+      p.spmv_opt = SPMV_OPT_CCSR;
+      continue;
+    }
+    if (i+1 >= argc)
+      usage();
+    const char *v = argv[++i];
+    if (strcmp(a, "-mesh") == 0) meshes.push_back(atoi(v));
+    else if (strcmp(a, "-mtx") == 0) files.push_back(v);
+    else if (strcmp(a, "-kernels") == 0) kernels = v;
+    else if (strcmp(a, "-warmup") == 0) p.warmup = atoi(v);
+    else if (strcmp(a, "-reps") == 0) p.reps = atoi(v);
+    else if (strcmp(a, "-min_time") == 0) p.min_time = atof(v)*1e-3;
+    else if (strcmp(a, "-lu_max") == 0) p.lu_max = atoi(v);
+    else if (strcmp(a, "-restart") == 0) p.restart = atoi(v);
+    else if (strcmp(a, "-max_iter") == 0) p.max_iter = atoi(v);
+    else if (strcmp(a, "-tol") == 0) p.tol = atof(v);
+    else if (strcmp(a, "-json") == 0) json = v;
+    else if (strcmp(a, "-baseline") == 0) baseline = v;
+    else if (strcmp(a, "-threshold") == 0) threshold = atof(v);
+    else usage();
+  }
+  if (p.reps < 1 || p.warmup < 0 || p.restart < 1 || p.max_iter < 1)
+    usage();
+  if (meshes.empty() && files.empty()){
+    meshes.push_back(128);
+    meshes.push_back(1024);
+  }
+
+  vector<BenchResult> res;
+  for (size_t k = 0; k < meshes.size(); k++){
+    if (meshes[k] < 2)
+      usage();
+    BenchMatrix M;
+    mesh_matrix(meshes[k], M);
+    bench_matrix(M, p, kernels, res);
+  }
+  for (size_t k = 0; k < files.size(); k++){
+    BenchMatrix M;
+    if (load_matrix(files[k], M) != 0)
+      exit(-1);
+    bench_matrix(M, p, kernels, res);
+  }
+
+  if (json != NULL)
+    write_json(json, res, argc, argv);
+  if (baseline != NULL && compare_baseline(baseline, res, threshold) > 0)
+    return 1;
+  return 0;
+}
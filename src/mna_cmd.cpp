@@ -187,8 +187,10 @@ int main(int argc, char* argv[]){
 	char ir_name[100];
 	strcpy(ir_name, cktname);
 	strcat(ir_name, ".ir.mna");
+	SOLVER_CTX ctx;
+	solver_ctx_init(&ctx);
 	mna_solve(Gs, Cs, Bs, VS, nVS, IS, nIS, tstep, tstop, 
-			  port, sim_port_value, tc_node, tc_name, display_ir_num, ir_info, ir_name);
+			  port, sim_port_value, tc_node, tc_name, display_ir_num, ir_info, ir_name, &ctx);
 	delete [] VS;
 	delete [] IS;
 	cs_dl_spfree(Gs);
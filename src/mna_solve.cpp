@@ -37,6 +37,8 @@
 #include "interp.h"
 #include "svd0.h"
 #include "cs.h"
+#include "direct_solver.h"
+#include "phase_timer.h"
 #include <vector>
 #include <itpp/base/math/min_max.h>
 #include <itpp/base/matfunc.h>
@@ -45,6 +47,34 @@
 using namespace itpp;
 using namespace std;
 
+double integ_coef(int method, double tstep)
+{
+  if (method == INTEG_TR)
+	return 2/tstep;
+  if (method == INTEG_BDF2)
+	return 1.5/tstep;
+  return 1/tstep;
+}
+
+/* BE:   (G + C/h)x1    = C/h*x0 + B*u1
+   TR:   (G + 2C/h)x1   = (2C/h - G)*x0 + B*u0 + B*u1
+   BDF2: (G + 3C/2h)x1  = C/2h*(4*x0 - xm1) + B*u1 */
+void integ_history(int method, cs_dl *G, cs_dl *right, const vec &bu0, const vec &x0,
+				   const vec &xm1, vec &w)
+{
+  if (method == INTEG_TR){
+	vec t = -x0;
+	cs_dl_gaxpy(right, x0._data(), w._data());
+	cs_dl_gaxpy(G, t._data(), w._data());
+	w += bu0;
+  }else if (method == INTEG_BDF2){
+	vec t = (4*x0 - xm1)/3;
+	cs_dl_gaxpy(right, t._data(), w._data());
+  }else{
+	cs_dl_gaxpy(right, x0._data(), w._data());
+  }
+}
+
 void mna_solve(cs_dl *G, cs_dl *C, cs_dl *B, 
 			   Source *VS, int nVS, Source *IS, int nIS, 
 			   double tstep, double tstop, const ivec &port, 
@@ -146,10 +176,8 @@ void mna_solve(cs_dl *G, cs_dl *C, cs_dl *B,
 			   Source *VS, int nVS, Source *IS, int nIS, 
 			   double tstep, double tstop, const ivec &port, mat &sim_port_value, 
 			   vector<int> &tc_node, vector<string> &tc_name, int num, int ir_info,
-			   char *ir_name)
+			   char *ir_name, SOLVER_CTX *ctx)
 {
-  Real_Timer interp2_run_time;
-  Real_Timer ir_run_time;
 
   vec max_value, min_value, avg_value, ir_value;
   double max_ir, min_ir, avg_ir;
@@ -213,57 +241,54 @@ void mna_solve(cs_dl *G, cs_dl *C, cs_dl *B,
   xres.zeros();
   vec x(n);
   x.zeros();
-  cs_dls *Symbolic;
-  cs_dln *Numeric;
-  int order = 2;
-  double tol = 1e-14;
-  Symbolic = cs_dl_sqr(order, G, 0);
-  Real_Timer lufact_time, lusol_time;
-  lufact_time.start();
-  Numeric = cs_dl_lu(G, Symbolic, tol);
-  lufact_time.stop();
-  lusol_time.start();
-  cs_dl_ipvec(Numeric->pinv, w._data(), x._data(), n);
-  cs_dl_lsolve(Numeric->L, x._data());
-  cs_dl_usolve(Numeric->U, x._data());
-  cs_dl_ipvec(Symbolic->q, x._data(), xres._data(), n);  
-  lusol_time.stop();
-  cs_dl_sfree(Symbolic);
-  cs_dl_nfree(Numeric);
+  DSOLVER ds;
+  phase_begin("lufact");
+  ds_factor(ds, G, ctx->direct_solver, ctx->pool);
+  phase_end();
+  phase_begin("lusol");
+  ds_solve(ds, w._data(), xres._data());
+  phase_end();
+  ds_free(ds);
   for (int j = 0; j < port.size(); j++){
 	sim_port_value.set(j, 0, xres(port(j)));
   }
   if (ir_info){
-	ir_run_time.start();
+	phase_begin("ir_analysis");
 	for (int j = 0; j < nNodes; j++){
 	  max_value(j) = xres(tc_node[j]);
 	  min_value(j) = xres(tc_node[j]);
 	  avg_value(j) = xres(tc_node[j]);
 	}
-	ir_run_time.stop();
+	phase_end();
   }
   printf("Matrix size: %d\n",n);
-  printf("LU factorization time:\t%.2f\n",lufact_time.get_time());
-  printf("LU solve time:        \t%.2f\n",lusol_time.get_time());
+  printf("LU factorization time:\t%.2f\n",phase_child_wall("lufact"));
+  printf("LU solve time:        \t%.2f\n",phase_child_wall("lusol"));
 
   /* Transient simulation */
+  double a = integ_coef(ctx->integ_method, tstep);
   cs_dl *right = cs_dl_spalloc(C->m, C->n, C->nzmax, 1, 0);
   for (UF_long i = 0; i < C->n+1; i++){
 	right->p[i] = C->p[i];
   }
   for (UF_long i = 0; i < C->nzmax; i++){
 	right->i[i] = C->i[i];
-	right->x[i] = 1/tstep*C->x[i];
+	right->x[i] = a*C->x[i];
   }
   cs_dl *left = cs_dl_add(G, right, 1, 1);
-  Symbolic = cs_dl_sqr(order, left, 0);
-  Numeric = cs_dl_lu(left, Symbolic, tol);
+  phase_begin("lufact");
+  ds_factor(ds, left, ctx->direct_solver, ctx->pool);
+  phase_end();
   cs_dl_spfree(left);
 
-  vec xn(n), xnr(n), xn1(n), xn1t(n);
+  vec xn(n), xp(n), xn1(n), bu(n), bu0(n);
   xn = xres;
+  xp = xres;
+  bu0 = w;
   xn1.zeros();
-  xn1t.zeros();
+  /* per step phases would cost more than the steps; time the parts
+	 and record them once */
+  Real_Timer interp2_time, lusol_time, ir_time;
   for (int i = 1; i < ts.size(); i++){
 	/*
 	for(int j = 0; j < nVS; j++){
@@ -275,7 +300,7 @@ void mna_solve(cs_dl *G, cs_dl *C, cs_dl *B,
 	  u_col(nVS+j) = temp;
 	}
 	*/
-	interp2_run_time.start();
+	interp2_time.start();
 	for(vector<int>::iterator it = var_v.begin(); it != var_v.end(); ++it){
 	  interp1(VS[*it].time, VS[*it].value, ts(i), temp, cur[*it]);
 	  u_col(*it) = temp;
@@ -284,23 +309,20 @@ void mna_solve(cs_dl *G, cs_dl *C, cs_dl *B,
 	  interp1(IS[*it].time, IS[*it].value, ts(i), temp, cur[nVS+(*it)]);
 	  u_col(nVS+(*it)) = temp;
 	}
-	interp2_run_time.stop();
+	interp2_time.stop();
 	w.zeros();
 	cs_dl_gaxpy(B, u_col._data(), w._data());
-	xnr.zeros();
-	// cs_dl_gaxpy(C, xn._data(), xnr._data());
-	// w += 1/tstep*xnr;
-	cs_dl_gaxpy(right, xn._data(), xnr._data());
-	w += xnr;
-	cs_dl_ipvec(Numeric->pinv, w._data(), xn1t._data(), n);
-	cs_dl_lsolve(Numeric->L, xn1t._data());
-	cs_dl_usolve(Numeric->U, xn1t._data());
-	cs_dl_ipvec(Symbolic->q, xn1t._data(), xn1._data(), n);   
+	bu = w;
+	integ_history(ctx->integ_method, G, right, bu0, xn, xp, w);
+	bu0 = bu;
+	lusol_time.start();
+	ds_solve(ds, w._data(), xn1._data());
+	lusol_time.stop();
 	for (int j = 0; j < port.size(); j++){
 	  sim_port_value.set(j, i, xn1(port(j)));
 	}
 	if (ir_info){
-	  ir_run_time.start();
+	  ir_time.start();
 	  for (int j = 0; j < nNodes; j++){
 		if (max_value(j) < xn1(tc_node[j])){
 		  max_value(j) = xn1(tc_node[j]);
@@ -310,17 +332,21 @@ void mna_solve(cs_dl *G, cs_dl *C, cs_dl *B,
 		}
 		avg_value(j) += xn1(tc_node[j]);
 	  }
-	  ir_run_time.stop();
+	  ir_time.stop();
 	}
+	xp = xn;
 	xn = xn1;
   }
+  phase_record("interp2", ts.size()-1, interp2_time.get_time());
+  phase_record("lusol", ts.size()-1, lusol_time.get_time());
+  if (ir_info)
+	phase_record("ir_analysis", ts.size()-1, ir_time.get_time());
   cs_dl_spfree(right);
-  cs_dl_sfree(Symbolic);
-  cs_dl_nfree(Numeric);
+  ds_free(ds);
   delete [] cur;
 
   if (ir_info){
-	ir_run_time.start();
+	phase_begin("ir_analysis");
 	avg_value /= ts.size();
 	sorted_max_value_idx = sort_index(max_value);
 	sorted_avg_value_idx = sort_index(avg_value);
@@ -378,11 +404,11 @@ void mna_solve(cs_dl *G, cs_dl *C, cs_dl *B,
 		   << ir_value(sorted_ir_value_idx(nNodes-1-i)) << endl;
 	}
 	out_ir.close();
-	ir_run_time.stop();
+	phase_end();
   }
 
   std::cout.setf(std::ios::fixed,std::ios::floatfield); 
   std::cout.precision(2);
-  std::cout << "interpolation2  \t: " << interp2_run_time.get_time() << std::endl;
-  std::cout << "IR analysis     \t: " << ir_run_time.get_time() << std::endl;
+  std::cout << "interpolation2  \t: " << phase_child_wall("interp2") << std::endl;
+  std::cout << "IR analysis     \t: " << phase_child_wall("ir_analysis") << std::endl;
 }
@@ -0,0 +1,362 @@
+/*
+*******************************************************
+
+    Cadence Extended Truncated Balanced Realization
+                (*** CadETBR ***)
+
+*******************************************************
+*/
+
+/*
+ *    $RCSfile: mna_solve_exp.cpp,v $
+ *    $Revision: 1.1 $
+ *    $Date: 2013/03/23 21:08:01 $
+ *
+ *    Functions: MNA transient with a rational Krylov matrix exponential
+ *
+ */
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <math.h>
+#include <itpp/base/timing.h>
+#include <itpp/base/mat.h>
+#include <itpp/base/vec.h>
+#include <itpp/base/specmat.h>
+#include <itpp/base/algebra/inv.h>
+#include <itpp/base/algebra/ls_solve.h>
+#include <itpp/base/math/elem_math.h>
+#include <itpp/base/math/min_max.h>
+#include <itpp/base/matfunc.h>
+#include <itpp/base/sort.h>
+#include <itpp/stat/misc_stat.h>
+#include "etbr.h"
+#include "interp.h"
+#include "cs.h"
+#include "direct_solver.h"
+
+using namespace itpp;
+using namespace std;
+
+#define EXP_KRYLOV_MAX 40	/* largest rational Krylov space per segment */
+#define EXP_KRYLOV_TOL 1e-7	/* relative change of the segment end value */
+
+/* exp(A) of a small dense matrix, scaling and squaring with the (6,6)
+   Pade approximant */
+static mat expm_small(const mat &A)
+{
+  int m = A.rows();
+  double nrm = 0;
+  for (int j = 0; j < m; j++){
+	double s = 0;
+	for (int i = 0; i < m; i++)
+	  s += fabs(A(i, j));
+	nrm = s > nrm ? s : nrm;
+  }
+  int sq = nrm > 0.5 ? (int)ceil(log(nrm/0.5)/log(2.0)) : 0;
+  mat X = A/pow(2.0, sq);
+  mat N = eye(m), D = eye(m), Xk = eye(m);
+  double c = 1;
+  for (int k = 1; k <= 6; k++){
+	c *= (double)(6-k+1)/(k*(12-k+1));
+	Xk = Xk*X;
+	N += c*Xk;
+	D += (k % 2 ? -c : c)*Xk;
+  }
+  mat E = ls_solve(D, N);
+  for (int k = 0; k < sq; k++)
+	E = E*E;
+  return E;
+}
+
+/* u(t) of all the sources, cur[] moves forward with t */
+static void source_values(Source *VS, int nVS, Source *IS, int nIS,
+						  double t, int *cur, vec &u)
+{
+  double temp;
+  for (int j = 0; j < nVS; j++){
+	if (VS[j].time.size() == 1)
+	  u(j) = VS[j].value(0);
+	else{
+	  interp1(VS[j].time, VS[j].value, t, temp, cur[j]);
+	  u(j) = temp;
+	}
+  }
+  for (int j = 0; j < nIS; j++){
+	if (IS[j].time.size() == 1)
+	  u(nVS+j) = IS[j].value(0);
+	else{
+	  interp1(IS[j].time, IS[j].value, t, temp, cur[nVS+j]);
+	  u(nVS+j) = temp;
+	}
+  }
+}
+
+/* Arnoldi on Z = (C + gamma*G)^-1*C from v; V gets the basis and K the
+   projection of A = -C^-1*G, K = (I - H^-1)/gamma. Returns 0 if the
+   value at the end of the segment has not settled */
+static int rational_krylov(cs_dl *C, DSOLVER &dz, double gamma, const vec &v,
+						   double h, vector<vec> &V, mat &K, vec &y)
+{
+  UF_long n = v.size();
+  double beta = norm(v);
+  V.clear();
+  y.set_size(0);
+  if (beta == 0){
+	K.set_size(0, 0);
+	return 1;
+  }
+  mat H(EXP_KRYLOV_MAX+1, EXP_KRYLOV_MAX);
+  H.zeros();
+  vec w(n), cv(n);
+  V.push_back(v/beta);
+  vec y_old;
+  for (int j = 0; j < EXP_KRYLOV_MAX; j++){
+	cv.zeros();
+	cs_dl_gaxpy(C, V[j]._data(), cv._data());
+	ds_solve(dz, cv._data(), w._data());
+	for (int i = 0; i <= j; i++){
+	  H(i, j) = dot(V[i], w);
+	  w -= H(i, j)*V[i];
+	}
+	H(j+1, j) = norm(w);
+	int m = j+1;
+	int breakdown = H(j+1, j) <= 1e-12*fabs(H(0, 0));
+	if (m % 5 == 0 || breakdown || m == EXP_KRYLOV_MAX){
+	  mat Hm = H.get(0, m-1, 0, m-1);
+	  K = (eye(m) - inv(Hm))/gamma;
+	  y = beta*expm_small(h*K).get_col(0);
+	  if (breakdown)
+		return 1;
+	  if (y_old.size() > 0){
+		vec d = y;
+		for (int i = 0; i < y_old.size(); i++)
+		  d(i) -= y_old(i);
+		if (norm(d) <= EXP_KRYLOV_TOL*norm(y))
+		  return 1;
+	  }
+	  y_old = y;
+	}
+	V.push_back(w/H(j+1, j));
+  }
+  return 0;
+}
+
+void mna_solve_exp(cs_dl *G, cs_dl *C, cs_dl *B,
+				   Source *VS, int nVS, Source *IS, int nIS,
+				   double tstep, double tstop, const ivec &port, mat &sim_port_value,
+				   vector<int> &tc_node, vector<string> &tc_name, int num, int ir_info,
+				   char *ir_name, SOLVER_CTX *ctx)
+{
+  Real_Timer lufact_time, krylov_time, ir_run_time;
+
+  vec max_value, min_value, avg_value, ir_value;
+  double max_ir, avg_ir;
+  int max_ir_idx;
+  ivec sorted_max_value_idx, sorted_avg_value_idx, sorted_ir_value_idx;
+  int nNodes = tc_node.size();
+  int display_num = num<tc_node.size()?num:tc_node.size();
+  max_value.set_size(nNodes);
+  min_value.set_size(nNodes);
+  avg_value.set_size(nNodes);
+  UF_long n = G->n;
+  vec ts;
+  form_vec(ts, 0, tstep, tstop);
+  sim_port_value.set_size(port.size(), ts.size());
+
+  /* the segments end at the source breakpoints */
+  vector<double> bp;
+  for (int j = 0; j < nVS; j++)
+	for (int k = 0; k < VS[j].time.size(); k++)
+	  bp.push_back(VS[j].time(k));
+  for (int j = 0; j < nIS; j++)
+	for (int k = 0; k < IS[j].time.size(); k++)
+	  bp.push_back(IS[j].time(k));
+  bp.push_back(tstop);
+  sort(bp.begin(), bp.end());
+  vector<double> seg_end;
+  for (size_t k = 0; k < bp.size(); k++){
+	if (bp[k] <= 0 || bp[k] > tstop)
+	  continue;
+	if (seg_end.empty() || bp[k] - seg_end.back() > 1e-12*tstop)
+	  seg_end.push_back(bp[k]);
+  }
+  double gamma = tstop/seg_end.size();
+  if (gamma < tstep)
+	gamma = tstep;
+
+  DSOLVER dg, dz;
+  lufact_time.start();
+  ds_factor(dg, G, ctx->direct_solver, ctx->pool);
+  cs_dl *left = cs_dl_add(C, G, 1, gamma);
+  ds_factor(dz, left, ctx->direct_solver, ctx->pool);
+  cs_dl_spfree(left);
+  lufact_time.stop();
+
+  /* the rows that are written out */
+  vector<UF_long> rows;
+  for (int j = 0; j < port.size(); j++)
+	rows.push_back(port(j));
+  if (ir_info)
+	for (int j = 0; j < nNodes; j++)
+	  rows.push_back(tc_node[j]);
+
+  int *cur = new int[nVS+nIS];
+  for (int i = 0; i < nVS+nIS; i++)
+	cur[i] = 0;
+  vec u0(nVS+nIS), u1(nVS+nIS), s(nVS+nIS);
+  vec bu(n), x(n), alpha(n), beta(n), r(n), xt(n), cb(n);
+
+  /* DC */
+  source_values(VS, nVS, IS, nIS, 0, cur, u0);
+  bu.zeros();
+  cs_dl_gaxpy(B, u0._data(), bu._data());
+  ds_solve(dg, bu._data(), x._data());
+  for (int j = 0; j < port.size(); j++)
+	sim_port_value.set(j, 0, x(port(j)));
+  if (ir_info){
+	for (int j = 0; j < nNodes; j++){
+	  max_value(j) = x(tc_node[j]);
+	  min_value(j) = x(tc_node[j]);
+	  avg_value(j) = x(tc_node[j]);
+	}
+  }
+
+  krylov_time.start();
+  int nseg = 0, nsplit = 0, ksum = 0;
+  int it = 1;
+  double t0 = 0;
+  size_t e = 0;
+  while (e < seg_end.size()){
+	double t1 = seg_end[e];
+	source_values(VS, nVS, IS, nIS, t1, cur, u1);
+	/* u = u0 + s*tau on the segment: x_p = alpha + beta*tau with
+	   G*beta = B*s and G*alpha = B*u0 - C*beta */
+	s = (u1 - u0)/(t1 - t0);
+	bu.zeros();
+	cs_dl_gaxpy(B, s._data(), bu._data());
+	ds_solve(dg, bu._data(), beta._data());
+	cb.zeros();
+	cs_dl_gaxpy(C, beta._data(), cb._data());
+	bu.zeros();
+	cs_dl_gaxpy(B, u0._data(), bu._data());
+	bu -= cb;
+	ds_solve(dg, bu._data(), alpha._data());
+	r = x - alpha;
+
+	vector<vec> V;
+	mat K;
+	vec y;
+	if (!rational_krylov(C, dz, gamma, r, t1 - t0, V, K, y) && t1 - t0 > 1e-6*tstep){
+	  /* restart on the first half of the segment */
+	  seg_end.insert(seg_end.begin() + e, 0.5*(t0 + t1));
+	  for (int j = 0; j < nVS+nIS; j++)
+		cur[j] = 0;
+	  source_values(VS, nVS, IS, nIS, t0, cur, u0);
+	  nsplit++;
+	  continue;
+	}
+	nseg++;
+	ksum += V.size();
+
+	/* output times inside the segment only need the written rows */
+	for (; it < ts.size() && ts(it) <= t1 + 1e-12*tstop; it++){
+	  double tau = ts(it) - t0;
+	  vec yt;
+	  if (V.size() > 0)
+		yt = norm(r)*expm_small(tau*K).get_col(0);
+	  for (size_t k = 0; k < rows.size(); k++){
+		UF_long i = rows[k];
+		double v = alpha(i) + beta(i)*tau;
+		for (int j = 0; j < yt.size(); j++)
+		  v += V[j](i)*yt(j);
+		xt(i) = v;
+	  }
+	  for (int j = 0; j < port.size(); j++)
+		sim_port_value.set(j, it, xt(port(j)));
+	  if (ir_info){
+		ir_run_time.start();
+		for (int j = 0; j < nNodes; j++){
+		  double v = xt(tc_node[j]);
+		  if (max_value(j) < v)
+			max_value(j) = v;
+		  if (v < min_value(j))
+			min_value(j) = v;
+		  avg_value(j) += v;
+		}
+		ir_run_time.stop();
+	  }
+	}
+
+	x = alpha + (t1 - t0)*beta;
+	for (int j = 0; j < y.size(); j++)
+	  x += y(j)*V[j];
+	t0 = t1;
+	u0 = u1;
+	e++;
+  }
+  krylov_time.stop();
+  ds_free(dg);
+  ds_free(dz);
+  delete [] cur;
+
+  if (ir_info){
+	ir_run_time.start();
+	avg_value /= ts.size();
+	sorted_max_value_idx = sort_index(max_value);
+	sorted_avg_value_idx = sort_index(avg_value);
+	ir_value = max_value - min_value;
+	max_ir = max(ir_value);
+	max_ir_idx = max_index(ir_value);
+	avg_ir = sum(ir_value)/ir_value.size();
+	sorted_ir_value_idx = sort_index(ir_value);
+	std::cout.precision(6);
+	cout << "****** Node Voltage Info ******  " << endl;
+	cout << "#Tap Currents: " << tc_node.size() << endl;
+	cout << "******" << endl;
+	cout << "Max " << display_num << " Node Voltage: " << endl;
+	for (int i = 0; i < display_num; i++){
+	  cout << tc_name[sorted_max_value_idx(nNodes-1-i)] << " : "
+		   << max_value(sorted_max_value_idx(nNodes-1-i)) << endl;
+	}
+	cout << "******" << endl;
+	cout << "Avg " << display_num << " Node Voltage: " << endl;
+	for (int i = 0; i < display_num; i++){
+	  cout << tc_name[sorted_avg_value_idx(nNodes-1-i)] << " : "
+		   << avg_value(sorted_avg_value_idx(nNodes-1-i)) << endl;
+	}
+	cout << "****** IR Drop Info ******  " << endl;
+	cout << "Max IR:     " << tc_name[max_ir_idx] << " : " << max_ir << endl;
+	cout << "Avg IR:     " << avg_ir << endl;
+	cout << "******" << endl;
+	cout << "Max " << display_num << " IR: " << endl;
+	for (int i = 0; i < display_num; i++){
+	  cout << tc_name[sorted_ir_value_idx(nNodes-1-i)] << " : "
+		   << ir_value(sorted_ir_value_idx(nNodes-1-i)) << endl;
+	}
+	cout << "******" << endl;
+
+	ofstream out_ir;
+	out_ir.open(ir_name);
+	if (!out_ir){
+	  cout << "couldn't open " << ir_name << endl;
+	  exit(-1);
+	}
+	for (int i = 0; i < tc_node.size(); i++){
+	  out_ir << tc_name[sorted_ir_value_idx(nNodes-1-i)] << " : "
+		   << ir_value(sorted_ir_value_idx(nNodes-1-i)) << endl;
+	}
+	out_ir.close();
+	ir_run_time.stop();
+  }
+
+  printf("Matrix size: %d\n", (int)n);
+  printf("Segments: %d (%d split), average Krylov size %.1f\n",
+		 nseg, nsplit, nseg > 0 ? (double)ksum/nseg : 0.0);
+  std::cout.setf(std::ios::fixed,std::ios::floatfield);
+  std::cout.precision(2);
+  std::cout << "LU factorization\t: " << lufact_time.get_time() << std::endl;
+  std::cout << "Krylov exponential\t: " << krylov_time.get_time() << std::endl;
+  std::cout << "IR analysis     \t: " << ir_run_time.get_time() << std::endl;
+}
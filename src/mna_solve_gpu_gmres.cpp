@@ -12,8 +12,9 @@
 #include "gpuData.h"
 #include "SpMV.h"
 #include "iluplusplus.h"
-
-double threshold=1.2, factor=1.0; // threshold=3.0
+#include "phase_timer.h"
+#include "gmres_log.h"
+#include "SpMV_tune.h"
 
 typedef iluplusplus::Real Real;
 typedef iluplusplus::matrix_sparse<Real> Matrix;
@@ -191,17 +192,15 @@ void mna_solve_gpu_gmres(cs_dl *G, cs_dl *C, cs_dl *B,
                          Source *VS, int nVS, Source *IS, int nIS, 
                          double tstep, double tstop, const ivec &port, mat &sim_port_value, 
                          vector<int> &tc_node, vector<string> &tc_name, int num, int ir_info,
-                         char *ir_name, gpuETBR *myGPUetbr)
+                         char *ir_name, gpuETBR *myGPUetbr, SOLVER_CTX *ctx)
 {
   printf("             mna_solve_gpu_gmres()\n");
   setGPUdevice();
+  gmres_log_bind(ctx->gmres_log);
+  ctx->spmv_cache = spmv_cache_new();
   
   int useDoubleILU=0;
 
-  Real_Timer interp2_run_time;
-  Real_Timer ir_run_time;
-  Real_Timer lufact_time;
-  Real_Timer gmresCPUilu_time;
    
   vec max_value, min_value, avg_value, ir_value;
   double max_ir, avg_ir; // min_ir, 
@@ -283,23 +282,24 @@ void mna_solve_gpu_gmres(cs_dl *G, cs_dl *C, cs_dl *B,
   // ----------- LU part finish ----------------
 
   if (ir_info){
-	ir_run_time.start();
+	phase_begin("ir_analysis");
 	for (int j = 0; j < nNodes; j++){
 	  max_value(j) = xres(tc_node[j]);
 	  min_value(j) = xres(tc_node[j]);
 	  avg_value(j) = xres(tc_node[j]);
 	}
-	ir_run_time.stop();
+	phase_end();
   }
 
   /* Transient simulation */
+  double a = integ_coef(ctx->integ_method, tstep);
   cs_dl *right = cs_dl_spalloc(C->m, C->n, C->nzmax, 1, 0);
   for (UF_long i = 0; i < C->n+1; i++){
 	right->p[i] = C->p[i];
   }
   for (UF_long i = 0; i < C->nzmax; i++){
 	right->i[i] = C->i[i];
-	right->x[i] = 1/tstep*C->x[i];
+	right->x[i] = a*C->x[i];
   }
   cs_dl *left = cs_dl_add(G, right, 1, 1);
   // ----------- LU part start ----------------
@@ -324,11 +324,11 @@ void mna_solve_gpu_gmres(cs_dl *G, cs_dl *C, cs_dl *B,
   //   threshold = 1.7;//8
   //   factor = 1.0;
   // }
-  param.set_threshold(threshold);
-  param.set_MEM_FACTOR(factor);
+  param.set_threshold(ctx->ilu_threshold);
+  param.set_MEM_FACTOR(ctx->ilu_factor);
   param.set_MAX_LEVELS(1);
 
-  printf("    threshold=%f,  factor=%f\n", threshold, factor);
+  printf("    threshold=%f,  factor=%f\n", ctx->ilu_threshold, ctx->ilu_factor);
   
   //Matrix Arow;
   ucr_cs_di Gcs_di, Acs_di;
@@ -338,10 +338,10 @@ void mna_solve_gpu_gmres(cs_dl *G, cs_dl *C, cs_dl *B,
   Matrix Acol(Acs_di.x, Acs_di.i, Acs_di.p, Acs_di.m, Acs_di.n, iluplusplus::COLUMN);
   iluplusplus::multilevelILUCDPPreconditioner<Real,Matrix,Vector> PrG, PrA;
   PrG.make_preprocessed_multilevelILUCDP(Gcol,param);
-  Real_Timer precondBuild_time;
-  precondBuild_time.start();
+  phase_begin("precond_build");
   PrA.make_preprocessed_multilevelILUCDP(Acol,param);
-  precondBuild_time.stop();
+  phase_count("fill", ((Real) PrA.total_nnz())/(Real)Acol.non_zeroes());
+  phase_end();
   cout<<"Information on the preconditioner G:"<<endl;
   PrG.print_info();
   cout<<"fill-in: "<<((Real) PrG.total_nnz())/(Real)Gcol.non_zeroes()<<endl;
@@ -509,31 +509,36 @@ void mna_solve_gpu_gmres(cs_dl *G, cs_dl *C, cs_dl *B,
   if(useDoubleILU == 1) {
     GmyInterfacePG.setPrecondPG
       (&GmySpM, &PrLeft_GmySpMdouble, &PrRight_GmySpMdouble, &PrMiddle_GmySpM,
-       &PrPermRow_GmySpM, &PrPermCol_GmySpM, &PrLscale_GmySpMdouble, &PrRscale_GmySpMdouble);
+       &PrPermRow_GmySpM, &PrPermCol_GmySpM, &PrLscale_GmySpMdouble, &PrRscale_GmySpMdouble,
+       ctx->spmv_cache, ctx->spmv_opt);
     AmyInterfacePG.setPrecondPG
       (&AmySpM, &PrLeft_AmySpMdouble, &PrRight_AmySpMdouble, &PrMiddle_AmySpM,
-       &PrPermRow_AmySpM, &PrPermCol_AmySpM, &PrLscale_AmySpMdouble, &PrRscale_AmySpMdouble);
+       &PrPermRow_AmySpM, &PrPermCol_AmySpM, &PrLscale_AmySpMdouble, &PrRscale_AmySpMdouble,
+       ctx->spmv_cache, ctx->spmv_opt);
   }
   else {
     GmyInterfacePGfloat.setPrecondPG
       ( &GmySpM, &PrLeft_GmySpMdouble, &PrRight_GmySpMdouble, &PrMiddle_GmySpM,
-        &PrPermRow_GmySpM, &PrPermCol_GmySpM, &PrLscale_GmySpM, &PrRscale_GmySpM );
+        &PrPermRow_GmySpM, &PrPermCol_GmySpM, &PrLscale_GmySpM, &PrRscale_GmySpM,
+        ctx->spmv_cache, ctx->spmv_opt );
     AmyInterfacePGfloat.setPrecondPG
       ( &AmySpM, &PrLeft_AmySpMdouble, &PrRight_AmySpMdouble, &PrMiddle_AmySpM,
-        &PrPermRow_AmySpM, &PrPermCol_AmySpM, &PrLscale_AmySpM, &PrRscale_AmySpM );
+        &PrPermRow_AmySpM, &PrPermCol_AmySpM, &PrLscale_AmySpM, &PrRscale_AmySpM,
+        ctx->spmv_cache, ctx->spmv_opt );
   }
   for(int i=0; i<n; i++) {
     GmyInterfacePGfloat.xgmres_h[i] = 0.0;
     GmyInterfacePGfloat.rhs_h[i] = *(w._data()+i); // 1.0
   }
   printf("DC simulation:  ");
-  gmresCPUilu_time.start();
+  gmres_log_step(0, 0.0);
+  phase_begin("gmres_dc");
   GmyInterfacePGfloat.GMRES_dev_PG();
-  gmresCPUilu_time.stop();
+  phase_count("iterations", GmyInterfacePGfloat.max_it);
+  phase_end();
   cout<<"Iterations: "<< GmyInterfacePGfloat.max_it
       <<"  Residual: "<< GmyInterfacePGfloat.tol
-      <<"  Time: " << gmresCPUilu_time.get_time() << endl;
-  gmresCPUilu_time.reset();
+      <<"  Time: " << phase_child_wall("gmres_dc") << endl;
   for(int j = 0; j < port.size(); j++)
     sim_port_value.set(j, 0, GmyInterfacePGfloat.xgmres_h[port(j)]);
 
@@ -546,7 +551,7 @@ void mna_solve_gpu_gmres(cs_dl *G, cs_dl *C, cs_dl *B,
   int iterTotal=0;
   /* GMRES solver part finishes. */
   
-  vec xn(n), xnr(n), xn1(n), xn1t(n);
+  vec xn(n), xp(n), xn1(n), xn1t(n), bu(n), bu0(n);
   // ----------- LU part start ----------------
   //xn = xres;
   // ----------- LU part finish ----------------
@@ -557,7 +562,8 @@ void mna_solve_gpu_gmres(cs_dl *G, cs_dl *C, cs_dl *B,
     for(int j=0; j<n; j++)  xn._data()[j] = GmyInterfacePG.xgmres_h[j]; // for UCRilu gmres
   else
     for(int j=0; j<n; j++)  xn._data()[j] = GmyInterfacePGfloat.xgmres_h[j]; // for UCRilu gmres
-    
+  xp = xn;
+  bu0 = w;
   xn1.zeros();
   xn1t.zeros();
   printf("   ts.size() = %d.\n",ts.size());
@@ -572,7 +578,8 @@ void mna_solve_gpu_gmres(cs_dl *G, cs_dl *C, cs_dl *B,
           u_col(nVS+j) = temp;
         }
         */
-        interp2_run_time.start();
+        gmres_log_step(i, ts(i));
+        phase_begin("interp2");
         for(vector<int>::iterator it = var_v.begin(); it != var_v.end(); ++it){
           interp1(VS[*it].time, VS[*it].value, ts(i), temp, cur[*it]);
           u_col(*it) = temp;
@@ -581,15 +588,13 @@ void mna_solve_gpu_gmres(cs_dl *G, cs_dl *C, cs_dl *B,
           interp1(IS[*it].time, IS[*it].value, ts(i), temp, cur[nVS+(*it)]);
           u_col(nVS+(*it)) = temp;
         }
-        interp2_run_time.stop();
+        phase_end();
   
         w.zeros();
         cs_dl_gaxpy(B, u_col._data(), w._data());
-        xnr.zeros();
-        // cs_dl_gaxpy(C, xn._data(), xnr._data());
-        // w += 1/tstep*xnr;
-        cs_dl_gaxpy(right, xn._data(), xnr._data());
-        w += xnr;
+        bu = w;
+        integ_history(ctx->integ_method, G, right, bu0, xn, xp, w);
+        bu0 = bu;
         
         //-----------------------------
         // rel_tol =  reach_rel_tol;
@@ -613,9 +618,10 @@ void mna_solve_gpu_gmres(cs_dl *G, cs_dl *C, cs_dl *B,
         }
         else {
           for(int j=0; j<n; j++)  AmyInterfacePGfloat.rhs_h[j] = *(w._data()+j);
-          gmresCPUilu_time.start();
+          phase_begin("gmres");
           AmyInterfacePGfloat.GMRES_dev_PG();
-          gmresCPUilu_time.stop();
+          phase_count("iterations", AmyInterfacePGfloat.max_it);
+          phase_end();
           for(int j=0; j<n; j++)  xn1._data()[j] = AmyInterfacePGfloat.xgmres_h[j];
           iterTotal += AmyInterfacePGfloat.max_it;
         }
@@ -631,7 +637,7 @@ void mna_solve_gpu_gmres(cs_dl *G, cs_dl *C, cs_dl *B,
           sim_port_value.set(j, i, xn1(port(j)));
 
         if (ir_info){
-          ir_run_time.start();
+          phase_begin("ir_analysis");
           for (int j = 0; j < nNodes; j++){
         	if (max_value(j) < xn1(tc_node[j])){
         	  max_value(j) = xn1(tc_node[j]);
@@ -641,8 +647,9 @@ void mna_solve_gpu_gmres(cs_dl *G, cs_dl *C, cs_dl *B,
         	}
         	avg_value(j) += xn1(tc_node[j]);
           }
-          ir_run_time.stop();
+          phase_end();
         }
+        xp = xn;
         xn = xn1;
   }
   //------------------------------------------
@@ -778,7 +785,7 @@ void mna_solve_gpu_gmres(cs_dl *G, cs_dl *C, cs_dl *B,
   delete [] cur;
 
   if (ir_info){
-	ir_run_time.start();
+	phase_begin("ir_analysis");
 	avg_value /= ts.size();
 	sorted_max_value_idx = sort_index(max_value);
 	sorted_avg_value_idx = sort_index(avg_value);
@@ -836,19 +843,23 @@ void mna_solve_gpu_gmres(cs_dl *G, cs_dl *C, cs_dl *B,
 		   << ir_value(sorted_ir_value_idx(nNodes-1-i)) << endl;
 	}
 	out_ir.close();
-	ir_run_time.stop();
+	phase_end();
   }
 
   std::cout.setf(std::ios::fixed,std::ios::floatfield); 
   std::cout.precision(2);
-  std::cout << "interpolation2  \t: " << interp2_run_time.get_time() << std::endl;
-  std::cout << "IR analysis     \t: " << ir_run_time.get_time() << std::endl;
-  std::cout << "LU factorization\t: " << lufact_time.get_time() << std::endl;
-  std::cout << "ILU++ construct \t: " << precondBuild_time.get_time() << std::endl;
-  std::cout << "ILU++ GMRES GPU \t: " << gmresCPUilu_time.get_time()
+  std::cout << "interpolation2  \t: " << phase_child_wall("interp2") << std::endl;
+  std::cout << "IR analysis     \t: " << phase_child_wall("ir_analysis") << std::endl;
+  std::cout << "LU factorization\t: " << phase_child_wall("lufact") << std::endl;
+  std::cout << "ILU++ construct \t: " << phase_child_wall("precond_build") << std::endl;
+  std::cout << "ILU++ GMRES GPU \t: " << phase_child_wall("gmres")
             << "    Avg iter per point: " << (int)ceil(1.0*iterTotal/ts.size())
-            << "    Time per point: " << gmresCPUilu_time.get_time() / ts.size() << std::endl;
+            << "    Time per point: " << phase_child_wall("gmres") / ts.size() << std::endl;
 
+  /* the SpMV plans of the host solves (-spmvtune, -ccsr, -stencil) */
+  spmv_cache_free(ctx->spmv_cache);
+  ctx->spmv_cache = NULL;
+  gmres_log_bind(NULL);
   mySpMatrixFree(&GmySpM); //PrLeft_GmySpM, PrRight_GmySpM,
   mySpMatrixFree(&PrMiddle_GmySpM);
   mySpMatrixFree(&PrPermRow_GmySpM);
@@ -876,13 +887,11 @@ void mna_solve_cpu_gmres(cs_dl *G, cs_dl *C, cs_dl *B,
                          Source *VS, int nVS, Source *IS, int nIS, 
                          double tstep, double tstop, const ivec &port, mat &sim_port_value, 
                          vector<int> &tc_node, vector<string> &tc_name, int num, int ir_info,
-                         char *ir_name, gpuETBR *myGPUetbr)
+                         char *ir_name, gpuETBR *myGPUetbr, SOLVER_CTX *ctx)
 {
   printf("             mna_solve_cpu_gmres()\n");
-  Real_Timer interp2_run_time;
-  Real_Timer ir_run_time;
-  Real_Timer lufact_time;
-  Real_Timer gmresCPUilu_time;
+  gmres_log_bind(ctx->gmres_log);
+  ctx->spmv_cache = spmv_cache_new();
    
   vec max_value, min_value, avg_value, ir_value;
   double max_ir, avg_ir; // min_ir, 
@@ -964,23 +973,24 @@ void mna_solve_cpu_gmres(cs_dl *G, cs_dl *C, cs_dl *B,
   // ----------- LU part finish ----------------
 
   if (ir_info){
-	ir_run_time.start();
+	phase_begin("ir_analysis");
 	for (int j = 0; j < nNodes; j++){
 	  max_value(j) = xres(tc_node[j]);
 	  min_value(j) = xres(tc_node[j]);
 	  avg_value(j) = xres(tc_node[j]);
 	}
-	ir_run_time.stop();
+	phase_end();
   }
 
   /* Transient simulation */
+  double a = integ_coef(ctx->integ_method, tstep);
   cs_dl *right = cs_dl_spalloc(C->m, C->n, C->nzmax, 1, 0);
   for (UF_long i = 0; i < C->n+1; i++){
 	right->p[i] = C->p[i];
   }
   for (UF_long i = 0; i < C->nzmax; i++){
 	right->i[i] = C->i[i];
-	right->x[i] = 1/tstep*C->x[i];
+	right->x[i] = a*C->x[i];
   }
   cs_dl *left = cs_dl_add(G, right, 1, 1);
   // ----------- LU part start ----------------
@@ -1002,11 +1012,11 @@ void mna_solve_cpu_gmres(cs_dl *G, cs_dl *C, cs_dl *B,
   iluplusplus::iluplusplus_precond_parameter param;
   param.init(L,11,"test"); // setup some other default values. Has no effect on preprocessing (except choice of PQ-Algorithm)
   //double threshold=3.0, factor=1.0; // threshold=3.0
-  param.set_threshold(threshold);
-  param.set_MEM_FACTOR(factor);
+  param.set_threshold(ctx->ilu_threshold);
+  param.set_MEM_FACTOR(ctx->ilu_factor);
   param.set_MAX_LEVELS(1);
   
-  printf("    threshold=%f,  factor=%f\n", threshold, factor);
+  printf("    threshold=%f,  factor=%f\n", ctx->ilu_threshold, ctx->ilu_factor);
   
   //Matrix Arow;
   ucr_cs_di Gcs_di, Acs_di;
@@ -1166,23 +1176,26 @@ void mna_solve_cpu_gmres(cs_dl *G, cs_dl *C, cs_dl *B,
   GmyInterfacePG.setPrecondPG(&GmySpM,
                               &PrLeft_GmySpMdouble, &PrRight_GmySpMdouble, &PrMiddle_GmySpM,
                               &PrPermRow_GmySpM, &PrPermCol_GmySpM,
-                              &PrLscale_GmySpMdouble, &PrRscale_GmySpMdouble);
+                              &PrLscale_GmySpMdouble, &PrRscale_GmySpMdouble,
+                              ctx->spmv_cache, ctx->spmv_opt);
   AmyInterfacePG.setPrecondPG(&AmySpM,
                               &PrLeft_AmySpMdouble, &PrRight_AmySpMdouble, &PrMiddle_AmySpM,
                               &PrPermRow_AmySpM, &PrPermCol_AmySpM,
-                              &PrLscale_AmySpMdouble, &PrRscale_AmySpMdouble);
+                              &PrLscale_AmySpMdouble, &PrRscale_AmySpMdouble,
+                              ctx->spmv_cache, ctx->spmv_opt);
   for(int i=0; i<n; i++) {
     GmyInterfacePG.xgmres_h[i] = 0.0;
     GmyInterfacePG.rhs_h[i] = *(w._data()+i); // 1.0
   }
   printf("DC simulation:  ");
-  gmresCPUilu_time.start();
+  gmres_log_step(0, 0.0);
+  phase_begin("gmres_dc");
   GmyInterfacePG.GMRES_host_PG();
-  gmresCPUilu_time.stop();
+  phase_count("iterations", GmyInterfacePG.max_it);
+  phase_end();
   cout<<"Iterations: "<< GmyInterfacePG.max_it
       <<"  Residual: "<< GmyInterfacePG.tol
-      <<"  Time: " << gmresCPUilu_time.get_time() << endl;
-  gmresCPUilu_time.reset();
+      <<"  Time: " << phase_child_wall("gmres_dc") << endl;
   for(int j = 0; j < port.size(); j++)
     sim_port_value.set(j, 0, GmyInterfacePG.xgmres_h[port(j)]);
 
@@ -1192,15 +1205,16 @@ void mna_solve_cpu_gmres(cs_dl *G, cs_dl *C, cs_dl *B,
   int iterTotal=0;
   /* GMRES solver part finishes. */
   
-  vec xn(n), xnr(n), xn1(n), xn1t(n);
+  vec xn(n), xp(n), xn1(n), bu(n), bu0(n);
   // ----------- LU part start ----------------
   //xn = xres;
   // ----------- LU part finish ----------------
   //for(int j=0; j<n; j++)  xn._data()[j] = GmyInterfacePG.xgmres_h[j];
   //for(int j=0; j<n; j++)  xn._data()[j] = xgmres[j]; // for ILU++ gmres
   for(int j=0; j<n; j++)  xn._data()[j] = GmyInterfacePG.xgmres_h[j]; // for UCRilu gmres
+  xp = xn;
+  bu0 = w;
   xn1.zeros();
-  xn1t.zeros();
   printf("   ts.size() = %d.\n",ts.size());
   for (int i = 1; i < ts.size(); i++){//
         /*
@@ -1213,7 +1227,8 @@ void mna_solve_cpu_gmres(cs_dl *G, cs_dl *C, cs_dl *B,
           u_col(nVS+j) = temp;
         }
         */
-        interp2_run_time.start();
+        gmres_log_step(i, ts(i));
+        phase_begin("interp2");
         for(vector<int>::iterator it = var_v.begin(); it != var_v.end(); ++it){
           interp1(VS[*it].time, VS[*it].value, ts(i), temp, cur[*it]);
           u_col(*it) = temp;
@@ -1222,15 +1237,13 @@ void mna_solve_cpu_gmres(cs_dl *G, cs_dl *C, cs_dl *B,
           interp1(IS[*it].time, IS[*it].value, ts(i), temp, cur[nVS+(*it)]);
           u_col(nVS+(*it)) = temp;
         }
-        interp2_run_time.stop();
+        phase_end();
   
         w.zeros();
         cs_dl_gaxpy(B, u_col._data(), w._data());
-        xnr.zeros();
-        // cs_dl_gaxpy(C, xn._data(), xnr._data());
-        // w += 1/tstep*xnr;
-        cs_dl_gaxpy(right, xn._data(), xnr._data());
-        w += xnr;
+        bu = w;
+        integ_history(ctx->integ_method, G, right, bu0, xn, xp, w);
+        bu0 = bu;
         
 
         rel_tol =  reach_rel_tol;
@@ -1248,9 +1261,10 @@ void mna_solve_cpu_gmres(cs_dl *G, cs_dl *C, cs_dl *B,
         //-----------------------------
         for(int j=0; j<n; j++)  AmyInterfacePG.rhs_h[j] = *(w._data()+j);
         //for(int j=0; j<n; j++)  AmyInterfacePG.xgmres_h[j] = 0.0;
-        gmresCPUilu_time.start(); 
+        phase_begin("gmres");
         AmyInterfacePG.GMRES_host_PG();
-        gmresCPUilu_time.stop();
+        phase_count("iterations", AmyInterfacePG.max_it);
+        phase_end();
         iterTotal += AmyInterfacePG.max_it;
         for(int j=0; j<n; j++)  xn1._data()[j] = AmyInterfacePG.xgmres_h[j];
         //-----------------------------
@@ -1266,7 +1280,7 @@ void mna_solve_cpu_gmres(cs_dl *G, cs_dl *C, cs_dl *B,
           sim_port_value.set(j, i, xn1(port(j)));
 
         if (ir_info){
-          ir_run_time.start();
+          phase_begin("ir_analysis");
           for (int j = 0; j < nNodes; j++){
         	if (max_value(j) < xn1(tc_node[j])){
         	  max_value(j) = xn1(tc_node[j]);
@@ -1276,8 +1290,9 @@ void mna_solve_cpu_gmres(cs_dl *G, cs_dl *C, cs_dl *B,
         	}
         	avg_value(j) += xn1(tc_node[j]);
           }
-          ir_run_time.stop();
+          phase_end();
         }
+        xp = xn;
         xn = xn1;
   }
   //------------------------------------------
@@ -1413,7 +1428,7 @@ void mna_solve_cpu_gmres(cs_dl *G, cs_dl *C, cs_dl *B,
   delete [] cur;
 
   if (ir_info){
-	ir_run_time.start();
+	phase_begin("ir_analysis");
 	avg_value /= ts.size();
 	sorted_max_value_idx = sort_index(max_value);
 	sorted_avg_value_idx = sort_index(avg_value);
@@ -1471,17 +1486,21 @@ void mna_solve_cpu_gmres(cs_dl *G, cs_dl *C, cs_dl *B,
 		   << ir_value(sorted_ir_value_idx(nNodes-1-i)) << endl;
 	}
 	out_ir.close();
-	ir_run_time.stop();
+	phase_end();
   }
 
   std::cout.setf(std::ios::fixed,std::ios::floatfield); 
   std::cout.precision(2);
-  std::cout << "interpolation2  \t: " << interp2_run_time.get_time() << std::endl;
-  std::cout << "IR analysis     \t: " << ir_run_time.get_time() << std::endl;
+  std::cout << "interpolation2  \t: " << phase_child_wall("interp2") << std::endl;
+  std::cout << "IR analysis     \t: " << phase_child_wall("ir_analysis") << std::endl;
   //std::cout << "LU factorization\t: " << lufact_time.get_time() << std::endl;
-  std::cout << "ILU++ GMRES CPU \t: " << gmresCPUilu_time.get_time()
+  std::cout << "ILU++ GMRES CPU \t: " << phase_child_wall("gmres")
             << "    Avg iter per point: " << (int)ceil(1.0*iterTotal/ts.size())
-            << "    Time per point: " << gmresCPUilu_time.get_time() / ts.size() << std::endl;
+            << "    Time per point: " << phase_child_wall("gmres") / ts.size() << std::endl;
+  /* the SpMV plans of G and A (-spmvtune, -ccsr, -stencil) */
+  spmv_cache_free(ctx->spmv_cache);
+  ctx->spmv_cache = NULL;
+  gmres_log_bind(NULL);
   mySpMatrixFree(&GmySpM); //PrLeft_GmySpM, PrRight_GmySpM,
   mySpMatrixFree(&PrMiddle_GmySpM);
   mySpMatrixFree(&PrPermRow_GmySpM);
@@ -1513,10 +1532,6 @@ void mna_solve_gpu(cs_dl *G, cs_dl *C, cs_dl *B,
                    gpuETBR *myGPUetbr)
 {
   printf("             mna_solve_gpu()\n");
-  Real_Timer interp2_run_time;
-  Real_Timer ir_run_time;
-  Real_Timer lufact_time;
-  Real_Timer gmresCPUilu_time;
    
   vec max_value, min_value, avg_value, ir_value;
   double max_ir, avg_ir; // min_ir, 
@@ -1584,10 +1599,12 @@ void mna_solve_gpu(cs_dl *G, cs_dl *C, cs_dl *B,
   cs_dln *NumericG, *NumericA;
   int order = 2;
   double tol = 1e-10; // XXLiu: was 1e-14
-  lufact_time.start();
+  phase_begin("lufact");
   SymbolicG = cs_dl_sqr(order, G, 0);
   NumericG = cs_dl_lu(G, SymbolicG, tol);
-  lufact_time.stop();
+  phase_count("nnz", (double)G->p[n]);
+  phase_count("factor_nnz", (double)(NumericG->L->p[n] + NumericG->U->p[n]));
+  phase_end();
   cs_dl_ipvec(NumericG->pinv, w._data(), x._data(), n);
   cs_dl_lsolve(NumericG->L, x._data());
   cs_dl_usolve(NumericG->U, x._data());
@@ -1602,13 +1619,13 @@ void mna_solve_gpu(cs_dl *G, cs_dl *C, cs_dl *B,
   }
 
   if (ir_info){
-	ir_run_time.start();
+	phase_begin("ir_analysis");
 	for (int j = 0; j < nNodes; j++){
 	  max_value(j) = xres(tc_node[j]);
 	  min_value(j) = xres(tc_node[j]);
 	  avg_value(j) = xres(tc_node[j]);
 	}
-	ir_run_time.stop();
+	phase_end();
   }
 
   /* Transient simulation */
@@ -1621,10 +1638,12 @@ void mna_solve_gpu(cs_dl *G, cs_dl *C, cs_dl *B,
 	right->x[i] = 1/tstep*C->x[i];
   }
   cs_dl *left = cs_dl_add(G, right, 1, 1);
-  lufact_time.start();
+  phase_begin("lufact");
   SymbolicA = cs_dl_sqr(order, left, 0);
   NumericA = cs_dl_lu(left, SymbolicA, tol);
-  lufact_time.stop();
+  phase_count("nnz", (double)left->p[n]);
+  phase_count("factor_nnz", (double)(NumericA->L->p[n] + NumericA->U->p[n]));
+  phase_end();
 
   /* GMRES solver part starts. */
   ucr_cs_dl leftUCR, rightUCR, G_UCR, B_UCR, LG, UG, LA, UA;
@@ -1823,7 +1842,7 @@ void mna_solve_gpu(cs_dl *G, cs_dl *C, cs_dl *B,
   delete [] cur;
 
   if (ir_info){
-	ir_run_time.start();
+	phase_begin("ir_analysis");
 	avg_value /= ts.size();
 	sorted_max_value_idx = sort_index(max_value);
 	sorted_avg_value_idx = sort_index(avg_value);
@@ -1881,14 +1900,14 @@ void mna_solve_gpu(cs_dl *G, cs_dl *C, cs_dl *B,
 		   << ir_value(sorted_ir_value_idx(nNodes-1-i)) << endl;
 	}
 	out_ir.close();
-	ir_run_time.stop();
+	phase_end();
   }
 
   std::cout.setf(std::ios::fixed,std::ios::floatfield); 
   std::cout.precision(2);
-  std::cout << "interpolation2  \t: " << interp2_run_time.get_time() << std::endl;
-  std::cout << "IR analysis     \t: " << ir_run_time.get_time() << std::endl;
-  std::cout << "LU factorization\t: " << lufact_time.get_time() << std::endl;
+  std::cout << "interpolation2  \t: " << phase_child_wall("interp2") << std::endl;
+  std::cout << "IR analysis     \t: " << phase_child_wall("ir_analysis") << std::endl;
+  std::cout << "LU factorization\t: " << phase_child_wall("lufact") << std::endl;
 }
 
 
@@ -1897,13 +1916,9 @@ void mna_solve_cpu_ilu_gmres(cs_dl *G, cs_dl *C, cs_dl *B,
                          Source *VS, int nVS, Source *IS, int nIS, 
                          double tstep, double tstop, const ivec &port, mat &sim_port_value, 
                          vector<int> &tc_node, vector<string> &tc_name, int num, int ir_info,
-                         char *ir_name)//, gpuETBR *myGPUetbr
+                         char *ir_name, SOLVER_CTX *ctx)//, gpuETBR *myGPUetbr
 {
   printf("             mna_solve_cpu_ilu_gmres()\n");
-  Real_Timer interp2_run_time;
-  Real_Timer ir_run_time;
-  Real_Timer lufact_time;
-  Real_Timer gmresCPUilu_time;
    
   vec max_value, min_value, avg_value, ir_value;
   double max_ir, avg_ir; // min_ir, 
@@ -1989,23 +2004,24 @@ void mna_solve_cpu_ilu_gmres(cs_dl *G, cs_dl *C, cs_dl *B,
   }
 
   if (ir_info){
-	ir_run_time.start();
+	phase_begin("ir_analysis");
 	for (int j = 0; j < nNodes; j++){
 	  max_value(j) = xres(tc_node[j]);
 	  min_value(j) = xres(tc_node[j]);
 	  avg_value(j) = xres(tc_node[j]);
 	}
-	ir_run_time.stop();
+	phase_end();
   }
 
   /* Transient simulation */
+  double a = integ_coef(ctx->integ_method, tstep);
   cs_dl *right = cs_dl_spalloc(C->m, C->n, C->nzmax, 1, 0);
   for (UF_long i = 0; i < C->n+1; i++){
 	right->p[i] = C->p[i];
   }
   for (UF_long i = 0; i < C->nzmax; i++){
 	right->i[i] = C->i[i];
-	right->x[i] = 1/tstep*C->x[i];
+	right->x[i] = a*C->x[i];
   }
   cs_dl *left = cs_dl_add(G, right, 1, 1);
   // lufact_time.start();
@@ -2029,8 +2045,8 @@ void mna_solve_cpu_ilu_gmres(cs_dl *G, cs_dl *C, cs_dl *B,
   cout<<endl;
   iluplusplus::iluplusplus_precond_parameter param;
   param.init(L,10,"test"); // setup some other default values. Has no effect on preprocessing (except choice of PQ-Algorithm)
-  param.set_threshold(threshold);
-  param.set_MEM_FACTOR(factor);
+  param.set_threshold(ctx->ilu_threshold);
+  param.set_MEM_FACTOR(ctx->ilu_factor);
   param.set_MAX_LEVELS(1);
   param.set_MAX_FILLIN_IS_INF(true);
   
@@ -2065,9 +2081,10 @@ void mna_solve_cpu_ilu_gmres(cs_dl *G, cs_dl *C, cs_dl *B,
   cout<<"*****************************************************************************"<<endl;
   cout<<"GMRES"<<endl;
   cout<<"*****************************************************************************"<<endl;
-  gmresCPUilu_time.start();
+  phase_begin("gmres_dc");
   iluplusplus::gmres<Real,Matrix,Vector>(PrG,iluplusplus::SPLIT,Gcol,b,xgmres,restart,min_iter,max_iter,rel_tol,abs_tol,true);
-  gmresCPUilu_time.stop();
+  phase_count("iterations", max_iter);
+  phase_end();
   cout<<"Iterations "<<max_iter<<endl;
   //cout<<"error: "<<(xgmres-x_exact).norm_max()<<endl<<flush;
   cout<<"relative decrease in norm of residual: "<<exp(-rel_tol*log(10.0))<<endl;
@@ -2124,9 +2141,11 @@ void mna_solve_cpu_ilu_gmres(cs_dl *G, cs_dl *C, cs_dl *B,
   int iterTotal=0;
   /* GMRES solver part finishes. */
   
-  vec xn(n), xnr(n), xn1(n), xn1t(n);
+  vec xn(n), xp(n), xn1(n), xn1t(n), bu(n), bu0(n);
   for(int j=0; j<n; j++)
     xn._data()[j] = xgmres[j]; // xn = xres;
+  xp = xn;
+  bu0 = w;
   xn1.zeros();
   xn1t.zeros();
   printf("   ts.size() = %d.\n",ts.size());
@@ -2141,7 +2160,7 @@ void mna_solve_cpu_ilu_gmres(cs_dl *G, cs_dl *C, cs_dl *B,
           u_col(nVS+j) = temp;
         }
         */
-        interp2_run_time.start();
+        phase_begin("interp2");
         for(vector<int>::iterator it = var_v.begin(); it != var_v.end(); ++it){
           interp1(VS[*it].time, VS[*it].value, ts(i), temp, cur[*it]);
           u_col(*it) = temp;
@@ -2150,24 +2169,23 @@ void mna_solve_cpu_ilu_gmres(cs_dl *G, cs_dl *C, cs_dl *B,
           interp1(IS[*it].time, IS[*it].value, ts(i), temp, cur[nVS+(*it)]);
           u_col(nVS+(*it)) = temp;
         }
-        interp2_run_time.stop();
+        phase_end();
 
         w.zeros();
         cs_dl_gaxpy(B, u_col._data(), w._data());
-        xnr.zeros();
-        // cs_dl_gaxpy(C, xn._data(), xnr._data());
-        // w += 1/tstep*xnr;
-        cs_dl_gaxpy(right, xn._data(), xnr._data());
-        w += xnr;
+        bu = w;
+        integ_history(ctx->integ_method, G, right, bu0, xn, xp, w);
+        bu0 = bu;
         
         rel_tol =  reach_rel_tol;
         abs_tol = reach_abs_tol;
         max_iter = reach_max_iter;
         restart = 100;
         b.value( w._data(), 0, n );
-        gmresCPUilu_time.start();
+        phase_begin("gmres");
         iluplusplus::gmres<Real,Matrix,Vector>(PrA,iluplusplus::SPLIT,Acol,b,xgmres,restart,min_iter,max_iter,rel_tol,abs_tol,true);
-        gmresCPUilu_time.stop();
+        phase_count("iterations", max_iter);
+        phase_end();
         //cout<<"Iterations "<<max_iter<<endl;
         
         iterTotal += max_iter;
@@ -2183,7 +2201,7 @@ void mna_solve_cpu_ilu_gmres(cs_dl *G, cs_dl *C, cs_dl *B,
           sim_port_value.set(j, i, xn1(port(j)));
         }
         if (ir_info){
-          ir_run_time.start();
+          phase_begin("ir_analysis");
           for (int j = 0; j < nNodes; j++){
         	if (max_value(j) < xn1(tc_node[j])){
         	  max_value(j) = xn1(tc_node[j]);
@@ -2193,8 +2211,9 @@ void mna_solve_cpu_ilu_gmres(cs_dl *G, cs_dl *C, cs_dl *B,
         	}
         	avg_value(j) += xn1(tc_node[j]);
           }
-          ir_run_time.stop();
+          phase_end();
         }
+        xp = xn;
         xn = xn1;
   }
   cs_dl_spfree(left);
@@ -2206,7 +2225,7 @@ void mna_solve_cpu_ilu_gmres(cs_dl *G, cs_dl *C, cs_dl *B,
   delete [] cur;
 
   if (ir_info){
-	ir_run_time.start();
+	phase_begin("ir_analysis");
 	avg_value /= ts.size();
 	sorted_max_value_idx = sort_index(max_value);
 	sorted_avg_value_idx = sort_index(avg_value);
@@ -2264,13 +2283,13 @@ void mna_solve_cpu_ilu_gmres(cs_dl *G, cs_dl *C, cs_dl *B,
 		   << ir_value(sorted_ir_value_idx(nNodes-1-i)) << endl;
 	}
 	out_ir.close();
-	ir_run_time.stop();
+	phase_end();
   }
 
   std::cout.setf(std::ios::fixed,std::ios::floatfield); 
   std::cout.precision(2);
-  std::cout << "interpolation2  \t: " << interp2_run_time.get_time() << std::endl;
-  std::cout << "IR analysis     \t: " << ir_run_time.get_time() << std::endl;
-  std::cout << "LU factorization\t: " << lufact_time.get_time() << std::endl;
-  std::cout << "ILU++ GMRES CPU \t: " << gmresCPUilu_time.get_time() << "    Avg Iter: " << (int)iterTotal/ts.size() << std::endl;
+  std::cout << "interpolation2  \t: " << phase_child_wall("interp2") << std::endl;
+  std::cout << "IR analysis     \t: " << phase_child_wall("ir_analysis") << std::endl;
+  std::cout << "LU factorization\t: " << phase_child_wall("lufact") << std::endl;
+  std::cout << "ILU++ GMRES CPU \t: " << phase_child_wall("gmres_dc") + phase_child_wall("gmres") << "    Avg Iter: " << (int)iterTotal/ts.size() << std::endl;
 }
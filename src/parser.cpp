@@ -636,6 +636,169 @@ void parser_sub(const char* filename, double& tstep, double& tstop, int& num_sub
 }
 
 
+/* -rom_load: the nodes of the sources and the ports only, R, C and L
+   lines are skipped. 0 if the deck has subcircuits, their nodes are
+   numbered by parser_sub */
+int parser_sources(const char* filename, double& tstep, double& tstop, int& nVS, int& nIS, NodeList* nodePool)
+{
+  char* strline;
+  char* node1, *node2;
+  char *tstepstr, *tstopstr;
+  char *portstr;
+  char *incfilename, *tmp_incfilename;
+
+  int num_V, num_I;
+  int pos;
+  int i,j;
+  int flat = 1;
+
+  FILE* fid_tmp = NULL;
+
+  FILE* fid = fopen(filename, "r");
+
+  if(fid == NULL){
+    printf("Open file Error!\n");
+    exit(-1);
+  }
+
+  strline = (char*)malloc(READ_BLOCK_SIZE*sizeof(char));
+
+  incfilename = (char*)malloc(NAME_BLOCK_SIZE*sizeof(char));
+  tmp_incfilename = (char*)malloc(NAME_BLOCK_SIZE*sizeof(char));
+  node1 = (char*)malloc(NAME_BLOCK_SIZE*sizeof(char));
+  node2 = (char*)malloc(NAME_BLOCK_SIZE*sizeof(char));
+  portstr = (char*)malloc(NAME_BLOCK_SIZE*sizeof(char));
+
+  tstepstr = (char*)malloc(VALUE_BLOCK_SIZE*sizeof(char));
+  tstopstr = (char*)malloc(VALUE_BLOCK_SIZE*sizeof(char));
+
+  i = 0;
+  pos = 0;
+  while(filename[i]!='\0'){
+    if(filename[i] == '/')
+      pos = i;
+    i++;
+  }
+
+  if(pos != 0){
+    pos++;
+    strncpy(incfilename,filename,pos);
+    incfilename[pos] = '\0';  }
+
+  num_V = 0;
+  num_I = 0;
+
+  while(flat && (!feof(fid) || (fid_tmp!=NULL && !feof(fid_tmp)))){
+
+    strline[0] = '\0';
+    if(feof(fid)==0)
+      fgets(strline, READ_BLOCK_SIZE,fid);
+    else
+      fgets(strline, READ_BLOCK_SIZE, fid_tmp);
+
+    switch(strline[0])
+      {
+      case'V': case'v':
+	num_V++;
+	if(sscanf(strline, "%*s %s %s %*s", node1, node2) == 2){
+	  nodePool->findorPushNode(node1);
+	  nodePool->findorPushNode(node2);
+	}
+	break;
+
+      case'I': case'i':
+	num_I++;
+	if(sscanf(strline, "%*s %s %s %*s", node1, node2) == 2){
+	  nodePool->findorPushNode(node1);
+	  nodePool->pushTCNode(node1);
+	  nodePool->findorPushNode(node2);
+	  nodePool->pushTCNode(node2);
+	}
+	break;
+
+      case'X': case'x':
+	flat = 0;
+	break;
+
+      case'.':
+	if(strncmp(strline, ".tran", 5)==0 || strncmp(strline, ".TRAN", 5)==0){
+	  if(sscanf(strline, "%*s %s %s", tstepstr, tstopstr)==2){
+	    tstep = StrToNum(tstepstr);
+	    tstop = StrToNum(tstopstr);
+	  }
+	}
+	else if (strncmp(strline, ".print", 6)==0 ){
+	  /* a port need not touch a source: its node is added here */
+	  i = 0;
+	  if (strline[12] != 'v' && strline[12] != 'V' && strline[12] != 'i' && strline[12] != 'I')
+	    printf("Invalid command: %s\n",strline);
+	  else{
+	    while(strline[i]!='\0'){
+	      if(strline[i]=='('){
+		i++;
+		j = 0;
+		while(strline[i]!=')'){
+		  portstr[j++] = strline[i++];
+		}
+		portstr[j] = '\0';
+		nodePool->findorPushNode(portstr);
+		nodePool->pushPort(portstr);
+	      }
+	      i++;
+	    }
+	  }
+	}
+	else if (strncmp(strline, ".include", 8)==0 || strncmp(strline, ".INCLUDE", 8)==0){
+	  if(sscanf(strline, "%*s %s", tmp_incfilename) == 1){
+	    i = 0;
+	    j = pos;
+	    while(tmp_incfilename[i] != '\0'){
+	      if(tmp_incfilename[i]!='\"'){
+		incfilename[j] = tmp_incfilename[i];
+		j++;
+	      }
+	      i++;
+	    }
+	    incfilename[j] = '\0';
+
+	    fid_tmp = fid;
+
+	    fid = fopen(incfilename,"r");
+	    if(fid == NULL){
+	      printf("Open file Error!\n");
+	      exit(-1);
+	    }
+	  }
+	}
+	else if(strncmp(strline, ".SUBCKT", 7)==0 || strncmp(strline, ".subckt", 7)==0)
+	  flat = 0;
+	break;
+
+      default:
+	break;
+      }
+  }
+  fclose(fid);
+
+  if(fid_tmp != NULL){
+    fclose(fid_tmp);
+  }
+
+  nIS = num_I;
+  nVS = num_V;
+
+  free(strline);
+  free(tmp_incfilename);
+  free(incfilename);
+  free(node1);
+  free(node2);
+  free(portstr);
+  free(tstepstr);
+  free(tstopstr);
+
+  return flat;
+}
+
 void stamp_sub(const char* filename, int nL, int nIS, int nVS, int& nNodes,
 	       double& tstep, double& tstop, Source *VS, Source *IS,
 	       matrix* G, matrix* C, matrix* B, NodeList* nodePool,
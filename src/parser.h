@@ -54,6 +54,10 @@ void parser(const char* filename, double& tstep, double& tstop, int& nIS, int& n
 
 void parser_sub(const char* filename, double& tstep, double& tstop, int& num_subnode, int& nVS, int& nIS, int& nL, NodeList* nodePool);
 
+/* the sources, ports and tap nodes only (-rom_load); 0 for a deck
+   with subcircuits */
+int parser_sources(const char* filename, double& tstep, double& tstop, int& nVS, int& nIS, NodeList* nodePool);
+
 
 void stamp(const char* filename, int nL, int nVS, int& nNodes, double& tstep, double& tstop, Source *VS, Source *IS, matrix* G, matrix* C, matrix* B, NodeList* nodePool);
 
@@ -18,8 +18,10 @@
  */
 
 #include <set>
+#include <algorithm>
 #include "cs.h"
 #include "metis.h"
+#include "thread_pool.h"
 //#include "metislib.h"
 
 using namespace std;
@@ -119,26 +121,143 @@ void partition3(cs_dl *A, int npart, int nNodes,
   delete [] part_current;
 }
 
+typedef struct{
+  idxtype *xadj;
+  idxtype *adjncy;
+  idxtype *deg;
+  UF_long begin;
+  UF_long end;
+}ADJDATA;
+
+/* sort and unique the neighbour lists of the vertices in [begin, end) */
+static void *adjacency_unique(void *arg)
+{
+  ADJDATA *d = (ADJDATA *)arg;
+  for (UF_long j = d->begin; j < d->end; j++){
+	idxtype *first = d->adjncy + d->xadj[j];
+	idxtype *last = d->adjncy + d->xadj[j+1];
+	sort(first, last);
+	d->deg[j] = unique(first, last) - first;
+  }
+  return NULL;
+}
+
+void build_adjacency(cs_dl *G, cs_dl *C, int nNodes,
+					 idxtype *&xadj, idxtype *&adjncy, idxtype *&vwgt,
+					 THREAD_POOL *pool)
+{
+  cs_dl *A[2] = {G, C};
+  UF_long j = 0, p = 0;
+
+  /* both (i,j) and (j,i) of every node-node entry of G and C go in,
+	 so the graph is symmetric even if the patterns are not */
+  xadj = (idxtype *) malloc((nNodes+1)*sizeof(idxtype));
+  vwgt = (idxtype *) malloc(nNodes*sizeof(idxtype));
+  idxtype *deg = (idxtype *) malloc(nNodes*sizeof(idxtype));
+  for (j = 0; j < nNodes; j++){
+	deg[j] = 0;
+	vwgt[j] = 0;
+  }
+  for (int k = 0; k < 2; k++){
+	if (A[k] == NULL)
+	  continue;
+	UF_long *Ap = A[k]->p, *Ai = A[k]->i;
+	for (j = 0; j < nNodes; j++){
+	  vwgt[j] += Ap[j+1] - Ap[j];
+	  for (p = Ap[j]; p < Ap[j+1]; p++){
+		if (Ai[p] < nNodes && Ai[p] != j){
+		  deg[j]++;
+		  deg[Ai[p]]++;
+		}
+	  }
+	}
+  }
+  xadj[0] = 0;
+  for (j = 0; j < nNodes; j++)
+	xadj[j+1] = xadj[j] + deg[j];
+  adjncy = (idxtype *) malloc((xadj[nNodes] > 0 ? xadj[nNodes] : 1)*sizeof(idxtype));
+  for (j = 0; j < nNodes; j++)
+	deg[j] = xadj[j];
+  for (int k = 0; k < 2; k++){
+	if (A[k] == NULL)
+	  continue;
+	UF_long *Ap = A[k]->p, *Ai = A[k]->i;
+	for (j = 0; j < nNodes; j++){
+	  for (p = Ap[j]; p < Ap[j+1]; p++){
+		if (Ai[p] < nNodes && Ai[p] != j){
+		  adjncy[deg[j]++] = Ai[p];
+		  adjncy[deg[Ai[p]]++] = j;
+		}
+	  }
+	}
+  }
+
+  /* the lists are independent, split the vertices over the pool; the
+	 caller sorts the first chunk */
+  THREAD_POOL *tpool = NULL;
+  int nthreads = 1;
+  if (xadj[nNodes] >= 100000){
+	tpool = pool != NULL ? pool : pool_create(pool_default_size());
+	nthreads = pool_size(tpool);
+  }
+  ADJDATA *tdata = new ADJDATA[nthreads];
+  void **args = new void*[nthreads];
+  UF_long chunk = (nNodes + nthreads - 1)/nthreads;
+  for (int t = 0; t < nthreads; t++){
+	tdata[t].xadj = xadj;
+	tdata[t].adjncy = adjncy;
+	tdata[t].deg = deg;
+	tdata[t].begin = min((UF_long)nNodes, t*chunk);
+	tdata[t].end = min((UF_long)nNodes, (t+1)*chunk);
+	args[t] = &tdata[t];
+  }
+  POOL_BATCH *batch = nthreads > 1 ? pool_submit(tpool, adjacency_unique, args+1, nthreads-1) : NULL;
+  adjacency_unique(args[0]);
+  if (batch != NULL)
+	pool_wait(batch);
+  if (tpool != NULL && tpool != pool)
+	pool_free(tpool);
+  delete [] tdata;
+  delete [] args;
+
+  /* squeeze out the duplicates */
+  idxtype nz = 0;
+  for (j = 0; j < nNodes; j++){
+	idxtype start = xadj[j];
+	xadj[j] = nz;
+	for (p = 0; p < deg[j]; p++)
+	  adjncy[nz++] = adjncy[start+p];
+  }
+  xadj[nNodes] = nz;
+  adjncy = (idxtype *) realloc(adjncy, (nz > 0 ? nz : 1)*sizeof(idxtype));
+  free(deg);
+}
+
 void partition4(idxtype *xadj, idxtype *adjncy, int npart, UF_long m, int nNodes, UF_long *vnode,
-			   UF_long *part_size, UF_long *node_part, UF_long *pinv, UF_long *q)
+			   UF_long *part_size, UF_long *node_part, UF_long *pinv, UF_long *q,
+			   idxtype *vwgt, int kway)
 {
   UF_long i = 0, j = 0, p = 0;
   
   idxtype nvtxs;
   idxtype nparts, numflag, wgtflag, edgecut, options[10];
-  idxtype *part, *vwgt, *adjwgt;
+  idxtype *part, *adjwgt;
 
   nvtxs= nNodes;
   numflag = 0; 
-  wgtflag = 0; 
+  wgtflag = vwgt != NULL ? 2 : 0;  /* 2: weights on the vertices only */
   nparts = npart;
   options[0] = 0;
   part = (idxtype *) malloc(nvtxs*sizeof(idxtype));
 
   printf("#Vertices: %d, #Edges: %d\n", nvtxs, xadj[nNodes]/2);
 
-  METIS_PartGraphRecursive(&nvtxs, xadj, adjncy, NULL, NULL, &wgtflag, &numflag,
-						   &nparts, options, &edgecut, part);
+  if (kway)
+	METIS_PartGraphKway(&nvtxs, xadj, adjncy, vwgt, NULL, &wgtflag, &numflag,
+						&nparts, options, &edgecut, part);
+  else
+	METIS_PartGraphRecursive(&nvtxs, xadj, adjncy, vwgt, NULL, &wgtflag, &numflag,
+							 &nparts, options, &edgecut, part);
 
   printf("%d-way cutsize is: %d\n", nparts, edgecut);
 
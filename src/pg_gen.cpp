@@ -0,0 +1,683 @@
+/*
+*******************************************************
+
+    Cadence Extended Truncated Balanced Realization
+                (*** CadETBR ***)
+
+*******************************************************
+*/
+
+/*
+ *    $RCSfile: pg_gen.cpp,v $
+ *    $Revision: 1.1 $
+ *    $Date: 2013/03/23 21:08:01 $
+ *
+ *    Functions: Synthetic power grid benchmark generator
+ *
+ *    Writes a flat SPICE deck in the dialect of parser_sub/stampG/C/B:
+ *    a stack of mesh layers (layer l has twice the pitch of layer l-1
+ *    and half its segment resistance), vias from every upper node to the
+ *    node below it with a given density, VDD pads on the top layer,
+ *    decaps and switching current loads on the bottom layer. The same
+ *    circuit can be written as the A = G+C/h, B, C, u_vec and t_step
+ *    files read by src_thermal, with the rows numbered the way the parser
+ *    numbers them (nodes by first appearance, then the voltage sources).
+ *    Everything is drawn from a hash of (seed, element), so a deck only
+ *    depends on its options.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+#define WAVE_DC     0
+#define WAVE_PWL    1
+#define WAVE_PULSE  2
+
+#define MAX_EVENTS  12	/* a PWL source has to fit in one READ_BLOCK_SIZE line */
+
+enum { E_R, E_C, E_V, E_I };
+
+struct PGParam {
+  long nodes;
+  int nx, ny, layers;
+  double pitch, width, rsheet;
+  double via, rvia;
+  int pads;
+  double vdd, rpad;
+  double decap, cdecap;
+  double load, iload;
+  int wave, events;
+  double period, tstep, tstop;
+  unsigned long seed;
+  int probes;
+};
+
+struct PGGrid {
+  PGParam p;
+  vector<int> nx, ny;
+  vector<long> off;	/* first node id of each layer; pads follow the top layer */
+  long nnode;
+};
+
+/* splitmix64 of (seed, stream, index), uniform in [0,1) */
+static double urand(const PGGrid &g, int stream, long idx)
+{
+  unsigned long long z = g.p.seed * 0x9e3779b97f4a7c15ULL + ((unsigned long long)stream << 48) + idx;
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  z ^= z >> 31;
+  return (z >> 11) * (1.0/9007199254740992.0);
+}
+
+/* round to what "%.6g" writes, so the deck and the matrices hold the same numbers */
+static double q6(double v)
+{
+  char s[32];
+  sprintf(s, "%.6g", v);
+  return strtod(s, NULL);
+}
+
+static long node_id(const PGGrid &g, int l, int x, int y)
+{
+  return g.off[l] + (long)y*g.nx[l] + x;
+}
+
+static void node_name(const PGGrid &g, long id, char *s)
+{
+  if (id < 0){
+    strcpy(s, "0");
+    return;
+  }
+  if (id >= g.off[g.p.layers]){
+    sprintf(s, "p%ld", id - g.off[g.p.layers]);
+    return;
+  }
+  int l = 0;
+  while (id >= g.off[l+1])
+    l++;
+  long k = id - g.off[l];
+  sprintf(s, "n%d_%ld_%ld", l, k % g.nx[l], k / g.nx[l]);
+}
+
+static void grid_setup(PGGrid &g)
+{
+  PGParam &p = g.p;
+  if (p.nx == 0){
+    /* bottom mesh side for about p.nodes nodes over all layers */
+    double s = 0;
+    for (int l = 0; l < p.layers; l++)
+      s += pow(0.25, l);
+    p.nx = p.ny = max(2, (int)(sqrt(p.nodes/s) + 0.5));
+  }
+  g.nx.resize(p.layers);
+  g.ny.resize(p.layers);
+  g.off.resize(p.layers+1);
+  g.nx[0] = p.nx;
+  g.ny[0] = p.ny;
+  for (int l = 1; l < p.layers; l++){
+    g.nx[l] = (g.nx[l-1]-1)/2 + 1;
+    g.ny[l] = (g.ny[l-1]-1)/2 + 1;
+  }
+  g.off[0] = 0;
+  for (int l = 0; l < p.layers; l++)
+    g.off[l+1] = g.off[l] + (long)g.nx[l]*g.ny[l];
+  g.nnode = g.off[p.layers] + p.pads;
+}
+
+/* the segment resistance of layer l: twice the pitch, twice the width
+   and half the sheet resistance of the layer below */
+static double seg_res(const PGGrid &g, int l)
+{
+  return q6(g.p.rsheet * g.p.pitch / (g.p.width * pow(2.0, l)));
+}
+
+/* ---------------- waveforms of the current loads ---------------- */
+
+struct Wave {
+  vector<double> t, v;	/* PWL points */
+  double v1, v2, td, tr, tf, pw, per;	/* PULSE */
+};
+
+static void load_wave(const PGGrid &g, long j, Wave &w)
+{
+  const PGParam &p = g.p;
+  double peak = q6(p.iload * (0.5 + 0.5*urand(g, 1, j)));
+  w.t.clear();
+  w.v.clear();
+  if (p.wave == WAVE_DC){
+    /* stampB waits for a key on a DC current source, so use a flat PWL */
+    w.t.push_back(0.0);        w.v.push_back(peak);
+    w.t.push_back(q6(p.tstop)); w.v.push_back(peak);
+  }else if (p.wave == WAVE_PWL){
+    double slot = p.tstop / p.events;
+    w.t.push_back(0.0);
+    w.v.push_back(0.0);
+    for (int e = 0; e < p.events; e++){
+      double ts = e*slot + slot*(0.05 + 0.45*urand(g, 2, j*MAX_EVENTS+e));
+      double a = q6(peak * (0.5 + 0.5*urand(g, 3, j*MAX_EVENTS+e)));
+      w.t.push_back(q6(ts));               w.v.push_back(0.0);
+      w.t.push_back(q6(ts + 0.1*slot));    w.v.push_back(a);
+      w.t.push_back(q6(ts + 0.3*slot));    w.v.push_back(0.0);
+    }
+  }else{
+    w.v1 = 0.0;
+    w.v2 = peak;
+    w.per = q6(p.period);
+    w.td = q6(0.6*p.period*urand(g, 2, j));
+    w.tr = q6(0.05*p.period);
+    w.tf = w.tr;
+    w.pw = q6(0.25*p.period);
+  }
+}
+
+/* the value stampB builds from the PWL points or from the PULSE periods */
+static double wave_value(const PGParam &p, const Wave &w, double t)
+{
+  if (p.wave != WAVE_PULSE){
+    if (t >= w.t.back())
+      return w.v.back();
+    size_t k = 1;
+    while (w.t[k] < t)
+      k++;
+    double dt = w.t[k] - w.t[k-1];
+    return dt > 0 ? w.v[k-1] + (w.v[k]-w.v[k-1])*(t-w.t[k-1])/dt : w.v[k];
+  }
+  double tt = t - floor(t/w.per)*w.per;
+  if (tt < w.td)
+    return w.v1;
+  if (tt < w.td + w.tr)
+    return w.v1 + (w.v2-w.v1)*(tt-w.td)/w.tr;
+  if (tt < w.td + w.tr + w.pw)
+    return w.v2;
+  if (tt < w.td + w.tr + w.pw + w.tf)
+    return w.v2 + (w.v1-w.v2)*(tt-w.td-w.tr-w.pw)/w.tf;
+  return w.v1;
+}
+
+/* ---------------- element enumeration ---------------- */
+
+class PGVisitor {
+public:
+  virtual ~PGVisitor() {}
+  /* n1, n2 are node ids, -1 is the ground */
+  virtual void element(int type, long idx, long n1, long n2, double value) = 0;
+};
+
+static void pg_elements(const PGGrid &g, PGVisitor &v)
+{
+  const PGParam &p = g.p;
+  long nr = 0, nc = 0, ni = 0;
+
+  /* mesh layers; row y, then the segments from row y to y+1, so each
+     layer appears row by row */
+  for (int l = 0; l < p.layers; l++){
+    double r = seg_res(g, l);
+    for (int y = 0; y < g.ny[l]; y++){
+      for (int x = 0; x+1 < g.nx[l]; x++)
+	v.element(E_R, nr++, node_id(g, l, x, y), node_id(g, l, x+1, y), r);
+      if (y+1 < g.ny[l])
+	for (int x = 0; x < g.nx[l]; x++)
+	  v.element(E_R, nr++, node_id(g, l, x, y), node_id(g, l, x, y+1), r);
+    }
+  }
+
+  /* vias; the corner one is always there so that the stack is connected */
+  for (int l = 1; l < p.layers; l++)
+    for (int y = 0; y < g.ny[l]; y++)
+      for (int x = 0; x < g.nx[l]; x++){
+	long id = node_id(g, l, x, y);
+	if ((x == 0 && y == 0) || urand(g, 4, id) < p.via)
+	  v.element(E_R, nr++, id, node_id(g, l-1, 2*x, 2*y), q6(p.rvia));
+      }
+
+  /* pads on a regular array over the top layer */
+  int top = p.layers-1;
+  int kx = (int)ceil(sqrt((double)p.pads));
+  int ky = (p.pads + kx - 1) / kx;
+  for (int k = 0; k < p.pads; k++){
+    int x = (int)((k % kx + 0.5) * g.nx[top] / kx);
+    int y = (int)((k / kx + 0.5) * g.ny[top] / ky);
+    long pad = g.off[p.layers] + k;
+    v.element(E_R, nr++, pad, node_id(g, top, x, y), q6(p.rpad));
+    v.element(E_V, k, pad, -1, q6(p.vdd));
+  }
+
+  /* decaps and loads on the bottom layer */
+  for (long id = 0; id < g.off[1]; id++)
+    if (urand(g, 5, id) < p.decap)
+      v.element(E_C, nc++, id, -1, q6(p.cdecap));
+  for (long id = 0; id < g.off[1]; id++)
+    if (urand(g, 6, id) < p.load)
+      v.element(E_I, ni++, id, -1, 0.0);
+}
+
+/* ---------------- the deck ---------------- */
+
+class DeckWriter : public PGVisitor {
+public:
+  const PGGrid &g;
+  FILE *f;
+  long count[4];
+  DeckWriter(const PGGrid &grid, FILE *fp) : g(grid), f(fp) { memset(count, 0, sizeof(count)); }
+  void element(int type, long idx, long n1, long n2, double value)
+  {
+    char s1[64], s2[64];
+    node_name(g, n1, s1);
+    node_name(g, n2, s2);
+    count[type]++;
+    switch (type){
+    case E_R: fprintf(f, "R%ld %s %s %.6g\n", idx, s1, s2, value); break;
+    case E_C: fprintf(f, "C%ld %s %s %.6g\n", idx, s1, s2, value); break;
+    case E_V: fprintf(f, "V%ld %s %s %.6g\n", idx, s1, s2, value); break;
+    case E_I:{
+      Wave w;
+      load_wave(g, idx, w);
+      if (g.p.wave == WAVE_PULSE){
+	/* stampB reads "DC PULSE(v1 v2 td tr tf pw per)" */
+	fprintf(f, "I%ld %s %s 0 PULSE(%.6g %.6g %.6g %.6g %.6g %.6g %.6g)\n", idx, s1, s2,
+		w.v1, w.v2, w.td, w.tr, w.tf, w.pw, w.per);
+      }else{
+	fprintf(f, "I%ld %s %s PWL(", idx, s1, s2);
+	for (size_t k = 0; k < w.t.size(); k++)
+	  fprintf(f, "%s%.6g %.6g", k ? " " : "", w.t[k], w.v[k]);
+	fprintf(f, ")\n");
+      }
+      break;
+    }
+    }
+  }
+};
+
+static void write_deck(const PGGrid &g, const char *name, long *count)
+{
+  const PGParam &p = g.p;
+  FILE *f = fopen(name, "w");
+  if (f == NULL){
+    printf("Can not open %s.\n", name);
+    exit(-1);
+  }
+  static const char *wave_name[] = { "dc", "pwl", "pulse" };
+  fprintf(f, "* synthetic power grid: %d layers, bottom mesh %d x %d, %ld nodes\n",
+	  p.layers, p.nx, p.ny, g.nnode);
+  fprintf(f, "* pitch %g um, width %g um, rsheet %g, via %g (%g ohm), %d pads (%g V, %g ohm)\n",
+	  p.pitch, p.width, p.rsheet, p.via, p.rvia, p.pads, p.vdd, p.rpad);
+  fprintf(f, "* decap %g (%g F), load %g (%g A, %s), seed %lu\n",
+	  p.decap, p.cdecap, p.load, p.iload, wave_name[p.wave], p.seed);
+  DeckWriter dw(g, f);
+  pg_elements(g, dw);
+  fprintf(f, ".tran %.6g %.6g\n", q6(p.tstep), q6(p.tstop));
+  /* probes along the diagonal of the bottom layer, after the elements
+     since .print only looks up existing nodes */
+  char s[64];
+  for (int k = 0; k < p.probes; k++){
+    int x = p.probes > 1 ? (int)((long)k*(g.nx[0]-1)/(p.probes-1)) : g.nx[0]/2;
+    int y = p.probes > 1 ? (int)((long)k*(g.ny[0]-1)/(p.probes-1)) : g.ny[0]/2;
+    node_name(g, node_id(g, 0, x, y), s);
+    fprintf(f, ".print tran v(%s)\n", s);
+  }
+  fprintf(f, ".end\n");
+  fclose(f);
+  memcpy(count, dw.count, sizeof(dw.count));
+}
+
+/* ---------------- the matrices ---------------- */
+
+/* row numbers as parser_sub gives them: first appearance, n1 before n2 */
+class RowNumbering : public PGVisitor {
+public:
+  vector<int> row;
+  int nrow;
+  RowNumbering(long nnode) : row(nnode, -1), nrow(0) {}
+  void element(int, long, long n1, long n2, double)
+  {
+    if (n1 >= 0 && row[n1] < 0) row[n1] = nrow++;
+    if (n2 >= 0 && row[n2] < 0) row[n2] = nrow++;
+  }
+};
+
+/* G = off-diagonal CSR + diagonal, C diagonal, B triplets; the
+   off-diagonals are counted on the first pass and filled on the second */
+class MNABuilder : public PGVisitor {
+public:
+  const vector<int> &row;
+  int nNodes, nVS, nrow, pass;
+  vector<long> ptr;
+  vector<int> col;
+  vector<double> val, gdiag, cdiag;
+  vector<long> brow;
+  vector<int> bcol;
+
+  MNABuilder(const vector<int> &r, int nn, int nv) : row(r), nNodes(nn), nVS(nv), nrow(nn+nv), pass(0)
+  {
+    ptr.assign(nrow+1, 0);
+    gdiag.assign(nrow, 0.0);
+    cdiag.assign(nrow, 0.0);
+  }
+  void off(int i, int j, double v)
+  {
+    if (pass == 0)
+      ptr[i+1]++;
+    else{
+      col[ptr[i]] = j;
+      val[ptr[i]++] = v;
+    }
+  }
+  void element(int type, long idx, long n1, long n2, double value)
+  {
+    int r1 = n1 >= 0 ? row[n1] : -1, r2 = n2 >= 0 ? row[n2] : -1;
+    switch (type){
+    case E_R:{
+      double gv = 1.0/value;
+      if (r1 >= 0 && r2 >= 0){
+	off(r1, r2, -gv);
+	off(r2, r1, -gv);
+      }
+      if (pass == 0){
+	if (r1 >= 0) gdiag[r1] += gv;
+	if (r2 >= 0) gdiag[r2] += gv;
+      }
+      break;
+    }
+    case E_C:
+      if (pass == 0)
+	cdiag[r1] += value;
+      break;
+    case E_V:{
+      int k = nNodes + idx;
+      off(r1, k, 1.0);
+      off(k, r1, -1.0);
+      if (pass == 0){
+	brow.push_back(k);
+	bcol.push_back(idx);
+      }
+      break;
+    }
+    case E_I:
+      if (pass == 0){
+	brow.push_back(r1);
+	bcol.push_back(nVS + idx);
+      }
+      break;
+    }
+  }
+  void fill_pass()
+  {
+    for (int i = 0; i < nrow; i++)
+      ptr[i+1] += ptr[i];
+    col.resize(ptr[nrow]);
+    val.resize(ptr[nrow]);
+    pass = 1;
+  }
+  void finish()
+  {
+    /* the fill pass moved ptr[i] to the end of row i */
+    for (int i = nrow; i > 0; i--)
+      ptr[i] = ptr[i-1];
+    ptr[0] = 0;
+  }
+};
+
+/* mkdir -p */
+static void make_dir(const char *dir)
+{
+  char path[1024];
+  snprintf(path, sizeof(path), "%s", dir);
+  for (char *c = path + 1; ; c++){
+    if (*c != '/' && *c != 0)
+      continue;
+    char end = *c;
+    *c = 0;
+    if (mkdir(path, 0755) != 0 && errno != EEXIST){
+      printf("Can not create directory %s.\n", path);
+      exit(-1);
+    }
+    if (end == 0)
+      break;
+    *c = '/';
+  }
+}
+
+static FILE *open_mtx(const char *dir, const char *name)
+{
+  char path[1024];
+  sprintf(path, "%s/%s", dir, name);
+  FILE *f = fopen(path, "w");
+  if (f == NULL){
+    printf("Can not open %s.\n", path);
+    exit(-1);
+  }
+  return f;
+}
+
+/* readSparseMatrix needs at least one entry in every row, the empty
+   rows of B and C get an explicit zero */
+static void write_mtx(const PGGrid &g, const char *dir, int ubin)
+{
+  const PGParam &p = g.p;
+  RowNumbering rn(g.nnode);
+  pg_elements(g, rn);
+  MNABuilder mb(rn.row, rn.nrow, p.pads);
+  pg_elements(g, mb);
+  mb.fill_pass();
+  pg_elements(g, mb);
+  mb.finish();
+  int nrow = mb.nrow;
+  int nIS = mb.brow.size() - p.pads;
+  double h = q6(p.tstep);
+
+  /* A = G + C/h, rows sorted by column */
+  long nnz = mb.ptr[nrow];
+  for (int i = 0; i < nrow; i++)
+    if (i < mb.nNodes)
+      nnz++;
+  FILE *f = open_mtx(dir, "A.mtx");
+  fprintf(f, "%d %d %ld\n", nrow, nrow, nnz);
+  vector<pair<int, double> > r;
+  for (int i = 0; i < nrow; i++){
+    r.clear();
+    if (i < mb.nNodes)
+      r.push_back(make_pair(i, mb.gdiag[i] + mb.cdiag[i]/h));
+    for (long j = mb.ptr[i]; j < mb.ptr[i+1]; j++)
+      r.push_back(make_pair(mb.col[j], mb.val[j]));
+    sort(r.begin(), r.end());
+    for (size_t k = 0; k < r.size(); k++)
+      fprintf(f, "%d %d %.9g\n", i+1, r[k].first+1, r[k].second);
+  }
+  fclose(f);
+
+  f = open_mtx(dir, "C.mtx");
+  fprintf(f, "%d %d %d\n", nrow, nrow, nrow);
+  for (int i = 0; i < nrow; i++)
+    fprintf(f, "%d %d %.9g\n", i+1, i+1, mb.cdiag[i]);
+  fclose(f);
+
+  vector<pair<long, int> > b;
+  for (size_t k = 0; k < mb.brow.size(); k++)
+    b.push_back(make_pair(mb.brow[k], mb.bcol[k]));
+  sort(b.begin(), b.end());
+  long nempty = 0;
+  for (size_t k = 0, i = 0; i < (size_t)nrow; i++){
+    if (k < b.size() && b[k].first == (long)i)
+      while (k < b.size() && b[k].first == (long)i) k++;
+    else
+      nempty++;
+  }
+  f = open_mtx(dir, "B.mtx");
+  fprintf(f, "%d %d %ld\n", nrow, p.pads + nIS, (long)b.size() + nempty);
+  for (size_t k = 0, i = 0; i < (size_t)nrow; i++){
+    if (k < b.size() && b[k].first == (long)i)
+      for (; k < b.size() && b[k].first == (long)i; k++)
+	fprintf(f, "%ld %d -1\n", i+1, b[k].second+1);
+    else
+      fprintf(f, "%ld 1 0\n", i+1);
+  }
+  fclose(f);
+
+  f = open_mtx(dir, "t_step.mtx");
+  fprintf(f, "%.9g\n", h);
+  fclose(f);
+
+  /* one column per time step (k+1)*h: the pad voltages, then the loads */
+  int nstep = (int)(p.tstop/h + 0.5);
+  int nu = p.pads + nIS;
+  vector<Wave> w(nIS);
+  for (int j = 0; j < nIS; j++)
+    load_wave(g, j, w[j]);
+  vector<float> u(nu);
+  f = open_mtx(dir, ubin ? "u_vec.bin" : "u_vec.mtx");
+  if (ubin){
+    int header[2] = { nstep, nu };
+    fwrite("UVEC", 1, 4, f);
+    fwrite(header, sizeof(int), 2, f);
+  }else
+    fprintf(f, "%d %d\n", nstep, nu);
+  for (int s = 0; s < nstep; s++){
+    double t = (s+1)*h;
+    for (int k = 0; k < p.pads; k++)
+      u[k] = q6(p.vdd);
+    for (int j = 0; j < nIS; j++)
+      u[p.pads+j] = wave_value(p, w[j], t);
+    if (ubin)
+      fwrite(&u[0], sizeof(float), nu, f);
+    else
+      for (int k = 0; k < nu; k++)
+	fprintf(f, "%.9g\n", u[k]);
+  }
+  fclose(f);
+  printf("matrices: %d rows, A nnz %ld, %d inputs, %d steps -> %s\n", nrow, nnz, nu, nstep, dir);
+}
+
+static void usage()
+{
+  printf("usage: pg_gen [options] deck.sp\n");
+  printf("       -nodes n         about n nodes in all layers (10000)\n");
+  printf("       -nx n -ny n      bottom mesh size instead of -nodes\n");
+  printf("       -layers n        number of mesh layers, the pitch doubles per layer (3)\n");
+  printf("       -pitch um        bottom layer pitch (10)\n");
+  printf("       -width um        bottom layer wire width (1)\n");
+  printf("       -rsheet ohm      bottom layer sheet resistance (0.1)\n");
+  printf("       -via d           fraction of upper nodes with a via down (0.5)\n");
+  printf("       -rvia ohm        via resistance (0.05)\n");
+  printf("       -pads n          VDD pads on the top layer (4)\n");
+  printf("       -vdd v           pad voltage (1.0)\n");
+  printf("       -rpad ohm        pad resistance (0.01)\n");
+  printf("       -decap d         fraction of bottom nodes with a decap (0.2)\n");
+  printf("       -cdecap f        decap value (1e-13)\n");
+  printf("       -load d          fraction of bottom nodes with a current load (0.1)\n");
+  printf("       -iload a         peak load current (1e-4)\n");
+  printf("       -wave dc|pwl|pulse  load activity (pwl)\n");
+  printf("       -events n        switching events per PWL load, at most %d (4)\n", MAX_EVENTS);
+  printf("       -period s        PULSE period (1e-9)\n");
+  printf("       -tstep s         time step (1e-11)\n");
+  printf("       -tstop s         stop time (5e-9)\n");
+  printf("       -probes n        .print nodes on the bottom layer (5)\n");
+  printf("       -seed n          random seed (1)\n");
+  printf("       -mtx dir         also write A, B, C, u_vec and t_step .mtx for src_thermal,\n");
+  printf("                        dir is created if needed\n");
+  printf("       -ubin            write u_vec.bin (binary) instead of u_vec.mtx\n");
+  exit(-1);
+}
+
+int main(int argc, char* argv[])
+{
+  PGGrid g;
+  PGParam &p = g.p;
+  p.nodes = 10000;
+  p.nx = p.ny = 0;
+  p.layers = 3;
+  p.pitch = 10;
+  p.width = 1;
+  p.rsheet = 0.1;
+  p.via = 0.5;
+  p.rvia = 0.05;
+  p.pads = 4;
+  p.vdd = 1.0;
+  p.rpad = 0.01;
+  p.decap = 0.2;
+  p.cdecap = 1e-13;
+  p.load = 0.1;
+  p.iload = 1e-4;
+  p.wave = WAVE_PWL;
+  p.events = 4;
+  p.period = 1e-9;
+  p.tstep = 1e-11;
+  p.tstop = 5e-9;
+  p.probes = 5;
+  p.seed = 1;
+  const char *deck = NULL, *mtxdir = NULL;
+  int ubin = 0;
+
+  for (int i = 1; i < argc; i++){
+    const char *a = argv[i];
+    const char *v = i+1 < argc ? argv[i+1] : NULL;
+    if (a[0] != '-'){
+      deck = a;
+      continue;
+    }
+    if (strcmp(a, "-ubin") == 0){
+      ubin = 1;
+      continue;
+    }
+    if (v == NULL)
+      usage();
+    i++;
+    if (strcmp(a, "-nodes") == 0) p.nodes = atol(v);
+    else if (strcmp(a, "-nx") == 0) p.nx = atoi(v);
+    else if (strcmp(a, "-ny") == 0) p.ny = atoi(v);
+    else if (strcmp(a, "-layers") == 0) p.layers = atoi(v);
+    else if (strcmp(a, "-pitch") == 0) p.pitch = atof(v);
+    else if (strcmp(a, "-width") == 0) p.width = atof(v);
+    else if (strcmp(a, "-rsheet") == 0) p.rsheet = atof(v);
+    else if (strcmp(a, "-via") == 0) p.via = atof(v);
+    else if (strcmp(a, "-rvia") == 0) p.rvia = atof(v);
+    else if (strcmp(a, "-pads") == 0) p.pads = atoi(v);
+    else if (strcmp(a, "-vdd") == 0) p.vdd = atof(v);
+    else if (strcmp(a, "-rpad") == 0) p.rpad = atof(v);
+    else if (strcmp(a, "-decap") == 0) p.decap = atof(v);
+    else if (strcmp(a, "-cdecap") == 0) p.cdecap = atof(v);
+    else if (strcmp(a, "-load") == 0) p.load = atof(v);
+    else if (strcmp(a, "-iload") == 0) p.iload = atof(v);
+    else if (strcmp(a, "-events") == 0) p.events = atoi(v);
+    else if (strcmp(a, "-period") == 0) p.period = atof(v);
+    else if (strcmp(a, "-tstep") == 0) p.tstep = atof(v);
+    else if (strcmp(a, "-tstop") == 0) p.tstop = atof(v);
+    else if (strcmp(a, "-probes") == 0) p.probes = atoi(v);
+    else if (strcmp(a, "-seed") == 0) p.seed = strtoul(v, NULL, 10);
+    else if (strcmp(a, "-mtx") == 0) mtxdir = v;
+    else if (strcmp(a, "-wave") == 0){
+      if (strcmp(v, "dc") == 0) p.wave = WAVE_DC;
+      else if (strcmp(v, "pwl") == 0) p.wave = WAVE_PWL;
+      else if (strcmp(v, "pulse") == 0) p.wave = WAVE_PULSE;
+      else usage();
+    }
+    else usage();
+  }
+  if (deck == NULL)
+    usage();
+  if ((p.nx != 0) != (p.ny != 0) || p.nx < 0 || p.ny < 0 ||
+      p.layers < 1 || p.pads < 1 || p.events < 1 || p.events > MAX_EVENTS ||
+      (p.nx != 0 && (p.nx < 2 || p.ny < 2)) ||
+      p.tstep <= 0 || p.tstop < p.tstep || p.period <= 0){
+    printf("Invalid options.\n");
+    usage();
+  }
+
+  grid_setup(g);
+  long count[4];
+  write_deck(g, deck, count);
+  printf("%s: %d layers, bottom mesh %d x %d, %ld nodes\n", deck, p.layers, p.nx, p.ny, g.nnode);
+  printf("  %ld R, %ld C, %ld V, %ld I\n", count[E_R], count[E_C], count[E_V], count[E_I]);
+  if (mtxdir != NULL){
+    make_dir(mtxdir);
+    write_mtx(g, mtxdir, ubin);
+  }
+  return 0;
+}
@@ -0,0 +1,503 @@
+/*
+*******************************************************
+
+    Cadence Extended Truncated Balanced Realization
+                (*** CadETBR ***)
+
+*******************************************************
+*/
+
+/*
+ *    $RCSfile: phase_timer.cpp,v $
+ *    $Revision: 1.1 $
+ *    $Date: 2013/03/23 21:08:01 $
+ *
+ *    Functions: Process-wide registry of nested phase timers and counters
+ *
+ *    Each thread keeps its stack of open phases, its trace events and its
+ *    per path totals in its own state, so phase_begin/phase_end take no
+ *    lock; the global lock is only taken when a thread registers. The
+ *    path of a phase is the names of the open phases of its thread,
+ *    "total/simulation/gmres". Wall time is gettimeofday, CPU time is
+ *    the process CPU time (as CPU_Timer) and the thread CPU time.
+ *    Each open phase also adds up the wall time of its closed children
+ *    by name, for the reports of the solvers.
+ *
+ *    When a thread exits its record is merged into an earlier exited
+ *    thread of the same name (unnamed ones all go under "threads") and
+ *    freed, so the threads of temporary pools do not pile up; with a
+ *    trace the records are kept for it.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <utility>
+#include <algorithm>
+#include "phase_timer.h"
+
+using namespace std;
+
+const char *phase_trace_file = NULL;
+
+/* trace events kept per thread; later phases still go to the summary */
+#define PHASE_MAX_EVENTS  (1<<20)
+
+typedef vector<pair<string, double> > COUNTS;
+
+struct PHASE_FRAME {
+  string name, path;
+  double t0, cpu0, tcpu0;
+  COUNTS counts;
+  COUNTS child_wall;		/* closed children, by name */
+};
+
+struct PHASE_EVENT {
+  int name;			/* index into the thread's names */
+  double t0, dur, cpu, tcpu;
+  COUNTS counts;
+};
+
+struct PHASE_STAT {
+  string name;
+  long calls;
+  double wall, cpu, tcpu;
+  map<string, double> counts;
+};
+
+struct PHASE_THREAD {
+  int tid;
+  string name;
+  int named;			/* by phase_thread_name */
+  int nthreads;			/* threads merged into this record */
+  int exited;
+  vector<PHASE_FRAME> stack;
+  COUNTS child_wall;		/* closed outermost phases, by name */
+  vector<string> names;
+  map<string, int> name_idx;
+  vector<PHASE_EVENT> events;
+  long dropped;
+  map<string, PHASE_STAT> stats;	/* by path */
+};
+
+static pthread_mutex_t phase_lock = PTHREAD_MUTEX_INITIALIZER;
+static vector<PHASE_THREAD *> phase_threads;
+static double phase_epoch = -1;
+static __thread PHASE_THREAD *phase_self = NULL;
+static pthread_key_t phase_key;
+static int phase_ntids = 0;
+
+static double phase_now()
+{
+  struct timeval t;
+  gettimeofday(&t, NULL);
+  return t.tv_sec + t.tv_usec*1e-6;
+}
+
+static double phase_clock(clockid_t id)
+{
+  struct timespec t;
+  clock_gettime(id, &t);
+  return t.tv_sec + t.tv_nsec*1e-9;
+}
+
+static void phase_exit();
+static void phase_thread_exit(void *arg);
+static void phase_close(PHASE_THREAD *T);
+
+static void count_add(COUNTS &c, const string &name, double v)
+{
+  for (size_t k = 0; k < c.size(); k++)
+    if (c[k].first == name){
+      c[k].second += v;
+      return;
+    }
+  c.push_back(make_pair(name, v));
+}
+
+static PHASE_THREAD *phase_thread()
+{
+  if (phase_self != NULL)
+    return phase_self;
+  PHASE_THREAD *T = new PHASE_THREAD;
+  T->dropped = 0;
+  T->named = 0;
+  T->nthreads = 1;
+  T->exited = 0;
+  pthread_mutex_lock(&phase_lock);
+  if (phase_epoch < 0){
+    phase_epoch = phase_now();
+    pthread_key_create(&phase_key, phase_thread_exit);
+    atexit(phase_exit);
+  }
+  T->tid = phase_ntids++;
+  phase_threads.push_back(T);
+  pthread_mutex_unlock(&phase_lock);
+  if (syscall(SYS_gettid) == getpid()){
+    T->name = "main";
+    T->named = 1;
+  }
+  else{
+    char s[32];
+    sprintf(s, "thread %d", T->tid);
+    T->name = s;
+  }
+  phase_self = T;
+  pthread_setspecific(phase_key, T);
+  return T;
+}
+
+static void stat_add(PHASE_STAT &d, const PHASE_STAT &s)
+{
+  d.calls += s.calls;
+  d.wall += s.wall;
+  d.cpu += s.cpu;
+  d.tcpu += s.tcpu;
+  for (map<string, double>::const_iterator c = s.counts.begin(); c != s.counts.end(); ++c)
+    d.counts[c->first] += c->second;
+}
+
+/* the phases a thread left open end with it */
+static void phase_thread_exit(void *arg)
+{
+  PHASE_THREAD *T = (PHASE_THREAD *)arg;
+  while (!T->stack.empty())
+    phase_close(T);
+  pthread_mutex_lock(&phase_lock);
+  T->exited = 1;
+  if (!T->named && phase_trace_file == NULL)
+    T->name = "threads";
+  PHASE_THREAD *D = NULL;
+  if (phase_trace_file == NULL)
+    for (size_t t = 0; t < phase_threads.size() && D == NULL; t++)
+      if (phase_threads[t] != T && phase_threads[t]->exited && phase_threads[t]->name == T->name)
+	D = phase_threads[t];
+  if (D != NULL){
+    for (map<string, PHASE_STAT>::iterator it = T->stats.begin(); it != T->stats.end(); ++it){
+      map<string, PHASE_STAT>::iterator d = D->stats.find(it->first);
+      if (d == D->stats.end())
+	D->stats.insert(*it);
+      else
+	stat_add(d->second, it->second);
+    }
+    D->nthreads += T->nthreads;
+    phase_threads.erase(find(phase_threads.begin(), phase_threads.end(), T));
+    delete T;
+  }
+  pthread_mutex_unlock(&phase_lock);
+  phase_self = NULL;
+}
+
+void phase_begin(const char *name)
+{
+  PHASE_THREAD *T = phase_thread();
+  PHASE_FRAME f;
+  f.name = name;
+  f.path = T->stack.empty() ? f.name : T->stack.back().path + "/" + f.name;
+  f.cpu0 = phase_clock(CLOCK_PROCESS_CPUTIME_ID);
+  f.tcpu0 = phase_clock(CLOCK_THREAD_CPUTIME_ID);
+  f.t0 = phase_now();
+  T->stack.push_back(f);
+}
+
+static PHASE_STAT &phase_stat(PHASE_THREAD *T, const string &path, const string &name)
+{
+  map<string, PHASE_STAT>::iterator it = T->stats.find(path);
+  if (it == T->stats.end()){
+    PHASE_STAT s;
+    s.name = name;
+    s.calls = 0;
+    s.wall = s.cpu = s.tcpu = 0;
+    it = T->stats.insert(make_pair(path, s)).first;
+  }
+  return it->second;
+}
+
+/* children of the innermost of the first nopen frames, or of the thread */
+static COUNTS &phase_parent(PHASE_THREAD *T, size_t nopen)
+{
+  return nopen > 0 ? T->stack[nopen-1].child_wall : T->child_wall;
+}
+
+static void phase_close(PHASE_THREAD *T)
+{
+  double t1 = phase_now();
+  PHASE_FRAME &f = T->stack.back();
+  double cpu = phase_clock(CLOCK_PROCESS_CPUTIME_ID) - f.cpu0;
+  double tcpu = phase_clock(CLOCK_THREAD_CPUTIME_ID) - f.tcpu0;
+
+  PHASE_STAT &s = phase_stat(T, f.path, f.name);
+  s.calls++;
+  s.wall += t1 - f.t0;
+  s.cpu += cpu;
+  s.tcpu += tcpu;
+  for (size_t k = 0; k < f.counts.size(); k++)
+    s.counts[f.counts[k].first] += f.counts[k].second;
+  count_add(phase_parent(T, T->stack.size()-1), f.name, t1 - f.t0);
+
+  if (phase_trace_file != NULL){
+    if ((int)T->events.size() < PHASE_MAX_EVENTS){
+      map<string, int>::iterator n = T->name_idx.find(f.name);
+      if (n == T->name_idx.end()){
+	n = T->name_idx.insert(make_pair(f.name, (int)T->names.size())).first;
+	T->names.push_back(f.name);
+      }
+      PHASE_EVENT e;
+      e.name = n->second;
+      e.t0 = f.t0 - phase_epoch;
+      e.dur = t1 - f.t0;
+      e.cpu = cpu;
+      e.tcpu = tcpu;
+      e.counts.swap(f.counts);
+      T->events.push_back(e);
+    }else
+      T->dropped++;
+  }
+  T->stack.pop_back();
+}
+
+void phase_end()
+{
+  PHASE_THREAD *T = phase_thread();
+  if (T->stack.empty()){
+    printf("phase_end() without phase_begin()\n");
+    exit(-1);
+  }
+  phase_close(T);
+}
+
+void phase_record(const char *name, long calls, double wall)
+{
+  PHASE_THREAD *T = phase_thread();
+  string path = T->stack.empty() ? string(name) : T->stack.back().path + "/" + name;
+  PHASE_STAT &s = phase_stat(T, path, name);
+  s.calls += calls;
+  s.wall += wall;
+  count_add(phase_parent(T, T->stack.size()), name, wall);
+}
+
+void phase_count(const char *name, double v)
+{
+  PHASE_THREAD *T = phase_thread();
+  if (T->stack.empty())
+    return;
+  count_add(T->stack.back().counts, name, v);
+}
+
+void phase_thread_name(const char *name)
+{
+  PHASE_THREAD *T = phase_thread();
+  T->name = name;
+  T->named = 1;
+}
+
+/* the process CPU time of a phase already holds the threads it runs
+   next to; across the threads of a path only the thread CPU adds up */
+static void phase_sum(const char *path, const char *counter, double &wall, double &cpu, double &count)
+{
+  double pcpu = 0, tcpu = 0;
+  int nthreads = 0;
+  wall = count = 0;
+  pthread_mutex_lock(&phase_lock);
+  for (size_t t = 0; t < phase_threads.size(); t++){
+    map<string, PHASE_STAT> &stats = phase_threads[t]->stats;
+    map<string, PHASE_STAT>::iterator it = stats.find(path);
+    if (it == stats.end())
+      continue;
+    nthreads += phase_threads[t]->nthreads;
+    wall += it->second.wall;
+    pcpu += it->second.cpu;
+    tcpu += it->second.tcpu;
+    if (counter != NULL && it->second.counts.count(counter))
+      count += it->second.counts[counter];
+  }
+  pthread_mutex_unlock(&phase_lock);
+  cpu = nthreads > 1 ? tcpu : pcpu;
+}
+
+double phase_wall(const char *path)
+{
+  double wall, cpu, count;
+  phase_sum(path, NULL, wall, cpu, count);
+  return wall;
+}
+
+double phase_cpu(const char *path)
+{
+  double wall, cpu, count;
+  phase_sum(path, NULL, wall, cpu, count);
+  return cpu;
+}
+
+double phase_counter(const char *path, const char *counter)
+{
+  double wall, cpu, count;
+  phase_sum(path, counter, wall, cpu, count);
+  return count;
+}
+
+double phase_child_wall(const char *name)
+{
+  PHASE_THREAD *T = phase_thread();
+  COUNTS &c = T->stack.empty() ? T->child_wall : T->stack.back().child_wall;
+  for (size_t k = 0; k < c.size(); k++)
+    if (c[k].first == name)
+      return c[k].second;
+  return 0;
+}
+
+/* the threads of the same name (the workers of one pool) are added up */
+void phase_report()
+{
+  pthread_mutex_lock(&phase_lock);
+  vector<string> tnames;
+  map<string, map<string, PHASE_STAT> > merged;
+  map<string, int> nthreads;
+  for (size_t t = 0; t < phase_threads.size(); t++){
+    PHASE_THREAD *T = phase_threads[t];
+    if (T->stats.empty())
+      continue;
+    if (merged.find(T->name) == merged.end())
+      tnames.push_back(T->name);
+    nthreads[T->name] += T->nthreads;
+    map<string, PHASE_STAT> &m = merged[T->name];
+    for (map<string, PHASE_STAT>::iterator it = T->stats.begin(); it != T->stats.end(); ++it){
+      map<string, PHASE_STAT>::iterator d = m.find(it->first);
+      if (d == m.end())
+	m.insert(*it);
+      else
+	stat_add(d->second, it->second);
+    }
+  }
+  pthread_mutex_unlock(&phase_lock);
+
+  printf("****** Phases (seconds) ******\n");
+  printf("%-40s %8s %10s %10s\n", "phase", "calls", "wall", "CPU");
+  for (size_t t = 0; t < tnames.size(); t++){
+    if (tnames.size() > 1){
+      if (nthreads[tnames[t]] > 1)
+	printf("[%s] x %d threads\n", tnames[t].c_str(), nthreads[tnames[t]]);
+      else
+	printf("[%s]\n", tnames[t].c_str());
+    }
+    /* sorted with '/' below every other character, each path comes
+       right after its parent */
+    map<string, PHASE_STAT> &m = merged[tnames[t]];
+    vector<pair<string, const PHASE_STAT *> > order;
+    for (map<string, PHASE_STAT>::iterator it = m.begin(); it != m.end(); ++it){
+      string key = it->first;
+      for (size_t k = 0; k < key.size(); k++)
+	if (key[k] == '/')
+	  key[k] = '\001';
+      order.push_back(make_pair(key, &it->second));
+    }
+    sort(order.begin(), order.end());
+    for (size_t q = 0; q < order.size(); q++){
+      const PHASE_STAT &s = *order[q].second;
+      int depth = 0;
+      for (size_t k = 0; k < order[q].first.size(); k++)
+	if (order[q].first[k] == '\001')
+	  depth++;
+      string label = string(2*depth, ' ') + s.name;
+      printf("%-40s %8ld %10.2f %10.2f", label.c_str(), s.calls, s.wall, s.cpu);
+      for (map<string, double>::const_iterator c = s.counts.begin(); c != s.counts.end(); ++c)
+	printf("  %s=%.6g", c->first.c_str(), c->second);
+      printf("\n");
+    }
+  }
+}
+
+static void json_string(FILE *f, const string &s)
+{
+  fputc('"', f);
+  for (size_t k = 0; k < s.size(); k++){
+    if (s[k] == '"' || s[k] == '\\')
+      fputc('\\', f);
+    fputc(s[k], f);
+  }
+  fputc('"', f);
+}
+
+static void json_counts(FILE *f, const COUNTS &c)
+{
+  for (size_t k = 0; k < c.size(); k++){
+    fprintf(f, ", ");
+    json_string(f, c[k].first);
+    fprintf(f, ": %.10g", c[k].second);
+  }
+}
+
+void phase_write(const char *file)
+{
+  FILE *f = fopen(file, "w");
+  if (f == NULL){
+    printf("Can not open %s.\n", file);
+    return;
+  }
+  pthread_mutex_lock(&phase_lock);
+  fprintf(f, "{\"displayTimeUnit\": \"ms\",\n\"traceEvents\": [\n");
+  fprintf(f, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": {\"name\": \"etbr\"}}");
+  long dropped = 0;
+  for (size_t t = 0; t < phase_threads.size(); t++){
+    PHASE_THREAD *T = phase_threads[t];
+    dropped += T->dropped;
+    fprintf(f, ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"args\": {\"name\": ", T->tid);
+    json_string(f, T->name);
+    fprintf(f, "}}");
+    for (size_t k = 0; k < T->events.size(); k++){
+      const PHASE_EVENT &e = T->events[k];
+      fprintf(f, ",\n{\"name\": ");
+      json_string(f, T->names[e.name]);
+      fprintf(f, ", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %.1f, \"dur\": %.1f, "
+	      "\"args\": {\"cpu_s\": %.6f, \"thread_cpu_s\": %.6f",
+	      T->tid, e.t0*1e6, e.dur*1e6, e.cpu, e.tcpu);
+      json_counts(f, e.counts);
+      fprintf(f, "}}");
+    }
+  }
+  fprintf(f, "\n],\n\"droppedEvents\": %ld,\n\"phases\": [\n", dropped);
+  bool first = true;
+  for (size_t t = 0; t < phase_threads.size(); t++){
+    PHASE_THREAD *T = phase_threads[t];
+    for (map<string, PHASE_STAT>::iterator it = T->stats.begin(); it != T->stats.end(); ++it){
+      const PHASE_STAT &s = it->second;
+      fprintf(f, "%s{\"thread\": ", first ? "" : ",\n");
+      json_string(f, T->name);
+      fprintf(f, ", \"path\": ");
+      json_string(f, it->first);
+      fprintf(f, ", \"calls\": %ld, \"wall_s\": %.6f, \"cpu_s\": %.6f, \"thread_cpu_s\": %.6f, \"counters\": {",
+	      s.calls, s.wall, s.cpu, s.tcpu);
+      for (map<string, double>::const_iterator c = s.counts.begin(); c != s.counts.end(); ++c){
+	if (c != s.counts.begin())
+	  fprintf(f, ", ");
+	json_string(f, c->first);
+	fprintf(f, ": %.10g", c->second);
+      }
+      fprintf(f, "}}");
+      first = false;
+    }
+  }
+  fprintf(f, "\n]}\n");
+  pthread_mutex_unlock(&phase_lock);
+  fclose(f);
+  printf("phase trace written to %s\n", file);
+}
+
+/* an exit(-1) in the middle of a run still leaves a trace: the phases
+   the exiting thread has open are closed at the time of exit */
+static void phase_exit()
+{
+  if (phase_self != NULL)
+    while (!phase_self->stack.empty())
+      phase_close(phase_self);
+  if (phase_trace_file != NULL)
+    phase_write(phase_trace_file);
+}
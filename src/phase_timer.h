@@ -0,0 +1,71 @@
+/*
+*******************************************************
+
+    Cadence Extended Truncated Balanced Realization
+                (*** CadETBR ***)
+
+*******************************************************
+*/
+
+/*
+ *    $RCSfile: phase_timer.h,v $
+ *    $Revision: 1.1 $
+ *    $Date: 2013/03/23 21:08:01 $
+ *
+ *    Functions: Process-wide registry of nested phase timers and counters header
+ *
+ */
+
+#ifndef PHASE_TIMER_H
+#define PHASE_TIMER_H
+
+/* -trace file: the phases of all threads are written to file at exit as
+   a Chrome trace (chrome://tracing, ui.perfetto.dev), together with a
+   summary of the calls, times and counters of every phase path */
+extern const char *phase_trace_file;
+
+/* open a phase inside the innermost open phase of the calling thread;
+   every phase_begin needs its phase_end on the same thread */
+void phase_begin(const char *name);
+void phase_end();
+
+/* calls phases called name that took wall seconds in all, timed by the
+   caller: a step loop times its parts with plain timers and records
+   them once after the loop. No CPU time and no trace events */
+void phase_record(const char *name, long calls, double wall);
+
+/* add v to the counter of the innermost open phase of this thread
+   (iterations, nnz, bytes read, factor fill, ...) */
+void phase_count(const char *name, double v);
+
+/* name this thread in the trace and the report; the report adds up the
+   threads of the same name, e.g. the "solve_axb" workers */
+void phase_thread_name(const char *name);
+
+/* wall and CPU seconds of the closed phases of a full path such as
+   "total/simulation", summed over the threads that ran it (the CPU is
+   the thread CPU then); use after the worker threads are joined */
+double phase_wall(const char *path);
+double phase_cpu(const char *path);
+/* sum of a counter over the closed phases of path */
+double phase_counter(const char *path, const char *counter);
+
+/* wall seconds of the phases called name closed so far directly inside
+   the innermost open phase of this thread, i.e. in this call of it; with
+   no phase open, of the outermost phases this thread has closed */
+double phase_child_wall(const char *name);
+
+/* the phase tree with calls, times and counters on stdout */
+void phase_report();
+
+/* write the trace now (also done at exit when phase_trace_file is set) */
+void phase_write(const char *file);
+
+/* a phase for the lifetime of a scope */
+class PhaseScope {
+ public:
+  PhaseScope(const char *name) { phase_begin(name); }
+  ~PhaseScope() { phase_end(); }
+};
+
+#endif
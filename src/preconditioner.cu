@@ -4,6 +4,7 @@
 //#include <cutil.h>
 #include <helper_cuda.h>
 #include "preconditioner.h"
+#include "SpMV_tune.h"
 
 #include "gpuData.h"
 
@@ -778,6 +779,7 @@ void MyILUPP::Initilize(const MySpMatrix &mySpM){
 	A_des = new cusparseMatDescr_t();
 
 	this->numRows = mySpM.numRows;
+	l_ccsr = u_ccsr = NULL;
         // XXLiu added the following section adapted from ITSOL_2.
         csptr csmat = NULL;  /* matrix in csr formt             */
         csmat = (csptr)Malloc( sizeof(SparMat), "MyILUPP::Initilize" );
@@ -863,9 +865,29 @@ void MyILUPP::Initilize(const MySpMatrix &mySpM){
 	printf("void MyILUPP::Initilize() finished.\n");
 }
 
+/* SPMV_OPT_CCSR: host copies of the ILU++ factors with compressed
+   indices, the values stay double unless SPMV_OPT_BF16 asks for bfloat16 */
+static void ccsr_factors(int n, const int *l_rowIndices, const int *l_indices, const double *l_val,
+                         const int *u_rowIndices, const int *u_indices, const double *u_val,
+                         CCSR *&l_ccsr, CCSR *&u_ccsr, int spmv_opt)
+{
+  l_ccsr = u_ccsr = NULL;
+  if(!(spmv_opt & SPMV_OPT_CCSR))  return;
+  int vtype = spmv_opt & SPMV_OPT_BF16 ? CCSR_BF16 : CCSR_DOUBLE;
+  l_ccsr = ccsr_build(n, l_rowIndices, l_indices, l_val, vtype);
+  u_ccsr = ccsr_build(n, u_rowIndices, u_indices, u_val, vtype);
+  double nnz = (double)l_rowIndices[n] + u_rowIndices[n];
+  printf("ILU factors with %d/%d bit offsets%s: %.1f MB -> %.1f MB\n",
+         ccsr_delta_bits(l_ccsr), ccsr_delta_bits(u_ccsr), vtype == CCSR_BF16 ? ", bfloat16 values" : "",
+         ((n+1)*8.0 + nnz*12.0)/1048576.0,
+         (ccsr_bytes(l_ccsr) + ccsr_bytes(u_ccsr))/1048576.0);
+}
+
 MyILUPP::~MyILUPP()
 {
   delete [] tmpvector;
+  if(l_ccsr)  ccsr_free(l_ccsr);
+  if(u_ccsr)  ccsr_free(u_ccsr);
 }
 
 void MyILUPP::Initilize(const MySpMatrixDouble &PrLeft_mySpM,
@@ -874,7 +896,8 @@ void MyILUPP::Initilize(const MySpMatrixDouble &PrLeft_mySpM,
                         const MySpMatrix &PrPermRow,
                         const MySpMatrix &PrPermCol,
                         const MySpMatrixDouble &PrLscale,
-                        const MySpMatrixDouble &PrRscale)
+                        const MySpMatrixDouble &PrRscale,
+                        int spmv_opt)
 {
 
   status = new cusparseStatus_t();
@@ -892,6 +915,8 @@ void MyILUPP::Initilize(const MySpMatrixDouble &PrLeft_mySpM,
   u_val_double = PrRight_mySpM.val;
   u_rowIndices = PrRight_mySpM.rowIndices;
   u_indices = PrRight_mySpM.indices;
+  ccsr_factors(numRows, l_rowIndices, l_indices, l_val_double,
+               u_rowIndices, u_indices, u_val_double, l_ccsr, u_ccsr, spmv_opt);
   
   p_val = PrPermRow.val;
   p_rowIndices = PrPermRow.rowIndices;
@@ -1102,12 +1127,16 @@ void MyILUPP::HostPrecond_left(const ValueType *i_data, ValueType *o_data){
   for(i=0; i<numRows; ++i)  x[i] = v[ permRow_indices[i] ];
 
   // solve Lv = y, forward substitution
-  for(i=0; i<numRows; ++i){
-    lb = l_rowIndices[i];
-    ub = l_rowIndices[i+1];// ub is the up bound to U, not the L matrix
-    for(j=lb; j<ub-1; j++)
-      x[i] -= l_val_double[j] * x[l_indices[j]];
-    x[i] /= l_val_double[ub-1];
+  if(l_ccsr)
+    ccsr_lsolve(l_ccsr, x);
+  else {
+    for(i=0; i<numRows; ++i){
+      lb = l_rowIndices[i];
+      ub = l_rowIndices[i+1];// ub is the up bound to U, not the L matrix
+      for(j=lb; j<ub-1; j++)
+        x[i] -= l_val_double[j] * x[l_indices[j]];
+      x[i] /= l_val_double[ub-1];
+    }
   }
 
   //delete [] v;
@@ -1122,12 +1151,16 @@ void MyILUPP::HostPrecond_right(const ValueType *i_data, ValueType *o_data){
   int i, j, lb, ub;
   for(i=0; i<numRows; ++i)  v[i] = i_data[i]*middle_val[i];
 
-  for(i=numRows-1; i>=0; i--){
-    lb = u_rowIndices[i];
-    ub = u_rowIndices[i+1];
-    for(j=lb+1; j<ub; j++)
-      v[i] -= u_val_double[j] * v[ u_indices[j] ];
-    v[i] /= u_val_double[lb];
+  if(u_ccsr)
+    ccsr_usolve(u_ccsr, v);
+  else {
+    for(i=numRows-1; i>=0; i--){
+      lb = u_rowIndices[i];
+      ub = u_rowIndices[i+1];
+      for(j=lb+1; j<ub; j++)
+        v[i] -= u_val_double[j] * v[ u_indices[j] ];
+      v[i] /= u_val_double[lb];
+    }
   }
   for(i=0; i<numRows; ++i)  x[i] = v[ permCol_indices[i] ] / rscale_val[i];
   
@@ -1179,6 +1212,8 @@ MyILUPPfloat::~MyILUPPfloat()
   checkCudaErrors(cudaFree(d_rscale_val));
 
   delete [] tmpvector;
+  if(l_ccsr)  ccsr_free(l_ccsr);
+  if(u_ccsr)  ccsr_free(u_ccsr);
   checkCudaErrors(cudaFree(d_tmpvector_single));
   checkCudaErrors(cudaFree(d_tmpvector_double));
   checkCudaErrors(cudaFree(d_tmp_solution_double));
@@ -1209,7 +1244,8 @@ void MyILUPPfloat::Initilize(const MySpMatrixDouble &PrLeft_mySpM,
                              const MySpMatrix &PrPermCol,
                              const MySpMatrix &PrLscale,
                              const MySpMatrix &PrRscale,
-                             int m) // m is GMRES restart number
+                             int m, // m is GMRES restart number
+                             int spmv_opt)
 {
   status = new cusparseStatus_t();
   handle = new cusparseHandle_t();
@@ -1231,6 +1267,8 @@ void MyILUPPfloat::Initilize(const MySpMatrixDouble &PrLeft_mySpM,
   
   l_nnz = l_rowIndices[numRows];
   u_nnz = u_rowIndices[numRows];
+  ccsr_factors(numRows, l_rowIndices, l_indices, l_val,
+               u_rowIndices, u_indices, u_val, l_ccsr, u_ccsr, spmv_opt);
 
   checkCudaErrors(cudaMalloc((void**)&d_l_val_double, sizeof(double)*l_nnz));
   checkCudaErrors(cudaMalloc((void**)&d_l_rowIndices, sizeof(int)*(numRows+1)));
@@ -1382,12 +1420,16 @@ void MyILUPPfloat::HostPrecond_left(const ValueType *i_data, ValueType *o_data){
   for(i=0; i<numRows; ++i)  x[i] = v[ permRow_indices[i] ];
 
   // solve Lv = y, forward substitution
-  for(i=0; i<numRows; ++i){
-    lb = l_rowIndices[i];
-    ub = l_rowIndices[i+1];// ub is the up bound to U, not the L matrix
-    for(j=lb; j<ub-1; j++)
-      x[i] -= l_val[j] * x[l_indices[j]];
-    x[i] /= l_val[ub-1];
+  if(l_ccsr)
+    ccsr_lsolve(l_ccsr, x);
+  else {
+    for(i=0; i<numRows; ++i){
+      lb = l_rowIndices[i];
+      ub = l_rowIndices[i+1];// ub is the up bound to U, not the L matrix
+      for(j=lb; j<ub-1; j++)
+        x[i] -= l_val[j] * x[l_indices[j]];
+      x[i] /= l_val[ub-1];
+    }
   }
 
   //delete [] v;
@@ -1402,12 +1444,16 @@ void MyILUPPfloat::HostPrecond_right(const ValueType *i_data, ValueType *o_data)
   int i, j, lb, ub;
   for(i=0; i<numRows; ++i)  v[i] = i_data[i]*middle_val[i];
 
-  for(i=numRows-1; i>=0; i--){
-    lb = u_rowIndices[i];
-    ub = u_rowIndices[i+1];
-    for(j=lb+1; j<ub; j++)
-      v[i] -= u_val[j] * v[ u_indices[j] ];
-    v[i] /= u_val[lb];
+  if(u_ccsr)
+    ccsr_usolve(u_ccsr, v);
+  else {
+    for(i=numRows-1; i>=0; i--){
+      lb = u_rowIndices[i];
+      ub = u_rowIndices[i+1];
+      for(j=lb+1; j<ub; j++)
+        v[i] -= u_val[j] * v[ u_indices[j] ];
+      v[i] /= u_val[lb];
+    }
   }
   for(i=0; i<numRows; ++i)  x[i] = v[ permCol_indices[i] ] / rscale_val[i];
   
@@ -24,6 +24,7 @@
 
 #include "leftILU.h"
 #include "gpuData.h"
+#include "SpMV_ccsr.h"
 
 using namespace std;
 
@@ -212,6 +213,8 @@ class MyILUPP : public Preconditioner{
   cusparseMatDescr_t *L_des, *U_des, *A_des;
   
   float *tmpvector;
+  //! host factors with compressed indices (-ccsr), NULL otherwise
+  CCSR *l_ccsr, *u_ccsr;
 	public:
                 float *Lval_ITSOL;
                 int *LrowIndices_ITSOL, *Lindices_ITSOL;
@@ -228,7 +231,8 @@ class MyILUPP : public Preconditioner{
 		void Initilize(const MySpMatrixDouble &PrLeft, const MySpMatrixDouble &PrRight,
                                const MySpMatrix &PrMiddle_mySpM,
                                const MySpMatrix &PrPermRow, const MySpMatrix &PrPermCol,
-                               const MySpMatrixDouble &PrLscale, const MySpMatrixDouble &PrRscale);
+                               const MySpMatrixDouble &PrLscale, const MySpMatrixDouble &PrRscale,
+                               int spmv_opt = 0);
 
                 void HostPrecond_rhs(const ValueType *i_data, ValueType *o_data);
                 void HostPrecond_right(const ValueType *i_data, ValueType *o_data);
@@ -240,6 +244,7 @@ class MyILUPP : public Preconditioner{
                 void DevPrecond_left(float *i_data, float *o_data);
                 void DevPrecond_starting_value(float *i_data, float *o_data);
         
+                MyILUPP() : l_ccsr(NULL), u_ccsr(NULL) {}
                 ~MyILUPP();
 };
 
@@ -284,6 +289,8 @@ class MyILUPPfloat : public Preconditioner{
   float *d_tmpvector_single;
 
   int l_nnz, u_nnz;
+  //! host factors with compressed indices (-ccsr), NULL otherwise
+  CCSR *l_ccsr, *u_ccsr;
 
  public:
   // float *Lval_ITSOL;
@@ -302,7 +309,7 @@ class MyILUPPfloat : public Preconditioner{
                  const MySpMatrix &PrMiddle_mySpM,
                  const MySpMatrix &PrPermRow, const MySpMatrix &PrPermCol,
                  const MySpMatrix &PrLscale, const MySpMatrix &PrRscale,
-                 int restart);
+                 int restart, int spmv_opt = 0);
   
   void HostPrecond_rhs(const ValueType *i_data, ValueType *o_data);
   void HostPrecond_right(const ValueType *i_data, ValueType *o_data);
@@ -314,6 +321,7 @@ class MyILUPPfloat : public Preconditioner{
   void DevPrecond_left(float *i_data, float *o_data);
   void DevPrecond_starting_value(float *i_data, float *o_data);
   
+  MyILUPPfloat() : l_ccsr(NULL), u_ccsr(NULL) {}
   ~MyILUPPfloat();
 };
 
@@ -0,0 +1,494 @@
+/*
+*******************************************************
+
+    Cadence Extended Truncated Balanced Realization
+                (*** CadETBR ***)
+
+*******************************************************
+*/
+
+/*
+ *    $RCSfile: rom.cpp,v $
+ *    $Revision: 1.1 $
+ *    $Date: 2013/03/23 21:08:01 $
+ *
+ *    Functions: Reduced order model persistence
+ *
+ *    The ROM produced by etbr2 (Gr, Cr, Br, the map of the sources to
+ *    the projected dc solution and the port/tap rows of X)
+ *    is dumped with "-rom_save" and reloaded with "-rom_load", which
+ *    simulates new source waveforms without running the reduction again.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <string.h>
+#include <math.h>
+#include <itpp/base/timing.h>
+#include <itpp/base/mat.h>
+#include <itpp/base/vec.h>
+#include <itpp/base/algebra/lu.h>
+#include <itpp/base/math/elem_math.h>
+#include <itpp/base/math/min_max.h>
+#include <itpp/base/matfunc.h>
+#include <itpp/base/sort.h>
+#include "etbr.h"
+#include "interp.h"
+#include "direct_solver.h"
+
+using namespace itpp;
+using namespace std;
+
+#define ROM_MAGIC "ETBRROM"
+#define ROM_VERSION 3
+
+static void rom_mat_save(ofstream &file, const mat &A)
+{
+  int m = A.rows(), n = A.cols();
+  file.write((char *)&m, sizeof(int));
+  file.write((char *)&n, sizeof(int));
+  file.write((char *)A._data(), sizeof(double)*m*n);
+}
+
+static void rom_mat_load(ifstream &file, mat &A)
+{
+  int m = 0, n = 0;
+  file.read((char *)&m, sizeof(int));
+  file.read((char *)&n, sizeof(int));
+  A.set_size(m, n);
+  file.read((char *)A._data(), sizeof(double)*m*n);
+}
+
+static void rom_names_save(ofstream &file, vector<string> &names)
+{
+  int num = names.size();
+  file.write((char *)&num, sizeof(int));
+  for (int i = 0; i < num; i++){
+	int len = names[i].size();
+	file.write((char *)&len, sizeof(int));
+	file.write(names[i].c_str(), len);
+  }
+}
+
+static void rom_names_load(ifstream &file, vector<string> &names)
+{
+  int num = 0;
+  file.read((char *)&num, sizeof(int));
+  names.resize(num);
+  for (int i = 0; i < num; i++){
+	int len = 0;
+	file.read((char *)&len, sizeof(int));
+	names[i].resize(len);
+	if (len > 0)
+	  file.read(&names[i][0], len);
+  }
+}
+
+/* reduced_transim2 starts from X'*x(0) with G*x(0) = B*u(0); the
+   model keeps Dr = X'*inv(G)*B, from q solves with G', so it starts
+   the same way from the sources it is loaded with */
+static void rom_dc_map(ROMDATA &rom, mat &X, cs_dl *G, cs_dl *B, SOLVER_CTX *ctx)
+{
+  UF_long n = G->n;
+  int q = X.cols();
+  cs_dl *GT = cs_dl_transpose(G, 1);
+  DSOLVER ds;
+  ds_factor(ds, GT, ctx->direct_solver, ctx->pool);
+  cs_dl_spfree(GT);
+  vec x(n), y(n);
+  rom.Dr.set_size(q, B->n);
+  rom.Dr.zeros();
+  for (int k = 0; k < q; k++){
+	x = X.get_col(k);
+	ds_solve(ds, x._data(), y._data());
+	for (UF_long j = 0; j < B->n; j++){
+	  double d = 0;
+	  for (UF_long p = B->p[j]; p < B->p[j+1]; p++)
+		d += y(B->i[p])*B->x[p];
+	  rom.Dr(k, j) = d;
+	}
+  }
+  ds_free(ds);
+}
+
+void rom_save(char *rom_name, ROMDATA &rom, mat &X,
+			  const ivec &port, vector<int> &tc_node,
+			  cs_dl *G, cs_dl *B, SOLVER_CTX *ctx)
+{
+  ofstream file;
+  file.open(rom_name, ios::binary);
+  if (!file){
+	cout << "couldn't open " << rom_name << endl;
+	exit(-1);
+  }
+
+  /* only the rows of X at the ports and tap nodes are kept */
+  int nport = port.size();
+  int nNodes = tc_node.size();
+  ivec tc_vec(nNodes);
+  for (int i = 0; i < nNodes; i++){
+	tc_vec(i) = tc_node[i];
+  }
+  get_rows(X, port, rom.Xp);
+  get_rows(X, tc_vec, rom.Xc);
+  rom_dc_map(rom, X, G, B, ctx);
+
+  int version = ROM_VERSION;
+  file.write(ROM_MAGIC, strlen(ROM_MAGIC));
+  file.write((char *)&version, sizeof(int));
+  file.write((char *)&rom.q, sizeof(int));
+  file.write((char *)&rom.nDim, sizeof(UF_long));
+  file.write((char *)&rom.nVS, sizeof(int));
+  file.write((char *)&rom.nIS, sizeof(int));
+  file.write((char *)&rom.tstep, sizeof(double));
+  file.write((char *)&rom.tstop, sizeof(double));
+  file.write((char *)&rom.max_i, sizeof(double));
+  file.write((char *)&rom.max_i_idx, sizeof(int));
+  file.write((char *)&rom.fft_n, sizeof(int));
+  file.write((char *)&rom.f_min, sizeof(double));
+  file.write((char *)&rom.f_max, sizeof(double));
+  rom_mat_save(file, rom.Gr);
+  rom_mat_save(file, rom.Cr);
+  rom_mat_save(file, rom.Br);
+  rom_mat_save(file, rom.Dr);
+  rom_mat_save(file, rom.Xp);
+  rom_mat_save(file, rom.Xc);
+  rom_names_save(file, rom.port_name);
+  rom_names_save(file, rom.tc_name);
+  int ncl = rom.is_map.size();
+  file.write((char *)&ncl, sizeof(int));
+  if (ncl > 0){
+	file.write((char *)&rom.is_map[0], sizeof(int)*ncl);
+	file.write((char *)&rom.is_coef[0], sizeof(double)*ncl);
+  }
+  file.close();
+
+  cout << "** " << rom_name << " dumped (q = " << rom.q << ", "
+	   << nport << " ports, " << nNodes << " tap nodes)" << endl;
+}
+
+void rom_load(char *rom_name, ROMDATA &rom)
+{
+  ifstream file;
+  file.open(rom_name, ios::binary);
+  if (!file){
+	cout << "couldn't open " << rom_name << endl;
+	exit(-1);
+  }
+
+  char magic[sizeof(ROM_MAGIC)];
+  int version = 0;
+  file.read(magic, strlen(ROM_MAGIC));
+  magic[strlen(ROM_MAGIC)] = '\0';
+  file.read((char *)&version, sizeof(int));
+  if (strcmp(magic, ROM_MAGIC) != 0 || version != ROM_VERSION){
+	cout << rom_name << " is not a reduced order model file (version "
+		 << ROM_VERSION << ")" << endl;
+	exit(-1);
+  }
+  file.read((char *)&rom.q, sizeof(int));
+  file.read((char *)&rom.nDim, sizeof(UF_long));
+  file.read((char *)&rom.nVS, sizeof(int));
+  file.read((char *)&rom.nIS, sizeof(int));
+  file.read((char *)&rom.tstep, sizeof(double));
+  file.read((char *)&rom.tstop, sizeof(double));
+  file.read((char *)&rom.max_i, sizeof(double));
+  file.read((char *)&rom.max_i_idx, sizeof(int));
+  file.read((char *)&rom.fft_n, sizeof(int));
+  file.read((char *)&rom.f_min, sizeof(double));
+  file.read((char *)&rom.f_max, sizeof(double));
+  rom_mat_load(file, rom.Gr);
+  rom_mat_load(file, rom.Cr);
+  rom_mat_load(file, rom.Br);
+  rom_mat_load(file, rom.Dr);
+  rom_mat_load(file, rom.Xp);
+  rom_mat_load(file, rom.Xc);
+  rom_names_load(file, rom.port_name);
+  rom_names_load(file, rom.tc_name);
+  int ncl = 0;
+  file.read((char *)&ncl, sizeof(int));
+  rom.is_map.resize(ncl);
+  rom.is_coef.resize(ncl);
+  if (ncl > 0){
+	file.read((char *)&rom.is_map[0], sizeof(int)*ncl);
+	file.read((char *)&rom.is_coef[0], sizeof(double)*ncl);
+  }
+  if (!file){
+	cout << rom_name << " is truncated" << endl;
+	exit(-1);
+  }
+  file.close();
+
+  cout << "** " << rom_name << " loaded (q = " << rom.q << ", full order "
+	   << rom.nDim << ", reduced with tstep = " << rom.tstep << ")" << endl;
+}
+
+void rom_is_cluster(ROMDATA &rom, Source *&IS, int &nIS)
+{
+  int ncl = rom.is_map.size();
+  if (ncl == 0)
+	return;
+  if (nIS != ncl){
+	cout << "Error: the circuit has " << nIS << " current sources, the model was built with "
+		 << ncl << endl;
+	exit(-1);
+  }
+  /* the first member of a group drives it; the others have to keep
+	 their saved weight against it, else the columns of Br are wrong */
+  vector<int> rep(rom.nIS, -1);
+  for (int k = 0; k < ncl; k++){
+	int c = rom.is_map[k];
+	if (rep[c] < 0){
+	  rep[c] = k;
+	  continue;
+	}
+	vec &t = IS[k].time, &v = IS[k].value;
+	vec &tr = IS[rep[c]].time, &vr = IS[rep[c]].value;
+	bool same = t.size() == tr.size() && v.size() == vr.size();
+	for (int j = 0; same && j < t.size(); j++)
+	  same = t(j) == tr(j);
+	for (int j = 0; same && j < v.size(); j++)
+	  same = fabs(v(j) - rom.is_coef[k]*vr(j)) <= 1e-9*(fabs(v(j)) + fabs(rom.is_coef[k]*vr(j)));
+	if (!same){
+	  cout << "Error: current source " << k << " does not have the waveform shape it was"
+		   << " clustered with in the model; save the model without -iscluster" << endl;
+	  exit(-1);
+	}
+  }
+  Source *IS_cl = new Source[rom.nIS];
+  for (int c = 0; c < rom.nIS; c++)
+	IS_cl[c] = IS[rep[c]];
+  delete [] IS;
+  IS = IS_cl;
+  nIS = rom.nIS;
+  cout << "current source clustering of the model: " << ncl << " -> " << nIS << " waveforms" << endl;
+}
+
+/* Transient simulation of a loaded ROM, stepped as in reduced_transim2
+   with the integration method of ctx: the reduced state starts at
+   Dr*u(0) and the outputs are recovered with the port/tap rows of X. */
+void rom_transim(ROMDATA &rom, Source *VS, int nVS, Source *IS, int nIS,
+				 double tstep, double tstop, mat &sim_port_value,
+				 const ivec &port, vector<string> &port_name,
+				 vector<string> &tc_name,
+				 int num, int ir_info, char *ir_name, SOLVER_CTX *ctx)
+{
+  Real_Timer interp2_run_time, solve_red_lu_time, sim_run_time, ir_run_time;
+
+  sim_run_time.start();
+
+  if (nVS != rom.nVS || nIS != rom.nIS){
+	cout << "Error: the circuit has " << nVS << " voltage and " << nIS
+		 << " current sources, the model was built with " << rom.nVS
+		 << " and " << rom.nIS << endl;
+	exit(-1);
+  }
+  if (port.size() != rom.Xp.rows()){
+	cout << "Error: the circuit has " << port.size() << " ports, the model was built with "
+		 << rom.Xp.rows() << endl;
+	exit(-1);
+  }
+  for (int i = 0; i < port.size(); i++){
+	if (port_name[i] != rom.port_name[i]){
+	  cout << "Error: port " << port_name[i] << " does not match "
+		   << rom.port_name[i] << " in the model" << endl;
+	  exit(-1);
+	}
+  }
+  if (tc_name.size() != rom.tc_name.size()){
+	cout << "Error: the circuit has " << tc_name.size() << " tap nodes, the model was built with "
+		 << rom.tc_name.size() << endl;
+	exit(-1);
+  }
+  for (size_t i = 0; i < tc_name.size(); i++){
+	if (tc_name[i] != rom.tc_name[i]){
+	  cout << "Error: tap node " << tc_name[i] << " does not match "
+		   << rom.tc_name[i] << " in the model" << endl;
+	  exit(-1);
+	}
+  }
+  if (tstep != rom.tstep){
+	cout << "Warning: tstep " << tstep << " differs from " << rom.tstep
+		 << " used for the reduction" << endl;
+  }
+
+  int q = rom.q;
+  int nport = port.size();
+  int nNodes = rom.Xc.rows();
+  int display_num = num<nNodes?num:nNodes;
+  vec u_col(nVS+nIS);
+  u_col.zeros();
+  vec w_r(q), w_r1(q);
+  w_r.zeros();
+  w_r1.zeros();
+  vec max_value(nNodes), min_value(nNodes), ir_value(nNodes);
+
+  vec ts;
+  form_vec(ts, 0, tstep, tstop);
+  sim_port_value.set_size(nport, ts.size());
+  double temp;
+
+  int* cur = new int[nVS+nIS];
+  for(int i = 0; i < nVS+nIS; i++){
+	cur[i] = 0;
+  }
+  vec* slope = new vec[nVS+nIS];
+  for(int i = 0; i < nVS; i++){
+	int len = VS[i].time.size();
+	slope[i].set_size(len-1);
+	for(int j = 0; j < len-1; j++){
+	  double delta = (VS[i].value(j+1) - VS[i].value(j)) / (VS[i].time(j+1) - VS[i].time(j));
+	  slope[i].set(j, delta);
+	}
+  }
+  for(int i = 0; i < nIS; i++){
+	int len = IS[i].time.size();
+	slope[nVS+i].set_size(len-1);
+	for(int j = 0; j < len-1; j++){
+	  double delta = (IS[i].value(j+1) - IS[i].value(j)) / (IS[i].time(j+1) - IS[i].time(j));
+	  slope[nVS+i].set(j, delta);
+	}
+  }
+
+  vector<int> var_v, var_i;
+  for(int j = 0; j < nVS; j++){
+	if (VS[j].time.size() == 1)
+	  u_col(j) = VS[j].value(0);
+	else
+	  var_v.push_back(j);
+  }
+  for(int j = 0; j < nIS; j++){
+	if (IS[j].time.size() == 1)
+	  u_col(nVS+j) = IS[j].value(0);
+	else
+	  var_i.push_back(j);
+  }
+
+  /* DC simulation on the reduced model */
+  for(vector<int>::iterator it = var_v.begin(); it != var_v.end(); ++it){
+	interp1(VS[*it].time, VS[*it].value, ts(0), temp, cur[*it], slope[*it]);
+	u_col(*it) = temp;
+  }
+  for(vector<int>::iterator it = var_i.begin(); it != var_i.end(); ++it){
+	interp1(IS[*it].time, IS[*it].value, ts(0), temp, cur[nVS+(*it)], slope[nVS+*it]);
+	u_col(nVS+(*it)) = temp;
+  }
+  vec xn_r(q);
+  multiply(rom.Dr, u_col._data(), xn_r._data());
+  vec xn1_r(q), xn1t_r(q);
+  xn1_r.zeros();
+  xn1t_r.zeros();
+  if (nport > 0)
+	sim_port_value.set_col(0, rom.Xp * xn_r);
+  if (ir_info){
+	vec xn1c = rom.Xc * xn_r;
+	max_value = xn1c;
+	min_value = xn1c;
+  }
+
+  /* Transient simulation */
+  mat right_r = integ_coef(ctx->integ_method, tstep)*rom.Cr;
+  mat left_r = rom.Gr + right_r;
+  mat l_left_r, u_left_r;
+  ivec p_r;
+  lu(left_r, l_left_r, u_left_r, p_r);
+
+  vec xp_r = xn_r;
+  vec bu_r(q), bu0_r(q);
+  multiply(rom.Br, u_col._data(), bu0_r._data());
+
+  for (int i = 1; i < ts.size(); i++){
+	interp2_run_time.start();
+	for(vector<int>::iterator it = var_v.begin(); it != var_v.end(); ++it){
+	  interp1(VS[*it].time, VS[*it].value, ts(i), temp, cur[*it], slope[*it]);
+	  u_col(*it) = temp;
+	}
+	interp_next_step2(ts[i], IS, var_i, cur, slope, nVS, u_col);
+	interp2_run_time.stop();
+
+	solve_red_lu_time.start();
+	multiply(rom.Br, u_col._data(), w_r._data());
+	bu_r = w_r;
+	if (ctx->integ_method == INTEG_TR)
+	  w_r1 = right_r * xn_r - rom.Gr * xn_r + bu0_r;
+	else if (ctx->integ_method == INTEG_BDF2)
+	  w_r1 = right_r * ((4*xn_r - xp_r)/3);
+	else
+	  w_r1 = right_r * xn_r;
+	w_r = w_r + w_r1;
+	bu0_r = bu_r;
+	interchange_permutations(w_r, p_r);
+	forward_substitution(l_left_r, w_r, xn1t_r);
+	backward_substitution(u_left_r, xn1t_r, xn1_r);
+	solve_red_lu_time.stop();
+
+	if (nport > 0)
+	  sim_port_value.set_col(i, rom.Xp * xn1_r);
+	xp_r = xn_r;
+	xn_r = xn1_r;
+	if (ir_info){
+	  ir_run_time.start();
+	  vec xn1c = rom.Xc * xn1_r;
+	  for (int j = 0; j < nNodes; j++){
+		if (max_value(j) < xn1c(j))
+		  max_value(j) = xn1c(j);
+		if (xn1c(j) < min_value(j))
+		  min_value(j) = xn1c(j);
+	  }
+	  ir_run_time.stop();
+	}
+  }
+  delete [] cur;
+  delete [] slope;
+
+  if (ir_info && nNodes > 0){
+	ir_run_time.start();
+	vec sgn_value = sgn(max_value) - sgn(min_value);
+	for (int i = 0; i < sgn_value.size(); i++){
+	  if(sgn_value(i) == 0){
+		ir_value(i) = max_value(i) - min_value(i);
+	  }
+	  else{
+		ir_value(i) = abs(max_value(i)) > abs(min_value(i))? abs(max_value(i)):abs(min_value(i));
+	  }
+	}
+	int max_ir_idx = max_index(ir_value);
+	ivec sorted_ir_value_idx = sort_index(ir_value);
+	std::cout.precision(6);
+	cout << "****** IR Drop Info ******  " << endl;
+	cout << "Max IR:     " << rom.tc_name[max_ir_idx] << " : " << ir_value(max_ir_idx) << endl;
+	cout << "Avg IR:     " << sum(ir_value)/ir_value.size() << endl;
+	cout << "******" << endl;
+	cout << "Max " << display_num << " IR: " << endl;
+	for (int i = 0; i < display_num; i++){
+	  cout << rom.tc_name[sorted_ir_value_idx(nNodes-1-i)] << " : "
+		   << ir_value(sorted_ir_value_idx(nNodes-1-i)) << endl;
+	}
+	cout << "******" << endl;
+
+	ofstream out_ir;
+	out_ir.open(ir_name);
+	if (!out_ir){
+	  cout << "couldn't open " << ir_name << endl;
+	  exit(-1);
+	}
+	for (int i = 0; i < nNodes; i++){
+	  out_ir << rom.tc_name[sorted_ir_value_idx(nNodes-1-i)] << " : "
+			 << ir_value(sorted_ir_value_idx(nNodes-1-i)) << endl;
+	}
+	out_ir.close();
+	cout << "** " << ir_name << " dumped" << endl;
+	ir_run_time.stop();
+  }
+
+  sim_run_time.stop();
+
+#ifndef UCR_EXTERNAL
+  std::cout.setf(std::ios::fixed,std::ios::floatfield);
+  std::cout.precision(2);
+  std::cout << "interpolation2   \t: " << interp2_run_time.get_time() << std::endl;
+  std::cout << "solve reduced LU \t: " << solve_red_lu_time.get_time() << std::endl;
+  std::cout << "total simulation \t: " << sim_run_time.get_time() << std::endl;
+  std::cout << "IR analysis      \t: " << ir_run_time.get_time() << std::endl;
+#endif
+}
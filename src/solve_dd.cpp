@@ -25,9 +25,11 @@
 #include <itpp/base/vec.h>
 #include <itpp/base/algebra/lapack.h>
 #include <itpp/base/algebra/ls_solve.h>
+#include <vector>
 #include "cs.h"
 #include "umfpack.h"
 #include "etbr_dd.h"
+#include "phase_timer.h"
 
 void dd_solve(int npart, cs_dl **As, cs_dl **E, cs_dl **F, cs_dl *At, 
 			  double **f, double *g, double *z,
@@ -628,21 +630,324 @@ void dd_solve3(int npart, cs_dl **As, cs_dl **E, cs_dl **F, cs_dl *At,
   // std::cout << "cs_solve   \t: " << cs_solve_runtime.get_time() << std::endl;
 }
 
+/* nonzero pattern of G\b by depth first search from the rows of b,
+   returned in xi[top..n-1] in topological order; mark[] == stamp
+   flags the visited columns so each thread keeps its own marks and
+   G->p is not touched (cs_dl_reach flips it) */
+static UF_long sp_reach(const cs_dl *G, UF_long nb, const UF_long *bi,
+						UF_long *xi, UF_long *stack, UF_long *pstack,
+						UF_long *mark, UF_long stamp)
+{
+  UF_long n = G->n, top = n;
+  UF_long *Gp = G->p, *Gi = G->i;
+  for (UF_long k = 0; k < nb; k++){
+	if (mark[bi[k]] == stamp)
+	  continue;
+	UF_long head = 0;
+	stack[0] = bi[k];
+	while (head >= 0){
+	  UF_long j = stack[head];
+	  if (mark[j] != stamp){
+		mark[j] = stamp;
+		pstack[head] = Gp[j];
+	  }
+	  int done = 1;
+	  for (UF_long p = pstack[head]; p < Gp[j+1]; p++){
+		UF_long i = Gi[p];
+		if (mark[i] == stamp)
+		  continue;
+		pstack[head] = p+1;
+		stack[++head] = i;
+		done = 0;
+		break;
+	  }
+	  if (done){
+		head--;
+		xi[--top] = j;
+	  }
+	}
+  }
+  return top;
+}
+
+/* x = G\x for the columns in xi[top..n-1]; x is zero off that pattern.
+   lo: the diagonal is the first entry of a column of L, else the last of U */
+static void sp_trisolve(const cs_dl *G, int lo, UF_long top, const UF_long *xi, double *x)
+{
+  UF_long n = G->n;
+  UF_long *Gp = G->p, *Gi = G->i;
+  double *Gx = G->x;
+  for (UF_long px = top; px < n; px++){
+	UF_long j = xi[px];
+	if (x[j] == 0)
+	  continue;
+	UF_long p, q;
+	if (lo){
+	  x[j] /= Gx[Gp[j]];
+	  p = Gp[j]+1;
+	  q = Gp[j+1];
+	}else{
+	  x[j] /= Gx[Gp[j+1]-1];
+	  p = Gp[j];
+	  q = Gp[j+1]-1;
+	}
+	for (; p < q; p++)
+	  x[Gi[p]] -= Gx[p]*x[j];
+  }
+}
+
+typedef struct{
+  int npart;
+  cs_dl **As, **E, **F, *At;
+  double **f;
+  int order;
+  double tol;
+  cs_dls **Symbolic;
+  cs_dln **Numeric;
+  vec *Ab;
+  int *in_core;
+  string *part_file_name;
+  cs_dl *S;
+  vec *gg;
+  double spilled_mb;
+  DDIOJOB *io_job;
+  const DDSCRATCH *scratch;
+  int part_threads;             /* subdomains factored at a time */
+  int col_threads;              /* column blocks of the FAE of each */
+}SCHURDATA;
+
+/* one subdomain of the wave being factored */
+typedef struct{
+  SCHURDATA *sd;
+  int k;
+  cs_dln *N;
+  double *ab;                   /* A\f */
+  vec FAb;
+  Real_Timer symbolic_runtime, numeric_runtime, solve_runtime;
+}SCHURPART;
+
+typedef struct{
+  cs_dls *Symbolic;
+  cs_dln *Numeric;
+  cs_dl *E, *F;
+  UF_long m;              /* rows of FAE */
+  UF_long j0, j1;         /* interface columns of this thread */
+  vector<UF_long> ti, tj; /* entries of FAE(:,j0:j1-1) */
+  vector<double> tx;
+}SCHURCOLS;
+
+/* FAE(:,j) = F*(A\E(:,j)) with sparse right hand sides: only the reach
+   of the nonzeros of E(:,j) in L and U is visited */
+static void *schur_cols(void *arg)
+{
+  SCHURCOLS *c = (SCHURCOLS *)arg;
+  cs_dl *L = c->Numeric->L, *U = c->Numeric->U;
+  UF_long *pinv = c->Numeric->pinv, *q = c->Symbolic->q;
+  cs_dl *E = c->E, *F = c->F;
+  UF_long n = L->n;
+  vector<double> x(n, 0), fae(c->m, 0);
+  vector<UF_long> xi(n), bi(n), stack(n), pstack(n), mark(n, -1);
+  vector<UF_long> rows, row_mark(c->m, -1);
+  UF_long stamp = 0;
+  for (UF_long j = c->j0; j < c->j1; j++){
+	UF_long nb = 0;
+	for (UF_long p = E->p[j]; p < E->p[j+1]; p++){
+	  x[pinv[E->i[p]]] = E->x[p];
+	  bi[nb++] = pinv[E->i[p]];
+	}
+	if (nb == 0)
+	  continue;
+	UF_long top = sp_reach(L, nb, &bi[0], &xi[0], &stack[0], &pstack[0], &mark[0], stamp++);
+	sp_trisolve(L, 1, top, &xi[0], &x[0]);
+	nb = n - top;
+	for (UF_long k = 0; k < nb; k++)
+	  bi[k] = xi[top+k];
+	top = sp_reach(U, nb, &bi[0], &xi[0], &stack[0], &pstack[0], &mark[0], stamp++);
+	sp_trisolve(U, 0, top, &xi[0], &x[0]);
+	// (A\E)(q[i]) = x[i], scatter F(:,q[i])*x[i]
+	rows.clear();
+	for (UF_long px = top; px < n; px++){
+	  UF_long i = xi[px];
+	  if (x[i] != 0){
+		UF_long col = q != NULL ? q[i] : i;
+		for (UF_long p = F->p[col]; p < F->p[col+1]; p++){
+		  UF_long r = F->i[p];
+		  if (row_mark[r] != j){
+			row_mark[r] = j;
+			rows.push_back(r);
+		  }
+		  fae[r] += F->x[p]*x[i];
+		}
+	  }
+	  x[i] = 0;
+	}
+	for (size_t k = 0; k < rows.size(); k++){
+	  if (fae[rows[k]] != 0){
+		c->ti.push_back(rows[k]);
+		c->tj.push_back(j);
+		c->tx.push_back(fae[rows[k]]);
+	  }
+	  fae[rows[k]] = 0;
+	}
+  }
+  return NULL;
+}
+
+/* task: factor subdomain k and compute its FAb */
+static void *schur_factor(void *arg)
+{
+  SCHURPART *pt = (SCHURPART *)arg;
+  SCHURDATA *sd = pt->sd;
+  int k = pt->k;
+  cs_dl *A = sd->As[k];
+  phase_thread_name("dd_worker");
+  phase_begin("dd_part");
+  phase_count("nnz", (double)A->p[A->n]);
+
+  pt->symbolic_runtime.start();
+  sd->Symbolic[k] = cs_dl_sqr(sd->order, A, 0);
+  pt->symbolic_runtime.stop();
+  pt->numeric_runtime.start();
+  cs_dln *N = cs_dl_lu(A, sd->Symbolic[k], sd->tol);
+  pt->numeric_runtime.stop();
+  phase_count("factor_nnz", (double)(N->L->p[A->n] + N->U->p[A->n]));
+  pt->N = N;
+
+  // compute FAb
+  pt->solve_runtime.start();
+  double *ab = new double[A->m];
+  double *abp = new double[A->m];
+  for (int j = 0; j < A->m; j++){
+	ab[j] = sd->f[k][j];
+	abp[j] = 0;
+  }
+  cs_dl_ipvec(N->pinv, ab, abp, A->n);
+  cs_dl_lsolve(N->L, abp);
+  cs_dl_usolve(N->U, abp);
+  cs_dl_ipvec(sd->Symbolic[k]->q, abp, ab, A->n);
+  pt->FAb.set_size(sd->At->m);
+  pt->FAb.zeros();
+  (void) cs_dl_gaxpy(sd->F[k], ab, pt->FAb._data());
+  pt->ab = ab;
+  delete [] abp;
+  pt->solve_runtime.stop();
+  phase_end();
+  return NULL;
+}
+
+/* the subdomains are factored on the pool part_threads at a time, then
+   the interface columns of each are split in col_threads blocks; the
+   FAE and FAb of a wave are merged into S and gg in subdomain order on
+   the calling thread, so S does not depend on which task ends first */
+static void schur_waves(SCHURDATA *sd, THREAD_POOL *pool,
+						Real_Timer &symbolic_runtime, Real_Timer &numeric_runtime,
+						Real_Timer &solve_runtime)
+{
+  cs_dl *At = sd->At;
+  int nc = sd->col_threads;
+  if (nc > At->n)
+	nc = At->n > 0 ? At->n : 1;
+  UF_long chunk = (At->n + nc - 1)/nc;
+  SCHURPART *parts = new SCHURPART[sd->part_threads];
+  SCHURCOLS *cols = new SCHURCOLS[sd->part_threads*nc];
+  void **args = new void*[sd->part_threads*nc];
+  for (int k0 = 0; k0 < sd->npart; k0 += sd->part_threads){
+	int np = sd->npart - k0 < sd->part_threads ? sd->npart - k0 : sd->part_threads;
+	for (int i = 0; i < np; i++){
+	  parts[i].sd = sd;
+	  parts[i].k = k0 + i;
+	  args[i] = &parts[i];
+	}
+	pool_wait(pool_submit(pool, schur_factor, args, np));
+
+	// compute FAE in blocks of interface columns
+	solve_runtime.start();
+	for (int i = 0; i < np; i++)
+	  for (int t = 0; t < nc; t++){
+		SCHURCOLS &c = cols[i*nc + t];
+		c.Symbolic = sd->Symbolic[k0+i];
+		c.Numeric = parts[i].N;
+		c.E = sd->E[k0+i];
+		c.F = sd->F[k0+i];
+		c.m = At->m;
+		c.j0 = t*chunk < At->n ? t*chunk : At->n;
+		c.j1 = (t+1)*chunk < At->n ? (t+1)*chunk : At->n;
+		c.ti.clear();
+		c.tj.clear();
+		c.tx.clear();
+		args[i*nc + t] = &c;
+	  }
+	pool_wait(pool_submit(pool, schur_cols, args, np*nc));
+	solve_runtime.stop();
+
+	for (int i = 0; i < np; i++){
+	  int k = k0 + i;
+	  cs_dl *A = sd->As[k];
+	  cs_dln *N = parts[i].N;
+	  UF_long nz = 0;
+	  for (int t = 0; t < nc; t++)
+		nz += cols[i*nc + t].tx.size();
+	  cs_dl *TFAE = cs_dl_spalloc(At->m, At->n, nz > 0 ? nz : 1, 1, 1);
+	  for (int t = 0; t < nc; t++){
+		SCHURCOLS &c = cols[i*nc + t];
+		for (size_t p = 0; p < c.tx.size(); p++)
+		  cs_dl_entry(TFAE, c.ti[p], c.tj[p], c.tx[p]);
+	  }
+	  cs_dl *FAE = cs_dl_compress(TFAE);
+	  cs_dl_spfree(TFAE);
+
+	  // S = S - FAE, rhs Sy = g - FAb
+	  cs_dl *S1 = sd->S;
+	  sd->S = cs_dl_add(S1, FAE, 1, -1);
+	  cs_dl_spfree(S1);
+	  cs_dl_spfree(FAE);
+	  *sd->gg -= parts[i].FAb;
+	  sd->Ab[k] = vec(parts[i].ab, A->m);
+	  delete [] parts[i].ab;
+	  // Out of core
+	  double factor_mb = numeric_dl_bytes(N)/1048576.0;
+	  int in_core = sd->scratch->budget_mb > 0 && sd->spilled_mb + factor_mb > sd->scratch->budget_mb;
+	  sd->in_core[k] = in_core;
+	  if (in_core){
+		sd->Numeric[k] = N;
+	  }else{
+		/* written while the next wave is computed */
+		sd->Numeric[k] = NULL;
+		sd->spilled_mb += factor_mb;
+		dd_io_wait(*sd->io_job);
+		dd_io_start_save(*sd->io_job, sd->part_file_name[k], N, sd->scratch->compress);
+	  }
+	  symbolic_runtime.reset(symbolic_runtime.get_time() + parts[i].symbolic_runtime.get_time());
+	  numeric_runtime.reset(numeric_runtime.get_time() + parts[i].numeric_runtime.get_time());
+	  solve_runtime.reset(solve_runtime.get_time() + parts[i].solve_runtime.get_time());
+	  parts[i].symbolic_runtime.reset();
+	  parts[i].numeric_runtime.reset();
+	  parts[i].solve_runtime.reset();
+	}
+  }
+  delete [] parts;
+  delete [] cols;
+  delete [] args;
+}
+
 void dd_solve_ooc(int npart, cs_dl **As, cs_dl **E, cs_dl **F, cs_dl *At, 
 				  double **f, double *g, double *z,
-				  Real_Timer &cs_symbolic_runtime, Real_Timer &cs_numeric_runtime, Real_Timer &cs_solve_runtime)
+				  Real_Timer &cs_symbolic_runtime, Real_Timer &cs_numeric_runtime, Real_Timer &cs_solve_runtime,
+				  const DDSCRATCH &scratch, THREAD_POOL *pool)
 {
   Real_Timer schur_runtime, schur_solve_runtime,  ae_runtime, fae_runtime, runtime;
-  cs_dl *TFAE, *FAE, *S;
+  cs_dl *S;
   string *part_file_name = new string [npart];
   for (int k = 0; k < npart; k++){
-	part_file_name[k] = "temp/part";
 	stringstream ss;
-	ss << k;
-	part_file_name[k].append(ss.str());
+	ss << "part" << k;
+	part_file_name[k] = dd_scratch_path(scratch, ss.str().c_str());
   }
-  ifstream *in_part_file = new ifstream [npart];
-  ofstream *out_part_file = new ofstream [npart];
+  /* factors are written by an I/O thread while the next one is
+	 computed; past the scratch budget they stay in memory */
+  DDIOJOB io_job;
+  io_job.active = 0;
+  int *in_core = new int[npart];
 
   vec *Ab = new vec[npart];
   // initial S = At
@@ -660,135 +965,40 @@ void dd_solve_ooc(int npart, cs_dl **As, cs_dl **E, cs_dl **F, cs_dl *At,
   cs_dln **Numeric = new cs_dln* [npart];
   int order = 2;
   double tol = 1e-14;
-  schur_runtime.start();
-  for (int k = 0; k < npart; k++){
-	//runtime.tic();
-	cs_symbolic_runtime.start();
-	Symbolic[k] = cs_dl_sqr(order, As[k], 0);
-	cs_symbolic_runtime.stop();
 
-	cs_numeric_runtime.start();
-	Numeric[k] = cs_dl_lu(As[k], Symbolic[k], tol);
-	cs_numeric_runtime.stop();
+  /* the subdomains and the column blocks of their FAE run on the pool
+	 of the analysis, or on one of pool_default_size threads */
+  THREAD_POOL *tpool = pool != NULL ? pool : pool_create(pool_default_size());
+  int nthreads = pool_size(tpool);
+  SCHURDATA sd;
+  sd.npart = npart;
+  sd.As = As;
+  sd.E = E;
+  sd.F = F;
+  sd.At = At;
+  sd.f = f;
+  sd.order = order;
+  sd.tol = tol;
+  sd.Symbolic = Symbolic;
+  sd.Numeric = Numeric;
+  sd.Ab = Ab;
+  sd.in_core = in_core;
+  sd.part_file_name = part_file_name;
+  sd.S = S;
+  sd.gg = &gg;
+  sd.spilled_mb = 0;
+  sd.io_job = &io_job;
+  sd.scratch = &scratch;
+  sd.part_threads = nthreads < npart ? nthreads : npart;
+  sd.col_threads = nthreads/sd.part_threads;
 
-	// compute FAE and S;
-	TFAE = cs_dl_spalloc(At->m, At->n, 1, 1, 1);
-	// UF_long *xi = new UF_long[2*E[k]->m];
-	// UF_long top;
-	
-	int counter = 0;
-	//runtime.toc_print();
-	double *e = (double*) calloc(E[k]->m, sizeof(double));
-	double *ae = (double*) calloc(E[k]->m, sizeof(double));
-	double *fae = (double*) calloc(At->m, sizeof(double));
-	schur_solve_runtime.start();
-	for (UF_long j = 0; j < At->n; j++){	 
-	  ae_runtime.start(); 
-	  bool nonzero = false;
-	  for (UF_long p = E[k]->p[j]; p < E[k]->p[j+1]; p++){
-		// ae[E[k]->i[p]] = E[k]->x[p];
-		e[Numeric[k]->pinv[E[k]->i[p]]] = E[k]->x[p];
-		nonzero = true;
-	  }
-	  ae_runtime.stop();
-	  if (nonzero){
-		cs_solve_runtime.start();
-		// cs_dl_ipvec(Numeric[k]->pinv, ae, e, As[k]->n);
-		my_cs_dl_lsolve(Numeric[k]->L, e);
-		my_cs_dl_usolve(Numeric[k]->U, e);
-		cs_dl_ipvec(Symbolic[k]->q, e, ae, As[k]->n);
-		cs_solve_runtime.stop();
-		// column j for FAE
-		fae_runtime.start();		
-		(void) cs_dl_gaxpy(F[k], ae, fae);
-		for (int i = 0; i < At->m; i++){
-		  if (fae[i] != 0){
-			cs_dl_entry(TFAE, i, j, fae[i]);
-		  }
-		}
-		memset((void*) fae, 0, sizeof(double)*At->m);
-		fae_runtime.stop();		
-		ae_runtime.start(); 
-		memset((void*) e, 0, sizeof(double)*E[k]->m);
-		ae_runtime.stop();
-	  }	  
-	}
-	free(fae);
-	free(e);
-	free(ae);
-	schur_solve_runtime.stop();
-	//runtime.toc_print();
-	FAE = cs_dl_compress(TFAE);
-	cs_dl_spfree(TFAE);
-	// std::cout << "nnz of E[" << k << "] = " << E[k]->p[E[k]->n] << std::endl;
-	// std::cout << "counter = " << counter << std::endl;
-	// S = S - FAE;
-	//runtime.toc_print();
-	cs_dl *S1 = S;
-	S = cs_dl_add(S1, FAE, 1, -1);
-	cs_dl_spfree(S1);
-	/*
-	S = cs_dl_spalloc(S1->m, S1->n, S1->nzmax, 1, 0);
-	for (UF_long i = 0; i < S1->n+1; i++){
-	  S->p[i] = S1->p[i];
-	}
-	for (UF_long i = 0; i < S1->nzmax; i++){
-	  S->i[i] = S1->i[i];
-	  S->x[i] = S1->x[i];
-	}
-	*/
-	cs_dl_spfree(FAE);
-	//cs_dl_spfree(S1);
-	// runtime.toc_print();
-	// compute FAb;
-	double *ab = new double[As[k]->m];
-	double *abp = new double[As[k]->m];
-	for (int j = 0; j < As[k]->m; j++){
-	  ab[j] = f[k][j];
-	  abp[j] = 0;
-	}
-	cs_solve_runtime.start();
-	cs_dl_ipvec(Numeric[k]->pinv, ab, abp, As[k]->n);
-	cs_dl_lsolve(Numeric[k]->L, abp);
-	cs_dl_usolve(Numeric[k]->U, abp);	
-	cs_dl_ipvec(Symbolic[k]->q, abp, ab, As[k]->n);	
-	cs_solve_runtime.stop();
-	// Out of core
-	out_part_file[k].open(part_file_name[k].c_str(), ios::binary);
-	numeric_dl_save(out_part_file[k], Numeric[k]);
-	out_part_file[k].close();
-	cs_dl_nfree(Numeric[k]);
-	vec abk(ab, As[k]->m);
-	Ab[k] = abk;
-	// umfpack_dl_free_numeric(&Numeric[k]);
-	// compute right hand side Sy = g - FAb;
-	vec FAb(At->m);
-	FAb.zeros();
-	(void) cs_dl_gaxpy(F[k], ab, FAb._data());
-	delete [] ab;
-	delete [] abp;
-	gg = gg - FAb;	
-	//runtime.toc_print();
-  }
-  // solve Sy = g
-  /*
-  std::cout << "** S = " << std::endl;
-  for (int i = 0; i < S.rows(); i++){
-	for (int j = 0; j < S.cols(); j++){
-	  std::cout << S(i,j) << " " ;
-	}
-	std::cout<< std::endl;
-  }
-  */
-  /*
-  int nnzS = 0;
-  for (int i = 0; i < S._datasize(); i++){
-	if (*(S._data()+i) != 0)
-	  nnzS++;
-  }
-  std::cout << "nnz of S = " << nnzS << std::endl;
-  */
+  schur_runtime.start();
+  schur_waves(&sd, tpool, cs_symbolic_runtime, cs_numeric_runtime, cs_solve_runtime);
+  if (tpool != pool)
+	pool_free(tpool);
+  S = sd.S;
   schur_runtime.stop();
+  dd_io_wait(io_job);
   vec y = gg;
   // ls_solve(S, gg, y);
   cs_dl_lusol(order, S, y._data(), tol);
@@ -806,6 +1016,12 @@ void dd_solve_ooc(int npart, cs_dl **As, cs_dl **E, cs_dl **F, cs_dl *At,
   }
   */
   vec *x = new vec[npart];
+  // prefetch the first spilled factor, then always the next one
+  int next_load = 0;
+  while (next_load < npart && in_core[next_load])
+	next_load++;
+  if (next_load < npart)
+	dd_io_start_load(io_job, part_file_name[next_load]);
   for (int k = 0; k < npart; k++){ 
 	double *ey = new double[E[k]->m];
 	double *aey = new double[E[k]->m];
@@ -815,9 +1031,14 @@ void dd_solve_ooc(int npart, cs_dl **As, cs_dl **E, cs_dl **F, cs_dl *At,
 	}
 	(void) cs_dl_gaxpy(E[k], y._data(), aey);
 	// Out of core
-	in_part_file[k].open(part_file_name[k].c_str(), ios::binary);
-	numeric_dl_load(in_part_file[k], Numeric[k]);
-	in_part_file[k].close();
+	if (!in_core[k]){
+	  Numeric[k] = dd_io_wait(io_job);
+	  next_load = k+1;
+	  while (next_load < npart && in_core[next_load])
+		next_load++;
+	  if (next_load < npart)
+		dd_io_start_load(io_job, part_file_name[next_load]);
+	}
 	cs_solve_runtime.start();
 	cs_dl_ipvec(Numeric[k]->pinv, aey, ey, As[k]->n);
 	cs_dl_lsolve(Numeric[k]->L, ey);
@@ -834,9 +1055,12 @@ void dd_solve_ooc(int npart, cs_dl **As, cs_dl **E, cs_dl **F, cs_dl *At,
   delete [] Ab;
   delete [] Symbolic;
   delete [] Numeric;
+  for (int k = 0; k < npart; k++){
+	if (!in_core[k])
+	  remove(part_file_name[k].c_str());
+  }
   delete [] part_file_name;
-  delete [] in_part_file;
-  delete [] out_part_file;
+  delete [] in_core;
   // form z
   int current = 0;
   for (int k = 0; k < npart; k++){
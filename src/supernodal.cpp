@@ -0,0 +1,647 @@
+/*
+*******************************************************
+
+    Cadence Extended Truncated Balanced Realization
+                (*** CadETBR ***)
+
+*******************************************************
+*/
+
+/*
+ *    $RCSfile: supernodal.cpp,v $
+ *    $Revision: 1.1 $
+ *    $Date: 2013/03/23 21:08:01 $
+ *
+ *    Functions: Multifrontal supernodal sparse LU and Cholesky
+ *
+ */
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <string.h>
+#include <pthread.h>
+#include "cs.h"
+#include "supernodal.h"
+#include "thread_pool.h"
+
+using namespace std;
+
+extern "C" {
+  void dgetrf_(int *m, int *n, double *a, int *lda, int *ipiv, int *info);
+  void dlaswp_(int *n, double *a, int *lda, int *k1, int *k2, int *ipiv, int *incx);
+  void dtrsm_(char *side, char *uplo, char *transa, char *diag, int *m, int *n,
+			  double *alpha, double *a, int *lda, double *b, int *ldb);
+  void dgemm_(char *transa, char *transb, int *m, int *n, int *k, double *alpha,
+			  double *a, int *lda, double *b, int *ldb, double *beta, double *c, int *ldc);
+  void dtrsv_(char *uplo, char *trans, char *diag, int *n, double *a, int *lda,
+			  double *x, int *incx);
+  void dgemv_(char *trans, int *m, int *n, double *alpha, double *a, int *lda,
+			  double *x, int *incx, double *beta, double *y, int *incy);
+  void dpotrf_(char *uplo, int *n, double *a, int *lda, int *info);
+  void dsyrk_(char *uplo, char *trans, int *n, int *k, double *alpha, double *a,
+			  int *lda, double *beta, double *c, int *ldc);
+}
+
+typedef struct{
+  UF_long f;               /* first column, the columns are f..f+k-1 */
+  int k;                   /* number of columns */
+  int m;                   /* order of the front, rows[0..k-1] = f..f+k-1 */
+  vector<UF_long> rows;    /* rows of the front in the permuted matrix */
+  int parent;              /* parent supernode, -1 for a root */
+  int pending;             /* children not assembled yet */
+  vector<double> L;        /* m x k, L11\U11 over L21 (Cholesky: L11 over L21) */
+  vector<double> U;        /* k x (m-k), U12 */
+  vector<int> ipiv;        /* pivots inside the supernode */
+  vector<double> cb;       /* (m-k) x (m-k) contribution block */
+  vector<int> child;
+}SNODE;
+
+struct SNFACT{
+  UF_long n;
+  int chol;                /* A = L*L', U is not stored */
+  vector<UF_long> P;       /* C = A(P,P) */
+  vector<SNODE> sn;
+  cs_dl *C, *CT;           /* only during the factorization */
+  int failed;
+  /* threaded triangular solves (Cholesky): part[t] are the roots of the
+	 subtrees of thread t, a subtree of r is first[r]..r; the supernodes
+	 in top are above all the subtrees and are done by one thread, their
+	 columns are top_row[i] >= 0 */
+  int nthreads;
+  vector<vector<int> > part;
+  vector<int> first;
+  vector<int> top;
+  vector<UF_long> top_row;
+  UF_long ntop;
+  THREAD_POOL *pool;       /* nthreads-1 tasks, the caller takes part[0] */
+  int own_pool;            /* pool was created for this factor */
+  vector<int> ready;
+  int ndone;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+};
+
+/* a row with a zero diagonal (voltage source, inductor) is paired with a
+   neighbour, the pair is ordered as one vertex so both end up in the
+   same supernode where the 2x2 block can be pivoted */
+static void sn_order(cs_dl *A, cs_dl *S, vector<UF_long> &P)
+{
+  UF_long n = A->n;
+  vector<char> hasdiag(n, 0);
+  for (UF_long j = 0; j < n; j++)
+	for (UF_long p = A->p[j]; p < A->p[j+1]; p++)
+	  if (A->i[p] == j && A->x[p] != 0)
+		hasdiag[j] = 1;
+  vector<UF_long> mate(n, -1);
+  for (UF_long j = 0; j < n; j++){
+	if (hasdiag[j])
+	  continue;
+	for (UF_long p = S->p[j]; p < S->p[j+1]; p++){
+	  UF_long i = S->i[p];
+	  if (i != j && hasdiag[i] && mate[i] < 0){
+		mate[i] = j;
+		mate[j] = i;
+		break;
+	  }
+	}
+  }
+  vector<UF_long> sv(n), rep;
+  for (UF_long j = 0; j < n; j++){
+	if (mate[j] < 0 || hasdiag[j]){
+	  sv[j] = rep.size();
+	  rep.push_back(j);
+	}
+  }
+  for (UF_long j = 0; j < n; j++)
+	if (mate[j] >= 0 && !hasdiag[j])
+	  sv[j] = sv[mate[j]];
+  UF_long nsv = rep.size();
+  cs_dl *T = cs_dl_spalloc(nsv, nsv, S->p[n], 1, 1);
+  for (UF_long j = 0; j < n; j++)
+	for (UF_long p = S->p[j]; p < S->p[j+1]; p++)
+	  cs_dl_entry(T, sv[S->i[p]], sv[j], 1);
+  cs_dl *Ts = cs_dl_compress(T);
+  cs_dl_spfree(T);
+  UF_long *Psv = cs_dl_amd(1, Ts);
+  cs_dl_spfree(Ts);
+  P.clear();
+  for (UF_long k = 0; k < nsv; k++){
+	UF_long j = rep[Psv[k]];
+	P.push_back(j);
+	if (mate[j] >= 0)
+	  P.push_back(mate[j]);
+  }
+  cs_dl_free(Psv);
+}
+
+static void sn_symbolic(SNFACT *F, cs_dl *A)
+{
+  UF_long n = A->n;
+  cs_dl *AT = cs_dl_transpose(A, 1);
+  cs_dl *S = cs_dl_add(A, AT, 1, 1);
+  cs_dl_spfree(AT);
+
+  /* fill reducing order, then postorder the elimination tree */
+  vector<UF_long> P0;
+  sn_order(A, S, P0);
+  UF_long *pinv = cs_dl_pinv(&P0[0], n);
+  cs_dl *SP = cs_dl_permute(S, pinv, &P0[0], 0);
+  cs_dl_free(pinv);
+  UF_long *parent = cs_dl_etree(SP, 0);
+  UF_long *post = cs_dl_post(parent, n);
+  F->P.resize(n);
+  for (UF_long k = 0; k < n; k++)
+	F->P[k] = P0[post[k]];
+  cs_dl_free(parent);
+  cs_dl_free(post);
+  cs_dl_spfree(SP);
+
+  pinv = cs_dl_pinv(&F->P[0], n);
+  SP = cs_dl_permute(S, pinv, &F->P[0], 0);
+  F->C = cs_dl_permute(A, pinv, &F->P[0], 1);
+  F->CT = cs_dl_transpose(F->C, 1);
+  cs_dl_free(pinv);
+  cs_dl_spfree(S);
+  parent = cs_dl_etree(SP, 0);
+  post = cs_dl_post(parent, n);
+  UF_long *cc = cs_dl_counts(SP, parent, post, 0);
+  cs_dl_free(post);
+
+  /* fundamental supernodes, a zero diagonal always joins the column
+	 before it (its mate from sn_order) */
+  vector<int> nchild(n, 0);
+  for (UF_long j = 0; j < n; j++)
+	if (parent[j] >= 0)
+	  nchild[parent[j]]++;
+  vector<int> col2sn(n);
+  vector<char> hasdiag(n, 0);
+  for (UF_long j = 0; j < n; j++)
+	for (UF_long p = F->C->p[j]; p < F->C->p[j+1]; p++)
+	  if (F->C->i[p] == j && F->C->x[p] != 0)
+		hasdiag[j] = 1;
+  int ns = 0;
+  for (UF_long j = 0; j < n; j++){
+	if (j > 0 && parent[j-1] == j &&
+		((cc[j-1] == cc[j]+1 && nchild[j] == 1) || !hasdiag[j])){
+	  col2sn[j] = ns-1;
+	  F->sn[ns-1].k++;
+	}else{
+	  F->sn.push_back(SNODE());
+	  F->sn[ns].f = j;
+	  F->sn[ns].k = 1;
+	  col2sn[j] = ns++;
+	}
+  }
+  for (int s = 0; s < ns; s++){
+	UF_long last = F->sn[s].f + F->sn[s].k - 1;
+	F->sn[s].parent = parent[last] >= 0 ? col2sn[parent[last]] : -1;
+	if (F->sn[s].parent >= 0)
+	  F->sn[F->sn[s].parent].child.push_back(s);
+  }
+  cs_dl_free(parent);
+  cs_dl_free(cc);
+
+  /* rows of each front: its columns, the entries of the pattern below
+	 them and the update rows of the children (children come first) */
+  vector<UF_long> mark(n, -1);
+  for (int s = 0; s < ns; s++){
+	SNODE &sn = F->sn[s];
+	UF_long last = sn.f + sn.k - 1;
+	vector<UF_long> below;
+	for (UF_long j = sn.f; j <= last; j++){
+	  for (UF_long p = SP->p[j]; p < SP->p[j+1]; p++){
+		UF_long i = SP->i[p];
+		if (i > last && mark[i] != s){
+		  mark[i] = s;
+		  below.push_back(i);
+		}
+	  }
+	}
+	for (size_t c = 0; c < sn.child.size(); c++){
+	  SNODE &ch = F->sn[sn.child[c]];
+	  for (int r = ch.k; r < ch.m; r++){
+		UF_long i = ch.rows[r];
+		if (i > last && mark[i] != s){
+		  mark[i] = s;
+		  below.push_back(i);
+		}
+	  }
+	}
+	sort(below.begin(), below.end());
+	sn.rows.resize(sn.k + below.size());
+	for (int r = 0; r < sn.k; r++)
+	  sn.rows[r] = sn.f + r;
+	for (size_t r = 0; r < below.size(); r++)
+	  sn.rows[sn.k + r] = below[r];
+	sn.m = sn.rows.size();
+	sn.pending = sn.child.size();
+  }
+  cs_dl_spfree(SP);
+  F->n = n;
+}
+
+/* assemble, factor and hand the contribution block to the parent */
+static int sn_front(SNFACT *F, int s, vector<UF_long> &loc)
+{
+  SNODE &sn = F->sn[s];
+  int m = sn.m, k = sn.k, m2 = m - k;
+  UF_long last = sn.f + k - 1;
+  for (int r = 0; r < m; r++)
+	loc[sn.rows[r]] = r;
+  vector<double> W((size_t)m*m, 0);
+  double *Fm = &W[0];
+
+  cs_dl *C = F->C, *CT = F->CT;
+  for (UF_long j = sn.f; j <= last; j++){
+	for (UF_long p = C->p[j]; p < C->p[j+1]; p++)
+	  if (C->i[p] >= sn.f)
+		Fm[loc[C->i[p]] + (size_t)m*loc[j]] += C->x[p];
+	for (UF_long p = CT->p[j]; p < CT->p[j+1]; p++)
+	  if (CT->i[p] > last)
+		Fm[loc[j] + (size_t)m*loc[CT->i[p]]] += CT->x[p];
+  }
+  for (size_t c = 0; c < sn.child.size(); c++){
+	SNODE &ch = F->sn[sn.child[c]];
+	int mc = ch.m - ch.k;
+	for (int jj = 0; jj < mc; jj++){
+	  size_t col = (size_t)m*loc[ch.rows[ch.k+jj]];
+	  for (int ii = F->chol ? jj : 0; ii < mc; ii++)
+		Fm[loc[ch.rows[ch.k+ii]] + col] += ch.cb[ii + (size_t)mc*jj];
+	}
+	vector<double>().swap(ch.cb);
+  }
+
+  int info = 0, one = 1;
+  double alpha = 1, malpha = -1;
+  char L = 'L', R = 'R', U = 'U', N = 'N', T = 'T';
+  if (F->chol){
+	dpotrf_(&L, &k, Fm, &m, &info);
+	if (info != 0)
+	  return -1;
+	sn.cb.resize((size_t)m2*m2);
+	if (m2 > 0){
+	  dtrsm_(&R, &L, &T, &N, &m2, &k, &alpha, Fm, &m, Fm + k, &m);
+	  dsyrk_(&L, &N, &m2, &k, &malpha, Fm + k, &m, &alpha, Fm + k + (size_t)m*k, &m);
+	  for (int j = 0; j < m2; j++)
+		memcpy(&sn.cb[(size_t)m2*j], Fm + k + (size_t)m*(k+j), sizeof(double)*m2);
+	}
+	sn.L.resize((size_t)m*k);
+	memcpy(&sn.L[0], Fm, sizeof(double)*m*k);
+	return 0;
+  }
+  sn.ipiv.resize(k);
+  dgetrf_(&k, &k, Fm, &m, &sn.ipiv[0], &info);
+  if (info != 0)
+	return -1;
+  if (m2 > 0){
+	dlaswp_(&m2, Fm + (size_t)m*k, &m, &one, &k, &sn.ipiv[0], &one);
+	dtrsm_(&L, &L, &N, &U, &k, &m2, &alpha, Fm, &m, Fm + (size_t)m*k, &m);
+	dtrsm_(&R, &U, &N, &N, &m2, &k, &alpha, Fm, &m, Fm + k, &m);
+	dgemm_(&N, &N, &m2, &m2, &k, &malpha, Fm + k, &m, Fm + (size_t)m*k, &m,
+		   &alpha, Fm + k + (size_t)m*k, &m);
+  }
+
+  sn.L.resize((size_t)m*k);
+  memcpy(&sn.L[0], Fm, sizeof(double)*m*k);
+  sn.U.resize((size_t)k*m2);
+  sn.cb.resize((size_t)m2*m2);
+  for (int j = 0; j < m2; j++){
+	memcpy(&sn.U[(size_t)k*j], Fm + (size_t)m*(k+j), sizeof(double)*k);
+	memcpy(&sn.cb[(size_t)m2*j], Fm + k + (size_t)m*(k+j), sizeof(double)*m2);
+  }
+  return 0;
+}
+
+/* workers take the supernodes whose children are all done */
+static void *sn_worker(void *arg)
+{
+  SNFACT *F = (SNFACT *)arg;
+  vector<UF_long> loc(F->n);
+  int ns = F->sn.size();
+  pthread_mutex_lock(&F->mutex);
+  while (1){
+	while (F->ready.empty() && F->ndone < ns)
+	  pthread_cond_wait(&F->cond, &F->mutex);
+	if (F->ndone >= ns)
+	  break;
+	int s = F->ready.back();
+	F->ready.pop_back();
+	int failed = F->failed;
+	pthread_mutex_unlock(&F->mutex);
+
+	int ret = failed ? -1 : sn_front(F, s, loc);
+
+	pthread_mutex_lock(&F->mutex);
+	if (ret != 0)
+	  F->failed = 1;
+	F->ndone++;
+	int p = F->sn[s].parent;
+	if (p >= 0 && --F->sn[p].pending == 0)
+	  F->ready.push_back(p);
+	pthread_cond_broadcast(&F->cond);
+  }
+  pthread_mutex_unlock(&F->mutex);
+  return NULL;
+}
+
+/* split the assembly tree into subtrees of about the same solve cost,
+   at least two per thread, and deal them out largest first */
+static void sn_plan(SNFACT *F, int nthreads)
+{
+  int ns = F->sn.size();
+  vector<double> w(ns);
+  F->first.resize(ns);
+  for (int s = 0; s < ns; s++){
+	w[s] = (double)F->sn[s].m*F->sn[s].k;
+	F->first[s] = s;
+	for (size_t c = 0; c < F->sn[s].child.size(); c++){
+	  int ch = F->sn[s].child[c];
+	  w[s] += w[ch];
+	  F->first[s] = min(F->first[s], F->first[ch]);
+	}
+  }
+  vector<int> sub;
+  double total = 0;
+  for (int s = 0; s < ns; s++)
+	if (F->sn[s].parent < 0){
+	  sub.push_back(s);
+	  total += w[s];
+	}
+  vector<char> is_top(ns, 0);
+  while (nthreads > 1 && (int)sub.size() < 2*nthreads){
+	int big = 0;
+	for (size_t i = 1; i < sub.size(); i++)
+	  if (w[sub[i]] > w[sub[big]])
+		big = i;
+	int s = sub[big];
+	if (F->sn[s].child.empty() || w[s] < total/(8*nthreads))
+	  break;
+	is_top[s] = 1;
+	sub.erase(sub.begin() + big);
+	for (size_t c = 0; c < F->sn[s].child.size(); c++)
+	  sub.push_back(F->sn[s].child[c]);
+  }
+  if (nthreads <= 1 || (int)sub.size() < 2){
+	sub.clear();
+	for (int s = 0; s < ns; s++)
+	  is_top[s] = 1;
+	nthreads = 1;
+  }
+  vector<pair<double, int> > order;
+  for (size_t i = 0; i < sub.size(); i++)
+	order.push_back(make_pair(-w[sub[i]], sub[i]));
+  sort(order.begin(), order.end());
+  vector<double> load(nthreads, 0);
+  F->part.assign(nthreads, vector<int>());
+  for (size_t i = 0; i < order.size(); i++){
+	int t = min_element(load.begin(), load.end()) - load.begin();
+	load[t] -= order[i].first;
+	F->part[t].push_back(order[i].second);
+  }
+  F->nthreads = nthreads;
+  F->top.clear();
+  F->top_row.assign(F->n, -1);
+  F->ntop = 0;
+  for (int s = 0; s < ns; s++){
+	if (!is_top[s])
+	  continue;
+	F->top.push_back(s);
+	for (int j = 0; j < F->sn[s].k; j++)
+	  F->top_row[F->sn[s].f + j] = F->ntop++;
+  }
+}
+
+static SNFACT *sn_factor2(cs_dl *A, THREAD_POOL *pool, int chol)
+{
+  SNFACT *F = new SNFACT;
+  F->chol = chol;
+  F->nthreads = 1;
+  F->pool = pool != NULL ? pool : pool_create(pool_default_size());
+  F->own_pool = (pool == NULL);
+  sn_symbolic(F, A);
+  int ns = F->sn.size();
+  for (int s = 0; s < ns; s++)
+	if (F->sn[s].pending == 0)
+	  F->ready.push_back(s);
+  F->failed = 0;
+  F->ndone = 0;
+  /* the caller is a worker too; a task that starts after the last
+	 supernode is done returns at once */
+  int nthreads = pool_size(F->pool);
+  pthread_mutex_init(&F->mutex, NULL);
+  pthread_cond_init(&F->cond, NULL);
+  vector<void *> args(nthreads, (void *)F);
+  POOL_BATCH *batch = nthreads > 1 ? pool_submit(F->pool, sn_worker, &args[1], nthreads-1) : NULL;
+  sn_worker((void *)F);
+  if (batch != NULL)
+	pool_wait(batch);
+  pthread_mutex_destroy(&F->mutex);
+  pthread_cond_destroy(&F->cond);
+  cs_dl_spfree(F->C);
+  cs_dl_spfree(F->CT);
+  F->C = F->CT = NULL;
+  if (F->failed){
+	sn_free(F);
+	return NULL;
+  }
+  if (chol)
+	sn_plan(F, nthreads);
+  /* only the threaded Cholesky solves use the pool later on */
+  if (F->nthreads <= 1){
+	if (F->own_pool)
+	  pool_free(F->pool);
+	F->pool = NULL;
+	F->own_pool = 0;
+  }
+  return F;
+}
+
+SNFACT *sn_factor(cs_dl *A, THREAD_POOL *pool)
+{
+  return sn_factor2(A, pool, 0);
+}
+
+SNFACT *sn_chol(cs_dl *A, THREAD_POOL *pool)
+{
+  return sn_factor2(A, pool, 1);
+}
+
+/* y(f..f+k-1) = L11\y, then the rows below get -L21*y; with acc the
+   rows of the top supernodes are gathered in acc instead of y */
+static void chol_forward(SNFACT *F, int s, double *y, double *acc, vector<double> &t)
+{
+  SNODE &sn = F->sn[s];
+  int m = sn.m, k = sn.k, m2 = m - k, one = 1;
+  double alpha = 1, zero = 0;
+  char L = 'L', N = 'N';
+  dtrsv_(&L, &N, &N, &k, &sn.L[0], &m, y + sn.f, &one);
+  if (m2 == 0)
+	return;
+  t.resize(m2);
+  dgemv_(&N, &m2, &k, &alpha, &sn.L[k], &m, y + sn.f, &one, &zero, &t[0], &one);
+  for (int i = 0; i < m2; i++){
+	UF_long r = sn.rows[k+i];
+	if (acc != NULL && F->top_row[r] >= 0)
+	  acc[F->top_row[r]] += t[i];
+	else
+	  y[r] -= t[i];
+  }
+}
+
+/* y(f..f+k-1) = L11'\(y - L21'*y(rows below)) */
+static void chol_backward(SNFACT *F, int s, double *y, vector<double> &t)
+{
+  SNODE &sn = F->sn[s];
+  int m = sn.m, k = sn.k, m2 = m - k, one = 1;
+  double alpha = 1, malpha = -1;
+  char L = 'L', N = 'N', T = 'T';
+  if (m2 > 0){
+	t.resize(m2);
+	for (int i = 0; i < m2; i++)
+	  t[i] = y[sn.rows[k+i]];
+	dgemv_(&T, &m2, &k, &malpha, &sn.L[k], &m, &t[0], &one, &alpha, y + sn.f, &one);
+  }
+  dtrsv_(&L, &T, &N, &k, &sn.L[0], &m, y + sn.f, &one);
+}
+
+typedef struct{
+  SNFACT *F;
+  int t;
+  int backward;
+  double *y;
+  vector<double> acc;
+}SNSOLVE;
+
+static void *chol_subtrees(void *arg)
+{
+  SNSOLVE *d = (SNSOLVE *)arg;
+  SNFACT *F = d->F;
+  vector<int> &roots = F->part[d->t];
+  vector<double> t;
+  for (size_t i = 0; i < roots.size(); i++){
+	int r = roots[i];
+	if (d->backward){
+	  for (int s = r; s >= F->first[r]; s--)
+		chol_backward(F, s, d->y, t);
+	}else{
+	  for (int s = F->first[r]; s <= r; s++)
+		chol_forward(F, s, d->y, &d->acc[0], t);
+	}
+  }
+  return NULL;
+}
+
+static void chol_parts(SNFACT *F, vector<void *> &args)
+{
+  POOL_BATCH *batch = pool_submit(F->pool, chol_subtrees, &args[1], F->nthreads-1);
+  chol_subtrees(args[0]);
+  pool_wait(batch);
+}
+
+/* the subtrees go in parallel, the forward updates they send to the
+   top supernodes are summed per thread and added once they are done;
+   the threads are kept in F->pool from one solve to the next */
+static void chol_solve(SNFACT *F, double *y)
+{
+  int nt = F->nthreads;
+  vector<double> t;
+  if (nt <= 1){
+	for (size_t i = 0; i < F->top.size(); i++)
+	  chol_forward(F, F->top[i], y, NULL, t);
+	for (int i = F->top.size()-1; i >= 0; i--)
+	  chol_backward(F, F->top[i], y, t);
+	return;
+  }
+  vector<SNSOLVE> d(nt);
+  vector<void *> args(nt);
+  for (int i = 0; i < nt; i++){
+	d[i].F = F;
+	d[i].t = i;
+	d[i].y = y;
+	d[i].backward = 0;
+	d[i].acc.assign(F->ntop + 1, 0);
+	args[i] = &d[i];
+  }
+  chol_parts(F, args);
+  for (int i = 0; i < nt; i++)
+	for (size_t j = 0; j < F->top.size(); j++){
+	  SNODE &sn = F->sn[F->top[j]];
+	  for (int c = 0; c < sn.k; c++)
+		y[sn.f + c] -= d[i].acc[F->top_row[sn.f + c]];
+	}
+  for (size_t i = 0; i < F->top.size(); i++)
+	chol_forward(F, F->top[i], y, NULL, t);
+  for (int i = F->top.size()-1; i >= 0; i--)
+	chol_backward(F, F->top[i], y, t);
+  for (int i = 0; i < nt; i++)
+	d[i].backward = 1;
+  chol_parts(F, args);
+}
+
+void sn_solve(SNFACT *F, const double *b, double *x)
+{
+  UF_long n = F->n;
+  int ns = F->sn.size();
+  vector<double> y(n), t;
+  for (UF_long k = 0; k < n; k++)
+	y[k] = b[F->P[k]];
+  if (F->chol){
+	chol_solve(F, &y[0]);
+	for (UF_long k = 0; k < n; k++)
+	  x[F->P[k]] = y[k];
+	return;
+  }
+  int one = 1;
+  double alpha = 1, malpha = -1, zero = 0;
+  char L = 'L', U = 'U', N = 'N';
+
+  for (int s = 0; s < ns; s++){
+	SNODE &sn = F->sn[s];
+	int m = sn.m, k = sn.k, m2 = m - k;
+	double *ys = &y[sn.f];
+	for (int i = 0; i < k; i++)
+	  if (sn.ipiv[i]-1 != i)
+		swap(ys[i], ys[sn.ipiv[i]-1]);
+	dtrsv_(&L, &N, &U, &k, &sn.L[0], &m, ys, &one);
+	if (m2 > 0){
+	  t.resize(m2);
+	  dgemv_(&N, &m2, &k, &alpha, &sn.L[k], &m, ys, &one, &zero, &t[0], &one);
+	  for (int i = 0; i < m2; i++)
+		y[sn.rows[k+i]] -= t[i];
+	}
+  }
+  for (int s = ns-1; s >= 0; s--){
+	SNODE &sn = F->sn[s];
+	int m = sn.m, k = sn.k, m2 = m - k;
+	double *ys = &y[sn.f];
+	if (m2 > 0){
+	  t.resize(m2);
+	  for (int i = 0; i < m2; i++)
+		t[i] = y[sn.rows[k+i]];
+	  dgemv_(&N, &k, &m2, &malpha, &sn.U[0], &k, &t[0], &one, &alpha, ys, &one);
+	}
+	dtrsv_(&U, &N, &N, &k, &sn.L[0], &m, ys, &one);
+  }
+  for (UF_long k = 0; k < n; k++)
+	x[F->P[k]] = y[k];
+}
+
+double sn_nnz(SNFACT *F)
+{
+  double nnz = 0;
+  for (size_t s = 0; s < F->sn.size(); s++)
+	nnz += F->sn[s].L.size() + F->sn[s].U.size();
+  return nnz;
+}
+
+void sn_free(SNFACT *F)
+{
+  if (F->C != NULL)
+	cs_dl_spfree(F->C);
+  if (F->CT != NULL)
+	cs_dl_spfree(F->CT);
+  if (F->own_pool)
+	pool_free(F->pool);
+  delete F;
+}
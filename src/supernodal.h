@@ -0,0 +1,48 @@
+/*
+*******************************************************
+
+    Cadence Extended Truncated Balanced Realization
+                (*** CadETBR ***)
+
+*******************************************************
+*/
+
+/*
+ *    $RCSfile: supernodal.h,v $
+ *    $Revision: 1.1 $
+ *    $Date: 2013/03/23 21:08:01 $
+ *
+ *    Functions: Multifrontal supernodal sparse LU and Cholesky header
+ *
+ */
+
+#ifndef SUPERNODAL_H
+#define SUPERNODAL_H
+
+#include "cs.h"
+#include "thread_pool.h"
+
+typedef struct SNFACT SNFACT;
+
+/* factor A with a fill reducing ordering of A+A'; the fronts are
+   dense (LAPACK/BLAS-3) and independent subtrees of the assembly tree
+   are factored on the threads of pool (NULL: a pool of
+   pool_default_size threads for the call). Pivoting is done inside
+   each supernode only; returns NULL if a pivot is zero */
+SNFACT *sn_factor(cs_dl *A, THREAD_POOL *pool);
+
+/* A = L*L' for a symmetric positive definite A (only L is kept, half of
+   the LU factor); sn_solve then runs the independent subtrees of the
+   triangular solves on pool, which must outlive the factor (NULL: the
+   factor keeps a pool of its own). NULL if A is not SPD */
+SNFACT *sn_chol(cs_dl *A, THREAD_POOL *pool);
+
+/* x = A\b, b and x may be the same array */
+void sn_solve(SNFACT *F, const double *b, double *x);
+
+/* number of entries stored in the factor */
+double sn_nnz(SNFACT *F);
+
+void sn_free(SNFACT *F);
+
+#endif
@@ -0,0 +1,158 @@
+/*
+*******************************************************
+
+    Cadence Extended Truncated Balanced Realization
+                (*** CadETBR ***)
+
+*******************************************************
+*/
+
+/*
+ *    $RCSfile: thread_pool.cpp,v $
+ *    $Revision: 1.1 $
+ *    $Date: 2013/03/23 21:08:01 $
+ *
+ *    Functions: Fixed pool of worker threads shared by the analyses
+ *
+ *    One queue of tasks under one lock; a batch counts its finished
+ *    tasks so the submitter can pick up each result as soon as it is
+ *    done (etbr2_thread feeds the incremental SVD that way).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <deque>
+#include <vector>
+#include "thread_pool.h"
+
+using namespace std;
+
+struct POOL_TASK {
+  POOL_BATCH *batch;
+  int i;
+};
+
+struct POOL_BATCH {
+  void *(*fn)(void *);
+  vector<void *> args;
+  vector<char> done;
+  int left;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+};
+
+struct THREAD_POOL {
+  vector<pthread_t> threads;
+  deque<POOL_TASK> queue;
+  bool stop;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+};
+
+static void *pool_worker(void *arg)
+{
+  THREAD_POOL *pool = (THREAD_POOL *)arg;
+  for (;;){
+    pthread_mutex_lock(&pool->lock);
+    while (pool->queue.empty() && !pool->stop)
+      pthread_cond_wait(&pool->cond, &pool->lock);
+    if (pool->queue.empty()){
+      pthread_mutex_unlock(&pool->lock);
+      return NULL;
+    }
+    POOL_TASK t = pool->queue.front();
+    pool->queue.pop_front();
+    pthread_mutex_unlock(&pool->lock);
+
+    POOL_BATCH *b = t.batch;
+    b->fn(b->args[t.i]);
+
+    pthread_mutex_lock(&b->lock);
+    b->done[t.i] = 1;
+    b->left--;
+    pthread_cond_broadcast(&b->cond);
+    pthread_mutex_unlock(&b->lock);
+  }
+}
+
+THREAD_POOL *pool_create(int nthreads)
+{
+  THREAD_POOL *pool = new THREAD_POOL;
+  pool->stop = false;
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->cond, NULL);
+  pool->threads.resize(nthreads > 0 ? nthreads : 1);
+  for (size_t k = 0; k < pool->threads.size(); k++)
+    if (pthread_create(&pool->threads[k], NULL, pool_worker, pool) != 0){
+      printf("Can not create thread %d of the pool.\n", (int)k);
+      exit(-1);
+    }
+  return pool;
+}
+
+void pool_free(THREAD_POOL *pool)
+{
+  pthread_mutex_lock(&pool->lock);
+  pool->stop = true;
+  pthread_cond_broadcast(&pool->cond);
+  pthread_mutex_unlock(&pool->lock);
+  for (size_t k = 0; k < pool->threads.size(); k++)
+    pthread_join(pool->threads[k], NULL);
+  pthread_mutex_destroy(&pool->lock);
+  pthread_cond_destroy(&pool->cond);
+  delete pool;
+}
+
+int pool_size(THREAD_POOL *pool)
+{
+  return pool->threads.size();
+}
+
+int pool_default_size()
+{
+  int n = sysconf(_SC_NPROCESSORS_ONLN);
+  return n > 0 ? n : 1;
+}
+
+POOL_BATCH *pool_submit(THREAD_POOL *pool, void *(*fn)(void *), void **args, int n)
+{
+  POOL_BATCH *b = new POOL_BATCH;
+  b->fn = fn;
+  b->args.assign(args, args+n);
+  b->done.assign(n, 0);
+  b->left = n;
+  pthread_mutex_init(&b->lock, NULL);
+  pthread_cond_init(&b->cond, NULL);
+
+  pthread_mutex_lock(&pool->lock);
+  for (int i = 0; i < n; i++){
+    POOL_TASK t;
+    t.batch = b;
+    t.i = i;
+    pool->queue.push_back(t);
+  }
+  pthread_cond_broadcast(&pool->cond);
+  pthread_mutex_unlock(&pool->lock);
+  return b;
+}
+
+void pool_wait_task(POOL_BATCH *b, int i)
+{
+  pthread_mutex_lock(&b->lock);
+  while (!b->done[i])
+    pthread_cond_wait(&b->cond, &b->lock);
+  pthread_mutex_unlock(&b->lock);
+}
+
+void pool_wait(POOL_BATCH *b)
+{
+  pthread_mutex_lock(&b->lock);
+  while (b->left > 0)
+    pthread_cond_wait(&b->cond, &b->lock);
+  pthread_mutex_unlock(&b->lock);
+  pthread_mutex_destroy(&b->lock);
+  pthread_cond_destroy(&b->cond);
+  delete b;
+}
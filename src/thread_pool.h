@@ -0,0 +1,41 @@
+/*
+*******************************************************
+
+    Cadence Extended Truncated Balanced Realization
+                (*** CadETBR ***)
+
+*******************************************************
+*/
+
+/*
+ *    $RCSfile: thread_pool.h,v $
+ *    $Revision: 1.1 $
+ *    $Date: 2013/03/23 21:08:01 $
+ *
+ *    Functions: Fixed pool of worker threads shared by the analyses header
+ *
+ */
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+typedef struct THREAD_POOL THREAD_POOL;
+typedef struct POOL_BATCH POOL_BATCH;
+
+THREAD_POOL *pool_create(int nthreads);
+/* waits for the queued tasks; no batch may be submitted afterwards */
+void pool_free(THREAD_POOL *pool);
+int pool_size(THREAD_POOL *pool);
+/* one thread per online core: the size of the pool a module creates
+   for itself when the analysis has none (SOLVER_CTX::pool is NULL) */
+int pool_default_size();
+
+/* queue fn(args[0]) .. fn(args[n-1]); several analyses can submit to
+   one pool at the same time, the tasks run in the order queued */
+POOL_BATCH *pool_submit(THREAD_POOL *pool, void *(*fn)(void *), void **args, int n);
+/* wait for task i of the batch */
+void pool_wait_task(POOL_BATCH *batch, int i);
+/* wait for all tasks of the batch and free it */
+void pool_wait(POOL_BATCH *batch);
+
+#endif
@@ -0,0 +1,667 @@
+/*
+*******************************************************
+
+    Cadence Extended Truncated Balanced Realization
+                (*** CadETBR ***)
+
+*******************************************************
+*/
+
+/*
+ *    $RCSfile: topo_reduce.cpp,v $
+ *    $Revision: 1.1 $
+ *    $Date: 2013/03/23 21:08:01 $
+ *
+ *    Functions: Topological reduction of the MNA matrices
+ *
+ */
+
+#include <iostream>
+#include <stdio.h>
+#include <math.h>
+#include <map>
+#include <utility>
+#include <algorithm>
+#include <itpp/base/math/min_max.h>
+#include "cs.h"
+#include "topo_reduce.h"
+#include "etbr_dd.h"
+
+using namespace std;
+
+static UF_long uf_find(vector<UF_long> &p, UF_long i)
+{
+  while (p[i] != i){
+	p[i] = p[p[i]];
+	i = p[i];
+  }
+  return i;
+}
+
+/* keep the smaller row as representative */
+static void uf_union(vector<UF_long> &p, UF_long i, UF_long j)
+{
+  i = uf_find(p, i);
+  j = uf_find(p, j);
+  if (i < j)
+	p[j] = i;
+  else if (j < i)
+	p[i] = j;
+}
+
+static cs_dl *triplet_to_csc(cs_dl *T)
+{
+  cs_dl *A = cs_dl_compress(T);
+  cs_dl_spfree(T);
+  cs_dl_dupl(A);
+  return A;
+}
+
+void topo_reduce(cs_dl *&G, cs_dl *&C, cs_dl *&B, int &nNodes,
+				 ivec &port, vector<int> &tc_node, int keep_port,
+				 double short_r, TOPOMAP &tmap)
+{
+  UF_long n = G->n;
+  UF_long nb_col = B->n;
+  UF_long n_node = nNodes;
+  UF_long *Gp = G->p, *Gi = G->i;
+  double *Gx = G->x;
+
+  tmap.n = n;
+  tmap.rep.resize(n);
+  tmap.new_idx.assign(n, -1);
+  tmap.elim_node.clear();
+  tmap.elim_p.assign(1, 0);
+  tmap.elim_i.clear();
+  tmap.elim_x.clear();
+  vector<UF_long> &rep = tmap.rep;
+
+  /* merge the nodes connected by a (near) zero-ohm resistor */
+  for (UF_long i = 0; i < n; i++)
+	rep[i] = i;
+  double g_short = 1.0/short_r;
+  for (UF_long j = 0; j < n_node; j++){
+	for (UF_long p = Gp[j]; p < Gp[j+1]; p++){
+	  UF_long i = Gi[p];
+	  if (i < n_node && i != j && -Gx[p] > g_short)
+		uf_union(rep, i, j);
+	}
+  }
+  UF_long n_merged = 0;
+  for (UF_long i = 0; i < n; i++){
+	rep[i] = uf_find(rep, i);
+	if (rep[i] != i)
+	  n_merged++;
+  }
+
+  /* graph of the merged G, nb[k][j] = (G(k,j), G(j,k)) */
+  vector<double> diag(n, 0);
+  vector< map<UF_long, pair<double, double> > > nb(n);
+  for (UF_long j = 0; j < n; j++){
+	UF_long rj = rep[j];
+	for (UF_long p = Gp[j]; p < Gp[j+1]; p++){
+	  UF_long ri = rep[Gi[p]];
+	  if (ri == rj){
+		diag[ri] += Gx[p];
+	  }else{
+		nb[ri][rj].first += Gx[p];
+		nb[rj][ri].second += Gx[p];
+	  }
+	}
+  }
+
+  /* rows that have to stay: branch rows, sources, capacitors and probes */
+  vector<char> keep(n, 0), elim(n, 0);
+  for (UF_long i = n_node; i < n; i++)
+	keep[i] = 1;
+  for (UF_long p = 0; p < B->p[nb_col]; p++)
+	keep[rep[B->i[p]]] = 1;
+  if (C != NULL){
+	for (UF_long j = 0; j < C->n; j++){
+	  for (UF_long p = C->p[j]; p < C->p[j+1]; p++){
+		if (C->x[p] != 0){
+		  keep[rep[C->i[p]]] = 1;
+		  keep[rep[j]] = 1;
+		}
+	  }
+	}
+  }
+  if (keep_port){
+	for (int i = 0; i < port.size(); i++)
+	  keep[rep[port(i)]] = 1;
+  }
+  for (int i = 0; i < tc_node.size(); i++)
+	keep[rep[tc_node[i]]] = 1;
+
+  /* eliminate the internal nodes of degree <= 2; the Schur update
+	 G(a,b) -= G(a,k)*G(k,b)/G(k,k) only couples the neighbours of k,
+	 so series chains collapse and dangling stubs fold into their root */
+  vector<UF_long> work;
+  vector<char> queued(n, 0);
+  for (UF_long k = n_node-1; k >= 0; k--){
+	if (rep[k] == k && !keep[k]){
+	  work.push_back(k);
+	  queued[k] = 1;
+	}
+  }
+  while (!work.empty()){
+	UF_long k = work.back();
+	work.pop_back();
+	queued[k] = 0;
+	if (elim[k] || nb[k].size() > 2 || diag[k] == 0)
+	  continue;
+	map<UF_long, pair<double, double> >::iterator a, b;
+	int internal = 1;
+	for (a = nb[k].begin(); a != nb[k].end(); a++)
+	  if (a->first >= n_node)
+		internal = 0;
+	if (!internal)
+	  continue;
+
+	double dk = diag[k];
+	tmap.elim_node.push_back(k);
+	for (b = nb[k].begin(); b != nb[k].end(); b++){
+	  tmap.elim_i.push_back(b->first);
+	  tmap.elim_x.push_back(-b->second.first/dk);
+	}
+	tmap.elim_p.push_back(tmap.elim_i.size());
+
+	for (a = nb[k].begin(); a != nb[k].end(); a++){
+	  for (b = nb[k].begin(); b != nb[k].end(); b++){
+		double val = a->second.second*b->second.first/dk;
+		if (a->first == b->first){
+		  diag[a->first] -= val;
+		}else{
+		  nb[a->first][b->first].first -= val;
+		  nb[b->first][a->first].second -= val;
+		}
+	  }
+	}
+	for (a = nb[k].begin(); a != nb[k].end(); a++){
+	  nb[a->first].erase(k);
+	  if (!keep[a->first] && !queued[a->first]){
+		work.push_back(a->first);
+		queued[a->first] = 1;
+	  }
+	}
+	nb[k].clear();
+	elim[k] = 1;
+  }
+  UF_long n_elim = tmap.elim_node.size();
+
+  /* drop the floating pieces: without a branch row, source, capacitor
+	 or probe all of their voltages are zero */
+  vector<UF_long> comp(n);
+  for (UF_long i = 0; i < n; i++)
+	comp[i] = i;
+  for (UF_long k = 0; k < n; k++){
+	map<UF_long, pair<double, double> >::iterator a;
+	for (a = nb[k].begin(); a != nb[k].end(); a++)
+	  uf_union(comp, k, a->first);
+  }
+  if (C != NULL){
+	for (UF_long j = 0; j < C->n; j++)
+	  for (UF_long p = C->p[j]; p < C->p[j+1]; p++)
+		uf_union(comp, rep[C->i[p]], rep[j]);
+  }
+  vector<char> anchored(n, 0);
+  for (UF_long k = 0; k < n; k++){
+	if (rep[k] == k && !elim[k] && (keep[k] || k >= n_node))
+	  anchored[uf_find(comp, k)] = 1;
+  }
+  UF_long n_float = 0, n_red = 0, n_node_red = 0;
+  for (UF_long k = 0; k < n; k++){
+	if (rep[k] != k || elim[k])
+	  continue;
+	if (!anchored[uf_find(comp, k)]){
+	  n_float++;
+	  continue;
+	}
+	tmap.new_idx[k] = n_red++;
+	if (k < n_node)
+	  n_node_red++;
+  }
+  tmap.n_red = n_red;
+  vector<UF_long> &new_idx = tmap.new_idx;
+
+  /* rebuild G, C and B on the remaining rows */
+  UF_long nz = 0;
+  for (UF_long k = 0; k < n; k++)
+	if (new_idx[k] >= 0)
+	  nz += 1 + nb[k].size();
+  cs_dl *T = cs_dl_spalloc(n_red, n_red, nz, 1, 1);
+  for (UF_long k = 0; k < n; k++){
+	if (new_idx[k] < 0)
+	  continue;
+	if (diag[k] != 0)
+	  cs_dl_entry(T, new_idx[k], new_idx[k], diag[k]);
+	map<UF_long, pair<double, double> >::iterator a;
+	for (a = nb[k].begin(); a != nb[k].end(); a++)
+	  if (a->second.first != 0 && new_idx[a->first] >= 0)
+		cs_dl_entry(T, new_idx[k], new_idx[a->first], a->second.first);
+  }
+  cs_dl_spfree(G);
+  G = triplet_to_csc(T);
+
+  if (C != NULL){
+	T = cs_dl_spalloc(n_red, n_red, C->p[C->n], 1, 1);
+	for (UF_long j = 0; j < C->n; j++){
+	  UF_long cj = new_idx[rep[j]];
+	  for (UF_long p = C->p[j]; p < C->p[j+1]; p++){
+		UF_long ci = new_idx[rep[C->i[p]]];
+		if (ci >= 0 && cj >= 0)
+		  cs_dl_entry(T, ci, cj, C->x[p]);
+	  }
+	}
+	cs_dl_spfree(C);
+	C = triplet_to_csc(T);
+  }
+
+  T = cs_dl_spalloc(n_red, nb_col, B->p[nb_col], 1, 1);
+  for (UF_long j = 0; j < nb_col; j++){
+	for (UF_long p = B->p[j]; p < B->p[j+1]; p++){
+	  UF_long bi = new_idx[rep[B->i[p]]];
+	  if (bi >= 0)
+		cs_dl_entry(T, bi, j, B->x[p]);
+	}
+  }
+  cs_dl_spfree(B);
+  B = triplet_to_csc(T);
+
+  nNodes = n_node_red;
+  /* unprotected ports of eliminated nodes get -1 */
+  for (int i = 0; i < port.size(); i++)
+	port(i) = new_idx[rep[port(i)]];
+  for (int i = 0; i < tc_node.size(); i++)
+	tc_node[i] = new_idx[rep[tc_node[i]]];
+
+  printf("topological reduction: %ld -> %ld rows (%ld merged, %ld eliminated, %ld floating)\n",
+		 (long)n, (long)n_red, (long)n_merged, (long)n_elim, (long)n_float);
+}
+
+void topo_restore(TOPOMAP &tmap, const vec &xr, vec &x)
+{
+  UF_long n = tmap.n;
+  vector<double> xm(n, 0);
+  for (UF_long k = 0; k < n; k++)
+	if (tmap.new_idx[k] >= 0)
+	  xm[k] = xr(tmap.new_idx[k]);
+  for (UF_long k = (UF_long)tmap.elim_node.size()-1; k >= 0; k--){
+	double s = 0;
+	for (UF_long p = tmap.elim_p[k]; p < tmap.elim_p[k+1]; p++)
+	  s += tmap.elim_x[p]*xm[tmap.elim_i[p]];
+	xm[tmap.elim_node[k]] = s;
+  }
+  x.set_size(n);
+  for (UF_long k = 0; k < n; k++)
+	x(k) = xm[tmap.rep[k]];
+}
+
+int vs_fold(cs_dl *&G, cs_dl *&C, cs_dl *&B, int nNodes,
+			Source *VS, int nVS, ivec &port, vector<int> &tc_node)
+{
+  UF_long n = G->n;
+  UF_long nb_col = B->n;
+  UF_long *Gp = G->p, *Gi = G->i;
+  double *Gx = G->x;
+
+  /* source k drives row vrow[k] with B(vrow[k],k) */
+  vector<UF_long> vrow(nVS, -1), row_src(n, -1);
+  vector<double> bval(nVS, 0);
+  for (int k = 0; k < nVS && k < nb_col; k++){
+	for (UF_long p = B->p[k]; p < B->p[k+1]; p++){
+	  if (B->i[p] >= nNodes && B->x[p] != 0){
+		vrow[k] = B->i[p];
+		bval[k] = B->x[p];
+	  }
+	}
+	if (vrow[k] >= 0)
+	  row_src[vrow[k]] = k;
+  }
+
+  /* a source row with a single node entry is a grounded source */
+  vector<UF_long> row_node(n, -1), row_cnt(n, 0);
+  vector<double> row_val(n, 0);
+  for (UF_long j = 0; j < n; j++){
+	for (UF_long p = Gp[j]; p < Gp[j+1]; p++){
+	  UF_long i = Gi[p];
+	  if (row_src[i] >= 0 && Gx[p] != 0){
+		row_cnt[i]++;
+		row_node[i] = j;
+		row_val[i] = Gx[p];
+	  }
+	}
+  }
+
+  vector<int> pad_src(n, -1);
+  vector<double> pad_scale(n, 0);
+  vector<char> vfold(n, 0);
+  int n_fold = 0;
+  for (int k = 0; k < nVS; k++){
+	UF_long r = vrow[k];
+	if (r < 0 || row_cnt[r] != 1 || row_node[r] >= nNodes)
+	  continue;
+	UF_long a = row_node[r];
+	if (pad_src[a] >= 0)
+	  continue;
+	pad_src[a] = k;
+	pad_scale[a] = bval[k]/row_val[r];     /* v_a = pad_scale*u_k */
+	vfold[r] = 1;
+	n_fold++;
+  }
+  if (n_fold == 0)
+	return 0;
+
+  vector<UF_long> new_idx(n, -1);
+  UF_long n_red = 0;
+  for (UF_long i = 0; i < n; i++)
+	if (!vfold[i])
+	  new_idx[i] = n_red++;
+
+  /* G without the source rows; the pad columns go to the right hand side */
+  vector<double> pad_diag(n, 0);
+  cs_dl *T = cs_dl_spalloc(n_red, n_red, Gp[n], 1, 1);
+  cs_dl *TB = cs_dl_spalloc(n_red, nb_col, B->p[nb_col] + Gp[n], 1, 1);
+  for (UF_long j = 0; j < n; j++){
+	if (vfold[j])
+	  continue;
+	for (UF_long p = Gp[j]; p < Gp[j+1]; p++){
+	  UF_long i = Gi[p];
+	  if (vfold[i])
+		continue;
+	  if (pad_src[j] >= 0){
+		if (i == j)
+		  pad_diag[j] += Gx[p];
+		else if (pad_src[i] < 0)
+		  cs_dl_entry(TB, new_idx[i], pad_src[j], -Gx[p]*pad_scale[j]);
+		continue;
+	  }
+	  if (pad_src[i] >= 0)
+		continue;
+	  cs_dl_entry(T, new_idx[i], new_idx[j], Gx[p]);
+	}
+  }
+  for (UF_long a = 0; a < nNodes; a++){
+	if (pad_src[a] < 0)
+	  continue;
+	double d = pad_diag[a] > 0 ? pad_diag[a] : 1.0;
+	cs_dl_entry(T, new_idx[a], new_idx[a], d);
+	cs_dl_entry(TB, new_idx[a], pad_src[a], d*pad_scale[a]);
+  }
+  cs_dl_spfree(G);
+  G = triplet_to_csc(T);
+
+  for (UF_long j = 0; j < nb_col; j++){
+	for (UF_long p = B->p[j]; p < B->p[j+1]; p++){
+	  UF_long i = B->i[p];
+	  if (!vfold[i] && pad_src[i] < 0)
+		cs_dl_entry(TB, new_idx[i], j, B->x[p]);
+	}
+  }
+  cs_dl_spfree(B);
+  B = triplet_to_csc(TB);
+
+  /* C*du/dt of a constant supply is zero; a varying one loses the
+	 current through the pad capacitors */
+  if (C != NULL){
+	int n_dyn = 0;
+	T = cs_dl_spalloc(n_red, n_red, C->p[C->n], 1, 1);
+	for (UF_long j = 0; j < C->n; j++){
+	  for (UF_long p = C->p[j]; p < C->p[j+1]; p++){
+		UF_long i = C->i[p];
+		if (vfold[i] || vfold[j])
+		  continue;
+		if (pad_src[i] >= 0 || pad_src[j] >= 0){
+		  int a = pad_src[j] >= 0 ? j : i;
+		  vec &u = VS[pad_src[a]].value;
+		  if (i != j && C->x[p] != 0 && u.size() > 1 && max(u) != min(u))
+			n_dyn++;
+		  continue;
+		}
+		cs_dl_entry(T, new_idx[i], new_idx[j], C->x[p]);
+	  }
+	}
+	cs_dl_spfree(C);
+	C = triplet_to_csc(T);
+	if (n_dyn > 0)
+	  printf("Warning: %d capacitors at varying voltage sources are dropped by -vsfold\n", n_dyn);
+  }
+
+  for (int i = 0; i < port.size(); i++)
+	port(i) = new_idx[port(i)];
+  for (int i = 0; i < tc_node.size(); i++)
+	tc_node[i] = new_idx[tc_node[i]];
+
+  printf("voltage source folding: %d of %d sources, %ld -> %ld rows\n",
+		 n_fold, nVS, (long)n, (long)n_red);
+  return n_fold;
+}
+
+int is_cluster(cs_dl *&B, int nVS, Source *&IS, int &nIS,
+			   vector<int> *cl_map, vector<double> *cl_coef)
+{
+  if (nIS == 0)
+	return 0;
+
+  /* the shape of a source is its waveform over its largest value */
+  map<vector<double>, int> shape_id;
+  vector<int> cluster(nIS);
+  vector<double> coef(nIS);
+  vector<int> rep;
+  vector<double> rep_scale;
+  for (int k = 0; k < nIS; k++){
+	vec &t = IS[k].time, &v = IS[k].value;
+	double a = 0;
+	for (int j = 0; j < v.size(); j++)
+	  if (fabs(v(j)) > fabs(a))
+		a = v(j);
+	if (a == 0)
+	  a = 1;
+	vector<double> key(t.size() + v.size());
+	for (int j = 0; j < t.size(); j++)
+	  key[j] = t(j);
+	for (int j = 0; j < v.size(); j++)
+	  key[t.size()+j] = floor(v(j)/a*1e12 + 0.5)*1e-12;
+	map<vector<double>, int>::iterator it = shape_id.find(key);
+	if (it == shape_id.end()){
+	  it = shape_id.insert(make_pair(key, (int)rep.size())).first;
+	  rep.push_back(k);
+	  rep_scale.push_back(a);
+	}
+	cluster[k] = it->second;
+	coef[k] = a/rep_scale[it->second];
+  }
+  int n_cl = rep.size();
+  if (n_cl == nIS)
+	return nIS;
+  if (cl_map != NULL)
+	*cl_map = cluster;
+  if (cl_coef != NULL)
+	*cl_coef = coef;
+
+  /* column nVS+c of the new B is the weighted sum of its members,
+	 driven by the waveform of the first one */
+  cs_dl *T = cs_dl_spalloc(B->m, nVS + n_cl, B->p[B->n], 1, 1);
+  for (UF_long j = 0; j < B->n; j++){
+	for (UF_long p = B->p[j]; p < B->p[j+1]; p++){
+	  if (j < nVS)
+		cs_dl_entry(T, B->i[p], j, B->x[p]);
+	  else
+		cs_dl_entry(T, B->i[p], nVS + cluster[j-nVS], coef[j-nVS]*B->x[p]);
+	}
+  }
+  cs_dl_spfree(B);
+  B = triplet_to_csc(T);
+
+  Source *IS_cl = new Source[n_cl];
+  for (int c = 0; c < n_cl; c++)
+	IS_cl[c] = IS[rep[c]];
+  delete [] IS;
+  IS = IS_cl;
+  printf("current source clustering: %d -> %d waveforms\n", nIS, n_cl);
+  nIS = n_cl;
+  return n_cl;
+}
+
+/* BFS from root over the unnumbered nodes; returns the node of least
+   degree on the last level, depth is the number of levels */
+static UF_long bfs_last(UF_long root, const idxtype *xadj, const idxtype *adjncy,
+						const vector<char> &done, vector<UF_long> &lev,
+						vector<UF_long> &q, UF_long &depth)
+{
+  q.clear();
+  q.push_back(root);
+  lev[root] = 0;
+  for (size_t h = 0; h < q.size(); h++){
+	UF_long i = q[h];
+	for (idxtype p = xadj[i]; p < xadj[i+1]; p++){
+	  UF_long j = adjncy[p];
+	  if (!done[j] && lev[j] < 0){
+		lev[j] = lev[i] + 1;
+		q.push_back(j);
+	  }
+	}
+  }
+  depth = lev[q.back()];
+  UF_long best = q.back();
+  for (size_t k = q.size(); k > 0 && lev[q[k-1]] == depth; k--){
+	UF_long i = q[k-1];
+	if (xadj[i+1]-xadj[i] < xadj[best+1]-xadj[best])
+	  best = i;
+  }
+  for (size_t k = 0; k < q.size(); k++)
+	lev[q[k]] = -1;
+  return best;
+}
+
+struct degree_less{
+  const idxtype *xadj;
+  bool operator()(UF_long a, UF_long b) const{
+	return xadj[a+1]-xadj[a] < xadj[b+1]-xadj[b];
+  }
+};
+
+/* order[k] = old node numbered k */
+static void rcm_order(UF_long n, const idxtype *xadj, const idxtype *adjncy,
+					  vector<UF_long> &order)
+{
+  vector<char> done(n, 0);
+  vector<UF_long> lev(n, -1), q, nbr;
+  degree_less less_deg = {xadj};
+  order.clear();
+  order.reserve(n);
+  for (UF_long s = 0; s < n; s++){
+	if (done[s])
+	  continue;
+	/* start each piece at a pseudo-peripheral node */
+	UF_long depth, depth2;
+	UF_long root = bfs_last(s, xadj, adjncy, done, lev, q, depth);
+	for (int it = 0; it < 8; it++){
+	  UF_long far = bfs_last(root, xadj, adjncy, done, lev, q, depth2);
+	  if (depth2 <= depth)
+		break;
+	  depth = depth2;
+	  root = far;
+	}
+	size_t head = order.size();
+	order.push_back(root);
+	done[root] = 1;
+	for (; head < order.size(); head++){
+	  UF_long i = order[head];
+	  nbr.clear();
+	  for (idxtype p = xadj[i]; p < xadj[i+1]; p++){
+		UF_long j = adjncy[p];
+		if (!done[j]){
+		  done[j] = 1;
+		  nbr.push_back(j);
+		}
+	  }
+	  sort(nbr.begin(), nbr.end(), less_deg);
+	  order.insert(order.end(), nbr.begin(), nbr.end());
+	}
+  }
+  reverse(order.begin(), order.end());
+}
+
+static UF_long node_bandwidth(cs_dl *G, int nNodes)
+{
+  UF_long bw = 0;
+  for (UF_long j = 0; j < nNodes; j++)
+	for (UF_long p = G->p[j]; p < G->p[j+1]; p++)
+	  if (G->i[p] < nNodes)
+		bw = max(bw, G->i[p] > j ? G->i[p]-j : j-G->i[p]);
+  return bw;
+}
+
+/* A(pinv,q) with the row indices of each column sorted again */
+static cs_dl *permute_sorted(cs_dl *A, UF_long *pinv, UF_long *q)
+{
+  cs_dl *P = cs_dl_permute(A, pinv, q, 1);
+  cs_dl *T = cs_dl_transpose(P, 1);
+  cs_dl_spfree(P);
+  P = cs_dl_transpose(T, 1);
+  cs_dl_spfree(T);
+  cs_dl_spfree(A);
+  return P;
+}
+
+void mna_reorder(cs_dl *&G, cs_dl *&C, cs_dl *&B, int nNodes, int type,
+				 ivec &port, vector<int> &tc_node, vector<UF_long> &pinv,
+				 THREAD_POOL *pool)
+{
+  UF_long n = G->n;
+  pinv.resize(n);
+  for (UF_long i = 0; i < n; i++)
+	pinv[i] = i;
+  if (type == REORDER_NONE || nNodes < 2)
+	return;
+
+  idxtype *xadj, *adjncy, *vwgt;
+  build_adjacency(G, C, nNodes, xadj, adjncy, vwgt, pool);
+  vector<UF_long> order;
+  if (type == REORDER_ND){
+	int nvtxs = nNodes, numflag = 0;
+	int options[8] = {0};
+	idxtype *perm = (idxtype *) malloc(nNodes*sizeof(idxtype));
+	idxtype *iperm = (idxtype *) malloc(nNodes*sizeof(idxtype));
+	METIS_NodeND(&nvtxs, xadj, adjncy, &numflag, options, perm, iperm);
+	order.assign(perm, perm+nNodes);
+	free(perm);
+	free(iperm);
+  }else{
+	rcm_order(nNodes, xadj, adjncy, order);
+  }
+  free(xadj);
+  free(adjncy);
+  free(vwgt);
+
+  /* q[new] = old, the branch and source rows stay at the end */
+  vector<UF_long> q(n);
+  for (UF_long k = 0; k < n; k++)
+	q[k] = k < nNodes ? order[k] : k;
+  for (UF_long k = 0; k < n; k++)
+	pinv[q[k]] = k;
+
+  UF_long bw = node_bandwidth(G, nNodes);
+  G = permute_sorted(G, &pinv[0], &q[0]);
+  if (C != NULL)
+	C = permute_sorted(C, &pinv[0], &q[0]);
+  B = permute_sorted(B, &pinv[0], NULL);
+
+  for (int i = 0; i < port.size(); i++)
+	if (port(i) >= 0)
+	  port(i) = pinv[port(i)];
+  for (int i = 0; i < tc_node.size(); i++)
+	tc_node[i] = pinv[tc_node[i]];
+
+  printf("node reordering (%s): bandwidth %ld -> %ld\n",
+		 type == REORDER_ND ? "nd" : "rcm", (long)bw, (long)node_bandwidth(G, nNodes));
+}
+
+void reorder_restore(const vector<UF_long> &pinv, const vec &xr, vec &x)
+{
+  UF_long n = pinv.size();
+  x.set_size(n);
+  for (UF_long i = 0; i < n; i++)
+	x(i) = xr(pinv[i]);
+}
@@ -0,0 +1,93 @@
+/*
+*******************************************************
+
+    Cadence Extended Truncated Balanced Realization
+                (*** CadETBR ***)
+
+*******************************************************
+*/
+
+/*
+ *    $RCSfile: topo_reduce.h,v $
+ *    $Revision: 1.1 $
+ *    $Date: 2013/03/23 21:08:01 $
+ *
+ *    Functions: Topological reduction of the MNA matrices header
+ *
+ */
+
+#ifndef TOPO_REDUCE_H
+#define TOPO_REDUCE_H
+
+#include <vector>
+#include <itpp/base/vec.h>
+#include "cs.h"
+#include "etbr.h"
+
+using namespace itpp;
+using namespace std;
+
+#define DEFAULT_SHORT_R 1e-6	/* resistors below this (ohm) are merged */
+
+/* how to rebuild the voltages of the original rows from the reduced
+   solution: rep merges the shorted nodes, the eliminated rows are
+   restored in reverse order as weighted sums of their neighbours */
+typedef struct{
+  UF_long n;                 /* size of the original system */
+  UF_long n_red;             /* size of the reduced system */
+  vector<UF_long> rep;       /* n, representative row after merging shorts */
+  vector<UF_long> new_idx;   /* n, row in the reduced system, -1 if removed */
+  vector<UF_long> elim_node; /* rows in elimination order */
+  vector<UF_long> elim_p;    /* weights of elim_node[k] are elim_i/elim_x[elim_p[k]..elim_p[k+1]-1] */
+  vector<UF_long> elim_i;
+  vector<double> elim_x;
+}TOPOMAP;
+
+/* merge shorted nodes, eliminate series/dangling nodes of degree <= 2
+   and drop floating pieces without sources; G, C, B are replaced by
+   the reduced matrices, nNodes, port and tc_node are renumbered.
+   With keep_port = 0 the ports are not protected (dc, all nodes are
+   ports); the ones on eliminated nodes get -1 and the dc solution is
+   rebuilt by topo_restore() */
+void topo_reduce(cs_dl *&G, cs_dl *&C, cs_dl *&B, int &nNodes,
+				 ivec &port, vector<int> &tc_node, int keep_port,
+				 double short_r, TOPOMAP &tmap);
+
+/* x = values of all the original rows from the reduced solution xr */
+void topo_restore(TOPOMAP &tmap, const vec &xr, vec &x);
+
+/* fold the grounded voltage sources into the right hand side: the
+   source row is removed, the pad row becomes G(a,a)*v_a = G(a,a)*u
+   and the pad column moves into B, so a grid of resistors, capacitors
+   and pads gives a symmetric positive definite G of size nNodes.
+   Rows above nNodes are renumbered in port and tc_node; returns the
+   number of folded sources */
+int vs_fold(cs_dl *&G, cs_dl *&C, cs_dl *&B, int nNodes,
+			Source *VS, int nVS, ivec &port, vector<int> &tc_node);
+
+/* merge the current sources whose waveforms are the same up to a
+   scale: each group becomes one column of B (the scaled sum of its
+   columns) driven by one waveform, so B*u and the interpolation of u
+   run over the distinct waveforms only. IS is reallocated, returns the
+   new nIS; source k goes to column nVS+cl_map[k] with the weight
+   cl_coef[k] (the first source of a group has the weight 1) */
+int is_cluster(cs_dl *&B, int nVS, Source *&IS, int &nIS,
+			   vector<int> *cl_map = NULL, vector<double> *cl_coef = NULL);
+
+#define REORDER_NONE 0
+#define REORDER_RCM  1	/* reverse Cuthill-McKee, small bandwidth */
+#define REORDER_ND   2	/* METIS nested dissection */
+
+/* renumber the nodes so that coupled nodes get close row numbers and
+   the x[] accesses of SpMV and the triangular solves stay in cache;
+   the ordering is computed on the node graph of G and C, the rows
+   above nNodes keep their place. G, C and B are permuted, port and
+   tc_node renumbered (ports < 0 are skipped), pinv[old row] = new row */
+void mna_reorder(cs_dl *&G, cs_dl *&C, cs_dl *&B, int nNodes, int type,
+				 ivec &port, vector<int> &tc_node, vector<UF_long> &pinv,
+				 THREAD_POOL *pool);
+
+/* x = a full solution xr of the reordered system in the original numbering */
+void reorder_restore(const vector<UF_long> &pinv, const vec &xr, vec &x);
+
+#endif
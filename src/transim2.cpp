@@ -41,10 +41,12 @@
 #include "interp.h"
 #include "svd0.h"
 #include "cs.h"
+#include "direct_solver.h"
 
 // #define _DEBUG
 
-extern long interp2_sum;
+#define TRAN_BLOCK_MAX 256          /* time points per block in reduced_transim2 */
+#define TRAN_BLOCK_DOUBLES 4000000  /* size of the source block U */
 
 using namespace itpp;
 using namespace std;
@@ -199,19 +201,12 @@ double max_eff_resist = 0;
 #endif
 
   int nport = port.size();
-  mat Xp(nport, q);
-  if (nport > 0){
-	for(int i = 0; i < nport; i++){
-	  Xp.set_row(i, X.get_row(port(i)));
-	}
-  }
-  mat Xc(nNodes, q);
-  for(int i = 0; i < nNodes; i++){
-	Xc.set_row(i, X.get_row(tc_node[i]));
-  }
+  mat Xp, Xc;
+  get_rows(X, port, Xp);
+  get_rows(X, tc_vec, Xc);
 
-  mat XT = X.T();
-  vec xn_r = XT * xn;
+  vec xn_r(q);
+  multiply_trans(X, xn._data(), xn_r._data());
 
   /* Transient simulation */
   cs_dl *right = cs_dl_spalloc(C->m, C->n, C->nzmax, 1, 0);
@@ -590,7 +585,7 @@ double max_eff_resist = 0;
 			  }
 			  ir_run_time.stop();
 			}
-			xn_r = XT * xn1;
+			multiply_trans(X, xn1._data(), xn_r._data());
 	  
 		  } 
 		else
@@ -736,7 +731,7 @@ void reduced_transim2(cs_dl *G, cs_dl *C, cs_dl *B, Source *VS, int nVS, Source
 					double tstep, double tstop, int q, double max_i, int max_i_idx, double threshold_percentage,
 					mat &Gr, mat &Cr, mat &Br, mat &X, mat &sim_port_value,
 					const ivec &port, vector<int> &tc_node, vector<string> &tc_name, 
-					int num, int ir_info, char *ir_name)
+					int num, int ir_info, char *ir_name, SOLVER_CTX *ctx, int x_float)
 {
   Real_Timer interp2_run_time, solve_red_lu_time;	
   Real_Timer check_run_time1, check_run_time2, solveLU_run_time, sim_run_time;
@@ -773,10 +768,6 @@ void reduced_transim2(cs_dl *G, cs_dl *C, cs_dl *B, Source *VS, int nVS, Source
   
   vec w(n);
   w.zeros();
-  vec wc(nNodes);
-  wc.zeros();
-  vec w_prev(n);
-  w_prev.zeros();
   vec w_r(q);
   w_r.zeros();
   vec w_r1(q);
@@ -846,18 +837,10 @@ void reduced_transim2(cs_dl *G, cs_dl *C, cs_dl *B, Source *VS, int nVS, Source
   xn.zeros();
   vec x(n);
   x.zeros();
-  cs_dls *Symbolic;
-  cs_dln *Numeric;
-  int order = 2;
-  double tol = 1e-14;
-  Symbolic = cs_dl_sqr(order, G, 0);
-  Numeric = cs_dl_lu(G, Symbolic, tol);
-  cs_dl_ipvec(Numeric->pinv, w._data(), x._data(), n);
-  cs_dl_lsolve(Numeric->L, x._data());
-  cs_dl_usolve(Numeric->U, x._data());
-  cs_dl_ipvec(Symbolic->q, x._data(), xn._data(), n);  
-  cs_dl_sfree(Symbolic);
-  cs_dl_nfree(Numeric);
+  DSOLVER ds;
+  ds_factor(ds, G, ctx->direct_solver, ctx->pool);
+  ds_solve(ds, w._data(), xn._data());
+  ds_free(ds);
   for (int j = 0; j < port.size(); j++){
 	sim_port_value.set(j, 0, xn(port(j)));
   }
@@ -881,68 +864,38 @@ void reduced_transim2(cs_dl *G, cs_dl *C, cs_dl *B, Source *VS, int nVS, Source
 #endif
 
   int nport = port.size();
-  mat Xp(nport, q);
-  if (nport > 0){
-	for(int i = 0; i < nport; i++){
-	  Xp.set_row(i, X.get_row(port(i)));
-	}
-  }
-  mat Xc(nNodes, q);
-  for(int i = 0; i < nNodes; i++){
-	Xc.set_row(i, X.get_row(tc_node[i]));
+  mat Xp, Xc;
+  float *Xpf = NULL, *Xcf = NULL;
+  if (x_float){
+	Xpf = new float[nport*q];
+	Xcf = new float[nNodes*q];
+	get_rows(X, port, Xpf);
+	get_rows(X, tc_vec, Xcf);
+  }else{
+	get_rows(X, port, Xp);
+	get_rows(X, tc_vec, Xc);
   }
 
-  mat XT = X.T();
-  vec xn_r = XT * xn;
+  vec xn_r(q);
+  multiply_trans(X, xn._data(), xn_r._data());
 
-  double *tmp_xnr=xn_r._data();
-  // for(int j=0; j<q; j++)  printf("  x[%d]=%6.4e  cpu\n",j,tmp_xnr[j]); // XXLiu
+  /* From here on only the port and tap rows of X are needed, X is
+	 released so the simulation memory depends on the probes only */
+  X.set_size(0, 0);
+  xn.set_size(0);
+  x.set_size(0);
+  w.set_size(0);
 
   /* Transient simulation */
-  cs_dl *right = cs_dl_spalloc(C->m, C->n, C->nzmax, 1, 0);
-  for (UF_long i = 0; i < C->n+1; i++){
-	right->p[i] = C->p[i];
-  }
-  for (UF_long i = 0; i < C->nzmax; i++){
-	right->i[i] = C->i[i];
-	right->x[i] = 1/tstep*C->x[i];
-  }
-  cs_dl *left = cs_dl_add(G, right, 1, 1);
-  Symbolic = cs_dl_sqr(order, left, 0);
-  Numeric = cs_dl_lu(left, Symbolic, tol);
-  
-  cs_dl *CG = cs_dl_add(C, G, 1/tstep, 1);
-  mat CGX(nDim, q);
-  for (int j = 0; j < q; j++){
-	vec v(nDim);
-	v.zeros();
-	(void) cs_dl_gaxpy(left, X.get_col(j)._data(), v._data());
-	CGX.set_col(j, v);
-  }
-  cs_dl_spfree(CG);
-  cs_dl_spfree(left);
- 
-  mat CX(nDim, q);
-  for (int j = 0; j < q; j++){
-	vec v(nDim);
-	v.zeros();
-	(void) cs_dl_gaxpy(right, X.get_col(j)._data(), v._data());
-	CX.set_col(j, v);
-  }
-
-  mat CGXc = CGX.get_rows(tc_vec);
-  mat CXc = CX.get_rows(tc_vec);
-
-  mat right_r = 1/tstep*Cr;
+  mat right_r = integ_coef(ctx->integ_method, tstep)*Cr;
   mat left_r = Gr + right_r;
   mat l_left_r, u_left_r;
   ivec p_r;
   lu(left_r, l_left_r, u_left_r, p_r);
 
-  vec xn1(n), xn1t(n), xnr(n);;
-  xn1.zeros();
-  xn1t.zeros();
-  xnr.zeros();
+  vec xp_r = xn_r;
+  vec bu_r(q), bu0_r(q);
+  multiply(Br, u_col._data(), bu0_r._data());
   vec xn1_r(q), xn1t_r(q), b(q);
   xn1_r.zeros();
   xn1t_r.zeros();
@@ -950,16 +903,11 @@ void reduced_transim2(cs_dl *G, cs_dl *C, cs_dl *B, Source *VS, int nVS, Source
   vec xn1p(nport), xn1c(nNodes);
   xn1p.zeros();
   xn1c.zeros();
-  vec w_res(n), w_res1(n);
-  w_res.zeros();
-  w_res1.zeros();
   vec wc_res(nNodes), wc_res1(nNodes);
   wc_res.zeros();
   wc_res1.zeros();
   vec xn1c_appx(nNodes);
   xn1c_appx.zeros();
-  vec resi(n);
-  resi.zeros();
   vec resic(nNodes);
   resic.zeros();
   vec x_diff(nNodes);
@@ -983,52 +931,91 @@ void reduced_transim2(cs_dl *G, cs_dl *C, cs_dl *B, Source *VS, int nVS, Source
 
   init_time.stop();
 
-  for (int i = 1; i < ts.size(); i++){
-    for(vector<int>::iterator it = var_v.begin(); it != var_v.end(); ++it){
-      interp1(VS[*it].time, VS[*it].value, ts(i), temp, cur[*it], slope[*it]);
-      u_col(*it) = temp;
+  /* the time points go in blocks: the sources of a block are evaluated
+	 into U, Br*U and the expansion to the ports and taps are GEMMs over
+	 the block and only the q x q recurrence is stepped; U is kept
+	 around TRAN_BLOCK_DOUBLES */
+  int nblk = TRAN_BLOCK_DOUBLES/(nVS+nIS+1);
+  nblk = nblk < TRAN_BLOCK_MAX ? nblk : TRAN_BLOCK_MAX;
+  nblk = nblk > 1 ? nblk : 1;
+  mat U, W, Xr, Pb, Cb;
+  for (int i0 = 1; i0 < ts.size(); i0 += nblk){
+    int nb = ts.size() - i0 < nblk ? ts.size() - i0 : nblk;
+    U.set_size(nVS+nIS, nb);
+    Xr.set_size(q, nb);
+    interp2_run_time.start();
+    for (int k = 0; k < nb; k++){
+      int i = i0 + k;
+      for(vector<int>::iterator it = var_v.begin(); it != var_v.end(); ++it){
+        interp1(VS[*it].time, VS[*it].value, ts(i), temp, cur[*it], slope[*it]);
+        u_col(*it) = temp;
+      }
+      interp_next_step2(ts[i], IS, var_i, cur, slope, nVS, u_col);
+      U.set_col(k, u_col);
     }
-    interp_next_step2(ts[i], IS, var_i, cur, slope, nVS, u_col);
-	
     interp2_run_time.stop();
 
-    solve_red_lu_time.start();	
-    multiply(Br, u_col._data(), w_r._data());
-    w_r1 = right_r * xn_r;
-    w_r = w_r + w_r1;
-    interchange_permutations(w_r, p_r);
-    forward_substitution(l_left_r, w_r, xn1t_r);
-    backward_substitution(u_left_r, xn1t_r, xn1_r);
+    solve_red_lu_time.start();
+    W = Br * U;
+    for (int k = 0; k < nb; k++){
+      w_r = W.get_col(k);
+      bu_r = w_r;
+      if (ctx->integ_method == INTEG_TR)
+        w_r1 = right_r * xn_r - Gr * xn_r + bu0_r;
+      else if (ctx->integ_method == INTEG_BDF2)
+        w_r1 = right_r * ((4*xn_r - xp_r)/3);
+      else
+        w_r1 = right_r * xn_r;
+      w_r = w_r + w_r1;
+      bu0_r = bu_r;
+      interchange_permutations(w_r, p_r);
+      forward_substitution(l_left_r, w_r, xn1t_r);
+      backward_substitution(u_left_r, xn1t_r, xn1_r);
+      Xr.set_col(k, xn1_r);
+      xp_r = xn_r;
+      xn_r = xn1_r;
+    }
     solve_red_lu_time.stop();
+
     compute_sol_time.start();
-		
     //xn1 = X * xn1_r;
     if (nport >0){
-      xn1p = Xp * xn1_r;
-      sim_port_value.set_col(i, xn1p);
+      if (x_float){
+        Pb.set_size(nport, nb);
+        for (int k = 0; k < nb; k++)
+          multiply(Xpf, nport, q, Xr._data() + k*q, Pb._data() + k*nport);
+      }else
+        Pb = Xp * Xr;
+      sim_port_value.set_submatrix(0, i0, Pb);
     }
-    xn_r = xn1_r;
     compute_sol_time.stop();
     if (ir_info){
-      xn1c = Xc * xn1_r;
+      if (x_float){
+        Cb.set_size(nNodes, nb);
+        for (int k = 0; k < nb; k++)
+          multiply(Xcf, nNodes, q, Xr._data() + k*q, Cb._data() + k*nNodes);
+      }else
+        Cb = Xc * Xr;
       ir_run_time.start();
-      for (int j = 0; j < nNodes; j++){
-	if (max_value(j) < xn1c(j)){
-	  max_value(j) = xn1c(j);
-	}
-	if (xn1c(j) < min_value(j)){
-	  min_value(j) = xn1c(j);
-	}
-	avg_value(j) += xn1c(j);
+      for (int k = 0; k < nb; k++){
+        double *xc = Cb._data() + k*nNodes;
+        for (int j = 0; j < nNodes; j++){
+          if (max_value(j) < xc[j]){
+            max_value(j) = xc[j];
+          }
+          if (xc[j] < min_value(j)){
+            min_value(j) = xc[j];
+          }
+          avg_value(j) += xc[j];
+        }
       }
       ir_run_time.stop();
-    }		
+    }
   }
   delete [] cur;
   delete [] slope;
-  cs_dl_spfree(right);
-  cs_dl_sfree(Symbolic);
-  cs_dl_nfree(Numeric);
+  delete [] Xpf;
+  delete [] Xcf;
 
   if (ir_info){
 	ir_run_time.start();
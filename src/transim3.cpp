@@ -43,8 +43,6 @@
 
 #define _DEBUG
 
-extern long interp2_sum;
-
 using namespace itpp;
 using namespace std;
 
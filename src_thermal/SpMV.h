@@ -109,6 +109,13 @@ void SpMV_cuda(float *x, SpMatrixGPU *spm, const float *y, const  int numRows,
 void computeSpMV(float *x, const float *val, const  int *rowIndices, const  int *indices,
 		const float *y, const  int numRows);
 
+//! compute X = A * Y for a block of \p k vectors
+/*!
+  \brief X and Y are numRows x k blocks stored row-major, i.e. entry (i, c) is at [i*k+c]. The matrix is streamed once for all the columns.
+ */
+void computeSpMM(float *X, const float *val, const  int *rowIndices, const  int *indices,
+		const float *Y, const  int numRows, const int k);
+
 //! solve 
 void LUSolve(float *x, const float *l_val, const int *l_rowIndices, const int *l_indices, const float *u_val, const int *u_rowIndices, const int *u_indices, const float *y, const  int numRows);
 
@@ -36,6 +36,29 @@ void computeSpMV(float *x, const float *val,
 	}
 }
 
+// X = A * Y, X and Y are numRows x k blocks stored row-major (X[i*k+c]),
+// so every nonzero of A is loaded once for all k columns
+void computeSpMM(float *X, const float *val,
+		const int *rowIndices, const int *indices, 
+		const float *Y, const int numRows, const int k)
+{
+	int i, j, c, lb, ub;
+	for (i=0; i<numRows; i++) {
+		float *x = X + i*k;
+		for (c=0; c<k; c++)
+			x[c] = 0.0;
+		lb = rowIndices[i]; 
+		ub = rowIndices[i+1];
+
+		for (j=lb; j<ub; j++) {
+			const float a = val[j];
+			const float *y = Y + indices[j]*k;
+			for (c=0; c<k; c++)
+				x[c] += a * y[c];
+		}
+	}
+}
+
 void addTwoVec2(const float *v1, float *v2, const int num){
 	for(int i=0; i<num; ++i){
 		v2[i] += v1[i];
@@ -2163,6 +2163,183 @@ GMRES_tran(const float *val, const  int *rowIndices, const  int *indices,
 	return 1;
 }
 
+// x(:,c) += V(:,c,0:i)*y for the column c of a row-major block, see Update()
+static void Update_block(float *X, const int c, const int k, const int i,
+		const float *H, const int m, const float *s, const float *V,
+		const int n)
+{
+	float *y = (float*) malloc((i+1)*sizeof(float));
+	for (int l=0; l<i+1; l++)  
+		y[l] = s[l];
+
+	// Back substituation, H is upper triangle matrix
+	for (int l = i; l >= 0; l--) {
+		y[l] /= *(H + l + l*(m+1));
+		for (int q=l-1; q >= 0; q--)
+			y[q] -= *(H + q + l*(m+1)) * y[l];
+	}
+
+	for (int q = 0; q <= i; q++){
+		const float *v = V + q*n*k + c;
+		for (int r=0; r < n; r++)
+			X[r*k+c] += v[r*k] * y[q];
+	}
+
+	free(y);
+}
+
+// R = M.solve(B - A*X) for the whole block, beta(c) = norm of column c
+static void residual_block(float *R, float *RR, float *beta,
+		const float *val, const  int *rowIndices, const  int *indices,
+		const float *X, const float *B, const int n, const int k,
+		Preconditioner &preconditioner)
+{
+	computeSpMM(RR, val, rowIndices, indices, X, n, k);
+	for (int r=0; r<n*k; r++)
+		RR[r] = B[r] - RR[r];
+	preconditioner.HostPrecondBlock(RR, R, k);
+
+	vec_initial(beta, 0.0, k);
+	for (int r=0; r<n; r++)
+		for (int c=0; c<k; c++)
+			beta[c] += R[r*k+c] * R[r*k+c];
+	for (int c=0; c<k; c++)
+		beta[c] = sqrt(beta[c]);
+}
+
+	int 
+GMRES_tran_block(const float *val, const  int *rowIndices, const  int *indices,
+		float *X, const float *B, const  int n, const int k,
+		const  int m, const int max_iter,
+		const float tol, 
+		Preconditioner &preconditioner)// n: rowNum, k: number of rhs, m: restart threshold
+{
+	int i, j = 1, c, l, numActive;
+
+	// the Hessenberg matrix and the rotations are kept per column
+	float *s = (float*) malloc(k*(m+1)*sizeof(float));
+	float *cs = (float*) malloc(k*(m+1)*sizeof(float));
+	float *sn = (float*) malloc(k*(m+1)*sizeof(float));
+	float *H = (float*) malloc(k*((m+1)*m)*sizeof(float));
+	float *h = (float*) malloc(k*sizeof(float));
+	float *normb = (float*) malloc(k*sizeof(float));
+	float *beta = (float*) malloc(k*sizeof(float));
+	int *active = (int*) malloc(k*sizeof(int));
+
+	float *W = (float*) malloc(n*k*sizeof(float));
+	float *WW = (float*) malloc(n*k*sizeof(float));
+	float *R = (float*) malloc(n*k*sizeof(float));
+	float *V = (float*) malloc(((m+1)*n*k)*sizeof(float));
+
+	// normb = norm( M.solve(b) ) for each column
+	preconditioner.HostPrecondBlock(B, W, k);
+	vec_initial(normb, 0.0, k);
+	for (l=0; l<n; l++)
+		for (c=0; c<k; c++)
+			normb[c] += W[l*k+c] * W[l*k+c];
+	for (c=0; c<k; c++){
+		normb[c] = sqrt(normb[c]);
+		if (normb[c] == 0.0)  normb[c] = 1;
+	}
+
+	residual_block(R, WW, beta, val, rowIndices, indices, X, B, n, k, preconditioner);
+	numActive = 0;
+	for (c=0; c<k; c++){
+		active[c] = (beta[c] / normb[c] > tol);
+		numActive += active[c];
+	}
+
+	while (numActive > 0 && j <= max_iter) {
+		// v[0] = r / beta, the converged columns are carried along as zeros
+		for (l=0; l<n; l++)
+			for (c=0; c<k; c++)
+				V[l*k+c] = active[c] ? R[l*k+c] / beta[c] : 0.0;
+
+		vec_initial(s, 0.0, k*(m+1));
+		for (c=0; c<k; c++)
+			s[c*(m+1)] = beta[c];
+
+		for (i = 0; i < m && j <= max_iter && numActive > 0; i++, j++) {
+			const float *vi = V + i*n*k;
+			float *vi1 = V + (i+1)*n*k;
+
+			// w = M.solve(A * v[i]) for all the columns at once
+			computeSpMM(WW, val, rowIndices, indices, vi, n, k);
+			preconditioner.HostPrecondBlock(WW, W, k);
+
+			// modified Gram-Schmidt, column by column
+			for (l = 0; l <= i; l++) {
+				const float *vl = V + l*n*k;
+				vec_initial(h, 0.0, k);
+				for (int r=0; r<n; r++)
+					for (c=0; c<k; c++)
+						h[c] += W[r*k+c] * vl[r*k+c];
+				for (int r=0; r<n; r++)
+					for (c=0; c<k; c++)
+						W[r*k+c] -= h[c] * vl[r*k+c];
+				for (c=0; c<k; c++)
+					*(H + c*(m+1)*m + l+i*(m+1)) = h[c];
+			}
+			vec_initial(h, 0.0, k);
+			for (int r=0; r<n; r++)
+				for (c=0; c<k; c++)
+					h[c] += W[r*k+c] * W[r*k+c];
+			for (c=0; c<k; c++){
+				h[c] = sqrt(h[c]);
+				*(H + c*(m+1)*m + (i+1)+i*(m+1)) = h[c];
+				h[c] = (active[c] && h[c] != 0.0) ? 1.0/h[c] : 0.0;
+			}
+			for (int r=0; r<n; r++)
+				for (c=0; c<k; c++)
+					vi1[r*k+c] = W[r*k+c] * h[c];
+
+			for (c=0; c<k; c++){
+				if (!active[c])
+					continue;
+				float *Hc = H + c*(m+1)*m;
+				float *sc = s + c*(m+1);
+				float *csc = cs + c*(m+1);
+				float *snc = sn + c*(m+1);
+
+				for (l = 0; l < i; l++)
+					ApplyPlaneRotation( Hc+l+i*(m+1), Hc+(l+1)+i*(m+1), csc[l], snc[l]);
+
+				GeneratePlaneRotation( *(Hc+i+i*(m+1)), *(Hc+(i+1)+i*(m+1)), csc+i, snc+i);
+				ApplyPlaneRotation( Hc+i+i*(m+1), Hc+(i+1)+i*(m+1), csc[i], snc[i]);
+				ApplyPlaneRotation( sc+i, sc+(i+1), csc[i], snc[i]);
+
+				if (fabs(sc[i+1]) / normb[c] < tol) {
+					Update_block(X, c, k, i, Hc, m, sc, V, n);
+					active[c] = 0;
+					numActive--;
+				}
+			}
+		}// end of for (i = 0; i < m && j <= max_iter; i++, j++)
+
+		if (numActive == 0)
+			break;
+
+		for (c=0; c<k; c++)
+			if (active[c])
+				Update_block(X, c, k, i-1, H + c*(m+1)*m, m, s + c*(m+1), V, n);
+
+		// r = M.solve(b - A * x)
+		residual_block(R, WW, beta, val, rowIndices, indices, X, B, n, k, preconditioner);
+		numActive = 0;
+		for (c=0; c<k; c++){
+			active[c] = (beta[c] / normb[c] > tol);
+			numActive += active[c];
+		}
+	}// end of while(j <= *max_iter)
+
+	free(s); free(cs); free(sn); free(H); free(h);
+	free(normb); free(beta); free(active);
+	free(W); free(WW); free(R); free(V);
+
+	return numActive;
+}
+
+
 
 	int 
 GMRES_GPU(SpMatrixGPU *Sparse, SpMatrix *spm, dim3 *grid, dim3 *block,
@@ -341,6 +341,28 @@ GMRES_tran(const float *val, const  int *rowIndices, const  int *indices,
 		Preconditioner &preconditioner);
 
 
+//! solve the transient problem for \p k independent right-hand sides in lockstep on CPU
+/*!
+	\brief pseudo-block GMRES: every column keeps its own Arnoldi process and Hessenberg matrix, but the SpMV and the preconditioning are done as one SpMM / block apply, so \p A and the preconditioner are streamed once per iteration for all the columns. The converged columns stop being updated.
+	\param val, rowIndices, indices the matrix \p A in CSR format
+	\param X the unknown variables, n x k stored row-major (X[i*k+c]), used as the initial guess
+	\param B the rhs, n x k stored row-major
+	\param n the dimension of the matrix
+	\param k the number of right-hand sides
+	\param m restart value
+	\param max_iter the number of maximum iteration
+	\param tol the tolrance of error
+	\param preconditioner the preconditioner for the equation
+	\return 0 for success, otherwise the number of columns which did not converge
+*/
+int 
+GMRES_tran_block(const float *val, const  int *rowIndices, const  int *indices,
+		float *X, const float *B, const  int n, const int k,
+		const  int m, const int max_iter,
+		const float tol, 
+		Preconditioner &preconditioner);
+
+
 
 //! solve the single liner equation on gpu
 /*!
@@ -7,6 +7,7 @@
 #include <string.h>
 #include <math.h>
 #include <sys/time.h>
+#include <unistd.h>
 #include "config.h"
 #include "SpMV.h"
 #include "SpMV_inspect.h"
@@ -21,6 +22,7 @@
 #include <cutil_inline.h>
 
 #include "gmres.h"
+#include "uvecStream.h"
 
 
 #include "rightLookingILU.h"
@@ -38,6 +40,101 @@ extern void ainvTest();
 using namespace std;
 
 
+//! advance \p k transient scenarios sharing A, B and C in lockstep on CPU
+/*!
+	\param A the matrix G + C/h
+	\param B the input matrix
+	\param C the matrix C/h
+	\param sources the u_vec sources of the scenarios, see UVecStream
+	\param k the number of scenarios
+	\param preconditioner the preconditioner of \p A
+	\brief the states of all the scenarios are kept in one row-major numRows x k block, so each time step
+	costs one SpMM with B and C and one GMRES_tran_block solve, instead of k of each.
+	The scenarios stop at the shortest stream.
+	\return 0 for success
+*/
+static int batchedTransient(MySpMatrix &A, MySpMatrix &B, MySpMatrix &C,
+		char **sources, const int k, Preconditioner &preconditioner)
+{
+	const int restart=32, max_iter=60000;
+	const float tolerance = 1e-6;
+	int numRows = A.numRows;
+	float cputime = 0.0;
+	int result = 0;
+
+	UVecStream *u_vec_stream = new UVecStream[k];
+	int numIter = -1;
+	for(int c=0; c<k; ++c){
+		if(u_vec_stream[c].Open(sources[c]) != 0)
+			exit(-1);
+		assert(u_vec_stream[c].numElements == B.numCols);
+		if(numIter < 0 || u_vec_stream[c].numLines < numIter)
+			numIter = u_vec_stream[c].numLines;
+	}
+	prval(numIter);
+
+	float *h_U = new float[B.numCols * k];
+	float *h_X = new float[numRows * k];
+	float *h_Y = new float[numRows * k];
+	float *h_temp = new float[numRows * k];
+	for(int i=0; i<numRows*k; ++i)// guess initial soln
+		h_X[i] = 0;
+
+	for(int i=0; i<numIter; ++i){
+		printf("Debug: %dth batched simulation for CPU!\n", i);
+		// gather u_vec of all the scenarios into a row-major block
+		for(int c=0; c<k; ++c){
+			float *h_u_vec = u_vec_stream[c].Acquire();
+			if(h_u_vec == NULL){
+				numIter = i;
+				break;
+			}
+			for(int j=0; j<B.numCols; ++j)
+				h_U[j*k+c] = h_u_vec[j];
+			u_vec_stream[c].Release();
+		}
+		if(i == numIter)
+			break;
+
+		// h_temp <- B * U
+		TIME(computeSpMM(h_temp, B.val, B.rowIndices, B.indices, h_U, numRows, k), cputime);
+
+		// h_Y <- (C / h) * h_X
+		TIME(computeSpMM(h_Y, C.val, C.rowIndices, C.indices, h_X, numRows, k), cputime);
+
+		// h_Y <- B * U + (C / h) * h_X
+		TIME(addTwoVec2(h_temp, h_Y, numRows*k), cputime);
+
+		TIME( result = GMRES_tran_block(A.val, A.rowIndices, A.indices, h_X, h_Y, numRows, k, restart, max_iter, tolerance, preconditioner), cputime);
+		if(result != 0)
+			printf("%d of %d scenarios failed to converge at step %d\n", result, k, i);
+	}
+
+	// store the last state of each scenario to file
+	float *h_x = new float[numRows];
+	for(int c=0; c<k; ++c){
+		char xCPUfileName[256];
+		sprintf(xCPUfileName, "xCPU_%d.txt", c);
+		FILE *fptr_cpu = fopen(xCPUfileName, "w");
+		assert(fptr_cpu != NULL);
+		for(int j=0; j<numRows; ++j)
+			h_x[j] = h_X[j*k+c];
+		writeOutputVector(h_x, fptr_cpu, numRows);
+		fclose(fptr_cpu);
+	}
+
+	printf("Time for CPU (%d scenarios) is %fms\n", k, cputime);
+
+	delete [] u_vec_stream;
+	delete [] h_U;
+	delete [] h_X;
+	delete [] h_Y;
+	delete [] h_temp;
+	delete [] h_x;
+	return 0;
+}
+
+
 //! main function of the program
 /*!
 	\param argc number of parameters
@@ -48,6 +145,11 @@ using namespace std;
 	C.mtx 
 	u_vec.mtx 
 	t_step.mtx. 
+	argv[2] (optional): the source of u_vec instead of dirName/u_vec.mtx, see UVecStream. 
+	Use "-" to read from stdin (e.g. a FIFO) or "!command" to read the output of a live process; 
+	such a source is read once and copied to a temporary file in /tmp for the GPU run. 
+	argv[3...] (optional): more u_vec sources. With more than one source the scenarios are 
+	advanced in lockstep on CPU with GMRES_tran_block and the result of scenario c goes to xCPU_c.txt. 
 */
 int main( int argc, char** argv) 
 {
@@ -107,9 +209,11 @@ int main( int argc, char** argv)
 	 * Step 0: check the input parameters and input files*
 	 *---------------------------------------------------*/
 	// read Sparse Matrix from file or generate
-	if (argc != 2) {
+	if (argc < 2) {
 		printf("Correct Usage:\n"
-				"  gmres_SpMV dirName\n");
+				"  gmres_SpMV dirName [uVecSource ...]\n"
+				"  uVecSource: file, - (stdin) or !command; stdin and a command are\n"
+				"  read once and copied to /tmp for the GPU run\n");
 		exit(-1);
 	}
 	trace;
@@ -171,23 +275,10 @@ int main( int argc, char** argv)
 	float* h_y = (float*) malloc(memSize_col);
 	float* h_x = (float*) malloc(memSize_row); 
 
-	FILE *f;
-	// if input vector file specified, read from it
-	// otherwise, initalize with random values
-	if (argc >=3) { 
-		strcpy(ivfileName,argv[2]);
-		if ((f = fopen(ivfileName, "r")) == NULL) {
-			printf("Non-existent input vector file\n"); exit(-1);
-		}
-		else { fclose(f); }
-		// read input vector
-		readInputVector(h_y, ivfileName, numCols);
-	}
-	else{// generate a radom vector
-		for (int i = 0; i < numCols; i++){
-			//h_y[i] = rand() / (float)RAND_MAX;
-			h_y[i] = 0.5f;
-		}
+	// generate a radom vector
+	for (int i = 0; i < numCols; i++){
+		//h_y[i] = rand() / (float)RAND_MAX;
+		h_y[i] = 0.5f;
 	}
 
 
@@ -378,6 +469,14 @@ int main( int argc, char** argv)
 
 
 
+	/*-----------------------------------------------------*
+	 * Batched transient simulation of several scenarios   *
+	 *-----------------------------------------------------*/
+	if(argc > 3){
+		int numScenarios = argc - 2;
+		return batchedTransient(mySpM, mySpM_B, mySpM_C, argv+2, numScenarios, *preconditioner);
+	}
+
 	/*-----------------------------------------*
 	 * Begin the transistant simulation in CPU *
 	 *-----------------------------------------*/
@@ -388,23 +487,37 @@ int main( int argc, char** argv)
 	float *h_temp = new float[A.numRows];
 	int result;
 
-	ifstream fin_u_vec;
-	fin_u_vec.open((dirName+"/u_vec.mtx").c_str());
-	assert(!fin_u_vec.fail());
+	// u_vec is decoded by a background thread into a ring of pinned buffers,
+	// so the file parsing overlaps with the solves of the previous time steps
+	// stdin and "!command" can not be read twice: the CPU run copies the columns to a
+	// temporary binary file, which the GPU run reads instead
+	string uVecSource = (argc == 3) ? string(argv[2]) : dirName+"/u_vec.mtx";
+	string uVecReplay = uVecSource;
+	const char *uVecTee = NULL;
+	if(!UVecStream::Replayable(uVecSource.c_str())){
+		char tmpName[] = "/tmp/u_vec_XXXXXX";
+		int fd = mkstemp(tmpName);
+		if(fd < 0){
+			fprintf(stderr, "Can not create the temporary copy of u_vec\n");
+			exit(-1);
+		}
+		close(fd);
+		uVecReplay = tmpName;
+		uVecTee = uVecReplay.c_str();
+	}
+	UVecStream u_vec_stream;
+	if(u_vec_stream.Open(uVecSource.c_str(), UVEC_NUM_BUFFERS, uVecTee) != 0)
+		exit(-1);
 
-	float f_u_vec_numLines, f_u_vec_numElements;
 	int u_vec_numLines, u_vec_numElements;
-	fin_u_vec>>f_u_vec_numLines>>f_u_vec_numElements;
-	u_vec_numLines= (int)f_u_vec_numLines;
-	u_vec_numElements = (int)f_u_vec_numElements;
+	u_vec_numLines = u_vec_stream.numLines;
+	u_vec_numElements = u_vec_stream.numElements;
 
-	prval(f_u_vec_numLines);
-	prval(f_u_vec_numElements);
 	prval(u_vec_numLines);
 	prval(u_vec_numElements);
 
 
-	float *h_u_vec = new float[u_vec_numElements];
+	float *h_u_vec;
 	float *d_u_vec;
 	cudaMalloc((void**)&d_u_vec, u_vec_numElements * sizeof(float));
 
@@ -436,11 +549,16 @@ int main( int argc, char** argv)
 
 	for(int i=0; i<numIter; ++i){
 		printf("Debug: %dth simulation for CPU!\n", i);
-		// load u_vec from file 
-		loadVectorFromFile(fin_u_vec, u_vec_numElements, h_u_vec);
+		// wait for the next column of u_vec
+		h_u_vec = u_vec_stream.Acquire();
+		if(h_u_vec == NULL){
+			numIter = i;
+			break;
+		}
 
 		// h_temp <- B * u_vec
 		TIME(computeSpMV(h_temp, mySpM_B.val, mySpM_B.rowIndices, mySpM_B.indices, h_u_vec, numRows), cputime);
+		u_vec_stream.Release();
 
 		// h_y <- (C / h) * h_x
 		TIME(computeSpMV(h_y, mySpM_C.val, mySpM_C.rowIndices, mySpM_C.indices, h_x, numRows), cputime);
@@ -454,7 +572,7 @@ int main( int argc, char** argv)
 	// store h_x to file
 	writeOutputVector(h_x, fptr_cpu, numRows);
 	fclose(fptr_cpu);
-	fin_u_vec.close();
+	u_vec_stream.Close();
 	delete [] h_temp;
 
 
@@ -470,10 +588,10 @@ int main( int argc, char** argv)
 	GMRES_GPU_Data gmres_gpu_data;
 	gmres_gpu_data.Initilize(restart, numRows);
 
-	ifstream fin_u_vec_gpu;
-	fin_u_vec_gpu.open((dirName+"/u_vec.mtx").c_str());
-	assert(!fin_u_vec_gpu.fail());
-	fin_u_vec_gpu>>f_u_vec_numLines>>f_u_vec_numElements;
+	// reopen the source, or its copy, for the GPU run
+	if(u_vec_stream.Open(uVecReplay.c_str()) != 0)
+		exit(-1);
+	assert(u_vec_stream.numElements == u_vec_numElements);
 
 	char xGPUfileName[] = "xGPU.txt";
 	FILE *fptr_gpu;
@@ -488,9 +606,12 @@ int main( int argc, char** argv)
 	prval(numIter);
 	for(int i=0; i<numIter; ++i){
 		printf("Debug: %dth simulation for GPU!\n", i);
-		// load u_vec from file 
-		loadVectorFromFile(fin_u_vec_gpu, u_vec_numElements, h_u_vec);
+		// copy the next column of u_vec from the pinned ring buffer
+		h_u_vec = u_vec_stream.Acquire();
+		if(h_u_vec == NULL)
+			break;
 		cudaMemcpy(d_u_vec, h_u_vec, u_vec_numElements * sizeof(float), cudaMemcpyHostToDevice);
+		u_vec_stream.Release();
 
 		// d_temp <- B * u_vec[i]
 		TIME((SpMV<<<grid, block>>>(d_temp, mySpM_B.d_val, mySpM_B.d_rowIndices, mySpM_B.d_indices, d_u_vec, mySpM_B.numRows, mySpM_B.numCols, mySpM_B.numNZEntries)), gputime);
@@ -508,7 +629,9 @@ int main( int argc, char** argv)
 	cudaMemcpy(h_x, d_x, numRows * sizeof(float), cudaMemcpyDeviceToHost);
 	writeOutputVector(h_x, fptr_gpu, numRows);
 	fclose(fptr_gpu);
-	fin_u_vec_gpu.close();
+	u_vec_stream.Close();
+	if(uVecTee != NULL)
+		unlink(uVecTee);
 	cudaFree(d_temp);
 
 	printf("Time for CPU is %fms\n", cputime);
@@ -104,6 +104,41 @@ bool getArray1dFromStringStream(stringstream &ss, float *&val, int &dim){
 	return true;
 }
 
+void Preconditioner::HostPrecondBlock(const ValueType *i_data, ValueType *o_data, const int k){
+	ValueType *in = new ValueType[numRows];
+	ValueType *out = new ValueType[numRows];
+
+	for(int c=0; c<k; ++c){
+		for(int i=0; i<numRows; ++i)
+			in[i] = i_data[i*k+c];
+		HostPrecond(in, out);
+		for(int i=0; i<numRows; ++i)
+			o_data[i*k+c] = out[i];
+	}
+
+	delete [] in;
+	delete [] out;
+}
+
+void MyAINV::HostPrecondBlock(const ValueType *i_data, ValueType *o_data, const int k){
+
+	ValueType *temp = new ValueType[numRows*k];
+
+	// o_data = w_t * i_data
+	computeSpMM(o_data, this->z_val, this->z_rowIndices, this->z_indices, i_data, numRows, k);
+
+	// temp = D * w_t * i_data
+	for(IndexType i=0; i<numRows; ++i){
+		for(int c=0; c<k; ++c)
+			temp[i*k+c] = o_data[i*k+c] * this->diag_val[i];
+	}
+
+	// o_data= z * (D^-1) * w_t * i_data
+	computeSpMM(o_data, this->w_t_val, this->w_t_rowIndices, this->w_t_indices, temp, numRows, k);
+
+	delete [] temp;
+}
+
 void MyAINV::HostPrecond(const ValueType *i_data, ValueType *o_data){
 
 	ValueType *temp = new ValueType[numRows];
@@ -240,6 +275,46 @@ void MyILU0::HostPrecond(const ValueType *i_data, ValueType *o_data){
 	delete [] v;
 }
 
+// same substitutions as HostPrecond, each row of L and U is visited once for the k columns
+void MyILU0::HostPrecondBlock(const ValueType *i_data, ValueType *o_data, const int k){
+	float *x = o_data;
+	memcpy(x, i_data, numRows*k*sizeof(float));
+
+	// solve Lv = y, forward substitution
+	for(int i=0; i<numRows; ++i){
+		int lb = l_rowIndices[i];
+		int ub = l_rowIndices[i+1];// ub is the up bound to U, not the L matrix
+		float *xi = x + i*k;
+		for(int j=lb; j<ub && l_indices[j] < i; ++j){
+			const float a = l_val[j];
+			const float *xj = x + l_indices[j]*k;
+			for(int c=0; c<k; ++c)
+				xi[c] -= a * xj[c];
+		}
+	}
+
+	// sovle Ux = v, backward substitution
+	for(int i=numRows-1; i>=0; --i){
+		int lb = u_rowIndices[i];// lb is the low bound for the L, not U
+		int ub = u_rowIndices[i+1];
+		float *xi = x + i*k;
+		int j=ub - 1;
+		for(; j>=lb; --j){
+			if(u_indices[j] <= i){// search to the L matrix
+				break;
+			}
+			const float a = u_val[j];
+			const float *xj = x + u_indices[j]*k;
+			for(int c=0; c<k; ++c)
+				xi[c] -= a * xj[c];
+		}
+		if(j >= lb && u_indices[j] == i && !Equal(u_val[j], 0)){
+			for(int c=0; c<k; ++c)
+				xi[c] /= u_val[j];
+		}
+	}
+}
+
 void MyILU0::DevPrecond(const ValueType *i_data, ValueType *o_data){
 
 
@@ -349,6 +424,13 @@ void MyDIAG::HostPrecond(const ValueType *i_data, ValueType *o_data){
 	}
 }
 
+void MyDIAG::HostPrecondBlock(const ValueType *i_data, ValueType *o_data, const int k){
+	for(int i=0; i<numRows; ++i){
+		for(int c=0; c<k; ++c)
+			o_data[i*k+c] = i_data[i*k+c] * this->val[i];
+	}
+}
+
 __global__ 
 void diagGpu(const int numRows, const float *val, const float *i_data, float *o_data){
 	int tid = blockDim.x * blockIdx.x + threadIdx.x;
@@ -52,6 +52,15 @@ class Preconditioner{
 	*/
 	virtual void HostPrecond(const ValueType *i_data, ValueType *o_data) = 0;
 
+	//! The function used to add preconditioning operation on a block of \p k host arrays
+	/*!
+		\param i_data the data to be preconditioned, numRows x k stored row-major
+		\param o_data the data after preconditioned, numRows x k stored row-major
+		\param k number of columns in the block
+		\brief the default implementation applies HostPrecond column by column, the inherited classes override it to stream the preconditioner only once for the whole block
+	*/
+	virtual void HostPrecondBlock(const ValueType *i_data, ValueType *o_data, const int k);
+
 	//! The funciton used to add preconditioning operation on a device array
 	/*!
 		\param i_data the data to be preconditioned
@@ -92,6 +101,8 @@ class MyAINV: public Preconditioner{
 	public:
 		//! The AINV precondition for host array
 		void HostPrecond(const ValueType *i_data, ValueType *o_data);
+		//! The AINV precondition for a block of host arrays
+		void HostPrecondBlock(const ValueType *i_data, ValueType *o_data, const int k);
 		//! The AINV precondition for device array
 		void DevPrecond(const ValueType *i_data, ValueType *o_data);
 		//! The initialize operations for AINV preconditioner
@@ -120,6 +131,8 @@ class MyILU0 : public Preconditioner{
 	public:
 		//! The ILU0 value on Host side
 		void HostPrecond(const ValueType *i_data, ValueType *o_data);
+		//! The ILU0 value on Host side for a block of arrays
+		void HostPrecondBlock(const ValueType *i_data, ValueType *o_data, const int k);
 		//! The ILU0 value on Device side
 		void DevPrecond(const ValueType *i_data, ValueType *o_data);
 		//! The ILU0 initilize operations
@@ -137,6 +150,8 @@ class MyDIAG : public Preconditioner{
 	public:
 		//! diagonal preconditioning on host
 		void HostPrecond(const ValueType *i_data, ValueType *o_data);
+		//! diagonal preconditioning on host for a block of arrays
+		void HostPrecondBlock(const ValueType *i_data, ValueType *o_data, const int k);
 		//! diagonal preconditioning on device
 		void DevPrecond(const ValueType *i_data, ValueType *o_data);
 		//! initialize diagonal preconditioner
@@ -153,6 +168,10 @@ class MyNONE : public Preconditioner{
 		void HostPrecond(const ValueType *i_data, ValueType *o_data){
 			memcpy(o_data, i_data, this->numRows * sizeof(ValueType));
 		}
+		//! Just copy the block \p i_data to \p o_data
+		void HostPrecondBlock(const ValueType *i_data, ValueType *o_data, const int k){
+			memcpy(o_data, i_data, this->numRows * k * sizeof(ValueType));
+		}
 		//! Just copy \p i_data to \p o_data
 		void DevPrecond(const ValueType *i_data, ValueType *o_data){
 			cudaMemcpy(o_data, i_data, this->numRows * sizeof(float), cudaMemcpyDeviceToDevice);
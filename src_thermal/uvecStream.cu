@@ -0,0 +1,343 @@
+/*!	\file
+	\brief implement the class of UVecStream, which reads u_vec in a background thread
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <cuda_runtime_api.h>
+#include "uvecStream.h"
+
+UVecStream::UVecStream(): numLines(0), numElements(0), fd(-1), pid(-1), rbuf(NULL), rpos(0), rlen(0), isBinary(0),
+	tee(NULL), numTeed(0), numBuffers(0), buffers(NULL), pinned(0), head(0), count(0), numRead(0), eof(0), stop(0),
+	threadStarted(0)
+{
+	pthread_mutex_init(&mutex, NULL);
+	pthread_cond_init(&notEmpty, NULL);
+	pthread_cond_init(&notFull, NULL);
+	wake[0] = wake[1] = -1;
+}
+
+UVecStream::~UVecStream(){
+	Close();
+	pthread_mutex_destroy(&mutex);
+	pthread_cond_destroy(&notEmpty);
+	pthread_cond_destroy(&notFull);
+}
+
+int UVecStream::Replayable(const char *source){
+	return source[0] != '!' && strcmp(source, "-") != 0;
+}
+
+int UVecStream::Open(const char *source, int numBuffers, const char *teeFile){
+	Close();
+
+	if(source[0] == '!'){
+		int out[2];
+		if(pipe(out) == 0){
+			pid = fork();
+			if(pid == 0){
+				dup2(out[1], 1);
+				close(out[0]);
+				close(out[1]);
+				execl("/bin/sh", "sh", "-c", source + 1, (char *)NULL);
+				_exit(127);
+			}
+			close(out[1]);
+			if(pid < 0)
+				close(out[0]);
+			else
+				fd = out[0];
+		}
+	}
+	else if(strcmp(source, "-") == 0)
+		fd = 0;
+	else
+		fd = open(source, O_RDONLY);
+	if(fd < 0 || pipe(wake) != 0){
+		fprintf(stderr, "Can not open u_vec source %s\n", source);
+		Close();
+		return -1;
+	}
+	rbuf = new char[UVEC_READ_SIZE];
+	rpos = rlen = 0;
+
+	if(readHeader() != 0){
+		fprintf(stderr, "Invalid u_vec header in %s\n", source);
+		Close();
+		return -1;
+	}
+
+	if(teeFile != NULL){
+		int header[2] = {numLines, numElements};
+		tee = fopen(teeFile, "wb");
+		if(tee == NULL || fwrite(UVEC_BIN_MAGIC, 1, 4, tee) != 4 || fwrite(header, sizeof(int), 2, tee) != 2){
+			fprintf(stderr, "Can not write the copy of u_vec to %s\n", teeFile);
+			Close();
+			return -1;
+		}
+		numTeed = 0;
+	}
+
+	this->numBuffers = numBuffers < 2 ? 2 : numBuffers;
+	buffers = new float*[this->numBuffers];
+	pinned = 1;
+	for(int i=0; i<this->numBuffers; ++i){
+		// page-locked buffers let cudaMemcpy skip the staging copy; fall back to pageable memory
+		if(pinned && cudaHostAlloc((void**)&buffers[i], numElements*sizeof(float), cudaHostAllocDefault) != cudaSuccess){
+			cudaGetLastError();
+			for(int j=0; j<i; ++j)
+				cudaFreeHost(buffers[j]);
+			pinned = 0;
+			i = -1;
+			continue;
+		}
+		if(!pinned)
+			buffers[i] = (float*)malloc(numElements*sizeof(float));
+	}
+
+	head = count = numRead = 0;
+	eof = stop = 0;
+	if(pthread_create(&thread, NULL, readerEntry, this) != 0){
+		fprintf(stderr, "Can not create the u_vec reader thread\n");
+		Close();
+		return -1;
+	}
+	threadStarted = 1;
+	return 0;
+}
+
+// refill rbuf; 0 at the end of the source, -1 on an error or when Close() wakes the reader
+int UVecStream::fill(){
+	for(;;){
+		struct pollfd p[2];
+		p[0].fd = fd;
+		p[0].events = POLLIN;
+		p[1].fd = wake[0];
+		p[1].events = POLLIN;
+		if(poll(p, 2, -1) < 0){
+			if(errno == EINTR)
+				continue;
+			return -1;
+		}
+		if(p[1].revents)
+			return -1;
+		int n = read(fd, rbuf, UVEC_READ_SIZE);
+		if(n < 0 && (errno == EINTR || errno == EAGAIN))
+			continue;
+		if(n <= 0)
+			return n;
+		rpos = 0;
+		rlen = n;
+		return n;
+	}
+}
+
+int UVecStream::getByte(){
+	if(rpos == rlen && fill() <= 0)
+		return -1;
+	return (unsigned char)rbuf[rpos++];
+}
+
+int UVecStream::readBytes(void *p, int n){
+	char *dst = (char *)p;
+	while(n > 0){
+		if(rpos == rlen && fill() <= 0)
+			return -1;
+		int k = rlen - rpos < n ? rlen - rpos : n;
+		memcpy(dst, rbuf + rpos, k);
+		rpos += k;
+		dst += k;
+		n -= k;
+	}
+	return 0;
+}
+
+// one whitespace separated ascii number
+int UVecStream::readFloat(float *f){
+	char tok[64];
+	int c, len = 0;
+	do
+		c = getByte();
+	while(c == ' ' || c == '\t' || c == '\n' || c == '\r');
+	while(c != -1 && c != ' ' && c != '\t' && c != '\n' && c != '\r'){
+		if(len == (int)sizeof(tok) - 1)
+			return -1;
+		tok[len++] = c;
+		c = getByte();
+	}
+	if(len == 0)
+		return -1;
+	tok[len] = 0;
+	char *end;
+	*f = strtof(tok, &end);
+	return *end == 0 ? 0 : -1;
+}
+
+int UVecStream::readHeader(){
+	if(rpos == rlen && fill() <= 0)
+		return -1;
+
+	if(rbuf[rpos] == UVEC_BIN_MAGIC[0]){
+		char magic[4];
+		int header[2];
+		if(readBytes(magic, 4) != 0 || strncmp(magic, UVEC_BIN_MAGIC, 4) != 0)
+			return -1;
+		if(readBytes(header, 2*sizeof(int)) != 0)
+			return -1;
+		isBinary = 1;
+		numLines = header[0];
+		numElements = header[1];
+	}
+	else{
+		// the ascii header is written by matlab as floats
+		float f_numLines, f_numElements;
+		if(readFloat(&f_numLines) != 0 || readFloat(&f_numElements) != 0)
+			return -1;
+		isBinary = 0;
+		numLines = (int)f_numLines;
+		numElements = (int)f_numElements;
+	}
+	return (numLines >= 0 && numElements > 0) ? 0 : -1;
+}
+
+int UVecStream::readColumn(float *vec){
+	if(isBinary)
+		return readBytes(vec, numElements*sizeof(float));
+
+	for(int i=0; i<numElements; ++i){
+		if(readFloat(&vec[i]) != 0)
+			return -1;
+	}
+	return 0;
+}
+
+void *UVecStream::readerEntry(void *arg){
+	((UVecStream *)arg)->readerLoop();
+	return NULL;
+}
+
+void UVecStream::readerLoop(){
+	int tail = 0;
+	while(numRead < numLines){
+		pthread_mutex_lock(&mutex);
+		while(count == numBuffers && !stop)
+			pthread_cond_wait(&notFull, &mutex);
+		int quit = stop;
+		pthread_mutex_unlock(&mutex);
+		if(quit)
+			break;
+
+		// decode outside of the lock, the slot at tail is owned by the reader until count is raised
+		if(readColumn(buffers[tail]) != 0){
+			pthread_mutex_lock(&mutex);
+			quit = stop;
+			pthread_mutex_unlock(&mutex);
+			if(!quit)
+				fprintf(stderr, "u_vec stream ended after %d of %d columns\n", numRead, numLines);
+			break;
+		}
+		if(tee != NULL){
+			if(fwrite(buffers[tail], sizeof(float), numElements, tee) != (size_t)numElements){
+				fprintf(stderr, "Can not write the copy of u_vec after %d columns\n", numTeed);
+				closeTee();
+			}
+			else
+				++numTeed;
+		}
+
+		pthread_mutex_lock(&mutex);
+		++numRead;
+		++count;
+		pthread_cond_signal(&notEmpty);
+		pthread_mutex_unlock(&mutex);
+		tail = (tail + 1) % numBuffers;
+	}
+
+	pthread_mutex_lock(&mutex);
+	eof = 1;
+	pthread_cond_signal(&notEmpty);
+	pthread_mutex_unlock(&mutex);
+}
+
+float *UVecStream::Acquire(){
+	pthread_mutex_lock(&mutex);
+	while(count == 0 && !eof)
+		pthread_cond_wait(&notEmpty, &mutex);
+	float *vec = count > 0 ? buffers[head] : NULL;
+	pthread_mutex_unlock(&mutex);
+	return vec;
+}
+
+void UVecStream::Release(){
+	pthread_mutex_lock(&mutex);
+	if(count > 0){
+		head = (head + 1) % numBuffers;
+		--count;
+		pthread_cond_signal(&notFull);
+	}
+	pthread_mutex_unlock(&mutex);
+}
+
+// the header gets the number of columns really copied, so that a replay ends where the source did
+void UVecStream::closeTee(){
+	if(tee == NULL)
+		return;
+	if(fseek(tee, 4, SEEK_SET) == 0)
+		fwrite(&numTeed, sizeof(int), 1, tee);
+	fclose(tee);
+	tee = NULL;
+}
+
+void UVecStream::Close(){
+	if(threadStarted){
+		pthread_mutex_lock(&mutex);
+		stop = 1;
+		pthread_cond_signal(&notFull);
+		pthread_mutex_unlock(&mutex);
+		// wakes the reader if it waits on a producer that neither writes nor closes
+		char c = 0;
+		if(write(wake[1], &c, 1) != 1)
+			fprintf(stderr, "Can not wake the u_vec reader thread\n");
+		pthread_join(thread, NULL);
+		threadStarted = 0;
+	}
+	closeTee();
+
+	if(fd > 0)
+		close(fd);
+	fd = -1;
+	if(pid > 0){
+		// a producer still writing would block on the closed pipe or never exit
+		if(waitpid(pid, NULL, WNOHANG) == 0){
+			kill(pid, SIGTERM);
+			waitpid(pid, NULL, 0);
+		}
+		pid = -1;
+	}
+	for(int i=0; i<2; ++i){
+		if(wake[i] >= 0)
+			close(wake[i]);
+		wake[i] = -1;
+	}
+	delete [] rbuf;
+	rbuf = NULL;
+	rpos = rlen = 0;
+
+	if(buffers != NULL){
+		for(int i=0; i<numBuffers; ++i){
+			if(pinned)
+				cudaFreeHost(buffers[i]);
+			else
+				free(buffers[i]);
+		}
+		delete [] buffers;
+		buffers = NULL;
+	}
+	numBuffers = 0;
+}
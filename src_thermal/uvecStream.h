@@ -0,0 +1,113 @@
+/*!	\file
+	\brief declare the class used to stream the input vectors u_vec for the transient simulation
+ */
+
+#ifndef UVECSTREAM_H_
+#define UVECSTREAM_H_
+
+#include <stdio.h>
+#include <sys/types.h>
+#include <pthread.h>
+
+//! magic word at the head of a binary u_vec file
+#define UVEC_BIN_MAGIC "UVEC"
+
+//! default number of buffers in the ring
+#define UVEC_NUM_BUFFERS 3
+
+//! size of the read buffer of the source
+#define UVEC_READ_SIZE 65536
+
+//! Stream the columns of u_vec from disk (or a live producer) with a background reader thread.
+/*!
+  \brief The reader thread decodes one column at a time into a ring of host buffers while the
+  solver consumes the previous ones, so parsing the (usually large) ASCII file no longer
+  sits between two time steps. The buffers are page-locked when the CUDA runtime allows it,
+  so that the copy to the device can be issued directly from them.
+
+  Supported sources:
+	- "file.mtx": ASCII, header "numLines numElements" followed by the values, as before
+	- "file.bin": binary, "UVEC" + int32 numLines + int32 numElements followed by float32 values
+	- "-": the same (ASCII or binary) stream read from stdin, e.g. a FIFO fed by another program
+	- "!command": the standard output of a local process started with /bin/sh -c
+
+  The format of stdin and of a process output is detected from the first 4 bytes.
+  Those two can only be read once; Open() can tee the decoded columns to a binary file
+  that is opened instead for a second pass.
+ */
+class UVecStream{
+	public:
+		int numLines;		//!< number of time steps (columns) in the stream
+		int numElements;	//!< number of entries of each column
+
+		UVecStream();
+		~UVecStream();
+
+		//! open \p source and start the reader thread
+		/*!
+		  \param source the file name, "-" or "!command", see above
+		  \param numBuffers number of buffers in the ring, at least 2
+		  \param teeFile if not NULL, every decoded column is also written to this file in the binary format
+		  \return 0 on success, -1 if the source can not be opened or the header is invalid
+		 */
+		int Open(const char *source, int numBuffers = UVEC_NUM_BUFFERS, const char *teeFile = NULL);
+
+		//! whether \p source can be opened a second time with the same content
+		static int Replayable(const char *source);
+
+		//! wait until the next column is decoded
+		/*!
+		  \return the pointer to the (pinned) host buffer holding the column, NULL if the stream ended early.
+		  The buffer stays valid until Release() is called.
+		 */
+		float *Acquire();
+
+		//! give back the buffer returned by the last Acquire() to the reader thread
+		void Release();
+
+		//! stop the reader thread, close the source and free the buffers
+		/*!
+		  The reader waits in poll() on the source and on a wake-up pipe, so Close() does not
+		  hang on a producer that stops writing without closing; a "!command" that is still
+		  running is terminated.
+		 */
+		void Close();
+
+	private:
+		int fd;		// the source, read through rbuf
+		pid_t pid;	// the process of "!command", -1 otherwise
+		int wake[2];	// written by Close() to interrupt the reader
+		char *rbuf;
+		int rpos, rlen;
+		int isBinary;
+		FILE *tee;	// copy of the decoded columns, see Open()
+		int numTeed;
+
+		int numBuffers;
+		float **buffers;
+		int pinned;
+
+		int head;	// next buffer to be consumed
+		int count;	// number of decoded buffers waiting for the consumer
+		int numRead;	// number of columns decoded by the reader
+		int eof;	// the reader thread has finished
+		int stop;	// asked to finish by Close()
+
+		pthread_t thread;
+		int threadStarted;
+		pthread_mutex_t mutex;
+		pthread_cond_t notEmpty;
+		pthread_cond_t notFull;
+
+		int fill();
+		int getByte();
+		int readBytes(void *p, int n);
+		int readFloat(float *f);
+		int readHeader();
+		int readColumn(float *vec);
+		void closeTee();
+		static void *readerEntry(void *arg);
+		void readerLoop();
+};
+
+#endif